@@ -0,0 +1,35 @@
+dnl ---------------------------------------------------------------------------
+dnl Macro: AC_CHECK_URING
+dnl Check for Linux io_uring availability on the target system. The io_uring
+dnl interface is used directly through system calls, so only kernel headers
+dnl are required.
+dnl ---------------------------------------------------------------------------
+
+AC_DEFUN([AC_CHECK_URING],[
+if test x$enable_uring = xyes; then
+    AC_CHECK_HEADER([linux/io_uring.h], , [enable_uring=no])
+fi
+if test x$enable_uring = xyes; then
+    AC_MSG_CHECKING(if io_uring system calls and fixed buffers are available)
+    AC_COMPILE_IFELSE([AC_LANG_PROGRAM(
+                       [[
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+                       ]],
+                       [[
+struct io_uring_params p;
+(void)p;
+return __NR_io_uring_setup + __NR_io_uring_enter + __NR_io_uring_register +
+  IORING_OP_READ_FIXED + IORING_REGISTER_FILES + IORING_SETUP_SQPOLL;
+                       ]] )
+    ], [
+        AC_DEFINE([HAVE_IO_URING], 1, [Define to 1 if Linux io_uring is available])
+        AC_MSG_RESULT(yes)
+       ],
+    [
+        enable_uring=no
+        AC_MSG_RESULT(no)
+    ]
+    )
+fi
+])
@@ -129,6 +129,25 @@ enum mysql_option opt = MYSQL_OPT_SSL_MODE;
                     [Define to 1 if mysql.h defines MYSQL_OPT_SSL_MODE])
           AC_MSG_RESULT([yes])
           ], [AC_MSG_RESULT([no])])
+
+AC_MSG_CHECKING([if the client library provides the non-blocking API])
+
+SAVE_LIBS="${LIBS}"
+LIBS="${LIBS} ${MYSQL_LIBS}"
+AC_LINK_IFELSE([AC_LANG_PROGRAM(
+        [[
+#include <mysql.h>
+        ]], [[
+enum mysql_option opt = MYSQL_OPT_NONBLOCK;
+int err;
+(void) opt;
+return mysql_real_query_start(&err, NULL, "", 0);
+        ]])], [
+          AC_DEFINE([HAVE_MYSQL_OPT_NONBLOCK], 1,
+                    [Define to 1 if the MySQL client library provides the non-blocking API])
+          AC_MSG_RESULT([yes])
+          ], [AC_MSG_RESULT([no])])
+LIBS="${SAVE_LIBS}"
 ])
 CFLAGS="${SAVE_CFLAGS}"
 
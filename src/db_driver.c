@@ -24,6 +24,8 @@
 # include <ctype.h>
 # include <inttypes.h>
 # include <stdbool.h>
+# include <stdarg.h>
+# include <stdio.h>
 #endif
 #ifdef HAVE_STRING_H
 # include <string.h>
@@ -38,13 +40,44 @@
 #include "sb_list.h"
 #include "sb_histogram.h"
 #include "sb_ck_pr.h"
+#include "sb_poll.h"
+#include "sb_util.h"
+#include "sb_rand.h"
+#include "sb_timer.h"
 
 /* Query length limit for bulk insert queries */
 #define BULK_PACKET_SIZE (512*1024)
 
+/* Maximum length of a printed 64-bit integer */
+#define DB_INT_STR_SIZE 24
+
+/* Templates of c and pad column values of sysbench tables */
+#define SBTEST_C_TEMPLATE "###########-###########-###########-"  \
+  "###########-###########-###########-"                          \
+  "###########-###########-###########-"                          \
+  "###########"
+#define SBTEST_PAD_TEMPLATE "###########-###########-###########-"        \
+  "###########-###########"
+
+#define SBTEST_C_LEN (sizeof(SBTEST_C_TEMPLATE) - 1)
+#define SBTEST_PAD_LEN (sizeof(SBTEST_PAD_TEMPLATE) - 1)
+
+/* Maximum length of a generated sysbench table row */
+#define SBTEST_ROW_SIZE (2 * DB_INT_STR_SIZE + SBTEST_C_LEN + SBTEST_PAD_LEN + 16)
+
+/*
+  Maximum number of rows loaded by a single bulk load statement, which is also
+  a single transaction
+*/
+#define LOAD_BATCH_ROWS 100000U
+
 /* How many rows to insert before COMMITs (used in bulk insert) */
 #define ROWS_BEFORE_COMMIT 1000
 
+/* Range of connect latencies to track, in milliseconds */
+#define CONNECT_LAT_MIN 1e-3
+#define CONNECT_LAT_MAX 1e5
+
 /* Global variables */
 db_globals_t db_globals CK_CC_CACHELINE;
 
@@ -59,6 +92,18 @@ static pthread_once_t db_global_once = PTHREAD_ONCE_INIT;
 static sb_timer_t *exec_timers;
 static sb_timer_t *fetch_timers;
 
+/*
+  Statistics of connections established while running a benchmark, i.e. after
+  the warmup and not counting ones created by thread_init()
+*/
+static sb_histogram_t connect_histogram;
+static uint64_t       connect_count;
+static uint64_t       connect_time_ns;
+/* Values as of the last intermediate and cumulative reports */
+static uint64_t       interm_connect_count;
+static uint64_t       cumul_connect_count;
+static uint64_t       cumul_connect_time_ns;
+
 /* Static functions */
 
 static int db_parse_arguments(void);
@@ -67,7 +112,12 @@ static void db_free_row(db_row_t *);
 #endif
 static int db_bulk_do_insert(db_conn_t *, int);
 static void db_reset_stats(void);
+static bool db_conn_busy(db_conn_t *);
+static db_result_t *db_op_done(db_conn_t *, db_result_t *);
+static db_emu_query_t *db_emu_parse(const char *);
 static int db_free_results_int(db_conn_t *con);
+static uint64_t db_time_ns(void);
+static void db_pool_free(db_pool_t *);
 
 /* DB layer arguments */
 
@@ -84,6 +134,12 @@ static sb_arg_t db_args[] =
   SB_OPT("db-ps-mode", "prepared statements usage mode {auto, disable}", "auto",
          STRING),
   SB_OPT("db-debug", "print database-specific debug information", "off", BOOL),
+  SB_OPT("db-stream-results", "fetch result sets from the server row by row "
+         "rather than buffering them in client memory", "off", BOOL),
+  SB_OPT("db-pool-size", "maximum number of connections in connection pools "
+         "opened by scripts, 0 disables pooling", "0", INT),
+  SB_OPT("db-pool-scope", "connection pools scope {thread, global}",
+         "thread", STRING),
 
   SB_OPT_END
 };
@@ -187,6 +243,11 @@ static void db_init(void)
     fetch_timers = sb_alloc_per_thread_array(sizeof(sb_timer_t));
   }
 
+  if (sb_histogram_init_hdr(&connect_histogram,
+                            sb_get_value_int("histogram-precision"),
+                            CONNECT_LAT_MIN, CONNECT_LAT_MAX))
+    return;
+
   db_reset_stats();
 
   enable_print_stats();
@@ -293,10 +354,31 @@ int db_describe(db_driver_t *drv, drv_caps_t *caps)
 }
 
 
+/* Account a connection established at a given time */
+
+
+static void db_connect_done(uint64_t start)
+{
+  uint64_t ns;
+
+  /* Only account connections made by running events */
+  if (sb_globals.threads_running == 0 ||
+      sb_timer_value(&sb_exec_timer) < SEC2NS(sb_globals.warmup_time))
+    return;
+
+  ns = db_time_ns() - start;
+
+  ck_pr_inc_64(&connect_count);
+  ck_pr_add_64(&connect_time_ns, ns);
+  sb_histogram_update(&connect_histogram, NS2MS(ns));
+}
+
+
 /* Connect to database */
 
 
-db_conn_t *db_connection_create(db_driver_t *drv)
+static db_conn_t *db_connection_create_int(db_driver_t *drv,
+                                           db_conn_role_t role, bool async)
 {
   db_conn_t *con;
 
@@ -308,19 +390,67 @@ db_conn_t *db_connection_create(db_driver_t *drv)
 
   con->driver = drv;
   con->state = DB_CONN_READY;
+  con->async = async;
+  con->async_fd = -1;
+  con->role = role;
 
   con->thread_id =  sb_tls_thread_id;
 
+  const uint64_t start = db_time_ns();
+
   if (drv->ops.connect(con))
   {
     free(con);
     return NULL;
   }
 
+  db_connect_done(start);
+
   return con;
 }
 
 
+db_conn_t *db_connection_create(db_driver_t *drv)
+{
+  return db_connection_create_int(drv, DB_ROLE_ANY, false);
+}
+
+
+/* Create a non-blocking connection */
+
+
+db_conn_t *db_connection_create_async(db_driver_t *drv)
+{
+  return db_connection_create_role(drv, DB_ROLE_ANY, true);
+}
+
+
+/* Connect to a server with a given role */
+
+
+db_conn_t *db_connection_create_role(db_driver_t *drv, db_conn_role_t role,
+                                     bool async)
+{
+  if (async && drv->ops.async_continue == NULL)
+  {
+    log_text(LOG_FATAL, "non-blocking connections are not supported by the "
+             "'%s' driver", drv->sname);
+    return NULL;
+  }
+
+  return db_connection_create_int(drv, role, async);
+}
+
+
+/* Check if non-blocking connections are supported by a driver */
+
+
+bool db_async_supported(db_driver_t *drv)
+{
+  return drv->ops.async_continue != NULL;
+}
+
+
 /* Disconnect from database */
 
 
@@ -369,6 +499,8 @@ int db_connection_reconnect(db_conn_t *con)
     db_free_results_int(con);
   }
 
+  const uint64_t start = db_time_ns();
+
   rc = drv->ops.reconnect(con);
 
   if (rc == DB_ERROR_FATAL)
@@ -380,6 +512,7 @@ int db_connection_reconnect(db_conn_t *con)
   {
     con->state = DB_CONN_READY;
     sb_counter_inc(con->thread_id, SB_CNT_RECONNECT);
+    db_connect_done(start);
 
     /* Clear DB_ERROR_IGNORABLE */
     rc = DB_ERROR_NONE;
@@ -399,6 +532,165 @@ void db_connection_free(db_conn_t *con)
 }
 
 
+/* Allocate a connection pool */
+
+
+static db_pool_t *db_pool_new(db_driver_t *drv, unsigned int size,
+                              bool shared)
+{
+  db_pool_t *pool;
+
+  pool = (db_pool_t *) calloc(1, sizeof(db_pool_t));
+  if (pool == NULL)
+    return NULL;
+
+  pool->idle = (db_conn_t **) calloc(size, sizeof(db_conn_t *));
+  if (pool->idle == NULL)
+  {
+    free(pool);
+    return NULL;
+  }
+
+  pool->driver = drv;
+  pool->size = size;
+  pool->shared = shared;
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+
+  return pool;
+}
+
+
+/* Open a connection pool */
+
+
+db_pool_t *db_pool_open(db_driver_t *drv, unsigned int size)
+{
+  if (size > 0)
+    return db_pool_new(drv, size, false);
+
+  if (db_globals.pool_size == 0)
+  {
+    log_text(LOG_FATAL, "connection pooling is disabled, use --db-pool-size");
+    return NULL;
+  }
+
+  if (!db_globals.pool_global)
+    return db_pool_new(drv, db_globals.pool_size, false);
+
+  pthread_mutex_lock(&drv->mutex);
+  if (drv->pool == NULL)
+    drv->pool = db_pool_new(drv, db_globals.pool_size, true);
+  pthread_mutex_unlock(&drv->mutex);
+
+  return drv->pool;
+}
+
+
+/* Check out a connection from a pool */
+
+
+db_conn_t *db_pool_checkout(db_pool_t *pool)
+{
+  db_conn_t *con = NULL;
+
+  if (pool->shared)
+    pthread_mutex_lock(&pool->mutex);
+
+  while (pool->nidle == 0 && pool->nopen >= pool->size)
+  {
+    if (!pool->shared)
+    {
+      log_text(LOG_FATAL, "all %u connections of the pool are checked out",
+               pool->size);
+      return NULL;
+    }
+
+    pthread_cond_wait(&pool->cond, &pool->mutex);
+  }
+
+  if (pool->nidle > 0)
+    con = pool->idle[--pool->nidle];
+  else
+    pool->nopen++;
+
+  if (pool->shared)
+    pthread_mutex_unlock(&pool->mutex);
+
+  if (con != NULL)
+  {
+    /* Account statistics to the current thread */
+    con->thread_id = sb_tls_thread_id;
+    return con;
+  }
+
+  /* Connect without holding the lock */
+  if ((con = db_connection_create(pool->driver)) == NULL)
+    db_pool_checkin(pool, NULL);
+
+  return con;
+}
+
+
+/* Return a connection to a pool */
+
+
+int db_pool_checkin(db_pool_t *pool, db_conn_t *con)
+{
+  /* Do not keep closed connections, as well as results of the last query */
+  if (con != NULL && con->state == DB_CONN_INVALID)
+  {
+    db_connection_free(con);
+    con = NULL;
+  }
+  else if (con != NULL && con->state == DB_CONN_RESULT_SET)
+    db_free_results_int(con);
+
+  if (pool->shared)
+    pthread_mutex_lock(&pool->mutex);
+
+  if (con != NULL)
+    pool->idle[pool->nidle++] = con;
+  else
+    pool->nopen--;
+
+  if (pool->shared)
+  {
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  return 0;
+}
+
+
+/* Free a pool and its idle connections */
+
+
+static void db_pool_free(db_pool_t *pool)
+{
+  while (pool->nidle > 0)
+    db_connection_free(pool->idle[--pool->nidle]);
+
+  pthread_cond_destroy(&pool->cond);
+  pthread_mutex_destroy(&pool->mutex);
+
+  free(pool->idle);
+  free(pool);
+}
+
+
+/* Close a thread-local connection pool */
+
+
+void db_pool_close(db_pool_t *pool)
+{
+  if (!pool->shared)
+    db_pool_free(pool);
+}
+
+
 /* Prepare statement */
 
 
@@ -411,6 +703,8 @@ db_stmt_t *db_prepare(db_conn_t *con, const char *query, size_t len)
     log_text(LOG_ALERT, "attempt to use an already closed connection");
     return NULL;
   }
+  else if (db_conn_busy(con))
+    return NULL;
 
   stmt = (db_stmt_t *)calloc(1, sizeof(db_stmt_t));
   if (stmt == NULL)
@@ -425,6 +719,13 @@ db_stmt_t *db_prepare(db_conn_t *con, const char *query, size_t len)
     return NULL;
   }
 
+  if (stmt->emulated && (stmt->emu = db_emu_parse(stmt->query)) == NULL)
+  {
+    con->error = DB_ERROR_FATAL;
+    db_close(stmt);
+    return NULL;
+  }
+
   return stmt;
 }
 
@@ -441,6 +742,8 @@ int db_bind_param(db_stmt_t *stmt, db_bind_t *params, size_t len)
     log_text(LOG_ALERT, "attempt to use an already closed connection");
     return 1;
   }
+  else if (db_conn_busy(con))
+    return 1;
 
   return con->driver->ops.bind_param(stmt, params, len);
 }
@@ -477,6 +780,8 @@ db_result_t *db_execute(db_stmt_t *stmt)
     log_text(LOG_ALERT, "attempt to use an already closed connection");
     return NULL;
   }
+  else if (db_conn_busy(con))
+    return NULL;
   else if (con->state == DB_CONN_RESULT_SET &&
            (rc = db_free_results_int(con)) != 0)
   {
@@ -485,23 +790,10 @@ db_result_t *db_execute(db_stmt_t *stmt)
 
   rs->statement = stmt;
 
+  con->async_events = 0;
   con->error = con->driver->ops.execute(stmt, rs);
 
-  sb_counter_inc(con->thread_id, rs->counter);
-
-  if (SB_LIKELY(con->error == DB_ERROR_NONE))
-  {
-    if (rs->counter == SB_CNT_READ)
-    {
-      con->state = DB_CONN_RESULT_SET;
-      return rs;
-    }
-    con->state = DB_CONN_READY;
-
-    return NULL;
-  }
-
-  return NULL;
+  return db_op_done(con, rs);
 }
 
 /* Retrieve the next result of a prepared statement */
@@ -517,6 +809,8 @@ db_result_t *db_stmt_next_result(db_stmt_t *stmt)
     log_text(LOG_ALERT, "attempt to use an already closed connection");
     return NULL;
   }
+  else if (db_conn_busy(con))
+    return NULL;
   else if (con->state == DB_CONN_RESULT_SET &&
            (rc = db_free_results_int(con)) != 0)
   {
@@ -531,23 +825,41 @@ db_result_t *db_stmt_next_result(db_stmt_t *stmt)
     return NULL;
   }
 
+  con->async_events = 0;
   con->error = con->driver->ops.stmt_next_result(stmt, rs);
 
-  sb_counter_inc(con->thread_id, rs->counter);
+  return db_op_done(con, rs);
+}
+
 
-  if (SB_LIKELY(con->error == DB_ERROR_NONE))
+/* Fetch row from result set of a prepared statement into bound buffers */
+
+
+int db_fetch(db_result_t *rs)
+{
+  db_conn_t *con = SB_CONTAINER_OF(rs, db_conn_t, rs);
+
+  if (con->state == DB_CONN_INVALID)
   {
-    if (rs->counter == SB_CNT_READ)
-    {
-      con->state = DB_CONN_RESULT_SET;
-      return rs;
-    }
-    con->state = DB_CONN_READY;
+    log_text(LOG_ALERT, "attempt to use an already closed connection");
+    return 1;
+  }
+  else if (con->state != DB_CONN_RESULT_SET || rs->statement == NULL)
+  {
+    log_text(LOG_ALERT, "attempt to fetch row from an invalid result set");
+    return 1;
+  }
 
-    return NULL;
+  if (con->driver->ops.fetch == NULL)
+  {
+    log_text(LOG_ALERT, "fetching rows is not supported by the driver");
+    return 1;
   }
 
-  return NULL;
+  if ((rs->nrows == 0 && !rs->streamed) || rs->nfields == 0)
+    return 1;
+
+  return con->driver->ops.fetch(rs);
 }
 
 
@@ -574,7 +886,7 @@ db_row_t *db_fetch_row(db_result_t *rs)
     log_text(LOG_ALERT, "fetching rows is not supported by the driver");
   }
 
-  if (rs->nrows == 0 || rs->nfields == 0)
+  if ((rs->nrows == 0 && !rs->streamed) || rs->nfields == 0)
   {
     log_text(LOG_ALERT, "attempt to fetch row from an empty result set");
     return NULL;
@@ -608,6 +920,8 @@ db_result_t *db_query(db_conn_t *con, const char *query, size_t len)
     con->error = DB_ERROR_FATAL;
     return NULL;
   }
+  else if (db_conn_busy(con))
+    return NULL;
   else if (con->state == DB_CONN_RESULT_SET &&
            (rc = db_free_results_int(con)) != 0)
   {
@@ -615,23 +929,10 @@ db_result_t *db_query(db_conn_t *con, const char *query, size_t len)
     return NULL;
   }
 
+  con->async_events = 0;
   con->error = con->driver->ops.query(con, query, len, rs);
 
-  sb_counter_inc(con->thread_id, rs->counter);
-
-  if (SB_LIKELY(con->error == DB_ERROR_NONE))
-  {
-    if (rs->counter == SB_CNT_READ)
-    {
-      con->state = DB_CONN_RESULT_SET;
-      return rs;
-    }
-    con->state = DB_CONN_READY;
-
-    return NULL;
-  }
-
-  return NULL;
+  return db_op_done(con, rs);
 }
 
 /* Check if more result sets are available */
@@ -665,6 +966,8 @@ db_result_t *db_next_result(db_conn_t *con)
     con->error = DB_ERROR_FATAL;
     return NULL;
   }
+  else if (db_conn_busy(con))
+    return NULL;
   else if (con->state == DB_CONN_RESULT_SET &&
            (rc = db_free_results_int(con)) != 0)
   {
@@ -678,21 +981,10 @@ db_result_t *db_next_result(db_conn_t *con)
     return NULL;
   }
 
+  con->async_events = 0;
   con->error = con->driver->ops.next_result(con, rs);
 
-  sb_counter_inc(con->thread_id, rs->counter);
-
-  if (SB_LIKELY(con->error == DB_ERROR_NONE))
-  {
-    if (rs->counter == SB_CNT_READ)
-    {
-      con->state = DB_CONN_RESULT_SET;
-      return rs;
-    }
-    con->state = DB_CONN_READY;
-  }
-
-  return NULL;
+  return db_op_done(con, rs);
 }
 
 /* Free result set */
@@ -712,6 +1004,7 @@ static int db_free_results_int(db_conn_t *con)
 
   con->rs.nrows = 0;
   con->rs.nfields = 0;
+  con->rs.streamed = false;
 
   con->rs.statement = NULL;
 
@@ -780,59 +1073,312 @@ int db_close(db_stmt_t *stmt)
     free(stmt->bound_param);
     stmt->bound_param = NULL;
   }
+  if (stmt->emu != NULL)
+  {
+    free(stmt->emu->param_pos);
+    free(stmt->emu->buf);
+    free(stmt->emu);
+    stmt->emu = NULL;
+  }
   free(stmt);
 
   return rc;
 }
 
-/* Uninitialize DB API */
+/*
+  Synchronous calls are not allowed until the current pipeline or non-blocking
+  operation is finished
+*/
 
-void db_done(void)
+static bool db_conn_busy(db_conn_t *con)
 {
-  sb_list_item_t *pos;
-  db_driver_t    *drv;
+  if (SB_LIKELY(con->state != DB_CONN_PIPELINE &&
+                con->state != DB_CONN_ASYNC))
+    return false;
 
-  if (!db_global_initialized)
-    return;
+  if (con->state == DB_CONN_PIPELINE)
+    log_text(LOG_ALERT,
+             "attempt to execute a synchronous call in pipeline mode");
+  else
+    log_text(LOG_ALERT, "attempt to use a connection while a non-blocking "
+             "operation is in progress");
 
-  disable_print_stats();
+  con->error = DB_ERROR_FATAL;
 
-  if (db_globals.debug)
-  {
-    free(exec_timers);
-    free(fetch_timers);
+  return true;
+}
 
-    exec_timers = fetch_timers = NULL;
-  }
+/*
+  Update counters and the connection state when an operation returning a
+  result set is either completed, or is pending on a non-blocking connection
+*/
 
-  SB_LIST_FOR_EACH(pos, &drivers)
+static db_result_t *db_op_done(db_conn_t *con, db_result_t *rs)
+{
+  if (SB_UNLIKELY(con->async_events != 0))
   {
-    drv = SB_LIST_ENTRY(pos, db_driver_t, listitem);
-    if (drv->initialized)
-    {
-      drv->ops.done();
-      pthread_mutex_destroy(&drv->mutex);
-    }
+    con->state = DB_CONN_ASYNC;
+    return NULL;
   }
 
-  return;
-}
-
+  sb_counter_inc(con->thread_id, rs->counter);
 
-/* Parse command line arguments */
+  if (SB_LIKELY(con->error == DB_ERROR_NONE) && rs->counter == SB_CNT_READ)
+  {
+    con->state = DB_CONN_RESULT_SET;
+    return rs;
+  }
 
+  con->state = DB_CONN_READY;
 
-int db_parse_arguments(void)
-{
-  char *s;
+  return NULL;
+}
 
-  s = sb_get_value_string("db-ps-mode");
+/* Enter pipeline mode */
 
-  if (!strcmp(s, "auto"))
-    db_globals.ps_mode = DB_PS_MODE_AUTO;
-  else if (!strcmp(s, "disable"))
-    db_globals.ps_mode = DB_PS_MODE_DISABLE;
-  else
+int db_pipeline_begin(db_conn_t *con)
+{
+  if (con->state == DB_CONN_INVALID)
+  {
+    log_text(LOG_ALERT, "attempt to use an already closed connection");
+    con->error = DB_ERROR_FATAL;
+    return 1;
+  }
+  else if (con->state == DB_CONN_PIPELINE)
+  {
+    log_text(LOG_ALERT, "attempt to start a pipeline while another one is "
+             "in progress");
+    con->error = DB_ERROR_FATAL;
+    return 1;
+  }
+  else if (db_conn_busy(con))
+    return 1;
+  else if (con->state == DB_CONN_RESULT_SET && db_free_results_int(con))
+  {
+    con->error = DB_ERROR_FATAL;
+    return 1;
+  }
+
+  con->error = DB_ERROR_NONE;
+
+  /*
+    Statements will be executed synchronously by db_execute_async(). Pipelines
+    are not used on non-blocking connections, as retrieving their results would
+    block.
+  */
+  if (con->driver->ops.pipeline_begin == NULL || con->async)
+    return 0;
+
+  if (con->driver->ops.pipeline_begin(con))
+  {
+    con->error = DB_ERROR_FATAL;
+    return 1;
+  }
+
+  con->state = DB_CONN_PIPELINE;
+  con->pipeline_len = 0;
+
+  return 0;
+}
+
+/* Queue prepared statement for execution in pipeline mode */
+
+int db_execute_async(db_stmt_t *stmt)
+{
+  db_conn_t       *con = stmt->connection;
+  db_result_t     *rs = &con->rs;
+
+  if (con->state != DB_CONN_PIPELINE)
+  {
+    if (db_execute(stmt) != NULL)
+      return db_free_results(rs);
+
+    return con->error != DB_ERROR_NONE;
+  }
+
+  rs->statement = stmt;
+
+  con->error = con->driver->ops.execute_async(stmt, rs);
+
+  if (SB_UNLIKELY(con->error != DB_ERROR_NONE))
+  {
+    sb_counter_inc(con->thread_id, SB_CNT_ERROR);
+    return 1;
+  }
+
+  con->pipeline_len++;
+
+  return 0;
+}
+
+/* Send queued statements, retrieve their results and leave pipeline mode */
+
+int db_pipeline_end(db_conn_t *con)
+{
+  db_result_t     *rs = &con->rs;
+  db_error_t      rc = DB_ERROR_NONE;
+  db_error_t      err;
+  unsigned int    i;
+
+  if (con->state == DB_CONN_INVALID)
+  {
+    log_text(LOG_ALERT, "attempt to use an already closed connection");
+    con->error = DB_ERROR_FATAL;
+    return 1;
+  }
+  else if (con->state != DB_CONN_PIPELINE)
+  {
+    /* Not supported by the driver, everything has already been executed */
+    con->error = DB_ERROR_NONE;
+    return 0;
+  }
+
+  if (con->driver->ops.pipeline_sync(con))
+  {
+    rc = DB_ERROR_FATAL;
+    sb_counter_inc(con->thread_id, SB_CNT_ERROR);
+    con->pipeline_len = 0;
+  }
+
+  for (i = 0; i < con->pipeline_len; i++)
+  {
+    err = con->driver->ops.pipeline_result(con, rs);
+
+    if (rs->counter != SB_CNT_MAX)
+      sb_counter_inc(con->thread_id, rs->counter);
+
+    if (err == DB_ERROR_NONE && rs->counter == SB_CNT_READ)
+      con->driver->ops.free_results(rs);
+
+    /* Report the first error, subsequent statements are skipped anyway */
+    if (rc == DB_ERROR_NONE)
+      rc = err;
+  }
+
+  con->pipeline_len = 0;
+  con->state = DB_CONN_READY;
+
+  if (con->driver->ops.pipeline_end(con, rc))
+    rc = DB_ERROR_FATAL;
+
+  con->error = rc;
+
+  return rc != DB_ERROR_NONE;
+}
+
+/* Events a pending non-blocking operation is waiting for */
+
+int db_async_events(db_conn_t *con)
+{
+  return con->state == DB_CONN_ASYNC ? con->async_events : 0;
+}
+
+/* Socket of a pending non-blocking operation */
+
+int db_async_fd(db_conn_t *con)
+{
+  return con->async_fd;
+}
+
+/* Continue a pending non-blocking operation */
+
+db_result_t *db_async_continue(db_conn_t *con, int events)
+{
+  db_result_t *rs = &con->rs;
+
+  if (con->state != DB_CONN_ASYNC)
+  {
+    log_text(LOG_ALERT, "attempt to continue a non-blocking operation which "
+             "is not in progress");
+    con->error = DB_ERROR_FATAL;
+    return NULL;
+  }
+
+  con->async_events = 0;
+  con->error = con->driver->ops.async_continue(con, rs, events);
+
+  return db_op_done(con, rs);
+}
+
+/* Block until a pending non-blocking operation is completed */
+
+db_result_t *db_async_wait(db_conn_t *con)
+{
+  db_result_t *rs = NULL;
+  int         events;
+
+  while (con->state == DB_CONN_ASYNC)
+  {
+    events = sb_poll_fd(con->async_fd, con->async_events, -1);
+    if (events < 0)
+    {
+      con->error = DB_ERROR_FATAL;
+      return NULL;
+    }
+
+    rs = db_async_continue(con, events);
+  }
+
+  return rs;
+}
+
+/* Uninitialize DB API */
+
+void db_done(void)
+{
+  sb_list_item_t *pos;
+  db_driver_t    *drv;
+
+  if (!db_global_initialized)
+    return;
+
+  disable_print_stats();
+
+  if (db_globals.debug)
+  {
+    free(exec_timers);
+    free(fetch_timers);
+
+    exec_timers = fetch_timers = NULL;
+  }
+
+  sb_histogram_done(&connect_histogram);
+
+  SB_LIST_FOR_EACH(pos, &drivers)
+  {
+    drv = SB_LIST_ENTRY(pos, db_driver_t, listitem);
+
+    if (drv->pool != NULL)
+    {
+      db_pool_free(drv->pool);
+      drv->pool = NULL;
+    }
+
+    if (drv->initialized)
+    {
+      drv->ops.done();
+      pthread_mutex_destroy(&drv->mutex);
+    }
+  }
+
+  return;
+}
+
+
+/* Parse command line arguments */
+
+
+int db_parse_arguments(void)
+{
+  char *s;
+
+  s = sb_get_value_string("db-ps-mode");
+
+  if (!strcmp(s, "auto"))
+    db_globals.ps_mode = DB_PS_MODE_AUTO;
+  else if (!strcmp(s, "disable"))
+    db_globals.ps_mode = DB_PS_MODE_DISABLE;
+  else
   {
     log_text(LOG_FATAL, "Invalid value for db-ps-mode: %s", s);
     return 1;
@@ -841,6 +1387,28 @@ int db_parse_arguments(void)
   db_globals.driver = sb_get_value_string("db-driver");
 
   db_globals.debug = sb_get_value_flag("db-debug");
+
+  db_globals.stream_results = sb_get_value_flag("db-stream-results");
+
+  if (sb_get_value_int("db-pool-size") < 0)
+  {
+    log_text(LOG_FATAL, "Invalid value for --db-pool-size: %d",
+             sb_get_value_int("db-pool-size"));
+    return 1;
+  }
+  db_globals.pool_size = sb_get_value_int("db-pool-size");
+
+  s = sb_get_value_string("db-pool-scope");
+
+  if (!strcmp(s, "thread"))
+    db_globals.pool_global = false;
+  else if (!strcmp(s, "global"))
+    db_globals.pool_global = true;
+  else
+  {
+    log_text(LOG_FATAL, "Invalid value for --db-pool-scope: %s", s);
+    return 1;
+  }
   
   return 0;
 }
@@ -907,6 +1475,298 @@ int db_print_value(db_bind_t *var, char *buf, int buflen)
 }
 
 
+/* Parse the query of an emulated prepared statement */
+
+
+static db_emu_query_t *db_emu_parse(const char *query)
+{
+  db_emu_query_t *emu;
+  size_t         i;
+  unsigned int   n;
+
+  if (query == NULL)
+    return NULL;
+
+  emu = (db_emu_query_t *) calloc(1, sizeof(db_emu_query_t));
+  if (emu == NULL)
+    return NULL;
+
+  emu->query_len = strlen(query);
+
+  for (i = 0; i < emu->query_len; i++)
+    if (query[i] == '?')
+      emu->nparams++;
+
+  /* Reserve some space for values, the buffer grows on demand */
+  emu->buflen = emu->query_len + 1 + emu->nparams * 16;
+
+  emu->param_pos = (size_t *) malloc((emu->nparams + 1) * sizeof(size_t));
+  emu->buf = (char *) malloc(emu->buflen);
+
+  if (emu->param_pos == NULL || emu->buf == NULL)
+  {
+    free(emu->param_pos);
+    free(emu->buf);
+    free(emu);
+    return NULL;
+  }
+
+  for (i = 0, n = 0; i < emu->query_len; i++)
+    if (query[i] == '?')
+      emu->param_pos[n++] = i;
+
+  return emu;
+}
+
+
+/* Make sure the rendered query buffer can hold a given number of bytes */
+
+
+static inline int db_emu_reserve(db_emu_query_t *emu, size_t size)
+{
+  if (SB_LIKELY(size <= emu->buflen))
+    return 0;
+
+  size_t newlen = SB_MAX(emu->buflen * 2, size);
+  char   *tmp = (char *) realloc(emu->buf, newlen);
+
+  if (tmp == NULL)
+    return 1;
+
+  emu->buf = tmp;
+  emu->buflen = newlen;
+
+  return 0;
+}
+
+
+/*
+  Print a formatted value at a given offset of the rendered query buffer.
+  Returns the number of printed characters, or -1 on error.
+*/
+
+
+static int db_emu_printf(db_emu_query_t *emu, size_t off, const char *fmt, ...)
+{
+  va_list ap;
+  int     n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(emu->buf + off, emu->buflen - off, fmt, ap);
+  va_end(ap);
+
+  if (n < 0)
+    return -1;
+
+  if ((size_t) n >= emu->buflen - off)
+  {
+    if (db_emu_reserve(emu, off + (size_t) n + 1))
+      return -1;
+
+    va_start(ap, fmt);
+    n = vsnprintf(emu->buf + off, emu->buflen - off, fmt, ap);
+    va_end(ap);
+  }
+
+  return n;
+}
+
+
+/*
+  Print an integer into a buffer of at least DB_INT_STR_SIZE bytes without a
+  terminating zero. Returns the number of printed characters.
+*/
+
+
+static unsigned int db_format_int(char *buf, long long val)
+{
+  char               tmp[DB_INT_STR_SIZE];
+  char               *p = tmp + sizeof(tmp);
+  unsigned long long u = (val < 0) ? 0ULL - (unsigned long long) val :
+    (unsigned long long) val;
+
+  do
+  {
+    *--p = (char) ('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+
+  if (val < 0)
+    *--p = '-';
+
+  const unsigned int n = (unsigned int) (tmp + sizeof(tmp) - p);
+
+  memcpy(buf, p, n);
+
+  return n;
+}
+
+
+/*
+  Print an integer at a given offset of the rendered query buffer. Returns the
+  number of printed characters, or -1 on error.
+*/
+
+
+static int db_emu_print_int(db_emu_query_t *emu, size_t off, long long val)
+{
+  if (db_emu_reserve(emu, off + DB_INT_STR_SIZE))
+    return -1;
+
+  return (int) db_format_int(emu->buf + off, val);
+}
+
+
+/*
+  Print a quoted string value at a given offset of the rendered query buffer,
+  escaping quotes and, with DB_EMU_ESCAPE_BACKSLASH, backslashes and zero bytes.
+  Returns the number of printed characters, or -1 on error.
+*/
+
+
+static int db_emu_print_str(db_emu_query_t *emu, size_t off, const char *str,
+                            size_t len, int flags)
+{
+  const bool escape_bs = (flags & DB_EMU_ESCAPE_BACKSLASH) != 0;
+  char       *p;
+  size_t     i;
+
+  /* Every character may be escaped with another one, plus 2 quotes */
+  if (db_emu_reserve(emu, off + len * 2 + 2))
+    return -1;
+
+  p = emu->buf + off;
+
+  *p++ = '\'';
+
+  for (i = 0; i < len; i++)
+  {
+    const char c = str[i];
+
+    if (c == '\'')
+      *p++ = '\'';
+    else if (escape_bs && (c == '\\' || c == '\0'))
+    {
+      *p++ = '\\';
+      *p++ = (c == '\0') ? '0' : '\\';
+      continue;
+    }
+
+    *p++ = c;
+  }
+
+  *p++ = '\'';
+
+  return (int) (p - (emu->buf + off));
+}
+
+
+/*
+  Print a value of a bound parameter at a given offset of the rendered query
+  buffer. Returns the number of printed characters, or -1 on error.
+*/
+
+
+static int db_emu_print_value(db_emu_query_t *emu, size_t off, db_bind_t *var,
+                              int flags)
+{
+  db_time_t *tm;
+
+  if (var->is_null != NULL && *var->is_null)
+    return db_emu_printf(emu, off, "NULL");
+
+  switch (var->type) {
+    case DB_TYPE_TINYINT:
+      return db_emu_print_int(emu, off, *(signed char *) var->buffer);
+    case DB_TYPE_SMALLINT:
+      return db_emu_print_int(emu, off, *(short *) var->buffer);
+    case DB_TYPE_INT:
+      return db_emu_print_int(emu, off, *(int *) var->buffer);
+    case DB_TYPE_BIGINT:
+      return db_emu_print_int(emu, off, *(long long *) var->buffer);
+    case DB_TYPE_FLOAT:
+      return db_emu_printf(emu, off, "%f", (double) *(float *) var->buffer);
+    case DB_TYPE_DOUBLE:
+      return db_emu_printf(emu, off, "%f", *(double *) var->buffer);
+    case DB_TYPE_CHAR:
+    case DB_TYPE_VARCHAR:
+      return db_emu_print_str(emu, off, (const char *) var->buffer,
+                              var->data_len != NULL ? *var->data_len :
+                              strlen((const char *) var->buffer), flags);
+    case DB_TYPE_DATE:
+      tm = (db_time_t *)var->buffer;
+      return db_emu_printf(emu, off, "'%d-%d-%d'", tm->year, tm->month,
+                           tm->day);
+    case DB_TYPE_TIME:
+      tm = (db_time_t *)var->buffer;
+      return db_emu_printf(emu, off, "'%d:%d:%d'", tm->hour, tm->minute,
+                           tm->second);
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+      tm = (db_time_t *)var->buffer;
+      return db_emu_printf(emu, off, "'%d-%d-%d %d:%d:%d'", tm->year,
+                           tm->month, tm->day, tm->hour, tm->minute,
+                           tm->second);
+    default:
+      return 0;
+  }
+}
+
+
+/* Render the query of an emulated prepared statement */
+
+
+const char *db_emulate_query(db_stmt_t *stmt, int flags, size_t *len)
+{
+  db_emu_query_t * const emu = stmt->emu;
+  size_t         pos = 0;
+  size_t         off = 0;
+  size_t         seg;
+  unsigned int   i;
+  int            n;
+
+  if (emu == NULL)
+    return NULL;
+
+  if (emu->nparams > 0 &&
+      (stmt->bound_param == NULL || stmt->bound_param_len < emu->nparams))
+  {
+    log_text(LOG_ALERT, "not all parameters of an emulated prepared statement "
+             "are bound");
+    return NULL;
+  }
+
+  for (i = 0; i < emu->nparams; i++)
+  {
+    /* Literal segment preceding the placeholder */
+    seg = emu->param_pos[i] - pos;
+    if (db_emu_reserve(emu, off + seg))
+      return NULL;
+
+    memcpy(emu->buf + off, stmt->query + pos, seg);
+    off += seg;
+    pos = emu->param_pos[i] + 1;
+
+    if ((n = db_emu_print_value(emu, off, stmt->bound_param + i, flags)) < 0)
+      return NULL;
+    off += (size_t) n;
+  }
+
+  /* The rest of the query and the terminating zero */
+  seg = emu->query_len - pos;
+  if (db_emu_reserve(emu, off + seg + 1))
+    return NULL;
+
+  memcpy(emu->buf + off, stmt->query + pos, seg);
+  off += seg;
+  emu->buf[off] = '\0';
+
+  *len = off;
+
+  return emu->buf;
+}
+
+
 #if 0
 /* Free row fetched by db_fetch_row() */
 
@@ -1008,13 +1868,10 @@ int db_bulk_insert_next(db_conn_t *con, const char *query, size_t query_len)
   }
 
   if (con->bulk_cnt > 0)
-  {
-    con->bulk_buffer[con->bulk_ptr] = ',';
-    strcpy(con->bulk_buffer + con->bulk_ptr + 1, query);
-  }
-  else
-    strcpy(con->bulk_buffer + con->bulk_ptr, query);
-  con->bulk_ptr += query_len + (con->bulk_cnt > 0);
+    con->bulk_buffer[con->bulk_ptr++] = ',';
+  memcpy(con->bulk_buffer + con->bulk_ptr, query, query_len);
+  con->bulk_ptr += query_len;
+  con->bulk_buffer[con->bulk_ptr] = '\0';
 
   con->bulk_cnt++;
 
@@ -1029,7 +1886,7 @@ static int db_bulk_do_insert(db_conn_t *con, int is_last)
     return 0;
 
   if (db_query(con, con->bulk_buffer, con->bulk_ptr) == NULL &&
-      con->error != DB_ERROR_NONE)
+      db_async_wait(con) == NULL && con->error != DB_ERROR_NONE)
     return 1;
 
 
@@ -1040,7 +1897,7 @@ static int db_bulk_do_insert(db_conn_t *con, int is_last)
     if (is_last || con->bulk_commit_cnt >= con->bulk_commit_max)
     {
       if (db_query(con, "COMMIT", 6) == NULL &&
-          con->error != DB_ERROR_NONE)
+          db_async_wait(con) == NULL && con->error != DB_ERROR_NONE)
         return 1;
       con->bulk_commit_cnt = 0;
     }
@@ -1069,6 +1926,242 @@ int db_bulk_insert_done(db_conn_t *con)
   return 0;
 }
 
+/* State of a sysbench table rows generator */
+
+typedef struct
+{
+  uint32_t     next_id;         /* id of the next row */
+  uint32_t     left;            /* number of rows left to generate */
+  uint32_t     k_max;           /* maximum value of k */
+  bool         with_id;         /* whether id values are generated */
+  bool         insert;          /* generate VALUES rows for INSERT */
+  unsigned int row_len;         /* length of a partially consumed row */
+  unsigned int row_pos;         /* consumed part of that row */
+  char         row[SBTEST_ROW_SIZE];
+} db_sbtest_gen_t;
+
+/* Progress of bulk loads by all threads, reported with --report-interval */
+
+static uint64_t load_rows;        /* number of loaded rows */
+static uint64_t load_start_ns;    /* time of the first loaded row */
+static uint64_t load_report_ns;   /* time of the next progress report */
+static uint64_t load_last_ns;     /* time of the last progress report */
+static uint64_t load_last_rows;   /* number of loaded rows at that time */
+
+static uint64_t db_time_ns(void)
+{
+  struct timespec ts;
+
+  SB_GETTIME(&ts);
+
+  return SEC2NS(ts.tv_sec) + (uint64_t) ts.tv_nsec;
+}
+
+/* Account a given number of loaded rows and report progress if it's time */
+
+static void load_progress(uint32_t rows)
+{
+  const uint64_t interval = sb_globals.report_interval_ns;
+  const uint64_t total = ck_pr_faa_64(&load_rows, rows) + rows;
+
+  if (interval == 0)
+    return;
+
+  const uint64_t now = db_time_ns();
+  const uint64_t next = ck_pr_load_64(&load_report_ns);
+
+  if (next == 0)
+  {
+    if (ck_pr_cas_64(&load_start_ns, 0, now))
+    {
+      load_last_ns = now;
+      ck_pr_store_64(&load_report_ns, now + interval);
+    }
+    return;
+  }
+
+  /* Only one thread reports progress for an interval */
+  if (now < next || !ck_pr_cas_64(&load_report_ns, next, now + interval))
+    return;
+
+  log_timestamp(LOG_NOTICE, NS2SEC(now - load_start_ns),
+                "rows: %" PRIu64 " rows/s: %4.2f", total,
+                (total - load_last_rows) / NS2SEC(now - load_last_ns));
+
+  load_last_ns = now;
+  load_last_rows = total;
+}
+
+/*
+  Generate the next row into a buffer of at least SBTEST_ROW_SIZE bytes, either
+  as a text row for bulk loads or as a VALUES row for INSERT. Returns the row
+  length.
+*/
+
+static unsigned int sbtest_gen_row(db_sbtest_gen_t *gen, char *buf)
+{
+  const char sep = gen->insert ? ',' : '\t';
+  char       *p = buf;
+
+  if (gen->insert)
+    *p++ = '(';
+
+  if (gen->with_id)
+  {
+    p += db_format_int(p, gen->next_id);
+    *p++ = sep;
+  }
+
+  p += db_format_int(p, sb_rand_default(1, gen->k_max));
+  *p++ = sep;
+
+  if (gen->insert)
+    *p++ = '\'';
+  sb_rand_str(SBTEST_C_TEMPLATE, p);
+  p += SBTEST_C_LEN;
+  if (gen->insert)
+    *p++ = '\'';
+  *p++ = sep;
+
+  if (gen->insert)
+    *p++ = '\'';
+  sb_rand_str(SBTEST_PAD_TEMPLATE, p);
+  p += SBTEST_PAD_LEN;
+  *p++ = gen->insert ? '\'' : '\n';
+  if (gen->insert)
+    *p++ = ')';
+
+  gen->next_id++;
+  gen->left--;
+
+  return (unsigned int) (p - buf);
+}
+
+/* Bulk load producer of sysbench table rows, see db_load_read_t */
+
+static int sbtest_gen_read(void *arg, char *buf, unsigned int len)
+{
+  db_sbtest_gen_t * const gen = arg;
+  const uint32_t  left = gen->left;
+  unsigned int    n = 0;
+
+  while (n < len)
+  {
+    if (gen->row_pos == gen->row_len)
+    {
+      if (gen->left == 0)
+        break;
+
+      /* Generate rows directly into the buffer while they fit */
+      if (len - n >= SBTEST_ROW_SIZE)
+      {
+        n += sbtest_gen_row(gen, buf + n);
+        continue;
+      }
+
+      gen->row_len = sbtest_gen_row(gen, gen->row);
+      gen->row_pos = 0;
+    }
+
+    const unsigned int size = SB_MIN(gen->row_len - gen->row_pos, len - n);
+
+    memcpy(buf + n, gen->row + gen->row_pos, size);
+    gen->row_pos += size;
+    n += size;
+  }
+
+  load_progress(left - gen->left);
+
+  return (int) n;
+}
+
+/* Load rows of a sysbench table */
+
+int db_load_sbtest(db_conn_t *con, const char *table, uint32_t first_id,
+                   uint32_t last_id, uint32_t k_max, bool with_id, bool native)
+{
+  db_sbtest_gen_t gen;
+  const char      *columns = with_id ? "id, k, c, pad" : "k, c, pad";
+  char            query[256];
+  int             rc;
+
+  if (con->state == DB_CONN_INVALID)
+  {
+    log_text(LOG_ALERT, "attempt to use an already closed connection");
+    return 1;
+  }
+  else if (con->state == DB_CONN_RESULT_SET &&
+           (rc = db_free_results_int(con)) != 0)
+  {
+    return 1;
+  }
+
+  if (last_id < first_id)
+    return 0;
+
+  memset(&gen, 0, sizeof(gen));
+  gen.next_id = first_id;
+  gen.k_max = k_max;
+  gen.with_id = with_id;
+
+  const uint32_t rows = last_id - first_id + 1;
+
+  if (native && con->driver->ops.bulk_load != NULL && !con->async)
+  {
+    uint32_t done = 0;
+
+    while (done < rows)
+    {
+      gen.left = SB_MIN(rows - done, LOAD_BATCH_ROWS);
+      done += gen.left;
+
+      rc = con->driver->ops.bulk_load(con, table, columns, sbtest_gen_read,
+                                      &gen);
+
+      if (rc == DB_LOAD_UNSUPPORTED && gen.next_id == first_id)
+        break;
+
+      if (rc != 0 || gen.left != 0)
+      {
+        log_text(LOG_FATAL, "failed to load rows into '%s'", table);
+        return 1;
+      }
+    }
+
+    if (done == rows)
+      return 0;
+
+    /* Fall back to multi-row INSERTs */
+    gen.left = 0;
+  }
+
+  snprintf(query, sizeof(query), "INSERT INTO %s(%s) VALUES", table, columns);
+
+  if (db_bulk_insert_init(con, query, strlen(query)))
+    return 1;
+
+  gen.left = rows;
+  gen.insert = true;
+
+  uint32_t reported = rows;
+
+  while (gen.left > 0)
+  {
+    const unsigned int len = sbtest_gen_row(&gen, gen.row);
+
+    if (db_bulk_insert_next(con, gen.row, len))
+      return 1;
+
+    if (reported - gen.left >= 1024 || gen.left == 0)
+    {
+      load_progress(reported - gen.left);
+      reported = gen.left;
+    }
+  }
+
+  return db_bulk_insert_done(con);
+}
+
 void db_report_intermediate(sb_stat_t *stat)
 {
   /* Use default stats handler if no drivers are used */
@@ -1079,11 +2172,12 @@ void db_report_intermediate(sb_stat_t *stat)
   }
 
   const double seconds = stat->time_interval;
+  char pcts[SB_LATENCY_PCTS_STR_SIZE];
 
   log_timestamp(LOG_NOTICE, stat->time_total,
                 "thds: %u tps: %4.2f "
                 "qps: %4.2f (r/w/o: %4.2f/%4.2f/%4.2f) "
-                "lat (ms,%u%%): %4.2f err/s: %4.2f "
+                "lat %s err/s: %4.2f "
                 "reconn/s: %4.2f",
                 stat->threads_running,
                 stat->events / seconds,
@@ -1091,16 +2185,41 @@ void db_report_intermediate(sb_stat_t *stat)
                 stat->reads / seconds,
                 stat->writes / seconds,
                 stat->other / seconds,
-                sb_globals.percentile,
-                SEC2MS(stat->latency_pct),
+                sb_latency_pcts_str(stat->latency_pcts, 2, pcts,
+                                    sizeof(pcts)),
                 stat->errors / seconds,
                 stat->reconnects / seconds);
 
+  /* Connect latency, if any connections have been made in this interval */
+  const uint64_t connects = ck_pr_load_64(&connect_count);
+
+  if (connects > interm_connect_count)
+  {
+    double conn_pcts[MAX_PERCENTILES];
+
+    sb_histogram_get_pcts_intermediate(&connect_histogram,
+                                       sb_globals.percentiles,
+                                       sb_globals.n_percentiles, conn_pcts);
+    for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+      conn_pcts[i] = MS2SEC(conn_pcts[i]);
+
+    log_timestamp(LOG_NOTICE, stat->time_total,
+                  "conn/s: %4.2f conn lat %s",
+                  (connects - interm_connect_count) / seconds,
+                  sb_latency_pcts_str(conn_pcts, 2, pcts, sizeof(pcts)));
+
+    interm_connect_count = connects;
+  }
+
   if (sb_globals.tx_rate > 0)
   {
     log_timestamp(LOG_NOTICE, stat->time_total,
-                  "queue length: %" PRIu64", concurrency: %" PRIu64,
-                  stat->queue_length, stat->concurrency);
+                  "queue length: %" PRIu64", concurrency: %" PRIu64
+                  ", lag (ms): %4.2f, resp %s",
+                  stat->queue_length, stat->concurrency,
+                  SEC2MS(stat->scheduler_lag),
+                  sb_latency_pcts_str(stat->response_pcts, 2, pcts,
+                                      sizeof(pcts)));
   }
 }
 
@@ -1109,6 +2228,7 @@ void db_report_cumulative(sb_stat_t *stat)
 {
   sb_timer_t    exec_timer;
   sb_timer_t    fetch_timer;
+  sb_list_item_t *pos;
 
   /* Use default stats handler if no drivers are used */
   if (!check_print_stats())
@@ -1140,6 +2260,43 @@ void db_report_cumulative(sb_stat_t *stat)
   log_text(LOG_NOTICE, "    reconnects:                          %-6" PRIu64
            " (%.2f per sec.)", stat->reconnects, stat->reconnects / seconds);
 
+  /* Connect latency, if any connections have been made since the last report */
+  const uint64_t connects = ck_pr_load_64(&connect_count) -
+    cumul_connect_count;
+  const uint64_t connect_ns = ck_pr_load_64(&connect_time_ns) -
+    cumul_connect_time_ns;
+
+  if (connects > 0)
+  {
+    double conn_pcts[MAX_PERCENTILES];
+
+    cumul_connect_count += connects;
+    cumul_connect_time_ns += connect_ns;
+
+    sb_histogram_get_pcts_checkpoint(&connect_histogram,
+                                     sb_globals.percentiles,
+                                     sb_globals.n_percentiles, conn_pcts);
+    for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+      conn_pcts[i] = MS2SEC(conn_pcts[i]);
+
+    log_text(LOG_NOTICE, "    connections:                         %-6" PRIu64
+             " (%.2f per sec.)", connects, connects / seconds);
+    log_text(LOG_NOTICE, "");
+    log_text(LOG_NOTICE, "Connect latency (ms):");
+    log_text(LOG_NOTICE, "         avg: %39.2f",
+             NS2MS((double) connect_ns / connects));
+    sb_print_latency_pcts(conn_pcts, 27);
+  }
+
+  /* Driver-specific statistics */
+  SB_LIST_FOR_EACH(pos, &drivers)
+  {
+    db_driver_t *drv = SB_LIST_ENTRY(pos, db_driver_t, listitem);
+
+    if (drv->initialized && drv->ops.report_cumulative != NULL)
+      drv->ops.report_cumulative(stat);
+  }
+
   if (db_globals.debug)
   {
     sb_timer_init(&exec_timer);
@@ -43,6 +43,9 @@ typedef struct
   db_ps_mode_t  ps_mode;   /* Requested prepared statements usage mode */
   char          *driver;   /* Requested database driver */
   unsigned char debug;     /* debug flag */
+  bool          stream_results; /* fetch result sets row by row */
+  unsigned int  pool_size; /* default size of connection pools */
+  bool          pool_global; /* whether default pools are shared by threads */
 } db_globals_t;
 
 /* Driver capabilities definition */
@@ -112,6 +115,34 @@ typedef struct
   char             *is_null;
 } db_bind_t;
 
+/*
+  Query of an emulated prepared statement parsed into literal segments around
+  parameter placeholders. It is rendered with the values of bound parameters
+  into a buffer reused by all executions of the statement.
+*/
+
+typedef struct
+{
+  unsigned int    nparams;        /* Number of placeholders */
+  size_t          *param_pos;     /* Offsets of placeholders in the query */
+  size_t          query_len;      /* Length of the query */
+  char            *buf;           /* Rendered query buffer */
+  size_t          buflen;         /* Allocated size of buf */
+} db_emu_query_t;
+
+/* Flags for db_emulate_query() */
+#define DB_EMU_ESCAPE_BACKSLASH 1 /* Escape backslashes in string values */
+
+/*
+  Producer of rows for bulk loads. Fills a buffer of a given size with rows in
+  the text format, i.e. tab-separated columns and newline-terminated rows, and
+  returns the number of written bytes, 0 at the end of data or -1 on error.
+*/
+typedef int db_load_read_t(void *, char *, unsigned int);
+
+/* Returned by the bulk_load driver operation when a bulk load is refused */
+#define DB_LOAD_UNSUPPORTED (-1)
+
 /* Forward declarations */
 
 struct db_conn;
@@ -141,6 +172,17 @@ typedef bool drv_op_more_results(struct db_conn *);
 typedef db_error_t drv_op_next_result(struct db_conn *, struct db_result *);
 typedef int drv_op_free_results(struct db_result *);
 typedef int drv_op_close(struct db_stmt *);
+typedef int drv_op_pipeline_begin(struct db_conn *);
+typedef db_error_t drv_op_execute_async(struct db_stmt *, struct db_result *);
+typedef int drv_op_pipeline_sync(struct db_conn *);
+typedef db_error_t drv_op_pipeline_result(struct db_conn *,
+                                          struct db_result *);
+typedef int drv_op_pipeline_end(struct db_conn *, db_error_t);
+typedef db_error_t drv_op_async_continue(struct db_conn *, struct db_result *,
+                                         int);
+typedef int drv_op_bulk_load(struct db_conn *, const char *, const char *,
+                             db_load_read_t *, void *);
+typedef void drv_op_report(sb_stat_t *);
 typedef int drv_op_thread_done(int);
 typedef int drv_op_done(void);
 
@@ -166,6 +208,38 @@ typedef struct
   drv_op_next_result     *next_result;    /* retrieve the next result set */
   drv_op_close           *close;          /* close prepared statement */
   drv_op_query           *query;          /* execute non-prepared statement */
+  /*
+    Pipeline operations, optional. When not implemented, statements are
+    executed synchronously by db_execute_async()
+  */
+  drv_op_pipeline_begin  *pipeline_begin; /* enter pipeline mode */
+  drv_op_execute_async   *execute_async;  /* queue prepared statement */
+  drv_op_pipeline_sync   *pipeline_sync;  /* send queued statements */
+  /*
+    retrieve the result of the next queued statement, rs->counter is set to
+    SB_CNT_MAX for statements skipped due to an earlier error
+  */
+  drv_op_pipeline_result *pipeline_result;
+  /* leave pipeline mode, the argument is the first error in the pipeline */
+  drv_op_pipeline_end    *pipeline_end;
+  /*
+    Continue a pending operation on a non-blocking connection when its socket
+    is ready for given SB_POLL_* events. Optional, non-blocking connections are
+    not supported by the driver if not implemented. On such connections the
+    execute, stmt_next_result, query and next_result operations may return
+    before completion with db_conn_t::async_events set to the events to wait
+    for. The same applies to this operation.
+  */
+  drv_op_async_continue  *async_continue;
+  /*
+    Load rows produced by a callback into a table with a given list of columns
+    using a native bulk load protocol. Optional, multi-row INSERTs are used if
+    not implemented or DB_LOAD_UNSUPPORTED is returned before any rows are
+    consumed.
+  */
+  drv_op_bulk_load       *bulk_load;
+  /* print driver-specific statistics in the cumulative report, optional */
+  drv_op_report          *report_cumulative;
   drv_op_thread_done     *thread_done;    /* thread-local driver deinitialization */
   drv_op_done            *done;           /* uninitialize driver */
 } drv_ops_t;
@@ -182,6 +256,7 @@ typedef struct
   sb_list_item_t  listitem; /* can be linked in a list */
   bool            initialized;
   pthread_mutex_t mutex;
+  struct db_pool  *pool;    /* connection pool shared by all threads */
 } db_driver_t;
 
 /* Row value definition */
@@ -209,14 +284,33 @@ typedef struct db_result
   struct db_stmt *statement;    /* Pointer to prepared statement (if used) */
   void           *ptr;          /* Pointer to driver-specific data */
   db_row_t       row;           /* Last fetched row */
+  /*
+    Rows are fetched from the server one by one rather than buffered by the
+    client. nrows is the number of rows fetched so far in this case.
+  */
+  bool           streamed;
 } db_result_t;
 
 typedef enum {
   DB_CONN_READY,
   DB_CONN_RESULT_SET,
+  DB_CONN_PIPELINE,
+  DB_CONN_ASYNC,
   DB_CONN_INVALID
 } db_conn_state_t;
 
+/*
+  Server role requested for a connection. Drivers balancing connections over
+  multiple servers use it to send writes to a writable server and reads to
+  read-only replicas.
+*/
+
+typedef enum {
+  DB_ROLE_ANY,                  /* any server */
+  DB_ROLE_WRITE,                /* a writable server */
+  DB_ROLE_READ                  /* a read-only server, if available */
+} db_conn_role_t;
+
 /* Database connection structure */
 
 typedef struct db_conn
@@ -239,6 +333,13 @@ typedef struct db_conn
   unsigned int    bulk_commit_cnt;   /* Current value of uncommitted rows */
   unsigned int    bulk_commit_max;   /* Maximum value of uncommitted rows */
 
+  unsigned int    pipeline_len;      /* Number of queued statements */
+  db_conn_role_t  role;              /* Requested server role */
+
+  int             async_fd;          /* Socket of a pending operation */
+  int             async_events;      /* SB_POLL_* events it is waiting for */
+  bool            async;             /* Non-blocking connection */
+
   char            pad[SB_CACHELINE_PAD(sizeof(db_error_t) +
                                        sizeof(int) +
                                        sizeof(void *) +
@@ -250,7 +351,11 @@ typedef struct db_conn
                                        sizeof(int) +
                                        sizeof(int) * 2 +
                                        sizeof(void *) +
-                                       sizeof(int) * 4
+                                       sizeof(int) * 4 +
+                                       sizeof(int) +
+                                       sizeof(db_conn_role_t) +
+                                       sizeof(int) * 2 +
+                                       sizeof(bool)
                                        )];
 } db_conn_t;
 
@@ -266,8 +371,26 @@ typedef struct db_stmt
   db_bind_t       *bound_res_len;  /* Length of the bound_res array */
   char            emulated;        /* Should this statement be emulated? */
   void            *ptr;            /* Pointer to driver-specific data structure */
+  db_emu_query_t  *emu;            /* Parsed query of an emulated PS */
 } db_stmt_t;
 
+/*
+  Connection pool. Connections are opened on demand up to the pool size, and
+  returned connections are kept open to be checked out again.
+*/
+
+typedef struct db_pool
+{
+  db_driver_t     *driver;
+  unsigned int    size;     /* maximum number of open connections */
+  unsigned int    nopen;    /* number of open connections */
+  unsigned int    nidle;    /* number of idle connections */
+  db_conn_t       **idle;   /* idle connections, most recently used last */
+  bool            shared;   /* whether the pool is shared by threads */
+  pthread_mutex_t mutex;    /* protects the above in a shared pool */
+  pthread_cond_t  cond;     /* signaled when a connection is returned */
+} db_pool_t;
+
 extern db_globals_t db_globals;
 
 /* Database abstraction layer calls */
@@ -284,12 +407,68 @@ int db_describe(db_driver_t *, drv_caps_t *);
 
 db_conn_t *db_connection_create(db_driver_t *);
 
+/*
+  Create a non-blocking connection. Calls executing statements on such a
+  connection may return before completion, in which case db_async_events()
+  returns a non-zero value, and the operation must be continued with
+  db_async_continue() when the socket returned by db_async_fd() is ready.
+*/
+db_conn_t *db_connection_create_async(db_driver_t *);
+
+/*
+  Create a connection to a server with a given role, either blocking or
+  non-blocking. Drivers not distinguishing servers ignore the role.
+*/
+db_conn_t *db_connection_create_role(db_driver_t *, db_conn_role_t, bool);
+
+/* Check if non-blocking connections are supported by a driver */
+bool db_async_supported(db_driver_t *);
+
+/* SB_POLL_* events a pending non-blocking operation is waiting for, or 0 */
+int db_async_events(db_conn_t *);
+
+/* Socket of a pending non-blocking operation */
+int db_async_fd(db_conn_t *);
+
+/*
+  Continue a pending non-blocking operation when its socket is ready for given
+  events. Returns the same as the call that started the operation would return
+  on completion.
+*/
+db_result_t *db_async_continue(db_conn_t *, int);
+
+/* Block until a pending non-blocking operation is completed */
+db_result_t *db_async_wait(db_conn_t *);
+
 int db_connection_close(db_conn_t *);
 
 int db_connection_reconnect(db_conn_t *con);
 
 void db_connection_free(db_conn_t *con);
 
+/*
+  Open a connection pool of a given size. With a zero size, the pool is
+  configured with --db-pool-size and --db-pool-scope, i.e. it is the pool shared
+  by all threads for --db-pool-scope=global. Returns NULL if pooling is disabled
+  (--db-pool-size=0) or on error.
+*/
+db_pool_t *db_pool_open(db_driver_t *, unsigned int);
+
+/*
+  Check out a connection from a pool. If all connections are checked out, wait
+  for one to be returned to a shared pool, or fail for a thread-local one.
+*/
+db_conn_t *db_pool_checkout(db_pool_t *);
+
+/*
+  Return a connection checked out from a pool. Closed connections are freed, so
+  a new one is opened on the next checkout.
+*/
+int db_pool_checkin(db_pool_t *, db_conn_t *);
+
+/* Close a thread-local pool and its idle connections, no-op for a shared one */
+void db_pool_close(db_pool_t *);
+
 db_stmt_t *db_prepare(db_conn_t *, const char *, size_t);
 
 int db_bind_param(db_stmt_t *, db_bind_t *, size_t);
@@ -300,6 +479,12 @@ db_result_t *db_execute(db_stmt_t *);
 
 db_result_t *db_stmt_next_result(db_stmt_t *);
 
+/*
+  Fetch the next row of a prepared statement result set into buffers bound with
+  db_bind_result(). Returns 0 on success, or non-zero if there are no more rows.
+*/
+int db_fetch(db_result_t *);
+
 db_row_t *db_fetch_row(db_result_t *);
 
 db_result_t *db_query(db_conn_t *, const char *, size_t len);
@@ -314,10 +499,37 @@ int db_store_results(db_result_t *);
 
 int db_close(db_stmt_t *);
 
+/*
+  Enter pipeline mode, i.e. queue statements executed with db_execute_async()
+  and send them to the server without waiting for results
+*/
+int db_pipeline_begin(db_conn_t *);
+
+/*
+  Queue a prepared statement for execution in pipeline mode. Statements are
+  executed synchronously with their results discarded when not in pipeline mode,
+  or when pipelining is not supported by the driver.
+*/
+int db_execute_async(db_stmt_t *);
+
+/*
+  Send queued statements, wait for and discard their results, and leave
+  pipeline mode. Returns 0 if all statements have been executed successfully.
+*/
+int db_pipeline_end(db_conn_t *);
+
 void db_done(void);
 
 int db_print_value(db_bind_t *, char *, int);
 
+/*
+  Render the query of an emulated prepared statement with values of bound
+  parameters according to given DB_EMU_* flags. Returns a buffer owned by the
+  statement which is valid until the next call, and stores the query length, or
+  returns NULL on error.
+*/
+const char *db_emulate_query(db_stmt_t *, int, size_t *);
+
 /* Initialize multi-row insert operation */
 int db_bulk_insert_init(db_conn_t *, const char *, size_t);
 
@@ -327,6 +539,16 @@ int db_bulk_insert_next(db_conn_t *, const char *, size_t);
 /* Finish multi-row insert operation */
 int db_bulk_insert_done(db_conn_t *);
 
+/*
+  Load rows of a sysbench table (id, k, c, pad) with ids in a given range and k
+  values generated by the default random numbers generator in a given range.
+  The id column is only loaded when requested, otherwise it is assigned by the
+  server. A native bulk load protocol is used when requested and supported by
+  the driver, multi-row INSERTs otherwise.
+*/
+int db_load_sbtest(db_conn_t *, const char *, uint32_t, uint32_t, uint32_t,
+                   bool, bool);
+
 /* Print database-specific test stats */
 void db_report_intermediate(sb_stat_t *);
 void db_report_cumulative(sb_stat_t *);
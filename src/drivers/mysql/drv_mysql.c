@@ -36,7 +36,9 @@
 #include <errmsg.h>
 
 #include "sb_options.h"
+#include "sb_poll.h"
 #include "db_driver.h"
+#include "sb_ck_pr.h"
 
 #define DEBUG(format, ...)                      \
   do {                                          \
@@ -61,6 +63,13 @@ static sb_arg_t mysql_drv_args[] =
   SB_OPT("mysql-host", "MySQL server host", "localhost", LIST),
   SB_OPT("mysql-port", "MySQL server port", "3306", LIST),
   SB_OPT("mysql-socket", "MySQL socket", NULL, LIST),
+  SB_OPT("mysql-balance", "method of choosing a server from the "
+         "--mysql-host/--mysql-port or --mysql-socket lists for new "
+         "connections {rr, weighted, least-conn}", "rr", STRING),
+  SB_OPT("mysql-weights", "list of server weights for --mysql-balance="
+         "weighted and least-conn, one for each server", NULL, LIST),
+  SB_OPT("mysql-retry-interval", "number of seconds a failed server is not "
+         "used for new connections, unless all servers have failed", "5", INT),
   SB_OPT("mysql-user", "MySQL user", "sbtest", STRING),
   SB_OPT("mysql-password", "MySQL password", "", STRING),
   SB_OPT("mysql-db", "MySQL database name", "sbtest", STRING),
@@ -92,11 +101,22 @@ static sb_arg_t mysql_drv_args[] =
   SB_OPT_END
 };
 
+/* Methods of choosing servers for new connections */
+
+typedef enum
+{
+  BALANCE_RR,                   /* round robin */
+  BALANCE_WEIGHTED,             /* smooth weighted round robin */
+  BALANCE_LEAST_CONN            /* fewest open connections per weight unit */
+} mysql_balance_t;
+
 typedef struct
 {
   sb_list_t          *hosts;
   sb_list_t          *ports;
   sb_list_t          *sockets;
+  mysql_balance_t    balance;
+  uint64_t           retry_interval; /* in nanoseconds */
   const char         *user;
   const char         *password;
   const char         *db;
@@ -117,15 +137,68 @@ typedef struct
   unsigned int       dry_run;
 } mysql_drv_args_t;
 
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+/* Non-blocking operations, i.e. client library calls in progress */
+
+typedef enum
+{
+  ASYNC_NONE,
+  ASYNC_QUERY,                  /* mysql_real_query() */
+  ASYNC_NEXT_RESULT,            /* mysql_next_result() */
+  ASYNC_STORE_RESULT,           /* mysql_store_result() */
+  ASYNC_STMT_EXECUTE,           /* mysql_stmt_execute() */
+  ASYNC_STMT_NEXT_RESULT,       /* mysql_stmt_next_result() */
+  ASYNC_STMT_STORE_RESULT       /* mysql_stmt_store_result() */
+} mysql_async_op_t;
+#endif
+
+/*
+  Server from the --mysql-host/--mysql-port or --mysql-socket lists. Statistics
+  are updated atomically, other fields are protected by nodes_mutex.
+*/
+
+typedef struct
+{
+  const char     *host;
+  unsigned int   port;
+  char           *socket;
+  unsigned int   weight;         /* --mysql-weights value */
+  int64_t        current_weight; /* smooth weighted round robin state */
+  /* Role detected from @@global.read_only, DB_ROLE_ANY if unknown */
+  db_conn_role_t role;
+  uint64_t       down_until;     /* not used until this time after a failure */
+  unsigned int   nconns;         /* number of open connections */
+
+  uint64_t       failures;       /* failed and lost connections */
+  uint64_t       queries;        /* queries and statement executions */
+  uint64_t       query_time_ns;  /* total latency of queries */
+
+  /* Statistics at the time of the last cumulative report */
+  uint64_t       last_failures;
+  uint64_t       last_queries;
+  uint64_t       last_query_time_ns;
+} mysql_node_t;
+
 typedef struct
 {
   MYSQL        *mysql;
+  mysql_node_t *node;           /* server of this connection */
+  uint64_t     op_start;        /* start time of an accounted operation */
   const char   *host;
   const char   *user;
   const char   *password;
   const char   *db;
   unsigned int port;
   char         *socket;
+  bool         async;           /* non-blocking connection */
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+  mysql_async_op_t async_op;    /* pending operation */
+  db_stmt_t    *async_stmt;     /* statement of a pending operation */
+  const char   *async_query;    /* query of a pending operation */
+  size_t       async_len;
+#endif
+  db_load_read_t *load_read;    /* producer of a bulk load in progress */
+  void         *load_arg;
 } db_mysql_conn_t;
 
 #ifdef HAVE_MYSQL_OPT_SSL_MODE
@@ -178,12 +251,13 @@ static mysql_drv_args_t args;          /* driver args */
 
 static char use_ps; /* whether server-side prepared statemens should be used */
 
-/* Positions in the list of hosts/ports/sockets. Protected by pos_mutex */
-static sb_list_item_t *hosts_pos;
-static sb_list_item_t *ports_pos;
-static sb_list_item_t *sockets_pos;
+/* Servers in the order of the hosts/ports or sockets lists */
+static mysql_node_t    *nodes;
+static unsigned int    nnodes;
+/* Next server in the round robin order. Protected by nodes_mutex */
+static unsigned int    nodes_pos;
 
-static pthread_mutex_t pos_mutex;
+static pthread_mutex_t nodes_mutex;
 
 #ifdef HAVE_MYSQL_OPT_SSL_MODE
 
@@ -226,10 +300,16 @@ static int mysql_drv_fetch(db_result_t *);
 static int mysql_drv_fetch_row(db_result_t *, db_row_t *);
 static db_error_t mysql_drv_query(db_conn_t *, const char *, size_t,
                            db_result_t *);
+static void mysql_drv_report_cumulative(sb_stat_t *);
 static bool mysql_drv_more_results(db_conn_t *);
 static db_error_t mysql_drv_next_result(db_conn_t *, db_result_t *);
 static int mysql_drv_free_results(db_result_t *);
 static int mysql_drv_close(db_stmt_t *);
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+static db_error_t mysql_drv_async_continue(db_conn_t *, db_result_t *, int);
+#endif
+static int mysql_drv_bulk_load(db_conn_t *, const char *, const char *,
+                               db_load_read_t *, void *);
 static int mysql_drv_thread_done(int);
 static int mysql_drv_done(void);
 
@@ -259,6 +339,11 @@ static db_driver_t mysql_driver =
     .free_results = mysql_drv_free_results,
     .close = mysql_drv_close,
     .query = mysql_drv_query,
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+    .async_continue = mysql_drv_async_continue,
+#endif
+    .bulk_load = mysql_drv_bulk_load,
+    .report_cumulative = mysql_drv_report_cumulative,
     .thread_done = mysql_drv_thread_done,
     .done = mysql_drv_done
   }
@@ -268,6 +353,19 @@ static db_driver_t mysql_driver =
 /* Local functions */
 
 static int get_mysql_bind_type(db_bind_type_t);
+static int nodes_init(void);
+static int node_connect(db_conn_t *, db_mysql_conn_t *, bool);
+static void node_disconnect(db_mysql_conn_t *);
+static db_error_t execute_int(db_stmt_t *, db_result_t *);
+static db_error_t query_int(db_conn_t *, const char *, size_t, db_result_t *);
+static db_error_t stmt_store_result(db_stmt_t *, db_result_t *);
+static db_error_t stmt_result_done(db_stmt_t *, int, db_result_t *);
+static db_error_t store_result(db_conn_t *, db_result_t *);
+static db_error_t result_done(db_conn_t *, MYSQL_RES *, db_result_t *);
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+static db_error_t async_start(db_conn_t *, mysql_async_op_t, db_stmt_t *,
+                              const char *, size_t, db_result_t *);
+#endif
 
 /* Register MySQL driver */
 
@@ -285,7 +383,7 @@ int register_driver_mysql(sb_list_t *drivers)
 
 int mysql_drv_init(void)
 {
-  pthread_mutex_init(&pos_mutex, NULL);
+  pthread_mutex_init(&nodes_mutex, NULL);
 
   args.hosts = sb_get_value_list("mysql-host");
   if (SB_LIST_IS_EMPTY(args.hosts))
@@ -293,7 +391,6 @@ int mysql_drv_init(void)
     log_text(LOG_FATAL, "No MySQL hosts specified, aborting");
     return 1;
   }
-  hosts_pos = SB_LIST_ITEM_NEXT(args.hosts);
 
   args.ports = sb_get_value_list("mysql-port");
   if (SB_LIST_IS_EMPTY(args.ports))
@@ -301,10 +398,35 @@ int mysql_drv_init(void)
     log_text(LOG_FATAL, "No MySQL ports specified, aborting");
     return 1;
   }
-  ports_pos = SB_LIST_ITEM_NEXT(args.ports);
 
   args.sockets = sb_get_value_list("mysql-socket");
-  sockets_pos = args.sockets;
+
+  const char * const balance = sb_get_value_string("mysql-balance");
+
+  if (!strcmp(balance, "rr"))
+    args.balance = BALANCE_RR;
+  else if (!strcmp(balance, "weighted"))
+    args.balance = BALANCE_WEIGHTED;
+  else if (!strcmp(balance, "least-conn"))
+    args.balance = BALANCE_LEAST_CONN;
+  else
+  {
+    log_text(LOG_FATAL, "Invalid value for --mysql-balance: '%s'", balance);
+    return 1;
+  }
+
+  const int retry_interval = sb_get_value_int("mysql-retry-interval");
+
+  if (retry_interval < 0)
+  {
+    log_text(LOG_FATAL, "Invalid value for --mysql-retry-interval: %d",
+             retry_interval);
+    return 1;
+  }
+  args.retry_interval = SEC2NS((uint64_t) retry_interval);
+
+  if (nodes_init())
+    return 1;
 
   args.user = sb_get_value_string("mysql-user");
   args.password = sb_get_value_string("mysql-password");
@@ -396,15 +518,76 @@ int mysql_drv_describe(drv_caps_t *caps)
 }
 
 
+/*
+  LOAD DATA LOCAL INFILE handler. Instead of reading files, it streams rows from
+  the producer of a bulk load in progress, and refuses requests made by the
+  server at any other time.
+*/
+
+static int local_infile_init(void **ptr, const char *filename, void *userdata)
+{
+  db_mysql_conn_t *db_mysql_con = userdata;
+
+  (void) filename; /* unused */
+
+  *ptr = db_mysql_con;
+
+  return db_mysql_con->load_read == NULL;
+}
+
+
+static int local_infile_read(void *ptr, char *buf, unsigned int len)
+{
+  db_mysql_conn_t *db_mysql_con = ptr;
+
+  return db_mysql_con->load_read(db_mysql_con->load_arg, buf, len);
+}
+
+
+static void local_infile_end(void *ptr)
+{
+  (void) ptr; /* unused */
+}
+
+
+static int local_infile_error(void *ptr, char *msg, unsigned int len)
+{
+  db_mysql_conn_t *db_mysql_con = ptr;
+
+  snprintf(msg, len, "%s", db_mysql_con->load_read == NULL ?
+           "LOAD DATA LOCAL INFILE is only allowed for sysbench bulk loads" :
+           "failed to generate rows");
+
+  return CR_UNKNOWN_ERROR;
+}
+
+
 static int mysql_drv_real_connect(db_mysql_conn_t *db_mysql_con)
 {
   MYSQL          *con = db_mysql_con->mysql;
+  unsigned int   local_infile = 1;
 
 #ifdef HAVE_MYSQL_OPT_SSL_MODE
   DEBUG("mysql_options(%p,%s,%d)", con, "MYSQL_OPT_SSL_MODE", args.ssl_mode);
   mysql_options(con, MYSQL_OPT_SSL_MODE, &args.ssl_mode);
 #endif
 
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+  if (db_mysql_con->async)
+  {
+    DEBUG("mysql_options(%p, %s, %d)", con, "MYSQL_OPT_NONBLOCK", 0);
+    mysql_options(con, MYSQL_OPT_NONBLOCK, 0);
+  }
+#endif
+
+  /* Only used by bulk loads, see local_infile_init() */
+  DEBUG("mysql_options(%p, %s, %u)", con, "MYSQL_OPT_LOCAL_INFILE",
+        local_infile);
+  mysql_options(con, MYSQL_OPT_LOCAL_INFILE, &local_infile);
+  mysql_set_local_infile_handler(con, local_infile_init, local_infile_read,
+                                 local_infile_end, local_infile_error,
+                                 db_mysql_con);
+
   if (args.use_ssl)
   {
     DEBUG("mysql_ssl_set(%p, \"%s\", \"%s\", \"%s\", NULL, \"%s\")", con,
@@ -453,85 +636,387 @@ static int mysql_drv_real_connect(db_mysql_conn_t *db_mysql_con)
 }
 
 
-/* Connect to MySQL database */
+/* Current time in nanoseconds */
+
+static uint64_t node_time_ns(void)
+{
+  struct timespec ts;
 
+  SB_GETTIME(&ts);
 
-int mysql_drv_connect(db_conn_t *sb_conn)
+  return SEC2NS(ts.tv_sec) + (uint64_t) ts.tv_nsec;
+}
+
+
+/* Number of items in a list */
+
+static unsigned int list_length(sb_list_t *list)
 {
-  MYSQL           *con;
-  db_mysql_conn_t *db_mysql_con;
+  sb_list_item_t *pos;
+  unsigned int   n = 0;
 
-  if (args.dry_run)
-    return 0;
+  SB_LIST_FOR_EACH(pos, list)
+    n++;
 
-  db_mysql_con = (db_mysql_conn_t *) calloc(1, sizeof(db_mysql_conn_t));
+  return n;
+}
 
-  if (db_mysql_con == NULL)
+
+/*
+  Create the list of servers from the --mysql-socket list, or from all
+  combinations of --mysql-host and --mysql-port values in the order they were
+  used by the round robin before, i.e. all ports of the first host go first.
+*/
+
+static int nodes_init(void)
+{
+  sb_list_item_t *hpos;
+  sb_list_item_t *ppos;
+  unsigned int   n = 0;
+
+  if (!SB_LIST_IS_EMPTY(args.sockets))
+    nnodes = list_length(args.sockets);
+  else
+    nnodes = list_length(args.hosts) * list_length(args.ports);
+
+  nodes = (mysql_node_t *) calloc(nnodes, sizeof(mysql_node_t));
+  if (nodes == NULL)
     return 1;
 
-  con = (MYSQL *) malloc(sizeof(MYSQL));
-  if (con == NULL)
+  if (!SB_LIST_IS_EMPTY(args.sockets))
+  {
+    SB_LIST_FOR_EACH(hpos, args.sockets)
+    {
+      nodes[n].host = "localhost";
+      nodes[n++].socket = SB_LIST_ENTRY(hpos, value_t, listitem)->data;
+    }
+  }
+  else
+  {
+    SB_LIST_FOR_EACH(hpos, args.hosts)
+    {
+      SB_LIST_FOR_EACH(ppos, args.ports)
+      {
+        nodes[n].host = SB_LIST_ENTRY(hpos, value_t, listitem)->data;
+        nodes[n++].port =
+          atoi(SB_LIST_ENTRY(ppos, value_t, listitem)->data);
+      }
+    }
+  }
+
+  sb_list_t * const weights = sb_get_value_list("mysql-weights");
+
+  if (!SB_LIST_IS_EMPTY(weights) && list_length(weights) != nnodes)
+  {
+    log_text(LOG_FATAL, "--mysql-weights must have %u values, one for each "
+             "server", nnodes);
     return 1;
+  }
+
+  n = 0;
+  SB_LIST_FOR_EACH(hpos, weights)
+  {
+    const int weight = atoi(SB_LIST_ENTRY(hpos, value_t, listitem)->data);
+
+    if (weight <= 0)
+    {
+      log_text(LOG_FATAL, "Invalid value in --mysql-weights: '%s'",
+               SB_LIST_ENTRY(hpos, value_t, listitem)->data);
+      return 1;
+    }
+    nodes[n++].weight = (unsigned int) weight;
+  }
+
+  for (n = 0; n < nnodes; n++)
+  {
+    if (nodes[n].weight == 0)
+      nodes[n].weight = 1;
+    nodes[n].role = DB_ROLE_ANY;
+  }
+
+  return 0;
+}
+
+
+/* Check if a server may be used for a connection with a given role */
+
+static inline bool node_eligible(const mysql_node_t *node, db_conn_role_t role)
+{
+  switch (role) {
+  case DB_ROLE_WRITE:
+    return node->role != DB_ROLE_READ;
+  case DB_ROLE_READ:
+    return node->role != DB_ROLE_WRITE;
+  default:
+    return true;
+  }
+}
+
+
+/* Check if there are servers eligible for a given role that have not failed */
+
+static bool nodes_eligible(db_conn_role_t role)
+{
+  const uint64_t now = node_time_ns();
+  bool           found = false;
+
+  pthread_mutex_lock(&nodes_mutex);
+  for (unsigned int i = 0; i < nnodes && !found; i++)
+    found = node_eligible(&nodes[i], role) && nodes[i].down_until <= now;
+  pthread_mutex_unlock(&nodes_mutex);
+
+  return found;
+}
 
-  db_mysql_con->mysql = con;
 
-  DEBUG("mysql_init(%p)", con);
-  mysql_init(con);
+/*
+  Choose a server for a new connection with a given role according to
+  --mysql-balance. Servers known to have a different role are skipped, as well
+  as failed ones unless 'failed' is true. Returns NULL if there are no eligible
+  servers. Must be called with nodes_mutex locked.
+*/
 
-  pthread_mutex_lock(&pos_mutex);
+static mysql_node_t *node_choose(db_conn_role_t role, uint64_t now,
+                                 bool failed)
+{
+  mysql_node_t *best = NULL;
+  int64_t      total = 0;
 
-  if (SB_LIST_IS_EMPTY(args.sockets))
+  for (unsigned int i = 0; i < nnodes; i++)
   {
-    db_mysql_con->socket = NULL;
-    db_mysql_con->host = SB_LIST_ENTRY(hosts_pos, value_t, listitem)->data;
-    db_mysql_con->port =
-      atoi(SB_LIST_ENTRY(ports_pos, value_t, listitem)->data);
+    mysql_node_t * const node = &nodes[(nodes_pos + i) % nnodes];
 
-    /*
-       Pick the next port in args.ports. If there are no more ports in the list,
-       move to the next available host and get the first port again.
-    */
-    ports_pos = SB_LIST_ITEM_NEXT(ports_pos);
-    if (ports_pos == args.ports) {
-      hosts_pos = SB_LIST_ITEM_NEXT(hosts_pos);
-      if (hosts_pos == args.hosts)
-        hosts_pos = SB_LIST_ITEM_NEXT(hosts_pos);
+    if (!node_eligible(node, role) || (!failed && node->down_until > now))
+      continue;
+
+    if (args.balance == BALANCE_RR)
+    {
+      best = node;
+      break;
+    }
+    else if (args.balance == BALANCE_WEIGHTED)
+    {
+      node->current_weight += node->weight;
+      total += node->weight;
 
-      ports_pos = SB_LIST_ITEM_NEXT(ports_pos);
+      if (best == NULL || node->current_weight > best->current_weight)
+        best = node;
     }
+    else if (best == NULL ||
+             (uint64_t) node->nconns * best->weight <
+             (uint64_t) best->nconns * node->weight)
+      best = node;
   }
-  else
+
+  if (best == NULL)
+    return NULL;
+
+  best->current_weight -= total;
+  nodes_pos = (unsigned int) (best - nodes + 1) % nnodes;
+
+  return best;
+}
+
+
+/*
+  Mark a server as failed, or just forget roles of all servers if it is NULL.
+  Roles are detected again by new connections after a failure of a server that
+  might be writable, since a replica may be promoted to replace it.
+*/
+
+static void node_failed(mysql_node_t *node)
+{
+  pthread_mutex_lock(&nodes_mutex);
+
+  if (node != NULL)
+    node->down_until = node_time_ns() + args.retry_interval;
+
+  if (node == NULL || node->role != DB_ROLE_READ)
+    for (unsigned int i = 0; i < nnodes; i++)
+      nodes[i].role = DB_ROLE_ANY;
+
+  pthread_mutex_unlock(&nodes_mutex);
+
+  if (node != NULL)
+    ck_pr_inc_64(&node->failures);
+}
+
+
+/* Detect the role of the server of a connection from @@global.read_only */
+
+static int node_detect_role(db_mysql_conn_t *db_mysql_con)
+{
+  MYSQL          *con = db_mysql_con->mysql;
+  MYSQL_RES      *res;
+  MYSQL_ROW      row;
+  db_conn_role_t role;
+
+  static const char query[] = "SELECT @@global.read_only";
+
+  int err = mysql_real_query(con, query, sizeof(query) - 1);
+  DEBUG("mysql_real_query(%p, \"%s\", %zu) = %d", con, query,
+        sizeof(query) - 1, err);
+
+  if (err || (res = mysql_store_result(con)) == NULL)
+    return 1;
+
+  row = mysql_fetch_row(res);
+  role = (row != NULL && row[0] != NULL && atoi(row[0]) != 0) ?
+    DB_ROLE_READ : DB_ROLE_WRITE;
+  mysql_free_result(res);
+
+  pthread_mutex_lock(&nodes_mutex);
+  db_mysql_con->node->role = role;
+  pthread_mutex_unlock(&nodes_mutex);
+
+  return 0;
+}
+
+
+/*
+  Connect to a server chosen for the role of a given connection, trying other
+  servers on failures. Connections with a role are only kept if the server has
+  that role, except that read connections fall back to writable servers if there
+  are no read-only ones. On reconnects failed servers are retried until the
+  connection succeeds or sysbench is terminated.
+*/
+
+static int node_connect(db_conn_t *sb_conn, db_mysql_conn_t *db_mysql_con,
+                        bool reconnect)
+{
+  MYSQL          *con = db_mysql_con->mysql;
+  mysql_node_t   *node;
+  unsigned int   failures = 0;
+
+  for (;;)
   {
-    db_mysql_con->host = "localhost";
+    pthread_mutex_lock(&nodes_mutex);
 
-    /*
-       The sockets list may be empty. So unlike hosts/ports the loop invariant
-       here is that sockets_pos points to the previous one and should be
-       advanced before using it, not after.
-     */
-    sockets_pos = SB_LIST_ITEM_NEXT(sockets_pos);
-    if (sockets_pos == args.sockets)
-      sockets_pos = SB_LIST_ITEM_NEXT(sockets_pos);
-
-    db_mysql_con->socket = SB_LIST_ENTRY(sockets_pos, value_t, listitem)->data;
+    const uint64_t now = node_time_ns();
+
+    /* Try servers that have not failed recently first */
+    node = NULL;
+    for (int failed = 0; failed < 2 && node == NULL; failed++)
+    {
+      node = node_choose(sb_conn->role, now, failed);
+      if (node == NULL && sb_conn->role == DB_ROLE_READ)
+        node = node_choose(DB_ROLE_ANY, now, failed);
+    }
+    if (node != NULL)
+      node->nconns++;
+
+    pthread_mutex_unlock(&nodes_mutex);
+
+    if (node == NULL)
+    {
+      if (!reconnect || sb_globals.error)
+      {
+        log_text(LOG_FATAL, "no writable MySQL server available, "
+                 "aborting...");
+        return 1;
+      }
+
+      /* Wait for a failover to complete */
+      node_failed(NULL);
+      usleep(1000);
+      continue;
+    }
+
+    db_mysql_con->node = node;
+    db_mysql_con->host = node->host;
+    db_mysql_con->port = node->port;
+    db_mysql_con->socket = node->socket;
+
+    DEBUG("mysql_init(%p)", con);
+    mysql_init(con);
+
+    if (mysql_drv_real_connect(db_mysql_con) ||
+        (sb_conn->role != DB_ROLE_ANY && node->role == DB_ROLE_ANY &&
+         node_detect_role(db_mysql_con)))
+    {
+      const bool last = !reconnect && ++failures >= nnodes;
+      const int  level = last ? LOG_FATAL : reconnect ? LOG_DEBUG : LOG_WARNING;
+
+      if (node->socket != NULL)
+        log_text(level, "unable to connect to MySQL server on socket '%s'%s",
+                 node->socket, last ? ", aborting..." : "");
+      else
+        log_text(level, "unable to connect to MySQL server on host '%s', "
+                 "port %u%s", node->host, node->port,
+                 last ? ", aborting..." : "");
+      log_text(level, "error %d: %s", mysql_errno(con), mysql_error(con));
+
+      DEBUG("mysql_close(%p)", con);
+      mysql_close(con);
+      node_disconnect(db_mysql_con);
+      node_failed(node);
+
+      if (last || sb_globals.error)
+        return 1;
+
+      if (reconnect)
+        usleep(1000);
+
+      continue;
+    }
+
+    /* Look for another server if this one has a different role */
+    if (sb_conn->role == DB_ROLE_ANY || node->role == sb_conn->role)
+      return 0;
+
+    if (sb_conn->role == DB_ROLE_READ && !nodes_eligible(DB_ROLE_READ))
+      return 0;
+
+    DEBUG("mysql_close(%p)", con);
+    mysql_close(con);
+    node_disconnect(db_mysql_con);
   }
-  pthread_mutex_unlock(&pos_mutex);
+}
+
+
+/* Release the server of a closed connection */
+
+static void node_disconnect(db_mysql_conn_t *db_mysql_con)
+{
+  if (db_mysql_con->node == NULL)
+    return;
+
+  pthread_mutex_lock(&nodes_mutex);
+  db_mysql_con->node->nconns--;
+  pthread_mutex_unlock(&nodes_mutex);
+
+  db_mysql_con->node = NULL;
+}
+
+
+/* Connect to MySQL database */
+
+
+int mysql_drv_connect(db_conn_t *sb_conn)
+{
+  MYSQL           *con;
+  db_mysql_conn_t *db_mysql_con;
+
+  if (args.dry_run)
+    return 0;
+
+  db_mysql_con = (db_mysql_conn_t *) calloc(1, sizeof(db_mysql_conn_t));
+
+  if (db_mysql_con == NULL)
+    return 1;
+
+  con = (MYSQL *) malloc(sizeof(MYSQL));
+  if (con == NULL)
+    return 1;
 
+  db_mysql_con->mysql = con;
   db_mysql_con->user = args.user;
   db_mysql_con->password = args.password;
   db_mysql_con->db = args.db;
+  db_mysql_con->async = sb_conn->async;
 
-  if (mysql_drv_real_connect(db_mysql_con))
+  if (node_connect(sb_conn, db_mysql_con, false))
   {
-    if (!SB_LIST_IS_EMPTY(args.sockets))
-      log_text(LOG_FATAL, "unable to connect to MySQL server on socket '%s', "
-               "aborting...", db_mysql_con->socket);
-    else
-      log_text(LOG_FATAL, "unable to connect to MySQL server on host '%s', "
-               "port %u, aborting...",
-               db_mysql_con->host, db_mysql_con->port);
-    log_text(LOG_FATAL, "error %d: %s", mysql_errno(con),
-             mysql_error(con));
     free(db_mysql_con);
     free(con);
     return 1;
@@ -562,6 +1047,7 @@ int mysql_drv_disconnect(db_conn_t *sb_conn)
   {
     DEBUG("mysql_close(%p)", db_mysql_con->mysql);
     mysql_close(db_mysql_con->mysql);
+    node_disconnect(db_mysql_con);
     free(db_mysql_con->mysql);
     free(db_mysql_con);
   }
@@ -578,8 +1064,20 @@ int mysql_drv_prepare(db_stmt_t *stmt, const char *query, size_t len)
   MYSQL_STMT *mystmt;
   unsigned int rc;
 
+  /*
+    Emulated statements are rendered even in the dry run mode to measure the
+    client-side cost of query construction
+  */
   if (args.dry_run)
+  {
+    if (!use_ps)
+    {
+      stmt->emulated = 1;
+      stmt->query = strdup(query);
+    }
+
     return 0;
+  }
 
   db_mysql_conn_t *db_mysql_con = (db_mysql_conn_t *) stmt->connection->ptr;
   MYSQL      *con = db_mysql_con->mysql;
@@ -668,60 +1166,57 @@ int mysql_drv_bind_param(db_stmt_t *stmt, db_bind_t *params, size_t len)
   my_bool rc;
   unsigned long param_count;
 
+  if (stmt->emulated)
+  {
+    /* Use emulation */
+    if (stmt->bound_param != NULL)
+      free(stmt->bound_param);
+    stmt->bound_param = (db_bind_t *)malloc(len * sizeof(db_bind_t));
+    if (stmt->bound_param == NULL)
+      return 1;
+    memcpy(stmt->bound_param, params, len * sizeof(db_bind_t));
+    stmt->bound_param_len = len;
+
+    return 0;
+  }
+
   if (args.dry_run)
     return 0;
 
   db_mysql_conn_t *db_mysql_con = (db_mysql_conn_t *) stmt->connection->ptr;
   MYSQL        *con = db_mysql_con->mysql;
 
-  if (con == NULL)
+  if (con == NULL || stmt->ptr == NULL)
     return 1;
 
-  if (!stmt->emulated)
+  /* Validate parameters count */
+  param_count = mysql_stmt_param_count(stmt->ptr);
+  DEBUG("mysql_stmt_param_count(%p) = %lu", stmt->ptr, param_count);
+  if (param_count != len)
   {
-    if (stmt->ptr == NULL)
-      return 1;
-    /* Validate parameters count */
-    param_count = mysql_stmt_param_count(stmt->ptr);
-    DEBUG("mysql_stmt_param_count(%p) = %lu", stmt->ptr, param_count);
-    if (param_count != len)
-    {
-      log_text(LOG_FATAL, "Wrong number of parameters to mysql_stmt_bind_param");
-      return 1;
-    }
-    /* Convert sysbench bind structures to MySQL ones */
-    bind = (MYSQL_BIND *)calloc(len, sizeof(MYSQL_BIND));
-    if (bind == NULL)
-      return 1;
-    for (i = 0; i < len; i++)
-      convert_to_mysql_bind(&bind[i], &params[i]);
-
-    rc = mysql_stmt_bind_param(stmt->ptr, bind);
-    DEBUG("mysql_stmt_bind_param(%p, %p) = %d", stmt->ptr, bind, rc);
-    if (rc)
-    {
-      log_text(LOG_FATAL, "mysql_stmt_bind_param() failed");
-      log_text(LOG_FATAL, "MySQL error: %d \"%s\"", mysql_errno(con),
-                 mysql_error(con));
-      free(bind);
-      return 1;
-    }
-    free(bind);
-
-    return 0;
+    log_text(LOG_FATAL, "Wrong number of parameters to mysql_stmt_bind_param");
+    return 1;
   }
+  /* Convert sysbench bind structures to MySQL ones */
+  bind = (MYSQL_BIND *)calloc(len, sizeof(MYSQL_BIND));
+  if (bind == NULL)
+    return 1;
+  for (i = 0; i < len; i++)
+    convert_to_mysql_bind(&bind[i], &params[i]);
 
-  /* Use emulation */
-  if (stmt->bound_param != NULL)
-    free(stmt->bound_param);
-  stmt->bound_param = (db_bind_t *)malloc(len * sizeof(db_bind_t));
-  if (stmt->bound_param == NULL)
+  rc = mysql_stmt_bind_param(stmt->ptr, bind);
+  DEBUG("mysql_stmt_bind_param(%p, %p) = %d", stmt->ptr, bind, rc);
+  if (rc)
+  {
+    log_text(LOG_FATAL, "mysql_stmt_bind_param() failed");
+    log_text(LOG_FATAL, "MySQL error: %d \"%s\"", mysql_errno(con),
+             mysql_error(con));
+    free(bind);
     return 1;
-  memcpy(stmt->bound_param, params, len * sizeof(db_bind_t));
-  stmt->bound_param_len = len;
+  }
+  free(bind);
 
   return 0;
-
 }
 
 
@@ -762,25 +1257,29 @@ int mysql_drv_bind_result(db_stmt_t *stmt, db_bind_t *params, size_t len)
   return 0;
 }
 
-/* Reset connection to the server by reconnecting with the same parameters. */
+/*
+  Reset connection to the server by reconnecting with the same parameters. The
+  server is considered failed, so another one is used if there are multiple
+  servers.
+*/
 
 static int mysql_drv_reconnect(db_conn_t *sb_con)
 {
   db_mysql_conn_t *db_mysql_con = (db_mysql_conn_t *) sb_con->ptr;
   MYSQL *con = db_mysql_con->mysql;
+  mysql_node_t *node = db_mysql_con->node;
 
   log_text(LOG_DEBUG, "Reconnecting");
 
   DEBUG("mysql_close(%p)", con);
   mysql_close(con);
+  node_disconnect(db_mysql_con);
 
-  while (mysql_drv_real_connect(db_mysql_con))
-  {
-    if (sb_globals.error)
-      return DB_ERROR_FATAL;
+  if (nnodes > 1)
+    node_failed(node);
 
-    usleep(1000);
-  }
+  if (node_connect(sb_con, db_mysql_con, true))
+    return DB_ERROR_FATAL;
 
   log_text(LOG_DEBUG, "Reconnected");
 
@@ -862,19 +1361,59 @@ static db_error_t check_error(db_conn_t *sb_con, const char *func,
   return DB_ERROR_FATAL;
 }
 
+/* Start accounting a query to the server of a connection */
+
+static inline void node_op_start(db_conn_t *sb_conn)
+{
+  db_mysql_conn_t *db_mysql_con = sb_conn->ptr;
+
+  if (nnodes > 1 && db_mysql_con != NULL)
+    db_mysql_con->op_start = node_time_ns();
+}
+
+
+/* Account a query to the server of a connection, unless it is still pending */
+
+static inline void node_op_done(db_conn_t *sb_conn)
+{
+  db_mysql_conn_t *db_mysql_con = sb_conn->ptr;
+
+  if (db_mysql_con == NULL || db_mysql_con->op_start == 0 ||
+      db_mysql_con->node == NULL || sb_conn->async_events != 0)
+    return;
+
+  ck_pr_inc_64(&db_mysql_con->node->queries);
+  ck_pr_add_64(&db_mysql_con->node->query_time_ns,
+               node_time_ns() - db_mysql_con->op_start);
+
+  db_mysql_con->op_start = 0;
+}
+
+
 /* Execute prepared statement */
 
 
 db_error_t mysql_drv_execute(db_stmt_t *stmt, db_result_t *rs)
+{
+  node_op_start(stmt->connection);
+
+  const db_error_t rc = execute_int(stmt, rs);
+
+  node_op_done(stmt->connection);
+
+  return rc;
+}
+
+
+static db_error_t execute_int(db_stmt_t *stmt, db_result_t *rs)
 {
   db_conn_t       *con = stmt->connection;
-  char            *buf = NULL;
-  unsigned int    buflen = 0;
-  unsigned int    i, j, vcnt;
-  char            need_realloc;
-  int             n;
+  db_mysql_conn_t *db_mysql_con;
+  const char      *query;
+  size_t          len;
+  int             flags = 0;
 
-  if (args.dry_run)
+  if (args.dry_run && !stmt->emulated)
     return DB_ERROR_NONE;
 
   con->sql_errno = 0;
@@ -890,6 +1429,11 @@ db_error_t mysql_drv_execute(db_stmt_t *stmt, db_result_t *rs)
       return DB_ERROR_FATAL;
     }
 
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+    if (((db_mysql_conn_t *) con->ptr)->async)
+      return async_start(con, ASYNC_STMT_EXECUTE, stmt, NULL, 0, rs);
+#endif
+
     int err = mysql_stmt_execute(stmt->ptr);
     DEBUG("mysql_stmt_execute(%p) = %d", stmt->ptr, err);
 
@@ -897,78 +1441,32 @@ db_error_t mysql_drv_execute(db_stmt_t *stmt, db_result_t *rs)
       return check_error(con, "mysql_stmt_execute()", stmt->query,
                          &rs->counter);
 
-    err = mysql_stmt_store_result(stmt->ptr);
-    DEBUG("mysql_stmt_store_result(%p) = %d", stmt->ptr, err);
-
-    if (err)
-      return check_error(con, "mysql_stmt_store_result()", NULL, &rs->counter);
-
-    if (mysql_stmt_errno(stmt->ptr) == 0 &&
-        mysql_stmt_field_count(stmt->ptr) == 0)
-    {
-      rs->nrows = (uint32_t) mysql_stmt_affected_rows(stmt->ptr);
-      DEBUG("mysql_stmt_affected_rows(%p) = %u", stmt->ptr,
-            (unsigned) rs->nrows);
-
-      rs->counter = (rs->nrows > 0) ? SB_CNT_WRITE : SB_CNT_OTHER;
-
-      return DB_ERROR_NONE;
-    }
-
-    rs->counter = SB_CNT_READ;
-
-    rs->nrows = (uint32_t) mysql_stmt_num_rows(stmt->ptr);
-    DEBUG("mysql_stmt_num_rows(%p) = %u", rs->statement->ptr,
-          (unsigned) (rs->nrows));
-
-    rs->nfields = (uint32_t) mysql_stmt_field_count(stmt->ptr);
-    DEBUG("mysql_stmt_field_count(%p) = %u", rs->statement->ptr,
-          (unsigned) (rs->nfields));
-
-    return DB_ERROR_NONE;
+    return stmt_store_result(stmt, rs);
   }
 
   /* Use emulation */
-  /* Build the actual query string from parameters list */
-  need_realloc = 1;
-  vcnt = 0;
-  for (i = 0, j = 0; stmt->query[i] != '\0'; i++)
+  /*
+    Build the actual query string from parameters list. The buffer is owned by
+    the statement, so it remains valid until a pending non-blocking operation
+    is completed. Backslashes are only escaped when the server treats them as
+    escape characters, i.e. unless NO_BACKSLASH_ESCAPES is in the SQL mode of
+    this connection.
+  */
+  db_mysql_con = (db_mysql_conn_t *) con->ptr;
+  if (db_mysql_con == NULL ||
+      !(db_mysql_con->mysql->server_status &
+        SERVER_STATUS_NO_BACKSLASH_ESCAPES))
+    flags = DB_EMU_ESCAPE_BACKSLASH;
+
+  query = db_emulate_query(stmt, flags, &len);
+  if (query == NULL)
   {
-  again:
-    if (j+1 >= buflen || need_realloc)
-    {
-      buflen = (buflen > 0) ? buflen * 2 : 256;
-      buf = realloc(buf, buflen);
-      if (buf == NULL)
-      {
-        log_text(LOG_DEBUG, "ERROR: exiting mysql_drv_execute(), memory allocation failure");
-        return DB_ERROR_FATAL;
-      }
-      need_realloc = 0;
-    }
-
-    if (stmt->query[i] != '?')
-    {
-      buf[j++] = stmt->query[i];
-      continue;
-    }
-
-    n = db_print_value(stmt->bound_param + vcnt, buf + j, (int)(buflen - j));
-    if (n < 0)
-    {
-      need_realloc = 1;
-      goto again;
-    }
-    j += (unsigned int)n;
-    vcnt++;
+    log_text(LOG_DEBUG, "ERROR: exiting mysql_drv_execute(), failed to "
+             "build query");
+    return DB_ERROR_FATAL;
   }
-  buf[j] = '\0';
 
-  db_error_t rc = mysql_drv_query(con, buf, j, rs);
-
-  free(buf);
-
-  return rc;
+  return query_int(con, query, len, rs);
 }
 
 /* Retrieve the next result of a prepared statement */
@@ -995,6 +1493,11 @@ db_error_t mysql_drv_stmt_next_result(db_stmt_t *stmt, db_result_t *rs)
       return DB_ERROR_FATAL;
     }
 
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+  if (((db_mysql_conn_t *) con->ptr)->async)
+    return async_start(con, ASYNC_STMT_NEXT_RESULT, stmt, NULL, 0, rs);
+#endif
+
   int err = mysql_stmt_next_result(stmt->ptr);
   DEBUG("mysql_stmt_next_result(%p) = %d", stmt->ptr, err);
 
@@ -1008,11 +1511,73 @@ db_error_t mysql_drv_stmt_next_result(db_stmt_t *stmt, db_result_t *rs)
     return DB_ERROR_NONE;
   }
 
-  err = mysql_stmt_store_result(stmt->ptr);
-  DEBUG("mysql_stmt_store_result(%p) = %d", stmt->ptr, err);
+  return stmt_store_result(stmt, rs);
+}
+
+
+/*
+  Store the result of a prepared statement, unless result sets are streamed, in
+  which case rows are read from the server by mysql_stmt_fetch() or discarded by
+  mysql_stmt_free_result()
+*/
+
+static db_error_t stmt_store_result(db_stmt_t *stmt, db_result_t *rs)
+{
+  int err = 0;
+
+  if (!db_globals.stream_results)
+  {
+    err = mysql_stmt_store_result(stmt->ptr);
+    DEBUG("mysql_stmt_store_result(%p) = %d", stmt->ptr, err);
+  }
+
+  db_error_t rc = stmt_result_done(stmt, err, rs);
+
+  rs->streamed = db_globals.stream_results && rs->counter == SB_CNT_READ;
+
+  return rc;
+}
+
+
+/*
+  Store the result of a query, or initiate a row-by-row retrieval with
+  mysql_use_result() if result sets are streamed
+*/
+
+static db_error_t store_result(db_conn_t *sb_conn, db_result_t *rs)
+{
+  MYSQL     *con = ((db_mysql_conn_t *) sb_conn->ptr)->mysql;
+  MYSQL_RES *res;
+
+  if (db_globals.stream_results)
+  {
+    res = mysql_use_result(con);
+    DEBUG("mysql_use_result(%p) = %p", con, res);
+  }
+  else
+  {
+    res = mysql_store_result(con);
+    DEBUG("mysql_store_result(%p) = %p", con, res);
+  }
+
+  db_error_t rc = result_done(sb_conn, res, rs);
+
+  rs->streamed = db_globals.stream_results && rs->counter == SB_CNT_READ;
+
+  return rc;
+}
+
 
+/*
+  Set result set properties after storing the result of a prepared statement
+  with a given mysql_stmt_store_result() return value
+*/
+
+static db_error_t stmt_result_done(db_stmt_t *stmt, int err, db_result_t *rs)
+{
   if (err)
-    return check_error(con, "mysql_stmt_store_result()", NULL, &rs->counter);
+    return check_error(stmt->connection, "mysql_stmt_store_result()", NULL,
+                       &rs->counter);
 
   if (mysql_stmt_errno(stmt->ptr) == 0 &&
       mysql_stmt_field_count(stmt->ptr) == 0)
@@ -1029,11 +1594,10 @@ db_error_t mysql_drv_stmt_next_result(db_stmt_t *stmt, db_result_t *rs)
   rs->counter = SB_CNT_READ;
 
   rs->nrows = (uint32_t) mysql_stmt_num_rows(stmt->ptr);
-  DEBUG("mysql_stmt_num_rows(%p) = %u", rs->statement->ptr,
-        (unsigned) (rs->nrows));
+  DEBUG("mysql_stmt_num_rows(%p) = %u", stmt->ptr, (unsigned) (rs->nrows));
 
   rs->nfields = (uint32_t) mysql_stmt_field_count(stmt->ptr);
-  DEBUG("mysql_stmt_field_count(%p) = %u", rs->statement->ptr,
+  DEBUG("mysql_stmt_field_count(%p) = %u", stmt->ptr,
         (unsigned) (rs->nfields));
 
   return DB_ERROR_NONE;
@@ -1045,6 +1609,19 @@ db_error_t mysql_drv_stmt_next_result(db_stmt_t *stmt, db_result_t *rs)
 
 db_error_t mysql_drv_query(db_conn_t *sb_conn, const char *query, size_t len,
                            db_result_t *rs)
+{
+  node_op_start(sb_conn);
+
+  const db_error_t rc = query_int(sb_conn, query, len, rs);
+
+  node_op_done(sb_conn);
+
+  return rc;
+}
+
+
+static db_error_t query_int(db_conn_t *sb_conn, const char *query, size_t len,
+                            db_result_t *rs)
 {
   db_mysql_conn_t *db_mysql_con;
   MYSQL *con;
@@ -1059,15 +1636,30 @@ db_error_t mysql_drv_query(db_conn_t *sb_conn, const char *query, size_t len,
   db_mysql_con = (db_mysql_conn_t *)sb_conn->ptr;
   con = db_mysql_con->mysql;
 
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+  if (db_mysql_con->async)
+    return async_start(sb_conn, ASYNC_QUERY, NULL, query, len, rs);
+#endif
+
   int err = mysql_real_query(con, query, len);
   DEBUG("mysql_real_query(%p, \"%s\", %zd) = %d", con, query, len, err);
 
   if (SB_UNLIKELY(err != 0))
     return check_error(sb_conn, "mysql_drv_query()", query, &rs->counter);
 
-  /* Store results and get query type */
-  MYSQL_RES *res = mysql_store_result(con);
-  DEBUG("mysql_store_result(%p) = %p", con, res);
+  return store_result(sb_conn, rs);
+}
+
+
+/*
+  Set result set properties after storing the result of a query with a given
+  mysql_store_result() return value
+*/
+
+static db_error_t result_done(db_conn_t *sb_conn, MYSQL_RES *res,
+                              db_result_t *rs)
+{
+  MYSQL *con = ((db_mysql_conn_t *) sb_conn->ptr)->mysql;
 
   if (res == NULL)
   {
@@ -1107,13 +1699,22 @@ db_error_t mysql_drv_query(db_conn_t *sb_conn, const char *query, size_t len,
 
 int mysql_drv_fetch(db_result_t *rs)
 {
-  /* NYI */
-  (void)rs;  /* unused */
+  int rc;
 
-  if (args.dry_run)
-    return DB_ERROR_NONE;
+  /* Results are only bound for server-side prepared statements */
+  if (args.dry_run || rs->statement->emulated)
+    return 1;
 
-  return 1;
+  rc = mysql_stmt_fetch(rs->statement->ptr);
+  DEBUG("mysql_stmt_fetch(%p) = %d", rs->statement->ptr, rc);
+
+  if (rc != 0 && rc != MYSQL_DATA_TRUNCATED)
+    return 1;
+
+  if (rs->streamed)
+    rs->nrows++;
+
+  return 0;
 }
 
 /* Fetch row from result set of a query */
@@ -1140,6 +1741,9 @@ int mysql_drv_fetch_row(db_result_t *rs, db_row_t *row)
     row->values[i].ptr = my_row[i];
   }
 
+  if (rs->streamed)
+    rs->nrows++;
+
   return DB_ERROR_NONE;
 }
 
@@ -1179,6 +1783,11 @@ db_error_t mysql_drv_next_result(db_conn_t *sb_conn, db_result_t *rs)
   db_mysql_con = (db_mysql_conn_t *)sb_conn->ptr;
   con = db_mysql_con->mysql;
 
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+  if (db_mysql_con->async)
+    return async_start(sb_conn, ASYNC_NEXT_RESULT, NULL, NULL, 0, rs);
+#endif
+
   int err = mysql_next_result(con);
   DEBUG("mysql_next_result(%p) = %d", con, err);
 
@@ -1191,42 +1800,220 @@ db_error_t mysql_drv_next_result(db_conn_t *sb_conn, db_result_t *rs)
     return DB_ERROR_NONE;
   }
 
-  /* Store results and get query type */
-  MYSQL_RES *res = mysql_store_result(con);
-  DEBUG("mysql_store_result(%p) = %p", con, res);
+  return store_result(sb_conn, rs);
+}
 
-  if (res == NULL)
+#ifdef HAVE_MYSQL_OPT_NONBLOCK
+
+/*
+  Finish a non-blocking operation: release its resources and return a given
+  error code
+*/
+
+static db_error_t async_done(db_conn_t *sb_con, db_error_t rc)
+{
+  db_mysql_conn_t *db_mysql_con = sb_con->ptr;
+
+  db_mysql_con->async_op = ASYNC_NONE;
+  db_mysql_con->async_stmt = NULL;
+  db_mysql_con->async_query = NULL;
+
+  return rc;
+}
+
+/*
+  Advance the pending non-blocking operation as far as possible without
+  blocking. 'ready' is the MYSQL_WAIT_* status to continue the current client
+  library call with, or 0 to start it.
+*/
+
+static db_error_t async_step(db_conn_t *sb_con, db_result_t *rs, int ready)
+{
+  db_mysql_conn_t *db_mysql_con = sb_con->ptr;
+  MYSQL           *con = db_mysql_con->mysql;
+  db_stmt_t       *stmt = db_mysql_con->async_stmt;
+  MYSQL_RES       *res;
+  int             status;
+  int             err;
+
+  for (;;)
   {
-    if (mysql_errno(con) == 0 && mysql_field_count(con) == 0)
+    switch (db_mysql_con->async_op)
     {
-      /* Not a select. Check if it was a DML */
-      uint32_t nrows = (uint32_t) mysql_affected_rows(con);
-      if (nrows > 0)
+    case ASYNC_QUERY:
+      status = ready ?
+        mysql_real_query_cont(&err, con, ready) :
+        mysql_real_query_start(&err, con, db_mysql_con->async_query,
+                               db_mysql_con->async_len);
+      if (status != 0)
+        break;
+
+      DEBUG("mysql_real_query(%p, \"%s\", %zd) = %d", con,
+            db_mysql_con->async_query, db_mysql_con->async_len, err);
+
+      if (SB_UNLIKELY(err != 0))
+        return async_done(sb_con,
+                          check_error(sb_con, "mysql_drv_query()",
+                                      db_mysql_con->async_query,
+                                      &rs->counter));
+
+      db_mysql_con->async_op = ASYNC_STORE_RESULT;
+      ready = 0;
+      continue;
+
+    case ASYNC_NEXT_RESULT:
+      status = ready ?
+        mysql_next_result_cont(&err, con, ready) :
+        mysql_next_result_start(&err, con);
+      if (status != 0)
+        break;
+
+      DEBUG("mysql_next_result(%p) = %d", con, err);
+
+      if (SB_UNLIKELY(err > 0))
+        return async_done(sb_con,
+                          check_error(sb_con, "mysql_drv_next_result()", NULL,
+                                      &rs->counter));
+
+      if (err == -1)
       {
-        rs->counter = SB_CNT_WRITE;
-        rs->nrows = nrows;
+        rs->counter = SB_CNT_OTHER;
+        return async_done(sb_con, DB_ERROR_NONE);
       }
-      else
+
+      db_mysql_con->async_op = ASYNC_STORE_RESULT;
+      ready = 0;
+      continue;
+
+    case ASYNC_STORE_RESULT:
+      status = ready ?
+        mysql_store_result_cont(&res, con, ready) :
+        mysql_store_result_start(&res, con);
+      if (status != 0)
+        break;
+
+      DEBUG("mysql_store_result(%p) = %p", con, res);
+
+      return async_done(sb_con, result_done(sb_con, res, rs));
+
+    case ASYNC_STMT_EXECUTE:
+      status = ready ?
+        mysql_stmt_execute_cont(&err, stmt->ptr, ready) :
+        mysql_stmt_execute_start(&err, stmt->ptr);
+      if (status != 0)
+        break;
+
+      DEBUG("mysql_stmt_execute(%p) = %d", stmt->ptr, err);
+
+      if (err)
+        return async_done(sb_con,
+                          check_error(sb_con, "mysql_stmt_execute()",
+                                      stmt->query, &rs->counter));
+
+      db_mysql_con->async_op = ASYNC_STMT_STORE_RESULT;
+      ready = 0;
+      continue;
+
+    case ASYNC_STMT_NEXT_RESULT:
+      status = ready ?
+        mysql_stmt_next_result_cont(&err, stmt->ptr, ready) :
+        mysql_stmt_next_result_start(&err, stmt->ptr);
+      if (status != 0)
+        break;
+
+      DEBUG("mysql_stmt_next_result(%p) = %d", stmt->ptr, err);
+
+      if (SB_UNLIKELY(err > 0))
+        return async_done(sb_con,
+                          check_error(sb_con, "mysql_drv_stmt_next_result()",
+                                      stmt->query, &rs->counter));
+
+      if (err == -1)
+      {
         rs->counter = SB_CNT_OTHER;
+        return async_done(sb_con, DB_ERROR_NONE);
+      }
 
-      return DB_ERROR_NONE;
+      db_mysql_con->async_op = ASYNC_STMT_STORE_RESULT;
+      ready = 0;
+      continue;
+
+    case ASYNC_STMT_STORE_RESULT:
+      status = ready ?
+        mysql_stmt_store_result_cont(&err, stmt->ptr, ready) :
+        mysql_stmt_store_result_start(&err, stmt->ptr);
+      if (status != 0)
+        break;
+
+      DEBUG("mysql_stmt_store_result(%p) = %d", stmt->ptr, err);
+
+      return async_done(sb_con, stmt_result_done(stmt, err, rs));
+
+    default:
+      log_text(LOG_ALERT, "no non-blocking operation in progress");
+      return async_done(sb_con, DB_ERROR_FATAL);
     }
 
-    return check_error(sb_conn, "mysql_store_result()", NULL, &rs->counter);
+    /*
+      The client library call would block. Timeouts are not used, so there is
+      always a socket event to wait for.
+    */
+    sb_con->async_fd = (int) mysql_get_socket(con);
+    sb_con->async_events =
+      ((status & (MYSQL_WAIT_READ | MYSQL_WAIT_EXCEPT)) ? SB_POLL_READ : 0) |
+      ((status & MYSQL_WAIT_WRITE) ? SB_POLL_WRITE : 0);
+
+    if (sb_con->async_events == 0)
+      sb_con->async_events = SB_POLL_READ;
+
+    return DB_ERROR_NONE;
   }
+}
 
-  rs->counter = SB_CNT_READ;
-  rs->ptr = (void *)res;
+/* Start a non-blocking operation */
 
-  rs->nrows = mysql_num_rows(res);
-  DEBUG("mysql_num_rows(%p) = %u", res, (unsigned int) rs->nrows);
+static db_error_t async_start(db_conn_t *sb_con, mysql_async_op_t op,
+                              db_stmt_t *stmt, const char *query, size_t len,
+                              db_result_t *rs)
+{
+  db_mysql_conn_t *db_mysql_con = sb_con->ptr;
 
-  rs->nfields = mysql_num_fields(res);
-  DEBUG("mysql_num_fields(%p) = %u", res, (unsigned int) rs->nfields);
+  db_mysql_con->async_op = op;
+  db_mysql_con->async_stmt = stmt;
+  db_mysql_con->async_query = query;
+  db_mysql_con->async_len = len;
 
-  return DB_ERROR_NONE;
+  return async_step(sb_con, rs, 0);
+}
+
+/* Continue a pending non-blocking operation */
+
+db_error_t mysql_drv_async_continue(db_conn_t *sb_con, db_result_t *rs,
+                                    int events)
+{
+  int ready = 0;
+
+  if (args.dry_run)
+    return DB_ERROR_NONE;
+
+  if (events & SB_POLL_READ)
+    ready |= MYSQL_WAIT_READ;
+  if (events & SB_POLL_WRITE)
+    ready |= MYSQL_WAIT_WRITE;
+
+  /* A zero status would restart the current call */
+  if (ready == 0)
+    ready = MYSQL_WAIT_READ;
+
+  const db_error_t rc = async_step(sb_con, rs, ready);
+
+  node_op_done(sb_con);
+
+  return rc;
 }
 
+#endif /* HAVE_MYSQL_OPT_NONBLOCK */
+
 /* Free result set */
 
 int mysql_drv_free_results(db_result_t *rs)
@@ -1258,15 +2045,15 @@ int mysql_drv_free_results(db_result_t *rs)
 
 int mysql_drv_close(db_stmt_t *stmt)
 {
-  if (args.dry_run)
-    return 0;
-
   if (stmt->query)
   {
     free(stmt->query);
     stmt->query = NULL;
   }
 
+  if (args.dry_run)
+    return 0;
+
   if (stmt->ptr == NULL)
     return 1;
 
@@ -1279,9 +2066,144 @@ int mysql_drv_close(db_stmt_t *stmt)
 }
 
 
+/* Check if an error means that LOAD DATA LOCAL INFILE is disabled */
+
+
+static bool local_infile_disabled(unsigned int err)
+{
+  switch (err) {
+  case ER_NOT_ALLOWED_COMMAND:
+#ifdef ER_CLIENT_LOCAL_FILES_DISABLED
+  case ER_CLIENT_LOCAL_FILES_DISABLED:
+#endif
+#ifdef ER_LOAD_INFILE_CAPABILITY_DISABLED
+  case ER_LOAD_INFILE_CAPABILITY_DISABLED:
+#endif
+#ifdef CR_LOAD_DATA_LOCAL_INFILE_REJECTED
+  case CR_LOAD_DATA_LOCAL_INFILE_REJECTED:
+#endif
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+/* Load rows into a table with LOAD DATA LOCAL INFILE */
+
+
+int mysql_drv_bulk_load(db_conn_t *sb_conn, const char *table,
+                        const char *columns, db_load_read_t *read, void *arg)
+{
+  static unsigned int warned;
+  char                query[256];
+  int                 rc;
+
+  if (args.dry_run)
+  {
+    char buf[65536];
+
+    /* Only generate rows */
+    while ((rc = read(arg, buf, sizeof(buf))) > 0)
+      ;
+
+    return rc < 0;
+  }
+
+  db_mysql_conn_t *db_mysql_con = sb_conn->ptr;
+  MYSQL           *con = db_mysql_con->mysql;
+
+  snprintf(query, sizeof(query), "LOAD DATA LOCAL INFILE 'sysbench' "
+           "INTO TABLE %s (%s)", table, columns);
+
+  db_mysql_con->load_read = read;
+  db_mysql_con->load_arg = arg;
+
+  rc = mysql_real_query(con, query, strlen(query));
+  DEBUG("mysql_real_query(%p, \"%s\", %zu) = %d", con, query, strlen(query),
+        rc);
+
+  db_mysql_con->load_read = NULL;
+  db_mysql_con->load_arg = NULL;
+
+  if (rc == 0)
+    return 0;
+
+  const unsigned int err = mysql_errno(con);
+
+  if (local_infile_disabled(err))
+  {
+    if (ck_pr_fas_uint(&warned, 1) == 0)
+      log_text(LOG_WARNING, "LOAD DATA LOCAL INFILE is disabled (%u: %s), "
+               "using INSERT to load data", err, mysql_error(con));
+
+    return DB_LOAD_UNSUPPORTED;
+  }
+
+  log_text(LOG_FATAL, "%s failed: %u \"%s\"", query, err, mysql_error(con));
+
+  return 1;
+}
+
+
+/* Print per-server statistics when there are multiple servers */
+
+void mysql_drv_report_cumulative(sb_stat_t *stat)
+{
+  const double seconds = stat->time_interval;
+  char         name[256];
+
+  if (nnodes < 2)
+    return;
+
+  log_text(LOG_NOTICE, "");
+  log_text(LOG_NOTICE, "Per-server statistics:");
+
+  pthread_mutex_lock(&nodes_mutex);
+
+  for (unsigned int i = 0; i < nnodes; i++)
+  {
+    mysql_node_t * const node = &nodes[i];
+
+    const uint64_t queries = ck_pr_load_64(&node->queries);
+    const uint64_t time_ns = ck_pr_load_64(&node->query_time_ns);
+    const uint64_t failures = ck_pr_load_64(&node->failures);
+
+    const uint64_t nqueries = queries - node->last_queries;
+    const uint64_t ntime_ns = time_ns - node->last_query_time_ns;
+
+    if (node->socket != NULL)
+      snprintf(name, sizeof(name), "%s", node->socket);
+    else
+      snprintf(name, sizeof(name), "%s:%u", node->host, node->port);
+
+    log_text(LOG_NOTICE, "    %s%s:", name,
+             node->role == DB_ROLE_WRITE ? " (writable)" :
+             node->role == DB_ROLE_READ ? " (read-only)" : "");
+    log_text(LOG_NOTICE, "        queries:                         %-6"
+             PRIu64 " (%.2f per sec.)", nqueries, nqueries / seconds);
+    log_text(LOG_NOTICE, "        avg latency (ms):                %.2f",
+             nqueries > 0 ? NS2MS((double) ntime_ns / nqueries) : 0.0);
+    log_text(LOG_NOTICE, "        connections:                     %u",
+             node->nconns);
+    log_text(LOG_NOTICE, "        failures:                        %" PRIu64,
+             failures - node->last_failures);
+
+    node->last_queries = queries;
+    node->last_query_time_ns = time_ns;
+    node->last_failures = failures;
+  }
+
+  pthread_mutex_unlock(&nodes_mutex);
+}
+
+
 /* Uninitialize driver */
 int mysql_drv_done(void)
 {
+  free(nodes);
+  nodes = NULL;
+
   if (args.dry_run)
     return 0;
 
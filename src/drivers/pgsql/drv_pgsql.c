@@ -32,12 +32,37 @@
 #include "sb_options.h"
 #include "db_driver.h"
 #include "sb_rand.h"
+#include "sb_poll.h"
 
 #define xfree(ptr) ({ if (ptr) free((void *)ptr); ptr = NULL; })
 
 /* Maximum length of text representation of bind parameters */
 #define MAX_PARAM_LENGTH 256UL
 
+/* Number of rows received at once in the chunked rows mode */
+#define STREAM_CHUNK_ROWS 256
+
+/* Parameter and result formats */
+#define PG_FORMAT_TEXT   0
+#define PG_FORMAT_BINARY 1
+
+/* Type OIDs of binary values handled by the driver */
+#define PG_OID_NAME        19
+#define PG_OID_INT8        20
+#define PG_OID_INT2        21
+#define PG_OID_INT4        23
+#define PG_OID_TEXT        25
+#define PG_OID_FLOAT4      700
+#define PG_OID_FLOAT8      701
+#define PG_OID_BPCHAR      1042
+#define PG_OID_VARCHAR     1043
+#define PG_OID_TIMESTAMP   1114
+#define PG_OID_TIMESTAMPTZ 1184
+
+/* Days between the Unix epoch and the PostgreSQL one (2000-01-01) */
+#define PG_EPOCH_DAYS 10957
+#define USEC_PER_DAY  86400000000LL
+
 /* PostgreSQL driver arguments */
 
 static sb_arg_t pgsql_drv_args[] =
@@ -48,6 +73,7 @@ static sb_arg_t pgsql_drv_args[] =
   SB_OPT("pgsql-password", "PostgreSQL password", "", STRING),
   SB_OPT("pgsql-db", "PostgreSQL database name", "sbtest", STRING),
   SB_OPT("pgsql-sslmode", "PostgreSQL SSL mode (disable, allow, prefer, require, verify-ca, verify-full)", "prefer", STRING),
+  SB_OPT("pgsql-binary", "Use the binary format for numeric, timestamp and string parameters and bound results of prepared statements", "on", BOOL),
 
   SB_OPT_END
 };
@@ -59,6 +85,7 @@ typedef struct
   char               *user;
   char               *password;
   char               *db;
+  bool               binary;
 } pgsql_drv_args_t;
 
 /* Structure used for DB-to-PgSQL bind types map */
@@ -104,7 +131,13 @@ typedef struct pg_stmt
   int      prepared;
   int      nparams;
   Oid      *ptypes;
-  char     **pvalues;
+  char     **pvalues;     /* parameter buffers */
+  const char **params;    /* parameter values passed to libpq */
+  int      *plengths;     /* lengths of binary parameter values */
+  int      *pformats;     /* parameter formats */
+  db_bind_t *results;     /* buffers bound with pgsql_drv_bind_result() */
+  int      nresults;
+  int      rformat;       /* result format, -1 if not determined yet */
 } pg_stmt_t;
 
 static pgsql_drv_args_t args;          /* driver args */
@@ -128,7 +161,17 @@ static db_error_t pgsql_drv_query(db_conn_t *, const char *, size_t,
                                   db_result_t *);
 static int pgsql_drv_free_results(db_result_t *);
 static int pgsql_drv_close(db_stmt_t *);
+static db_error_t pgsql_drv_async_continue(db_conn_t *, db_result_t *, int);
+static int pgsql_drv_bulk_load(db_conn_t *, const char *, const char *,
+                               db_load_read_t *, void *);
 static int pgsql_drv_done(void);
+#ifdef LIBPQ_HAS_PIPELINING
+static int pgsql_drv_pipeline_begin(db_conn_t *);
+static db_error_t pgsql_drv_execute_async(db_stmt_t *, db_result_t *);
+static int pgsql_drv_pipeline_sync(db_conn_t *);
+static db_error_t pgsql_drv_pipeline_result(db_conn_t *, db_result_t *);
+static int pgsql_drv_pipeline_end(db_conn_t *, db_error_t);
+#endif
 
 /* PgSQL driver definition */
 
@@ -153,6 +196,15 @@ static db_driver_t pgsql_driver =
     .free_results = pgsql_drv_free_results,
     .close = pgsql_drv_close,
     .query = pgsql_drv_query,
+#ifdef LIBPQ_HAS_PIPELINING
+    .pipeline_begin = pgsql_drv_pipeline_begin,
+    .execute_async = pgsql_drv_execute_async,
+    .pipeline_sync = pgsql_drv_pipeline_sync,
+    .pipeline_result = pgsql_drv_pipeline_result,
+    .pipeline_end = pgsql_drv_pipeline_end,
+#endif
+    .async_continue = pgsql_drv_async_continue,
+    .bulk_load = pgsql_drv_bulk_load,
     .done = pgsql_drv_done
   }
 };
@@ -161,6 +213,12 @@ static db_driver_t pgsql_driver =
 /* Local functions */
 
 static int get_pgsql_bind_type(db_bind_type_t);
+static int pgsql_param_format(PGconn *, db_bind_type_t);
+static int pgsql_result_format(PGconn *, pg_stmt_t *, bool);
+static db_error_t pgsql_async_step(db_conn_t *, db_result_t *);
+static db_error_t pgsql_async_error(db_conn_t *, const char *, db_result_t *);
+static db_error_t pgsql_stream_start(db_conn_t *, const char *, const char *,
+                                     db_result_t *);
 static int get_unique_stmt_name(char *, int);
 
 /* Register PgSQL driver */
@@ -191,6 +249,8 @@ int pgsql_drv_init(void)
                    1);
   sprintf(args.db, "dbname=%s sslmode=%s", dbname, sslmode);
 
+  args.binary = sb_get_value_flag("pgsql-binary");
+
   use_ps = 0;
   pgsql_drv_caps.prepared_statements = 1;
   if (db_globals.ps_mode != DB_PS_MODE_DISABLE)
@@ -263,6 +323,15 @@ int pgsql_drv_connect(db_conn_t *sb_conn)
 
   /* Silence the default notice receiver spitting NOTICE message to stderr */
   PQsetNoticeProcessor(con, empty_notice_processor, NULL);
+
+  /* Queries are sent without blocking, connecting still blocks */
+  if (sb_conn->async && PQsetnonblocking(con, 1) != 0)
+  {
+    log_text(LOG_FATAL, "PQsetnonblocking() failed: %s", PQerrorMessage(con));
+    PQfinish(con);
+    return 1;
+  }
+
   sb_conn->ptr = con;
   
   return 0;
@@ -472,7 +541,11 @@ int pgsql_drv_bind_param(db_stmt_t *stmt, db_bind_t *params, size_t len)
   PQclear(pgres);
 
   pgstmt->pvalues = (char **)calloc(len, sizeof(char *));
-  if (pgstmt->pvalues == NULL)
+  pgstmt->params = (const char **)calloc(len, sizeof(char *));
+  pgstmt->plengths = (int *)calloc(len, sizeof(int));
+  pgstmt->pformats = (int *)calloc(len, sizeof(int));
+  if (pgstmt->pvalues == NULL || pgstmt->params == NULL ||
+      pgstmt->plengths == NULL || pgstmt->pformats == NULL)
     return 1;
       
   /* Allocate buffers for bind parameters */
@@ -486,6 +559,8 @@ int pgsql_drv_bind_param(db_stmt_t *stmt, db_bind_t *params, size_t len)
     pgstmt->pvalues[i] = (char *)malloc(MAX_PARAM_LENGTH);
     if (pgstmt->pvalues[i] == NULL)
       return 1;
+
+    pgstmt->pformats[i] = pgsql_param_format(con, params[i].type);
   }
   pgstmt->prepared = 1;
 
@@ -498,11 +573,23 @@ int pgsql_drv_bind_param(db_stmt_t *stmt, db_bind_t *params, size_t len)
 
 int pgsql_drv_bind_result(db_stmt_t *stmt, db_bind_t *params, size_t len)
 {
-  /* unused */
-  (void)stmt;
-  (void)params;
-  (void)len;
-  
+  pg_stmt_t    *pgstmt = stmt->ptr;
+
+  /* Results are only bound for server-side prepared statements */
+  if (stmt->emulated)
+    return 0;
+
+  if (pgstmt == NULL)
+    return 1;
+
+  free(pgstmt->results);
+  pgstmt->results = (db_bind_t *)malloc(len * sizeof(db_bind_t));
+  if (pgstmt->results == NULL)
+    return 1;
+  memcpy(pgstmt->results, params, len * sizeof(db_bind_t));
+  pgstmt->nresults = len;
+  pgstmt->rformat = -1;
+
   return 0;
 }
 
@@ -561,9 +648,15 @@ static db_error_t pgsql_check_status(db_conn_t *con, PGresult *pgres,
         !strcmp(con->sql_state, "23505") /* unique violation */ ||
         !strcmp(con->sql_state, "40001"))/* serialization_failure */
     {
-      PGresult *tmp;
-      tmp = PQexec(pgcon, "ROLLBACK");
-      PQclear(tmp);
+#ifdef LIBPQ_HAS_PIPELINING
+      /* In pipeline mode this is done by pgsql_drv_pipeline_end() */
+      if (PQpipelineStatus(pgcon) == PQ_PIPELINE_OFF)
+#endif
+      {
+        PGresult *tmp;
+        tmp = PQexec(pgcon, "ROLLBACK");
+        PQclear(tmp);
+      }
       rc = DB_ERROR_IGNORABLE;
     }
     else
@@ -591,6 +684,210 @@ static db_error_t pgsql_check_status(db_conn_t *con, PGresult *pgres,
 }
 
 
+/* Store an integer in the network byte order */
+
+
+static void pgsql_put_uint(char *buf, uint64_t val, int len)
+{
+  int i;
+
+  for (i = len - 1; i >= 0; i--)
+  {
+    buf[i] = (char) (val & 0xff);
+    val >>= 8;
+  }
+}
+
+
+/* Read an integer in the network byte order */
+
+
+static int64_t pgsql_get_int(const char *buf, int len)
+{
+  uint64_t val = 0;
+  int      i;
+
+  for (i = 0; i < len; i++)
+    val = (val << 8) | (unsigned char) buf[i];
+
+  /* Sign-extend values shorter than 64 bits */
+  if (len < 8 && (val & (1ULL << (len * 8 - 1))))
+    val |= ~0ULL << (len * 8);
+
+  return (int64_t) val;
+}
+
+
+/* Convert a date to the number of days since the Unix epoch */
+
+
+static int64_t pgsql_days_from_civil(int y, unsigned int m, unsigned int d)
+{
+  int64_t      era;
+  unsigned int yoe, doy, doe;
+
+  y -= m <= 2;
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = (unsigned int) (y - era * 400);
+  doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + (int64_t) doe - 719468;
+}
+
+
+/* Convert the number of days since the Unix epoch to a date */
+
+
+static void pgsql_civil_from_days(int64_t z, db_time_t *tm)
+{
+  int64_t      era;
+  unsigned int doe, yoe, doy, mp;
+
+  z += 719468;
+  era = (z >= 0 ? z : z - 146096) / 146097;
+  doe = (unsigned int) (z - era * 146097);
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+
+  tm->day = doy - (153 * mp + 2) / 5 + 1;
+  tm->month = mp < 10 ? mp + 3 : mp - 9;
+  tm->year = (unsigned int) (yoe + era * 400 + (tm->month <= 2));
+}
+
+
+/*
+  Convert a binary timestamp, i.e. the number of microseconds since the
+  PostgreSQL epoch, to db_time_t and back
+*/
+
+
+static int64_t pgsql_timestamp_from_time(const db_time_t *tm)
+{
+  int64_t days = pgsql_days_from_civil((int) tm->year, tm->month, tm->day) -
+    PG_EPOCH_DAYS;
+
+  return (days * 86400 + tm->hour * 3600 + tm->minute * 60 + tm->second) *
+    1000000;
+}
+
+
+static void pgsql_time_from_timestamp(int64_t ts, db_time_t *tm)
+{
+  int64_t days = ts / USEC_PER_DAY;
+  int64_t secs;
+
+  ts %= USEC_PER_DAY;
+  if (ts < 0)
+  {
+    ts += USEC_PER_DAY;
+    days--;
+  }
+  secs = ts / 1000000;
+
+  pgsql_civil_from_days(days + PG_EPOCH_DAYS, tm);
+  tm->hour = (unsigned int) (secs / 3600);
+  tm->minute = (unsigned int) (secs / 60 % 60);
+  tm->second = (unsigned int) (secs % 60);
+}
+
+
+/*
+  Encode a parameter value in the binary format. Binary values of numeric types
+  are in the network byte order, string values are sent as is.
+*/
+
+
+static void pgsql_bind_binary(db_bind_t *bind, pg_stmt_t *pgstmt, int i)
+{
+  char     *buf = pgstmt->pvalues[i];
+  uint32_t u32;
+  uint64_t u64;
+
+  switch (bind->type) {
+    case DB_TYPE_SMALLINT:
+      pgsql_put_uint(buf, (uint64_t) *(short *) bind->buffer, 2);
+      pgstmt->plengths[i] = 2;
+      break;
+    case DB_TYPE_INT:
+      pgsql_put_uint(buf, (uint64_t) *(int *) bind->buffer, 4);
+      pgstmt->plengths[i] = 4;
+      break;
+    case DB_TYPE_BIGINT:
+      pgsql_put_uint(buf, (uint64_t) *(long long *) bind->buffer, 8);
+      pgstmt->plengths[i] = 8;
+      break;
+    case DB_TYPE_FLOAT:
+      memcpy(&u32, bind->buffer, sizeof(u32));
+      pgsql_put_uint(buf, u32, 4);
+      pgstmt->plengths[i] = 4;
+      break;
+    case DB_TYPE_DOUBLE:
+      memcpy(&u64, bind->buffer, sizeof(u64));
+      pgsql_put_uint(buf, u64, 8);
+      pgstmt->plengths[i] = 8;
+      break;
+    case DB_TYPE_TIMESTAMP:
+      pgsql_put_uint(buf, (uint64_t) pgsql_timestamp_from_time(bind->buffer),
+                     8);
+      pgstmt->plengths[i] = 8;
+      break;
+    case DB_TYPE_VARCHAR:
+      /* No need to copy the value or to zero-terminate it */
+      pgstmt->params[i] = bind->buffer;
+      pgstmt->plengths[i] = (int) bind->data_len[0];
+      break;
+    default:
+      break;
+  }
+}
+
+
+/* Convert sysbench bind structures to PgSQL data */
+
+
+static void pgsql_bind_values(db_stmt_t *stmt, pg_stmt_t *pgstmt)
+{
+  unsigned int    i;
+  unsigned long   len;
+
+  for (i = 0; i < (unsigned)pgstmt->nparams; i++)
+  {
+    if (stmt->bound_param[i].is_null && *(stmt->bound_param[i].is_null))
+    {
+      pgstmt->params[i] = NULL;
+      continue;
+    }
+
+    pgstmt->params[i] = pgstmt->pvalues[i];
+
+    if (pgstmt->pformats[i] == PG_FORMAT_BINARY)
+    {
+      pgsql_bind_binary(stmt->bound_param + i, pgstmt, i);
+      continue;
+    }
+
+    switch (stmt->bound_param[i].type) {
+      case DB_TYPE_CHAR:
+      case DB_TYPE_VARCHAR:
+
+        len = stmt->bound_param[i].data_len[0];
+
+        memcpy(pgstmt->pvalues[i], stmt->bound_param[i].buffer,
+               SB_MIN(MAX_PARAM_LENGTH, len));
+        /* PostgreSQL requires a zero-terminated string */
+        pgstmt->pvalues[i][len] = '\0';
+
+        break;
+      default:
+        db_print_value(stmt->bound_param + i, pgstmt->pvalues[i],
+                       MAX_PARAM_LENGTH);
+    }
+  }
+}
+
+
 /* Execute prepared statement */
 
 
@@ -600,13 +897,10 @@ db_error_t pgsql_drv_execute(db_stmt_t *stmt, db_result_t *rs)
   PGconn          *pgcon = (PGconn *)con->ptr;
   PGresult        *pgres;
   pg_stmt_t       *pgstmt;
-  char            *buf = NULL;
-  unsigned int    buflen = 0;
-  unsigned int    i, j, vcnt;
-  char            need_realloc;
-  int             n;
+  const char      *buf;
+  size_t          len;
   db_error_t      rc;
-  unsigned long   len;
+  int             rformat;
 
   con->sql_errno = 0;
   xfree(con->sql_state);
@@ -622,32 +916,32 @@ db_error_t pgsql_drv_execute(db_stmt_t *stmt, db_result_t *rs)
       return DB_ERROR_FATAL;
     }
 
-    /* Convert sysbench bind structures to PgSQL data */
-    for (i = 0; i < (unsigned)pgstmt->nparams; i++)
-    {
-      if (stmt->bound_param[i].is_null && *(stmt->bound_param[i].is_null))
-        continue;
+    pgsql_bind_values(stmt, pgstmt);
+    rformat = pgsql_result_format(pgcon, pgstmt, !con->async);
 
-      switch (stmt->bound_param[i].type) {
-        case DB_TYPE_CHAR:
-        case DB_TYPE_VARCHAR:
+    if (con->async)
+    {
+      if (!PQsendQueryPrepared(pgcon, pgstmt->name, pgstmt->nparams,
+                               pgstmt->params, pgstmt->plengths,
+                               pgstmt->pformats, rformat))
+        return pgsql_async_error(con, "PQsendQueryPrepared", rs);
 
-          len = stmt->bound_param[i].data_len[0];
+      return pgsql_async_step(con, rs);
+    }
 
-          memcpy(pgstmt->pvalues[i], stmt->bound_param[i].buffer,
-                 SB_MIN(MAX_PARAM_LENGTH, len));
-          /* PostgreSQL requires a zero-terminated string */
-          pgstmt->pvalues[i][len] = '\0';
+    if (db_globals.stream_results)
+    {
+      if (!PQsendQueryPrepared(pgcon, pgstmt->name, pgstmt->nparams,
+                               pgstmt->params, pgstmt->plengths,
+                               pgstmt->pformats, rformat))
+        return pgsql_async_error(con, "PQsendQueryPrepared", rs);
 
-          break;
-        default:
-          db_print_value(stmt->bound_param + i, pgstmt->pvalues[i],
-                         MAX_PARAM_LENGTH);
-      }
+      return pgsql_stream_start(con, "PQsendQueryPrepared", NULL, rs);
     }
 
     pgres = PQexecPrepared(pgcon, pgstmt->name, pgstmt->nparams,
-                           (const char **)pgstmt->pvalues, NULL, NULL, 1);
+                           pgstmt->params, pgstmt->plengths,
+                           pgstmt->pformats, rformat);
 
     rc = pgsql_check_status(con, pgres, "PQexecPrepared", NULL, rs);
 
@@ -657,45 +951,198 @@ db_error_t pgsql_drv_execute(db_stmt_t *stmt, db_result_t *rs)
   }
 
   /* Use emulation */
-  /* Build the actual query string from parameters list */
-  need_realloc = 1;
-  vcnt = 0;
-  for (i = 0, j = 0; stmt->query[i] != '\0'; i++)
+  if ((buf = db_emulate_query(stmt, 0, &len)) == NULL)
+    return DB_ERROR_FATAL;
+
+  return pgsql_drv_query(con, buf, len, rs);
+}
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+/* Enter pipeline mode */
+
+
+int pgsql_drv_pipeline_begin(db_conn_t *sb_conn)
+{
+  PGconn *pgcon = sb_conn->ptr;
+
+  sb_conn->sql_errno = 0;
+  xfree(sb_conn->sql_state);
+  xfree(sb_conn->sql_errmsg);
+
+  if (!PQenterPipelineMode(pgcon))
   {
-  again:
-    if (j+1 >= buflen || need_realloc)
+    log_text(LOG_FATAL, "PQenterPipelineMode() failed: %s",
+             PQerrorMessage(pgcon));
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/* Queue prepared statement in pipeline mode */
+
+
+db_error_t pgsql_drv_execute_async(db_stmt_t *stmt, db_result_t *rs)
+{
+  db_conn_t       *con = stmt->connection;
+  PGconn          *pgcon = (PGconn *)con->ptr;
+  pg_stmt_t       *pgstmt;
+  const char      *buf;
+  size_t          len;
+  const char      *funcname;
+  int             sent;
+
+  if (!stmt->emulated)
+  {
+    pgstmt = stmt->ptr;
+    if (pgstmt == NULL)
     {
-      buflen = (buflen > 0) ? buflen * 2 : 256;
-      buf = realloc(buf, buflen);
-      if (buf == NULL)
-        return DB_ERROR_FATAL;
-      need_realloc = 0;
+      log_text(LOG_DEBUG, "ERROR: exiting pgsql_drv_execute_async(), "
+               "uninitialized statement");
+      return DB_ERROR_FATAL;
     }
 
-    if (stmt->query[i] != '?')
+    pgsql_bind_values(stmt, pgstmt);
+
+    funcname = "PQsendQueryPrepared";
+    sent = PQsendQueryPrepared(pgcon, pgstmt->name, pgstmt->nparams,
+                               pgstmt->params, pgstmt->plengths,
+                               pgstmt->pformats,
+                               pgsql_result_format(pgcon, pgstmt, false));
+  }
+  else
+  {
+    /* Simple query protocol is not allowed in pipeline mode */
+    if ((buf = db_emulate_query(stmt, 0, &len)) == NULL)
+      return DB_ERROR_FATAL;
+
+    funcname = "PQsendQueryParams";
+    sent = PQsendQueryParams(pgcon, buf, 0, NULL, NULL, NULL, NULL, 0);
+  }
+
+  if (!sent)
+  {
+    log_text(LOG_FATAL, "%s() failed: %s", funcname, PQerrorMessage(pgcon));
+    rs->counter = SB_CNT_ERROR;
+    return DB_ERROR_FATAL;
+  }
+
+  return DB_ERROR_NONE;
+}
+
+
+/* Send queued statements followed by a synchronization point */
+
+
+int pgsql_drv_pipeline_sync(db_conn_t *sb_conn)
+{
+  PGconn *pgcon = sb_conn->ptr;
+
+  if (!PQpipelineSync(pgcon))
+  {
+    log_text(LOG_FATAL, "PQpipelineSync() failed: %s", PQerrorMessage(pgcon));
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/* Retrieve the result of the next queued statement */
+
+
+db_error_t pgsql_drv_pipeline_result(db_conn_t *sb_conn, db_result_t *rs)
+{
+  PGconn         *pgcon = sb_conn->ptr;
+  PGresult       *pgres;
+  PGresult       *tmp;
+  db_error_t     rc;
+
+  rs->ptr = NULL;
+
+  pgres = PQgetResult(pgcon);
+  if (pgres == NULL)
+  {
+    log_text(LOG_FATAL, "PQgetResult() failed: %s", PQerrorMessage(pgcon));
+    rs->nrows = 0;
+    rs->counter = SB_CNT_ERROR;
+    return DB_ERROR_FATAL;
+  }
+
+  if (PQresultStatus(pgres) == PGRES_PIPELINE_ABORTED)
+  {
+    /* Skipped by the server due to an error in a previous statement */
+    PQclear(pgres);
+    rs->nrows = 0;
+    rs->counter = SB_CNT_MAX;
+    rc = DB_ERROR_NONE;
+  }
+  else
+  {
+    rc = pgsql_check_status(sb_conn, pgres, "PQgetResult", NULL, rs);
+    rs->ptr = (rs->counter == SB_CNT_READ) ? (void *) pgres : NULL;
+  }
+
+  /* Results of each statement are terminated with a NULL pointer */
+  while ((tmp = PQgetResult(pgcon)) != NULL)
+    PQclear(tmp);
+
+  return rc;
+}
+
+
+/* Leave pipeline mode */
+
+
+int pgsql_drv_pipeline_end(db_conn_t *sb_conn, db_error_t err)
+{
+  PGconn         *pgcon = sb_conn->ptr;
+  PGresult       *pgres;
+  ExecStatusType status;
+  int            nulls = 0;
+
+  /*
+    Skip any remaining results up to the synchronization point. Two NULL
+    results in a row mean there is nothing left to read, e.g. if the
+    synchronization point has not been sent due to an error.
+  */
+  while (nulls < 2)
+  {
+    if ((pgres = PQgetResult(pgcon)) == NULL)
     {
-      buf[j++] = stmt->query[i];
+      nulls++;
       continue;
     }
 
-    n = db_print_value(stmt->bound_param + vcnt, buf + j, buflen - j);
-    if (n < 0)
-    {
-      need_realloc = 1;
-      goto again;
-    }
-    j += n;
-    vcnt++;
+    nulls = 0;
+    status = PQresultStatus(pgres);
+    PQclear(pgres);
+
+    if (status == PGRES_PIPELINE_SYNC)
+      break;
   }
-  buf[j] = '\0';
 
-  rc = pgsql_drv_query(con, buf, j, rs);
+  if (!PQexitPipelineMode(pgcon))
+  {
+    log_text(LOG_FATAL, "PQexitPipelineMode() failed: %s",
+             PQerrorMessage(pgcon));
+    return 1;
+  }
 
-  free(buf);
+  /* The transaction is aborted, see pgsql_check_status() */
+  if (err == DB_ERROR_IGNORABLE)
+  {
+    pgres = PQexec(pgcon, "ROLLBACK");
+    PQclear(pgres);
+  }
 
-  return rc;
+  return 0;
 }
 
+#endif /* LIBPQ_HAS_PIPELINING */
+
 
 /* Execute SQL query */
 
@@ -713,6 +1160,23 @@ db_error_t pgsql_drv_query(db_conn_t *sb_conn, const char *query, size_t len,
   xfree(sb_conn->sql_state);
   xfree(sb_conn->sql_errmsg);
 
+  if (sb_conn->async)
+  {
+    /* The query is copied to the output buffer, so it may be freed on return */
+    if (!PQsendQuery(pgcon, query))
+      return pgsql_async_error(sb_conn, "PQsendQuery", rs);
+
+    return pgsql_async_step(sb_conn, rs);
+  }
+
+  if (db_globals.stream_results)
+  {
+    if (!PQsendQuery(pgcon, query))
+      return pgsql_async_error(sb_conn, "PQsendQuery", rs);
+
+    return pgsql_stream_start(sb_conn, "PQsendQuery", query, rs);
+  }
+
   pgres = PQexec(pgcon, query);
   rc = pgsql_check_status(sb_conn, pgres, "PQexec", query, rs);
 
@@ -722,15 +1186,484 @@ db_error_t pgsql_drv_query(db_conn_t *sb_conn, const char *query, size_t len,
 }
 
 
-/* Fetch row from result set of a prepared statement */
+/* Load rows into a table with COPY FROM STDIN */
+
+
+int pgsql_drv_bulk_load(db_conn_t *sb_conn, const char *table,
+                        const char *columns, db_load_read_t *read, void *arg)
+{
+  PGconn         *pgcon = sb_conn->ptr;
+  PGresult       *pgres;
+  char           query[256];
+  char           buf[65536];
+  int            n;
+  int            rc = 0;
+
+  snprintf(query, sizeof(query), "COPY %s (%s) FROM STDIN", table, columns);
+
+  pgres = PQexec(pgcon, query);
+  if (PQresultStatus(pgres) != PGRES_COPY_IN)
+  {
+    log_text(LOG_FATAL, "%s failed: %s", query, PQerrorMessage(pgcon));
+    PQclear(pgres);
+    return 1;
+  }
+  PQclear(pgres);
+
+  while ((n = read(arg, buf, sizeof(buf))) > 0)
+  {
+    if (PQputCopyData(pgcon, buf, n) != 1)
+    {
+      log_text(LOG_FATAL, "PQputCopyData() failed: %s", PQerrorMessage(pgcon));
+      return 1;
+    }
+  }
+
+  if (PQputCopyEnd(pgcon, n < 0 ? "failed to generate rows" : NULL) != 1)
+  {
+    log_text(LOG_FATAL, "PQputCopyEnd() failed: %s", PQerrorMessage(pgcon));
+    return 1;
+  }
+
+  while ((pgres = PQgetResult(pgcon)) != NULL)
+  {
+    if (PQresultStatus(pgres) != PGRES_COMMAND_OK)
+    {
+      log_text(LOG_FATAL, "%s failed: %s", query,
+               PQresultErrorMessage(pgres));
+      rc = 1;
+    }
+    PQclear(pgres);
+  }
+
+  return rc || n < 0;
+}
+
+
+/* Handle a connection error of a query sent on a non-blocking connection */
+
+
+static db_error_t pgsql_async_error(db_conn_t *con, const char *funcname,
+                                    db_result_t *rs)
+{
+  PGconn *pgcon = con->ptr;
+
+  if (rs->ptr != NULL)
+  {
+    PQclear(rs->ptr);
+    rs->ptr = NULL;
+  }
+
+  xfree(con->sql_errmsg);
+  con->sql_errmsg = strdup(PQerrorMessage(pgcon));
+
+  log_text(LOG_FATAL, "%s() failed: %s", funcname, con->sql_errmsg);
+
+  rs->nrows = 0;
+  rs->counter = SB_CNT_ERROR;
+
+  return DB_ERROR_FATAL;
+}
+
+
+/* Check if a result is a part of a streamed result set */
+
+
+static inline bool pgsql_stream_chunk(PGresult *pgres)
+{
+  switch (PQresultStatus(pgres)) {
+  case PGRES_SINGLE_TUPLE:
+#ifdef LIBPQ_HAS_CHUNK_MODE
+  case PGRES_TUPLES_CHUNK:
+#endif
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+/* Discard the remaining results of a query */
+
+
+static void pgsql_stream_discard(PGconn *pgcon)
+{
+  PGresult *pgres;
+
+  while ((pgres = PQgetResult(pgcon)) != NULL)
+    PQclear(pgres);
+}
+
+
+/*
+  Start receiving the result of a query sent with PQsendQuery*() in the
+  single-row mode, or the chunked rows mode if supported by libpq. Rows are then
+  retrieved by pgsql_drv_fetch_row() as they arrive from the server. Any other
+  result is processed like PQexec() would return it.
+*/
+
+
+static db_error_t pgsql_stream_start(db_conn_t *con, const char *funcname,
+                                     const char *query, db_result_t *rs)
+{
+  PGconn         *pgcon = con->ptr;
+  PGresult       *pgres;
+  db_error_t     rc;
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+  PQsetChunkedRowsMode(pgcon, STREAM_CHUNK_ROWS);
+#else
+  PQsetSingleRowMode(pgcon);
+#endif
+
+  if ((pgres = PQgetResult(pgcon)) == NULL)
+    return pgsql_async_error(con, "PQgetResult", rs);
+
+  if (pgsql_stream_chunk(pgres))
+  {
+    rs->ptr = pgres;
+    rs->nrows = 0;
+    rs->nfields = PQnfields(pgres);
+    rs->counter = SB_CNT_READ;
+    rs->streamed = true;
+
+    return DB_ERROR_NONE;
+  }
+
+  pgsql_stream_discard(pgcon);
+
+  rc = pgsql_check_status(con, pgres, funcname, query, rs);
+
+  rs->ptr = (rs->counter == SB_CNT_READ) ? (void *) pgres : NULL;
+
+  return rc;
+}
+
+
+/*
+  Advance a query sent on a non-blocking connection as far as possible without
+  blocking. Results received so far are kept in rs->ptr. Once all of them are
+  received, the last one is processed like PQexec() would return it. Otherwise
+  db_conn_t::async_events is set to the events to wait for.
+*/
+
+
+static db_error_t pgsql_async_step(db_conn_t *con, db_result_t *rs)
+{
+  PGconn         *pgcon = con->ptr;
+  PGresult       *pgres;
+  db_error_t     rc;
+  int            flush;
+
+  /*
+    If the query has not been sent completely, wait until the socket is
+    writable. Input must be consumed meanwhile, as the server may block on
+    sending results before reading the rest of the query.
+  */
+  if ((flush = PQflush(pgcon)) != 0)
+  {
+    if (flush < 0)
+      return pgsql_async_error(con, "PQflush", rs);
+
+    if (!PQconsumeInput(pgcon))
+      return pgsql_async_error(con, "PQconsumeInput", rs);
+
+    con->async_fd = PQsocket(pgcon);
+    con->async_events = SB_POLL_READ | SB_POLL_WRITE;
+
+    return DB_ERROR_NONE;
+  }
+
+  if (!PQconsumeInput(pgcon))
+    return pgsql_async_error(con, "PQconsumeInput", rs);
+
+  while (!PQisBusy(pgcon))
+  {
+    pgres = PQgetResult(pgcon);
+
+    if (pgres == NULL)
+    {
+      /* All results are received */
+      pgres = rs->ptr;
+      rs->ptr = NULL;
+
+      if (pgres == NULL)
+        return pgsql_async_error(con, "PQgetResult", rs);
+
+      rc = pgsql_check_status(con, pgres, "PQgetResult", NULL, rs);
+
+      rs->ptr = (rs->counter == SB_CNT_READ) ? (void *) pgres : NULL;
+
+      return rc;
+    }
+
+    /* Keep the last result like PQexec() does, unless there was an error */
+    if (rs->ptr != NULL && PQresultStatus(rs->ptr) == PGRES_FATAL_ERROR)
+      PQclear(pgres);
+    else
+    {
+      if (rs->ptr != NULL)
+        PQclear(rs->ptr);
+      rs->ptr = pgres;
+    }
+  }
+
+  con->async_fd = PQsocket(pgcon);
+  con->async_events = SB_POLL_READ;
+
+  return DB_ERROR_NONE;
+}
+
+
+/* Continue a query sent on a non-blocking connection */
+
+
+db_error_t pgsql_drv_async_continue(db_conn_t *sb_conn, db_result_t *rs,
+                                    int events)
+{
+  (void) events; /* unused, the socket is polled by libpq calls */
+
+  return pgsql_async_step(sb_conn, rs);
+}
+
+
+/* Copy a string result value into a bound buffer, truncating it if necessary */
+
+
+static void pgsql_store_chars(db_bind_t *bind, const char *val, int len)
+{
+  *bind->data_len = SB_MIN((unsigned long) len, bind->max_len);
+  memcpy(bind->buffer, val, *bind->data_len);
+}
+
+
+/* Store an integer result value into a bound buffer */
+
+
+static void pgsql_store_int(db_bind_t *bind, int64_t val)
+{
+  char tmp[32];
+
+  switch (bind->type) {
+    case DB_TYPE_TINYINT:
+      *(char *) bind->buffer = (char) val;
+      break;
+    case DB_TYPE_SMALLINT:
+      *(short *) bind->buffer = (short) val;
+      break;
+    case DB_TYPE_INT:
+      *(int *) bind->buffer = (int) val;
+      break;
+    case DB_TYPE_BIGINT:
+      *(long long *) bind->buffer = val;
+      break;
+    case DB_TYPE_FLOAT:
+      *(float *) bind->buffer = (float) val;
+      break;
+    case DB_TYPE_DOUBLE:
+      *(double *) bind->buffer = (double) val;
+      break;
+    case DB_TYPE_CHAR:
+    case DB_TYPE_VARCHAR:
+      pgsql_store_chars(bind, tmp,
+                        snprintf(tmp, sizeof(tmp), "%lld", (long long) val));
+      break;
+    default:
+      break;
+  }
+}
+
+
+/* Store a floating point result value into a bound buffer */
+
+
+static void pgsql_store_double(db_bind_t *bind, double val)
+{
+  char tmp[32];
+
+  switch (bind->type) {
+    case DB_TYPE_FLOAT:
+      *(float *) bind->buffer = (float) val;
+      break;
+    case DB_TYPE_DOUBLE:
+      *(double *) bind->buffer = val;
+      break;
+    case DB_TYPE_CHAR:
+    case DB_TYPE_VARCHAR:
+      pgsql_store_chars(bind, tmp, snprintf(tmp, sizeof(tmp), "%g", val));
+      break;
+    default:
+      pgsql_store_int(bind, (int64_t) val);
+      break;
+  }
+}
+
+
+/* Store a string result value into a bound buffer */
+
+
+static void pgsql_store_str(db_bind_t *bind, const char *val, int len)
+{
+  db_time_t *tm = bind->buffer;
+
+  switch (bind->type) {
+    case DB_TYPE_CHAR:
+    case DB_TYPE_VARCHAR:
+      pgsql_store_chars(bind, val, len);
+      break;
+    case DB_TYPE_FLOAT:
+    case DB_TYPE_DOUBLE:
+      pgsql_store_double(bind, strtod(val, NULL));
+      break;
+    case DB_TYPE_DATE:
+    case DB_TYPE_TIME:
+    case DB_TYPE_DATETIME:
+    case DB_TYPE_TIMESTAMP:
+      memset(tm, 0, sizeof(*tm));
+      if (bind->type == DB_TYPE_TIME)
+        sscanf(val, "%u:%u:%u", &tm->hour, &tm->minute, &tm->second);
+      else
+        sscanf(val, "%u-%u-%u %u:%u:%u", &tm->year, &tm->month, &tm->day,
+               &tm->hour, &tm->minute, &tm->second);
+      break;
+    default:
+      pgsql_store_int(bind, strtoll(val, NULL, 10));
+      break;
+  }
+}
+
+
+/* Store a binary result value of a given type into a bound buffer */
+
+
+static void pgsql_store_binary(db_bind_t *bind, Oid type, const char *val,
+                               int len)
+{
+  uint64_t u64;
+  uint32_t u32;
+  float    f;
+  double   d;
+
+  switch (type) {
+    case PG_OID_INT2:
+    case PG_OID_INT4:
+    case PG_OID_INT8:
+      pgsql_store_int(bind, pgsql_get_int(val, len));
+      break;
+    case PG_OID_FLOAT4:
+      u32 = (uint32_t) pgsql_get_int(val, 4);
+      memcpy(&f, &u32, sizeof(f));
+      pgsql_store_double(bind, f);
+      break;
+    case PG_OID_FLOAT8:
+      u64 = (uint64_t) pgsql_get_int(val, 8);
+      memcpy(&d, &u64, sizeof(d));
+      pgsql_store_double(bind, d);
+      break;
+    case PG_OID_TIMESTAMP:
+    case PG_OID_TIMESTAMPTZ:
+      if (bind->type == DB_TYPE_DATE || bind->type == DB_TYPE_TIME ||
+          bind->type == DB_TYPE_DATETIME || bind->type == DB_TYPE_TIMESTAMP)
+        pgsql_time_from_timestamp(pgsql_get_int(val, 8), bind->buffer);
+      break;
+    default:
+      /* Text types */
+      if (bind->type == DB_TYPE_CHAR || bind->type == DB_TYPE_VARCHAR)
+        pgsql_store_chars(bind, val, len);
+      break;
+  }
+}
+
+
+/*
+  Advance to the next row of a result set. For streamed result sets, the next
+  part of the result set is received when the current one is read.
+*/
+
+
+static int pgsql_next_row(db_result_t *rs, intptr_t *rownum)
+{
+  if (!rs->streamed)
+    return (*rownum < (int) rs->nrows) ? DB_ERROR_NONE : DB_ERROR_IGNORABLE;
+
+  if (rs->ptr == NULL)
+    return DB_ERROR_IGNORABLE;
+
+  if (*rownum >= PQntuples(rs->ptr))
+  {
+    db_conn_t *con = SB_CONTAINER_OF(rs, db_conn_t, rs);
+    PGresult  *pgres;
+
+    PQclear(rs->ptr);
+    rs->ptr = NULL;
+    rs->row.ptr = NULL;
+    *rownum = 0;
+
+    pgres = PQgetResult(con->ptr);
+
+    if (pgres == NULL || !pgsql_stream_chunk(pgres))
+    {
+      if (pgres != NULL && PQresultStatus(pgres) != PGRES_TUPLES_OK)
+        log_text(LOG_FATAL, "PQgetResult() failed: %s",
+                 PQresultErrorMessage(pgres));
+
+      PQclear(pgres);
+      pgsql_stream_discard(con->ptr);
+
+      return DB_ERROR_IGNORABLE;
+    }
+
+    rs->ptr = pgres;
+  }
+
+  rs->nrows++;
+
+  return DB_ERROR_NONE;
+}
+
+
+/* Fetch row from result set of a prepared statement into bound buffers */
 
 
 int pgsql_drv_fetch(db_result_t *rs)
 {
-  /* NYI */
-  (void)rs;
+  pg_stmt_t *pgstmt = rs->statement->ptr;
+  intptr_t  rownum = (intptr_t) rs->row.ptr;
+  db_bind_t *bind;
+  char      *value;
+  int       len;
+  int       i;
 
-  return 1;
+  if (pgstmt == NULL || pgstmt->nresults == 0 ||
+      pgsql_next_row(rs, &rownum) != DB_ERROR_NONE)
+    return 1;
+
+  for (i = 0; i < (int) SB_MIN(rs->nfields, (unsigned) pgstmt->nresults); i++)
+  {
+    bind = pgstmt->results + i;
+
+    if (PQgetisnull(rs->ptr, rownum, i))
+    {
+      if (bind->is_null != NULL)
+        *bind->is_null = 1;
+      continue;
+    }
+
+    if (bind->is_null != NULL)
+      *bind->is_null = 0;
+
+    value = PQgetvalue(rs->ptr, rownum, i);
+    len = PQgetlength(rs->ptr, rownum, i);
+
+    if (PQfformat(rs->ptr, i) == PG_FORMAT_BINARY)
+      pgsql_store_binary(bind, PQftype(rs->ptr, i), value, len);
+    else
+      pgsql_store_str(bind, value, len);
+  }
+
+  rs->row.ptr = (void *) (rownum + 1);
+
+  return 0;
 }
 
 
@@ -747,7 +1680,8 @@ int pgsql_drv_fetch_row(db_result_t *rs, db_row_t *row)
     memory management.
   */
   rownum = (intptr_t) row->ptr;
-  if (rownum >= (int) rs->nrows)
+
+  if (pgsql_next_row(rs, &rownum) != DB_ERROR_NONE)
     return DB_ERROR_IGNORABLE;
 
   for (i = 0; i < (int) rs->nfields; i++)
@@ -776,6 +1710,20 @@ int pgsql_drv_fetch_row(db_result_t *rs, db_row_t *row)
 
 int pgsql_drv_free_results(db_result_t *rs)
 {
+  if (rs->streamed)
+  {
+    db_conn_t *con = SB_CONTAINER_OF(rs, db_conn_t, rs);
+
+    /* Receive and discard the rest of the result set */
+    PQclear(rs->ptr);
+    rs->ptr = NULL;
+    rs->row.ptr = 0;
+
+    pgsql_stream_discard(con->ptr);
+
+    return 0;
+  }
+
   if (rs->ptr != NULL)
   {
     PQclear((PGresult *)rs->ptr);
@@ -811,6 +1759,10 @@ int pgsql_drv_close(db_stmt_t *stmt)
         free(pgstmt->pvalues[i]);
     free(pgstmt->pvalues);
   }
+  free(pgstmt->params);
+  free(pgstmt->plengths);
+  free(pgstmt->pformats);
+  free(pgstmt->results);
 
   xfree(stmt->ptr);
 
@@ -840,6 +1792,114 @@ int get_pgsql_bind_type(db_bind_type_t type)
 }
 
 
+/* Get the format to send parameters of a given type in */
+
+
+int pgsql_param_format(PGconn *con, db_bind_type_t type)
+{
+  const char *val;
+
+  if (!args.binary)
+    return PG_FORMAT_TEXT;
+
+  switch (type) {
+    case DB_TYPE_SMALLINT:
+    case DB_TYPE_INT:
+    case DB_TYPE_BIGINT:
+    case DB_TYPE_FLOAT:
+    case DB_TYPE_DOUBLE:
+    case DB_TYPE_VARCHAR:
+      return PG_FORMAT_BINARY;
+    case DB_TYPE_TIMESTAMP:
+      /* Binary timestamps are only sent as integers */
+      val = PQparameterStatus(con, "integer_datetimes");
+      return (val != NULL && !strcmp(val, "on")) ?
+        PG_FORMAT_BINARY : PG_FORMAT_TEXT;
+    default:
+      /*
+        Either there is no binary representation, or the parameter type is
+        not known to the server (see db_pgsql_bind_map), or it is the
+        single-byte "char" type.
+      */
+      return PG_FORMAT_TEXT;
+  }
+}
+
+
+/* Check if binary values of a given type can be stored into bound buffers */
+
+
+static bool pgsql_binary_result_type(PGconn *con, Oid type)
+{
+  const char *val;
+
+  switch (type) {
+    case PG_OID_NAME:
+    case PG_OID_INT8:
+    case PG_OID_INT2:
+    case PG_OID_INT4:
+    case PG_OID_TEXT:
+    case PG_OID_FLOAT4:
+    case PG_OID_FLOAT8:
+    case PG_OID_BPCHAR:
+    case PG_OID_VARCHAR:
+      return true;
+    case PG_OID_TIMESTAMP:
+    case PG_OID_TIMESTAMPTZ:
+      val = PQparameterStatus(con, "integer_datetimes");
+      return val != NULL && !strcmp(val, "on");
+    default:
+      return false;
+  }
+}
+
+
+/*
+  Get the format to request results of a prepared statement in. Unless results
+  are bound, binary results are requested, as their values are not converted
+  anyway. Otherwise, the statement is described once to check if all columns
+  can be converted from the binary format. That requires a synchronous call,
+  so text results are requested until the statement is described.
+*/
+
+
+int pgsql_result_format(PGconn *con, pg_stmt_t *pgstmt, bool can_describe)
+{
+  PGresult *pgres;
+  int      i;
+
+  if (!args.binary)
+    return PG_FORMAT_TEXT;
+
+  if (pgstmt->nresults == 0)
+    return PG_FORMAT_BINARY;
+
+  if (pgstmt->rformat >= 0 || !can_describe)
+    return SB_MAX(pgstmt->rformat, PG_FORMAT_TEXT);
+
+  pgres = PQdescribePrepared(con, pgstmt->name);
+
+  if (PQresultStatus(pgres) == PGRES_COMMAND_OK)
+  {
+    pgstmt->rformat = PG_FORMAT_BINARY;
+
+    for (i = 0; i < PQnfields(pgres); i++)
+      if (!pgsql_binary_result_type(con, PQftype(pgres, i)))
+        pgstmt->rformat = PG_FORMAT_TEXT;
+  }
+  else
+  {
+    log_text(LOG_WARNING, "PQdescribePrepared() failed: %s",
+             PQerrorMessage(con));
+    pgstmt->rformat = PG_FORMAT_TEXT;
+  }
+
+  PQclear(pgres);
+
+  return pgstmt->rformat;
+}
+
+
 int get_unique_stmt_name(char *name, int len)
 {
   return snprintf(name, len, "sbstmt%d%d",
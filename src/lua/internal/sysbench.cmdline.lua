@@ -202,6 +202,19 @@ function sysbench.cmdline.call_command(name)
    end
 end
 
+ffi.cdef[[
+int sb_lua_cmd_barrier_wait(void);
+]]
+
+-- ----------------------------------------------------------------------
+-- Wait until all threads executing a parallel command reach this point. Threads
+-- that have finished executing the command are not waited for.
+-- ----------------------------------------------------------------------
+function sysbench.cmdline.barrier()
+   assert(ffi.C.sb_lua_cmd_barrier_wait() == 0,
+          "sb_lua_cmd_barrier_wait() failed")
+end
+
 ffi.cdef[[
 void sb_print_test_options(void);
 ]]
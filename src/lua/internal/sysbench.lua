@@ -20,34 +20,55 @@ ffi.cdef[[
 void sb_event_start(int thread_id);
 void sb_event_stop(int thread_id);
 bool sb_more_events(int thread_id);
+uint64_t sb_client_event_start(void);
+void sb_client_event_stop(int thread_id, uint64_t start_ns);
+
+typedef struct sb_poll sb_poll_t;
+sb_poll_t *sb_poll_create(void);
+void sb_poll_destroy(sb_poll_t *p);
+int sb_poll_add(sb_poll_t *p, int fd, int events, int id);
+int sb_poll_wait(sb_poll_t *p, int *ids, int *events, int max,
+                 int timeout_ms);
 ]]
 
+-- Execute event() until it succeeds, i.e. restart it on ignorable errors.
+-- Returns the value returned by event().
+local function run_event(thread_id)
+   local success, ret
+   repeat
+      success, ret = pcall(event, thread_id)
+
+      if not success then
+         if type(ret) == "table" and
+            ret.errcode == sysbench.error.RESTART_EVENT
+         then
+            if sysbench.hooks.before_restart_event then
+               sysbench.hooks.before_restart_event(ret)
+            end
+         else
+            error(ret, 0) -- propagate unknown errors
+         end
+      end
+   until success
+
+   return ret
+end
+
+local clients_run
+
 -- ----------------------------------------------------------------------
 -- Main event loop. This is a Lua version of sysbench.c:thread_run()
 -- ----------------------------------------------------------------------
 function thread_run(thread_id)
+   if sysbench.opt.clients > 0 then
+      return clients_run(thread_id)
+   end
+
    while ffi.C.sb_more_events(thread_id) do
       ffi.C.sb_event_start(thread_id)
 
-      local success, ret
-      repeat
-         success, ret = pcall(event, thread_id)
-
-         if not success then
-            if type(ret) == "table" and
-               ret.errcode == sysbench.error.RESTART_EVENT
-            then
-               if sysbench.hooks.before_restart_event then
-                  sysbench.hooks.before_restart_event(ret)
-               end
-            else
-               error(ret, 2) -- propagate unknown errors
-            end
-         end
-      until success
-
       -- Stop the benchmark if event() returns a value other than nil or false
-      if ret then
+      if run_event(thread_id) then
          break
       end
 
@@ -55,6 +76,171 @@ function thread_run(thread_id)
    end
 end
 
+-- ----------------------------------------------------------------------
+-- The --clients mode. Each worker thread runs its share of clients as
+-- coroutines calling thread_init(), event() and thread_done() with a client
+-- number in the 0..(--clients - 1) range as the argument. A coroutine is
+-- suspended while its non-blocking connection waits for the server (see
+-- sysbench.sql), and resumed by the thread event loop when the socket is
+-- ready. Global variables created by a client are only visible to that client,
+-- so scripts keeping per-thread state in globals work unmodified.
+-- ----------------------------------------------------------------------
+
+-- Yielded by clients to wait for other clients of the thread between
+-- thread_init(), events and thread_done()
+local CLIENT_PARKED = {}
+-- Yielded by clients after each event to let other clients run
+local CLIENT_READY = {}
+
+local clients = {}      -- clients of this thread
+local client_env        -- globals of the running client
+local poller            -- sb_poll_t of the thread
+
+local function client_main(thread_id, client)
+   if thread_init ~= nil then
+      thread_init(client.id)
+   end
+   coroutine.yield(CLIENT_PARKED)
+
+   while ffi.C.sb_more_events(thread_id) do
+      local start_ns = ffi.C.sb_client_event_start()
+
+      -- Stop the client if event() returns a value other than nil or false
+      if run_event(client.id) then
+         break
+      end
+
+      ffi.C.sb_client_event_stop(thread_id, start_ns)
+
+      coroutine.yield(CLIENT_READY)
+   end
+   coroutine.yield(CLIENT_PARKED)
+
+   if thread_done ~= nil then
+      thread_done(client.id)
+   end
+end
+
+-- Resume a client with given ready events of its connection, if any. Returns
+-- what it has yielded: a connection to wait for, CLIENT_READY or CLIENT_PARKED.
+-- Returns CLIENT_PARKED for a finished client as well.
+local function client_resume(client, events)
+   client_env = client.env
+   local ok, ret = coroutine.resume(client.co, events)
+   client_env = nil
+
+   if not ok then
+      error(ret, 0)
+   end
+
+   if coroutine.status(client.co) == "dead" then
+      return CLIENT_PARKED
+   end
+
+   return ret
+end
+
+-- Resume all parked clients of the thread and run them until every one of
+-- them is parked or finished again
+local function clients_schedule()
+   local ids = ffi.new("int[?]", #clients)
+   local events = ffi.new("int[?]", #clients)
+   local by_id = {}
+   local runnable = {}
+   local waiting = 0
+
+   for _, client in ipairs(clients) do
+      by_id[client.id] = client
+      if coroutine.status(client.co) == "suspended" then
+         runnable[#runnable + 1] = client
+      end
+   end
+
+   while #runnable > 0 or waiting > 0 do
+      if waiting > 0 then
+         -- Only check for ready connections if there are runnable clients
+         local n = ffi.C.sb_poll_wait(poller, ids, events, #clients,
+                                      #runnable > 0 and 0 or -1)
+         if n < 0 then
+            error("failed to wait for connections", 0)
+         end
+
+         for i = 0, n - 1 do
+            local client = by_id[ids[i]]
+            client.events = events[i]
+            runnable[#runnable + 1] = client
+         end
+         waiting = waiting - n
+      end
+
+      local batch = runnable
+      runnable = {}
+
+      for _, client in ipairs(batch) do
+         local ret = client_resume(client, client.events)
+         client.events = nil
+
+         if ret == CLIENT_READY then
+            runnable[#runnable + 1] = client
+         elseif ret ~= CLIENT_PARKED then
+            local con = ret
+            if ffi.C.sb_poll_add(poller, con:async_fd(), con:async_events(),
+                                 client.id) ~= 0 then
+               error("failed to wait for a connection", 0)
+            end
+            waiting = waiting + 1
+         end
+      end
+   end
+end
+
+function sysbench.clients_init(thread_id)
+   poller = ffi.C.sb_poll_create()
+   if poller == nil then
+      error("failed to create a poller", 0)
+   end
+
+   -- Route accesses to undefined globals to the running client
+   setmetatable(_G, {
+                   __index = function(_, k)
+                      if client_env ~= nil then
+                         return client_env[k]
+                      end
+                   end,
+                   __newindex = function(t, k, v)
+                      if client_env ~= nil then
+                         client_env[k] = v
+                      else
+                         rawset(t, k, v)
+                      end
+                   end
+   })
+
+   if sysbench.sql ~= nil then
+      sysbench.sql.async_yield = true
+   end
+
+   for id = thread_id, sysbench.opt.clients - 1, sysbench.opt.threads do
+      local client = { id = id, env = {} }
+      client.co = coroutine.create(function ()
+            client_main(thread_id, client)
+      end)
+      clients[#clients + 1] = client
+   end
+
+   -- Run thread_init() for all clients
+   clients_schedule()
+end
+
+clients_run = function()
+   clients_schedule()
+end
+
+function sysbench.clients_done(thread_id)
+   clients_schedule()
+   ffi.C.sb_poll_destroy(poller)
+end
+
 -- ----------------------------------------------------------------------
 -- Hooks
 -- ----------------------------------------------------------------------
@@ -65,24 +251,60 @@ sysbench.hooks = {
    -- report_cumulative = <func>
 }
 
+-- Return a list of human-readable names for percentile ranks in a given stat
+-- object, e.g. {"50%", "99.9%", "max"}
+local function percentile_names(stat)
+   local names = {}
+   for i, pct in ipairs(stat.percentiles) do
+      names[i] = pct == 100 and "max" or string.format("%g%%", pct)
+   end
+   -- Use the legacy format when percentile calculations are disabled
+   if #names == 0 then
+      names[1] = "0%"
+   end
+   return names
+end
+
+-- Return a list of latency percentile values in a given stat object formatted
+-- as milliseconds with a given format string
+local function latency_pcts(stat, fmt)
+   local values = {}
+   for i, val in ipairs(stat.latency_pcts) do
+      values[i] = string.format(fmt, val * 1000)
+   end
+   if #values == 0 then
+      values[1] = string.format(fmt, stat.latency_pct * 1000)
+   end
+   return values
+end
+
+-- Return the elapsed time in a given stat object formatted with as many decimal
+-- digits as a sub-second --report-interval has, e.g. "12" or "0.25"
+local function report_time(stat)
+   local interval = sysbench.opt and sysbench.opt.report_interval or 0
+   local frac = string.format("%.3f", interval):gsub("0+$", "")
+      :match("%.(%d+)$")
+   return string.format("%." .. (frac and #frac or 0) .. "f", stat.time_total)
+end
+
 -- Report statistics in the CSV format. Add the following to your
 -- script to replace the default human-readable reports
 --
 -- sysbench.hooks.report_intermediate = sysbench.report_csv
 function sysbench.report_csv(stat)
    local seconds = stat.time_interval
-   print(string.format("%.0f,%u,%4.2f," ..
+   print(string.format("%s,%u,%4.2f," ..
                           "%4.2f,%4.2f,%4.2f,%4.2f," ..
-                          "%4.2f,%4.2f," ..
+                          "%s,%4.2f," ..
                           "%4.2f",
-                       stat.time_total,
+                       report_time(stat),
                        stat.threads_running,
                        stat.events / seconds,
                        (stat.reads + stat.writes + stat.other) / seconds,
                        stat.reads / seconds,
                        stat.writes / seconds,
                        stat.other / seconds,
-                       stat.latency_pct * 1000,
+                       table.concat(latency_pcts(stat, "%4.2f"), ","),
                        stat.errors / seconds,
                        stat.reconnects / seconds
    ))
@@ -104,9 +326,23 @@ function sysbench.report_json(stat)
    end
 
    local seconds = stat.time_interval
+   -- Only report all percentiles when more than one is requested to keep
+   -- the single-percentile format compatible
+   local percentiles = ""
+   if #stat.percentiles > 1 then
+      local names = percentile_names(stat)
+      local values = latency_pcts(stat, "%4.2f")
+      local items = {}
+      for i = 1, #names do
+         items[i] = string.format('"%s": %s', (names[i]:gsub("%%$", "")),
+                                  values[i])
+      end
+      percentiles = '\n    "percentiles": {' .. table.concat(items, ", ") ..
+         "},"
+   end
    io.write(([[
   {
-    "time": %4.0f,
+    "time": %4s,
     "threads": %u,
     "tps": %4.2f,
     "qps": {
@@ -115,11 +351,11 @@ function sysbench.report_json(stat)
       "writes": %4.2f,
       "other": %4.2f
     },
-    "latency": %4.2f,
+    "latency": %4.2f,%s
     "errors": %4.2f,
     "reconnects": %4.2f
   }]]):format(
-            stat.time_total,
+            report_time(stat),
             stat.threads_running,
             stat.events / seconds,
             (stat.reads + stat.writes + stat.other) / seconds,
@@ -127,6 +363,7 @@ function sysbench.report_json(stat)
             stat.writes / seconds,
             stat.other / seconds,
             stat.latency_pct * 1000,
+            percentiles,
             stat.errors / seconds,
             stat.reconnects / seconds
    ))
@@ -142,18 +379,18 @@ end
 -- end
 function sysbench.report_default(stat)
    local seconds = stat.time_interval
-   print(string.format("[ %.0fs ] thds: %u tps: %4.2f qps: %4.2f " ..
-                          "(r/w/o: %4.2f/%4.2f/%4.2f) lat (ms,%u%%): %4.2f " ..
+   print(string.format("[ %ss ] thds: %u tps: %4.2f qps: %4.2f " ..
+                          "(r/w/o: %4.2f/%4.2f/%4.2f) lat (ms,%s): %s " ..
                           "err/s %4.2f reconn/s: %4.2f",
-                       stat.time_total,
+                       report_time(stat),
                        stat.threads_running,
                        stat.events / seconds,
                        (stat.reads + stat.writes + stat.other) / seconds,
                        stat.reads / seconds,
                        stat.writes / seconds,
                        stat.other / seconds,
-                       sysbench.opt.percentile,
-                       stat.latency_pct * 1000,
+                       table.concat(percentile_names(stat), "/"),
+                       table.concat(latency_pcts(stat, "%4.2f"), "/"),
                        stat.errors / seconds,
                        stat.reconnects / seconds
    ))
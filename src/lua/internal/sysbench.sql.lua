@@ -71,6 +71,8 @@ typedef enum
   SB_CNT_MAX
 } sb_counter_type;
 
+void sb_counter_add(int thread_id, sb_counter_type type, uint64_t val);
+
 typedef struct
 {
   sql_error_t     error;             /* Driver-independent error code */
@@ -89,6 +91,8 @@ typedef struct
   const char      opaque[?];
 } sql_statement;
 
+typedef struct sql_pool sql_pool;
+
 /* Result set definition */
 
 typedef struct
@@ -99,6 +103,7 @@ typedef struct
   sql_statement  *statement;    /* Pointer to prepared statement (if used) */
   void           *ptr;          /* Pointer to driver-specific data */
   sql_row        row;           /* Last fetched row */
+  bool           streamed;      /* Rows are fetched one by one */
 } sql_result;
 
 typedef enum
@@ -118,6 +123,13 @@ typedef enum
   SQL_TYPE_VARCHAR
 } sql_bind_type_t;
 
+typedef enum
+{
+  SQL_ROLE_ANY,
+  SQL_ROLE_WRITE,
+  SQL_ROLE_READ
+} sql_role;
+
 typedef struct
 {
   sql_bind_type_t   type;
@@ -131,17 +143,29 @@ sql_driver *db_create(const char *);
 int db_destroy(sql_driver *drv);
 
 sql_connection *db_connection_create(sql_driver * drv);
+sql_connection *db_connection_create_async(sql_driver * drv);
+sql_connection *db_connection_create_role(sql_driver * drv, sql_role role,
+                                          bool async);
+bool db_async_supported(sql_driver * drv);
 int db_connection_close(sql_connection *con);
 int db_connection_reconnect(sql_connection *con);
 void db_connection_free(sql_connection *con);
 
+sql_pool *db_pool_open(sql_driver *drv, unsigned int size);
+sql_connection *db_pool_checkout(sql_pool *pool);
+int db_pool_checkin(sql_pool *pool, sql_connection *con);
+void db_pool_close(sql_pool *pool);
+
 int db_bulk_insert_init(sql_connection *, const char *, size_t);
 int db_bulk_insert_next(sql_connection *, const char *, size_t);
 int db_bulk_insert_done(sql_connection *);
+int db_load_sbtest(sql_connection *, const char *, uint32_t, uint32_t,
+                   uint32_t, bool, bool);
 
 sql_result *db_query(sql_connection *con, const char *query, size_t len);
 
 sql_row *db_fetch_row(sql_result *rs);
+int db_fetch(sql_result *rs);
 
 sql_statement *db_prepare(sql_connection *con, const char *query, size_t len);
 int db_bind_param(sql_statement *stmt, sql_bind *params, size_t len);
@@ -150,6 +174,15 @@ sql_result *db_execute(sql_statement *stmt);
 sql_result *db_stmt_next_result(sql_statement *stmt);
 int db_close(sql_statement *stmt);
 
+int db_pipeline_begin(sql_connection *con);
+int db_execute_async(sql_statement *stmt);
+int db_pipeline_end(sql_connection *con);
+
+int db_async_events(sql_connection *con);
+int db_async_fd(sql_connection *con);
+sql_result *db_async_continue(sql_connection *con, int events);
+sql_result *db_async_wait(sql_connection *con);
+
 bool db_more_results(sql_connection *con);
 sql_result *db_next_result(sql_connection *con);
 int db_free_results(sql_result *);
@@ -180,6 +213,16 @@ sysbench.sql.type =
       VARCHAR = ffi.C.SQL_TYPE_VARCHAR
    }
 
+-- Server roles for sql_driver:connect(). Drivers balancing connections over
+-- multiple servers (currently MySQL) send WRITE connections to writable servers
+-- and READ ones to read-only replicas, if available.
+sysbench.sql.role =
+   {
+      ANY = ffi.C.SQL_ROLE_ANY,
+      WRITE = ffi.C.SQL_ROLE_WRITE,
+      READ = ffi.C.SQL_ROLE_READ
+   }
+
 -- Initialize a given SQL driver and return a handle to it to create
 -- connections. A nil driver name (i.e. no function argument) initializes the
 -- default driver, i.e. the one specified with --db-driver on the command line.
@@ -194,8 +237,39 @@ end
 -- sql_driver methods
 local driver_methods = {}
 
-function driver_methods.connect(self)
-   local con = ffi.C.db_connection_create(self)
+-- Connect to a server with a given role, sysbench.sql.role.ANY by default
+function driver_methods.connect(self, role)
+   -- Coroutines run by an event loop (e.g. clients in the --clients mode) get
+   -- non-blocking connections if the driver supports them
+   local async = sysbench.sql.async_yield and coroutine.running() ~= nil
+
+   if async and not ffi.C.db_async_supported(self) then
+      -- A blocking connection would stall all clients of the thread, which
+      -- defeats the purpose of --clients
+      if not (sysbench.opt and sysbench.opt.clients_blocking) then
+         error(string.format("--clients requires non-blocking connections " ..
+                                "which are not supported by the '%s' " ..
+                                "driver. Use --clients-blocking to run " ..
+                                "with blocking connections", self:name()), 2)
+      end
+      async = false
+   end
+
+   local con = ffi.C.db_connection_create_role(self, role or ffi.C.SQL_ROLE_ANY,
+                                               async)
+   if con == nil then
+      error("connection creation failed", 2)
+   end
+   return ffi.gc(con, ffi.C.db_connection_free)
+end
+
+-- Create a non-blocking connection. Calls on such a connection suspend the
+-- calling coroutine while waiting for the server when sysbench.sql.async_yield
+-- is true, see async_complete(). Otherwise they block as usual. The optional
+-- role argument is the same as for connect().
+function driver_methods.connect_async(self, role)
+   local con = ffi.C.db_connection_create_role(self, role or ffi.C.SQL_ROLE_ANY,
+                                               true)
    if con == nil then
       error("connection creation failed", 2)
    end
@@ -206,6 +280,17 @@ function driver_methods.name(self)
    return ffi.string(self.sname)
 end
 
+-- Open a connection pool with up to size connections. Without arguments, the
+-- pool is configured with --db-pool-size and --db-pool-scope, i.e. it is shared
+-- by all threads with --db-pool-scope=global.
+function driver_methods.pool(self, size)
+   local pool = ffi.C.db_pool_open(self, size or 0)
+   if pool == nil then
+      error("connection pool creation failed", 2)
+   end
+   return ffi.gc(pool, ffi.C.db_pool_close)
+end
+
 -- sql_driver metatable
 local driver_mt = {
    __index = driver_methods,
@@ -214,6 +299,57 @@ local driver_mt = {
 }
 ffi.metatype("sql_driver", driver_mt)
 
+-- sql_pool methods
+local pool_methods = {}
+
+-- Check out a connection from the pool, opening a new one if there are no idle
+-- connections. When all connections are checked out, waits for one to be
+-- checked in by another thread for a shared pool, or throws an error otherwise.
+-- Connections are owned by the pool and must be returned with checkin().
+function pool_methods.checkout(self)
+   local con = ffi.C.db_pool_checkout(self)
+   if con == nil then
+      error("connection checkout failed", 2)
+   end
+   return con
+end
+
+function pool_methods.checkin(self, con)
+   return assert(ffi.C.db_pool_checkin(self, con) == 0)
+end
+
+-- sql_pool metatable
+local pool_mt = {
+   __index = pool_methods,
+   __tostring = function() return '<sql_pool>' end,
+}
+ffi.metatype("sql_pool", pool_mt)
+
+-- Set by event loops running coroutines that issue queries on non-blocking
+-- connections
+sysbench.sql.async_yield = false
+
+-- Complete a pending operation on a non-blocking connection, if any. Inside a
+-- coroutine run by an event loop (i.e. when sysbench.sql.async_yield is true)
+-- the coroutine yields the connection until its socket (see
+-- sql_connection:async_fd()) is ready for sql_connection:async_events(). The
+-- event loop must resume it with the ready events. Otherwise the call blocks.
+local function async_complete(con, rs)
+   if rs ~= nil or ffi.C.db_async_events(con) == 0 then
+      return rs
+   end
+
+   if not sysbench.sql.async_yield or coroutine.running() == nil then
+      return ffi.C.db_async_wait(con)
+   end
+
+   repeat
+      rs = ffi.C.db_async_continue(con, coroutine.yield(con))
+   until rs ~= nil or ffi.C.db_async_events(con) == 0
+
+   return rs
+end
+
 -- sql_connection methods
 local connection_methods = {}
 
@@ -271,7 +407,7 @@ function connection_methods.check_error(self, rs, query)
 end
 
 function connection_methods.query(self, query)
-   local rs = ffi.C.db_query(self, query, #query)
+   local rs = async_complete(self, ffi.C.db_query(self, query, #query))
    return self:check_error(rs, query)
 end
 
@@ -280,10 +416,39 @@ function connection_methods.more_results(self)
 end
 
 function connection_methods.next_result(self)
-   local rs = ffi.C.db_next_result(self)
+   local rs = async_complete(self, ffi.C.db_next_result(self))
    return self:check_error(rs, "");
 end
 
+-- SB_POLL_* events a pending operation on a non-blocking connection is waiting
+-- for, or 0
+function connection_methods.async_events(self)
+   return ffi.C.db_async_events(self)
+end
+
+-- Socket of a pending operation on a non-blocking connection
+function connection_methods.async_fd(self)
+   return ffi.C.db_async_fd(self)
+end
+
+-- Enter pipeline mode. Statements executed with sql_statement:execute_async()
+-- are sent to the server without waiting for their results until
+-- sql_connection:pipeline_end() is called
+function connection_methods.pipeline(self)
+   if ffi.C.db_pipeline_begin(self) ~= 0 then
+      self:check_error(nil, '<pipeline>')
+   end
+end
+
+-- Wait for results of all statements queued since sql_connection:pipeline()
+-- and leave pipeline mode. Result sets are discarded, an error is thrown if any
+-- of the statements has failed
+function connection_methods.pipeline_end(self)
+   if ffi.C.db_pipeline_end(self) ~= 0 then
+      self:check_error(nil, '<pipeline>')
+   end
+end
+
 function connection_methods.bulk_insert_init(self, query)
    return assert(ffi.C.db_bulk_insert_init(self, query, #query) == 0,
                  "db_bulk_insert_init() failed")
@@ -299,6 +464,18 @@ function connection_methods.bulk_insert_done(self)
                  "db_bulk_insert_done() failed")
 end
 
+-- Load rows with ids from first_id to last_id into a table with the schema of
+-- OLTP benchmarks. Rows are generated in C with k values from 1 to k_max. When
+-- with_id is false, ids are assigned by the server. When native is true, use
+-- the native bulk load protocol of the driver (LOAD DATA LOCAL INFILE for
+-- MySQL, COPY for PostgreSQL) if supported, multi-row INSERTs otherwise.
+function connection_methods.load_sbtest(self, table_name, first_id, last_id,
+                                        k_max, with_id, native)
+   return assert(ffi.C.db_load_sbtest(self, table_name, first_id, last_id,
+                                      k_max, with_id, native) == 0,
+                 "db_load_sbtest() failed")
+end
+
 function connection_methods.prepare(self, query)
    local stmt = ffi.C.db_prepare(self, query, #query)
    if stmt == nil then
@@ -313,11 +490,17 @@ end
 function connection_methods.query_row(self, query)
    local rs = self:query(query)
 
-   if rs == nil or rs.nrows == 0 then
+   if rs == nil or (rs.nrows == 0 and not rs.streamed) then
       return nil
    end
 
-   return unpack(rs:fetch_row(), 1, rs.nfields)
+   local row = rs:fetch_row()
+
+   if row == nil then
+      return nil
+   end
+
+   return unpack(row, 1, rs.nfields)
 end
 
 -- sql_connection metatable
@@ -379,6 +562,27 @@ function sql_param.set_rand_str(self, fmt)
    end
 end
 
+-- Returns the current value of a parameter or a bound result buffer, or nil for
+-- a NULL value
+function sql_param.get(self)
+   local sql_type = sysbench.sql.type
+   local btype = self.type
+
+   if self.is_null[0] ~= 0 then
+      return nil
+   end
+
+   if btype == sql_type.CHAR or
+      btype == sql_type.VARCHAR
+   then
+      -- data_len may exceed the buffer size for truncated result values
+      local len = tonumber(self.data_len[0])
+      return ffi.string(self.buffer, self.max_len < len and self.max_len or len)
+   end
+
+   return tonumber(self.buffer[0])
+end
+
 sql_param.__index = sql_param
 sql_param.__tostring = function () return '<sql_param>' end
 
@@ -436,13 +640,47 @@ function statement_methods.bind_param(self, ...)
    return ffi.C.db_bind_param(self, binds, len)
 end
 
+-- Bind buffers created with bind_create() to the columns of result sets. Rows
+-- are then retrieved into bound buffers with sql_result:fetch()
+function statement_methods.bind_result(self, ...)
+   local len = select('#', ...)
+   if len  < 1 then return nil end
+
+   local binds = ffi.new("sql_bind[?]", len)
+
+   for i, param in ipairs({...}) do
+      binds[i-1].type = param.type
+      binds[i-1].buffer = param.buffer
+      binds[i-1].data_len = param.data_len
+      binds[i-1].max_len = param.max_len
+      binds[i-1].is_null = param.is_null
+   end
+   return ffi.C.db_bind_result(self, binds, len)
+end
+
 function statement_methods.execute(self)
-   local rs = ffi.C.db_execute(self)
+   local rs = async_complete(self.connection, ffi.C.db_execute(self))
    return self.connection:check_error(rs, '<prepared statement>')
 end
 
+-- Queue the statement for execution in pipeline mode, see
+-- sql_connection:pipeline(). Executes the statement synchronously and discards
+-- its result set when not in pipeline mode, or when pipelining is not
+-- supported by the driver
+function statement_methods.execute_async(self)
+   if ffi.C.db_execute_async(self) ~= 0 then
+      self.connection:check_error(nil, '<prepared statement>')
+   end
+
+   local rs = async_complete(self.connection, nil)
+   if rs ~= nil then
+      rs:free()
+   end
+   self.connection:check_error(rs, '<prepared statement>')
+end
+
 function statement_methods.next_result(self)
-   local rs = ffi.C.db_stmt_next_result(self)
+   local rs = async_complete(self.connection, ffi.C.db_stmt_next_result(self))
    return self.connection:check_error(rs, '<prepared statement>')
 end
 
@@ -487,6 +725,13 @@ function result_methods.fetch_row(self)
    return res
 end
 
+-- Fetches the next row of a prepared statement result set into buffers bound
+-- with sql_statement:bind_result(). Returns false if there are no more rows to
+-- fetch
+function result_methods.fetch(self)
+   return ffi.C.db_fetch(self) == 0
+end
+
 function result_methods.free(self)
    return assert(ffi.C.db_free_results(self) == 0, "db_free_results() failed")
 end
@@ -59,6 +59,10 @@ sysbench.cmdline.options = {
    {"Use AUTO_INCREMENT column as Primary Key (for MySQL), " ..
        "or its alternatives in other DBMS. When disabled, use " ..
        "client-generated IDs", true},
+   bulk_load =
+      {"Load data on prepare with LOAD DATA LOCAL INFILE (MySQL) or COPY " ..
+          "(PostgreSQL) rather than multi-row INSERTs, if allowed by " ..
+          "the server", true},
    create_table_options =
       {"Extra CREATE TABLE options", ""},
    skip_trx =
@@ -71,6 +75,28 @@ sysbench.cmdline.options = {
    reconnect =
       {"Reconnect after every N events. The default (0) is to not reconnect",
        0},
+   pipeline =
+      {"Send all queries of a transaction to the server at once and only " ..
+          "then wait for their results, if supported by the driver " ..
+          "(currently PostgreSQL only). Has no effect with --skip_trx",
+       false},
+   point_selects_batch =
+      {"Send point SELECT queries of a transaction in one round trip: 'in' " ..
+          "merges them into a single SELECT ... WHERE id IN (...) query, " ..
+          "'multi' sends them in a multi-statement query along with other " ..
+          "batched queries (MySQL only), 'none' executes them one by one",
+       "none"},
+   range_selects_batch =
+      {"Send range SELECT queries of a transaction in one round trip: " ..
+          "'multi' sends them in a multi-statement query along with other " ..
+          "batched queries (MySQL only), 'none' executes them one by one",
+       "none"},
+   rw_split =
+      {"Execute SELECT queries on a separate connection to a read-only " ..
+          "server and all other queries on a connection to a writable one, " ..
+          "if the driver balances connections over multiple servers " ..
+          "(currently MySQL only). SELECT queries are then executed outside " ..
+          "of transactions. Cannot be used with --pipeline", false},
    mysql_storage_engine =
       {"Storage engine, if MySQL is used", "innodb"},
    pgsql_variant =
@@ -82,14 +108,54 @@ sysbench.cmdline.options = {
 }
 
 -- Prepare the dataset. This command supports parallel execution, i.e. will
--- benefit from executing with --threads > 1 as long as --tables > 1
+-- benefit from executing with --threads > 1. When there are more threads than
+-- tables, each table is loaded by multiple threads, each one inserting its own
+-- range of ids
 function cmd_prepare()
    local drv = sysbench.sql.driver()
    local con = drv:connect()
+   local threads = sysbench.opt.threads
+   local tables = sysbench.opt.tables
 
-   for i = sysbench.tid % sysbench.opt.threads + 1, sysbench.opt.tables,
-   sysbench.opt.threads do
-     create_table(drv, con, i)
+   if threads <= tables then
+      for i = sysbench.tid % threads + 1, tables, threads do
+         create_table(drv, con, i)
+      end
+      return
+   end
+
+   -- Split each table into the same number of id ranges, extra threads are
+   -- not used
+   local ranges = math.floor(threads / tables)
+   local table_num = sysbench.tid % tables + 1
+   local range = math.floor(sysbench.tid / tables)
+
+   if range >= ranges then
+      return
+   end
+
+   -- The first thread loading a table creates it, and then creates a secondary
+   -- index when all rows have been loaded
+   if range == 0 then
+      create_table_schema(drv, con, table_num)
+   end
+
+   sysbench.cmdline.barrier()
+
+   local size = sysbench.opt.table_size
+
+   if range == 0 and size > 0 then
+      print(string.format("Inserting %d records into 'sbtest%d'", size,
+                          table_num))
+   end
+
+   load_table(con, table_num, math.floor(size * range / ranges) + 1,
+              math.floor(size * (range + 1) / ranges))
+
+   sysbench.cmdline.barrier()
+
+   if range == 0 then
+      create_secondary_index(con, table_num)
    end
 end
 
@@ -154,7 +220,7 @@ function get_pad_value()
    return sysbench.rand.string(pad_value_template)
 end
 
-function create_table(drv, con, table_num)
+function create_table_schema(drv, con, table_num)
    local id_index_def, id_def
    local engine_def = ""
    local extra_table_options = ""
@@ -201,44 +267,19 @@ CREATE TABLE sbtest%d(
       sysbench.opt.create_table_options)
 
    con:query(query)
+end
 
-   if (sysbench.opt.table_size > 0) then
-      print(string.format("Inserting %d records into 'sbtest%d'",
-                          sysbench.opt.table_size, table_num))
-   end
-
-   if sysbench.opt.auto_inc then
-      query = "INSERT INTO sbtest" .. table_num .. "(k, c, pad) VALUES"
-   else
-      query = "INSERT INTO sbtest" .. table_num .. "(id, k, c, pad) VALUES"
-   end
-
-   con:bulk_insert_init(query)
-
-   local c_val
-   local pad_val
-
-   for i = 1, sysbench.opt.table_size do
-
-      c_val = get_c_value()
-      pad_val = get_pad_value()
-
-      if (sysbench.opt.auto_inc) then
-         query = string.format("(%d, '%s', '%s')",
-                               sysbench.rand.default(1, sysbench.opt.table_size),
-                               c_val, pad_val)
-      else
-         query = string.format("(%d, %d, '%s', '%s')",
-                               i,
-                               sysbench.rand.default(1, sysbench.opt.table_size),
-                               c_val, pad_val)
-      end
-
-      con:bulk_insert_next(query)
-   end
-
-   con:bulk_insert_done()
+-- Load rows with ids from first_id to last_id into a table. Rows are generated
+-- in C and streamed to the server by the SQL API, see
+-- connection_methods.load_sbtest()
+function load_table(con, table_num, first_id, last_id)
+   con:load_sbtest("sbtest" .. table_num, first_id, last_id,
+                   sysbench.opt.table_size, not sysbench.opt.auto_inc,
+                   sysbench.opt.bulk_load and
+                      sysbench.opt.pgsql_variant ~= 'redshift')
+end
 
+function create_secondary_index(con, table_num)
    if sysbench.opt.create_secondary then
       print(string.format("Creating a secondary index on 'sbtest%d'...",
                           table_num))
@@ -247,6 +288,19 @@ CREATE TABLE sbtest%d(
    end
 end
 
+function create_table(drv, con, table_num)
+   create_table_schema(drv, con, table_num)
+
+   if (sysbench.opt.table_size > 0) then
+      print(string.format("Inserting %d records into 'sbtest%d'",
+                          sysbench.opt.table_size, table_num))
+   end
+
+   load_table(con, table_num, 1, sysbench.opt.table_size)
+
+   create_secondary_index(con, table_num)
+end
+
 local t = sysbench.sql.type
 local stmt_defs = {
    point_selects = {
@@ -278,6 +332,59 @@ local stmt_defs = {
       t.INT, t.INT, {t.CHAR, 120}, {t.CHAR, 60}},
 }
 
+-- Batched point selects merged into a single query
+local point_selects_in = "SELECT c FROM sbtest%u WHERE id IN (%s)"
+
+-- Statement definitions with placeholders replaced by format specifiers
+local batch_templates = {}
+
+-- Return a batching mode of a query class, checking that it is supported
+local function get_batch_mode(key, ...)
+   local mode = sysbench.opt[key]
+
+   for _, m in ipairs({"none", ...}) do
+      if mode == m then
+         if mode == "multi" and drv:name() ~= "mysql" then
+            error("--" .. key .. "=multi requires multi-statement " ..
+                     "queries, which are only supported by MySQL")
+         end
+         return mode
+      end
+   end
+
+   error(string.format("Invalid --%s value: '%s'", key, mode))
+end
+
+-- Queue a query for the next multi-statement batch. Placeholders of a statement
+-- definition are replaced with given integer values.
+local function queue_query(key, tnum, ...)
+   local template = batch_templates[key]
+
+   if template == nil then
+      template = stmt_defs[key][1]:gsub("%?", "%%d")
+      batch_templates[key] = template
+   end
+
+   batch.n = batch.n + 1
+   batch[batch.n] = string.format(template, tnum, ...)
+end
+
+-- Send queued queries in a single multi-statement query and read all of their
+-- result sets, so each statement is accounted separately
+function execute_batch()
+   if batch.n == 0 then
+      return
+   end
+
+   local query = table.concat(batch, ";", 1, batch.n)
+   batch.n = 0
+
+   rcon:query(query)
+   while rcon:more_results() do
+      rcon:next_result()
+   end
+end
+
 function prepare_begin()
    stmt.begin = con:prepare("BEGIN")
 end
@@ -286,9 +393,12 @@ function prepare_commit()
    stmt.commit = con:prepare("COMMIT")
 end
 
-function prepare_for_each_table(key)
+-- Prepare a statement for each table on a given connection, con by default
+function prepare_for_each_table(key, c)
+   c = c or con
+
    for t = 1, sysbench.opt.tables do
-      stmt[t][key] = con:prepare(string.format(stmt_defs[key][1], t))
+      stmt[t][key] = c:prepare(string.format(stmt_defs[key][1], t))
 
       local nparam = #stmt_defs[key] - 1
 
@@ -319,23 +429,48 @@ function prepare_for_each_table(key)
 end
 
 function prepare_point_selects()
-   prepare_for_each_table("point_selects")
+   local mode = get_batch_mode("point_selects_batch", "multi", "in")
+   local n = sysbench.opt.point_selects
+
+   if mode == "none" then
+      prepare_for_each_table("point_selects", rcon)
+   elseif mode == "in" and n > 0 then
+      -- A single statement with a placeholder for each point select
+      local placeholders = string.rep("?,", n - 1) .. "?"
+
+      for t = 1, sysbench.opt.tables do
+         stmt[t].point_selects = rcon:prepare(
+            string.format(point_selects_in, t, placeholders))
+         param[t].point_selects = {}
+         for p = 1, n do
+            param[t].point_selects[p] =
+               stmt[t].point_selects:bind_create(sysbench.sql.type.INT)
+         end
+         stmt[t].point_selects:bind_param(unpack(param[t].point_selects))
+      end
+   end
+end
+
+local function prepare_range(key)
+   if get_batch_mode("range_selects_batch", "multi") ~= "multi" then
+      prepare_for_each_table(key, rcon)
+   end
 end
 
 function prepare_simple_ranges()
-   prepare_for_each_table("simple_ranges")
+   prepare_range("simple_ranges")
 end
 
 function prepare_sum_ranges()
-   prepare_for_each_table("sum_ranges")
+   prepare_range("sum_ranges")
 end
 
 function prepare_order_ranges()
-   prepare_for_each_table("order_ranges")
+   prepare_range("order_ranges")
 end
 
 function prepare_distinct_ranges()
-   prepare_for_each_table("distinct_ranges")
+   prepare_range("distinct_ranges")
 end
 
 function prepare_index_updates()
@@ -353,7 +488,18 @@ end
 
 function thread_init()
    drv = sysbench.sql.driver()
-   con = drv:connect()
+
+   if sysbench.opt.rw_split then
+      if sysbench.opt.pipeline then
+         error("--rw_split cannot be used with --pipeline")
+      end
+      con = drv:connect(sysbench.sql.role.WRITE)
+      -- Connection for SELECT queries
+      rcon = drv:connect(sysbench.sql.role.READ)
+   else
+      con = drv:connect()
+      rcon = con
+   end
 
    -- Create global nested tables for prepared statements and their
    -- parameters. We need a statement and a parameter set for each combination
@@ -361,6 +507,9 @@ function thread_init()
    stmt = {}
    param = {}
 
+   -- Text of queries queued for the next multi-statement batch
+   batch = {n = 0}
+
    for t = 1, sysbench.opt.tables do
       stmt[t] = {}
       param[t] = {}
@@ -388,6 +537,9 @@ end
 function thread_done()
    close_statements()
    con:disconnect()
+   if rcon ~= con then
+      rcon:disconnect()
+   end
 end
 
 function cleanup()
@@ -408,22 +560,60 @@ local function get_id()
    return sysbench.rand.default(1, sysbench.opt.table_size)
 end
 
+-- Execute a prepared statement, or queue it if the current transaction is
+-- pipelined
+local function execute(s)
+   if sysbench.opt.pipeline then
+      s:execute_async()
+   else
+      s:execute()
+   end
+end
+
 function begin()
-   stmt.begin:execute()
+   if sysbench.opt.pipeline then
+      con:pipeline()
+   end
+   execute(stmt.begin)
 end
 
 function commit()
-   stmt.commit:execute()
+   execute(stmt.commit)
+   if sysbench.opt.pipeline then
+      con:pipeline_end()
+   end
 end
 
 function execute_point_selects()
    local tnum = get_table_num()
    local i
 
+   if sysbench.opt.point_selects_batch == "multi" then
+      for i = 1, sysbench.opt.point_selects do
+         queue_query("point_selects", tnum, get_id())
+      end
+      return
+   elseif sysbench.opt.point_selects_batch == "in" then
+      if sysbench.opt.point_selects > 0 then
+         for i = 1, sysbench.opt.point_selects do
+            param[tnum].point_selects[i]:set(get_id())
+         end
+
+         execute(stmt[tnum].point_selects)
+
+         -- The IN (...) query returns rows of all point selects in a single
+         -- result set. Account the remaining point selects as reads, so read
+         -- and query counters are comparable with other batching modes.
+         ffi.C.sb_counter_add(sysbench.tid, ffi.C.SB_CNT_READ,
+                              sysbench.opt.point_selects - 1)
+      end
+      return
+   end
+
    for i = 1, sysbench.opt.point_selects do
       param[tnum].point_selects[1]:set(get_id())
 
-      stmt[tnum].point_selects:execute()
+      execute(stmt[tnum].point_selects)
    end
 end
 
@@ -433,10 +623,14 @@ local function execute_range(key)
    for i = 1, sysbench.opt[key] do
       local id = get_id()
 
-      param[tnum][key][1]:set(id)
-      param[tnum][key][2]:set(id + sysbench.opt.range_size - 1)
+      if sysbench.opt.range_selects_batch == "multi" then
+         queue_query(key, tnum, id, id + sysbench.opt.range_size - 1)
+      else
+         param[tnum][key][1]:set(id)
+         param[tnum][key][2]:set(id + sysbench.opt.range_size - 1)
 
-      stmt[tnum][key]:execute()
+         execute(stmt[tnum][key])
+      end
    end
 end
 
@@ -462,7 +656,7 @@ function execute_index_updates()
    for i = 1, sysbench.opt.index_updates do
       param[tnum].index_updates[1]:set(get_id())
 
-      stmt[tnum].index_updates:execute()
+      execute(stmt[tnum].index_updates)
    end
 end
 
@@ -473,7 +667,7 @@ function execute_non_index_updates()
       param[tnum].non_index_updates[1]:set_rand_str(c_value_template)
       param[tnum].non_index_updates[2]:set(get_id())
 
-      stmt[tnum].non_index_updates:execute()
+      execute(stmt[tnum].non_index_updates)
    end
 end
 
@@ -491,8 +685,8 @@ function execute_delete_inserts()
       param[tnum].inserts[3]:set_rand_str(c_value_template)
       param[tnum].inserts[4]:set_rand_str(pad_value_template)
 
-      stmt[tnum].deletes:execute()
-      stmt[tnum].inserts:execute()
+      execute(stmt[tnum].deletes)
+      execute(stmt[tnum].inserts)
    end
 end
 
@@ -515,6 +709,9 @@ function check_reconnect()
       if transactions % sysbench.opt.reconnect == 0 then
          close_statements()
          con:reconnect()
+         if rcon ~= con then
+            rcon:reconnect()
+         end
          prepare_statements()
       end
    end
@@ -0,0 +1,67 @@
+#!/usr/bin/env sysbench
+-- Copyright (C) 2006-2017 Alexey Kopytov <akopytov@gmail.com>
+
+-- This program is free software; you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation; either version 2 of the License, or
+-- (at your option) any later version.
+
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+-- ----------------------------------------------------------------------
+-- Connection churn benchmark: each event opens a connection, executes
+-- --point_selects queries and closes it. Use --rate to open a given number of
+-- connections per second. Connect latency is reported separately from the event
+-- latency.
+-- ----------------------------------------------------------------------
+
+require("oltp_common")
+
+sysbench.cmdline.options.pool =
+   {"Check out connections from a pool configured with --db-pool-size and " ..
+       "--db-pool-scope rather than opening a new connection in each event",
+    false}
+
+-- Connections are opened by events, so there are no prepared statements
+function thread_init()
+   drv = sysbench.sql.driver()
+
+   if sysbench.opt.pool then
+      pool = drv:pool()
+   end
+end
+
+function thread_done()
+end
+
+local function execute_queries(c)
+   for i = 1, sysbench.opt.point_selects do
+      c:query(string.format("SELECT c FROM sbtest%d WHERE id=%d",
+                            sysbench.rand.uniform(1, sysbench.opt.tables),
+                            sysbench.rand.default(1, sysbench.opt.table_size)))
+   end
+end
+
+function event()
+   local c = pool and pool:checkout() or drv:connect()
+
+   -- Release the connection before passing errors on
+   local ok, err = pcall(execute_queries, c)
+
+   if pool then
+      pool:checkin(c)
+   else
+      c:disconnect()
+   end
+
+   if not ok then
+      error(err, 0)
+   end
+end
@@ -31,6 +31,7 @@ end
 
 function event()
    execute_point_selects()
+   execute_batch()
 
    check_reconnect()
 end
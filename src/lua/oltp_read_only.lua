@@ -51,6 +51,9 @@ function event()
       execute_distinct_ranges()
    end
 
+   -- Send queries queued by --point_selects_batch/--range_selects_batch=multi
+   execute_batch()
+
    if not sysbench.opt.skip_trx then
       commit()
    end
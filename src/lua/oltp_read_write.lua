@@ -55,6 +55,9 @@ function event()
       execute_distinct_ranges()
    end
 
+   -- Send queries queued by --point_selects_batch/--range_selects_batch=multi
+   execute_batch()
+
    execute_index_updates()
    execute_non_index_updates()
    execute_delete_inserts()
@@ -96,6 +96,29 @@ int sb_barrier_wait(sb_barrier_t *barrier)
 }
 
 
+/*
+  Stop participating in the barrier, i.e. decrement the number of threads
+  required to pass it, and release threads waiting for the current thread.
+*/
+
+void sb_barrier_leave(sb_barrier_t *barrier)
+{
+  pthread_mutex_lock(&barrier->mutex);
+
+  barrier->init_count--;
+
+  if (!--barrier->count && barrier->init_count > 0)
+  {
+    barrier->serial++;
+    barrier->count = barrier->init_count;
+
+    pthread_cond_broadcast(&barrier->cond);
+  }
+
+  pthread_mutex_unlock(&barrier->mutex);
+}
+
+
 void sb_barrier_destroy(sb_barrier_t *barrier)
 {
   pthread_mutex_destroy(&barrier->mutex);
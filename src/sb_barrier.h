@@ -49,6 +49,8 @@ int sb_barrier_init(sb_barrier_t *barrier, unsigned int count,
 
 int sb_barrier_wait(sb_barrier_t *barrier);
 
+void sb_barrier_leave(sb_barrier_t *barrier);
+
 void sb_barrier_destroy(sb_barrier_t *barrier);
 
 #endif /* SB_BARRIER_H */
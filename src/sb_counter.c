@@ -92,3 +92,14 @@ void sb_counters_agg_cumulative(sb_counters_t val)
   sb_counters_merge(val);
   sb_counters_checkpoint(val, last_cumulative_counters);
 }
+
+/*
+  Return aggregate counter values since the start of the run. This does not
+  affect report states and can be called from any thread.
+*/
+void sb_counters_agg_total(sb_counters_t val)
+{
+  memset(val, 0, sizeof(sb_counters_t));
+
+  sb_counters_merge(val);
+}
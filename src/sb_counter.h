@@ -112,4 +112,10 @@ void sb_counters_agg_intermediate(sb_counters_t val);
 */
 void sb_counters_agg_cumulative(sb_counters_t val);
 
+/*
+  Return aggregate counter values since the start of the run. This does not
+  affect report states and can be called from any thread.
+*/
+void sb_counters_agg_total(sb_counters_t val);
+
 #endif
@@ -0,0 +1,943 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdio.h>
+# include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+# include <sys/socket.h>
+#endif
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+
+#include <errno.h>
+
+#include "sb_dist.h"
+#include "sb_net.h"
+#include "sb_options.h"
+#include "sb_logger.h"
+#include "sb_thread.h"
+#include "sb_timer.h"
+#include "sb_counter.h"
+#include "sb_histogram.h"
+#include "sb_results.h"
+
+/*
+  Protocol messages. All messages start with a header followed by a payload of
+  the specified size. Values are in the native byte order, the magic value in
+  the handshake message is used to detect mismatches.
+*/
+
+#define DIST_MAGIC 0x53424431   /* "SBD1" */
+#define DIST_VERSION 2
+
+/* How long agents retry connecting to the coordinator, in milliseconds */
+#define DIST_CONNECT_TIMEOUT_MS 10000
+#define DIST_CONNECT_RETRY_MS 100
+
+/*
+  Number of report intervals for which the coordinator accumulates statistics
+  while waiting for lagging agents
+*/
+#define DIST_WINDOW 16
+
+typedef enum
+{
+  MSG_HELLO = 1,                /* agent -> coordinator handshake */
+  MSG_READY,                    /* agent -> coordinator threads initialized */
+  MSG_START,                    /* coordinator -> agent benchmark start */
+  MSG_REPORT                    /* agent -> coordinator statistics */
+} msg_type_t;
+
+typedef struct
+{
+  uint32_t type;                /* see msg_type_t */
+  uint32_t size;                /* payload size */
+} msg_hdr_t;
+
+typedef struct
+{
+  uint32_t magic;               /* DIST_MAGIC */
+  uint32_t version;             /* DIST_VERSION */
+  uint32_t threads;             /* number of worker threads */
+  uint32_t tx_rate;             /* --rate value */
+  uint64_t array_size;          /* number of latency histogram elements */
+} msg_hello_t;
+
+typedef struct
+{
+  uint64_t report_interval_ns;  /* 0 if only final reports are required */
+} msg_start_t;
+
+typedef struct
+{
+  /* Report interval number for intermediate reports, 0 for the final one */
+  uint64_t seq;
+  uint32_t final;
+  uint32_t threads_running;
+  /* Counter deltas since the previous report */
+  uint64_t counters[SB_CNT_MAX];
+  /* Values from the cumulative agent stat, only sent in final reports */
+  double   time_total;
+  double   latency_min;
+  double   latency_max;
+  double   latency_sum;
+  /*
+    Number of latency and response time histogram deltas following this
+    structure
+  */
+  uint32_t nlatency;
+  uint32_t nresponse;
+} msg_report_t;
+
+/* Histogram element delta since the previous report */
+typedef struct
+{
+  uint64_t index;
+  uint64_t count;
+} msg_delta_t;
+
+/* Distributed mode options */
+
+static sb_arg_t dist_args[] =
+{
+  SB_OPT("dist-coordinator", "coordinator address in distributed mode, "
+         "[host:]port or a Unix socket path. The 'coordinator' command listens "
+         "on this address, other commands connect to it as agents", NULL,
+         STRING),
+  SB_OPT("dist-agents", "number of agents the 'coordinator' command waits for "
+         "before starting the benchmark", "1", INT),
+
+  SB_OPT_END
+};
+
+/* Agent state */
+
+static int       agent_fd = -1;
+static pthread_t agent_thread;
+static int       agent_thread_created;
+static uint64_t  agent_interval_ns;
+/* Totals as of the previous report */
+static uint64_t  agent_sent_cnt[SB_CNT_MAX];
+static uint64_t  *agent_sent_latency;
+static uint64_t  *agent_sent_response;
+/* Scratch array for histogram totals */
+static uint64_t  *agent_totals;
+/* Report message buffer */
+static char      *agent_buf;
+
+/* Statistics accumulated by the coordinator for a single report interval */
+
+typedef struct
+{
+  uint64_t     counters[SB_CNT_MAX];
+  uint64_t     *latency;
+  uint64_t     *response;
+  uint32_t     threads_running;
+  unsigned int agents;          /* number of agents that reported */
+} interval_t;
+
+/* Coordinator state for each agent */
+
+typedef struct
+{
+  int      fd;
+  bool     done;                /* final report received or disconnected */
+  uint64_t seq;                 /* last received report interval number */
+  uint64_t events;              /* number of events reported so far */
+  uint32_t threads;
+  uint32_t tx_rate;
+} agent_t;
+
+
+int sb_dist_register(void)
+{
+  sb_register_arg_set(dist_args);
+
+  return 0;
+}
+
+
+void sb_dist_print_help(void)
+{
+  printf("Distributed mode options:\n");
+
+  sb_print_options(dist_args);
+}
+
+
+static size_t report_max_size(void)
+{
+  return sizeof(msg_hdr_t) + sizeof(msg_report_t) +
+    2 * sb_latency_histogram.array_size * sizeof(msg_delta_t);
+}
+
+
+/*
+  Append deltas of non-zero histogram elements since the previous report and
+  update previously sent totals. Returns the number of deltas.
+*/
+
+static uint32_t encode_deltas(sb_histogram_t *h, uint64_t *sent,
+                              msg_delta_t *deltas)
+{
+  uint32_t n = 0;
+
+  sb_histogram_get_totals(h, agent_totals);
+
+  for (size_t i = 0; i < h->array_size; i++)
+  {
+    if (agent_totals[i] == sent[i])
+      continue;
+
+    deltas[n].index = i;
+    deltas[n].count = agent_totals[i] - sent[i];
+    sent[i] = agent_totals[i];
+    n++;
+  }
+
+  return n;
+}
+
+
+/*
+  Send statistics collected since the previous report. stat is only used for
+  the final report. Returns 0 on success, 1 on error.
+*/
+
+static int agent_send_report(uint64_t seq, const sb_stat_t *stat)
+{
+  msg_hdr_t    * const hdr = (msg_hdr_t *) agent_buf;
+  msg_report_t * const rep = (msg_report_t *) (hdr + 1);
+  msg_delta_t  * const deltas = (msg_delta_t *) (rep + 1);
+  sb_counters_t cnt;
+
+  memset(rep, 0, sizeof(*rep));
+
+  rep->seq = seq;
+  rep->final = stat != NULL;
+  rep->threads_running = sb_globals.threads_running;
+
+  sb_counters_agg_total(cnt);
+
+  for (size_t i = 0; i < SB_CNT_MAX; i++)
+  {
+    rep->counters[i] = cnt[i] - agent_sent_cnt[i];
+    agent_sent_cnt[i] = cnt[i];
+  }
+
+  if (stat != NULL)
+  {
+    rep->time_total = stat->time_total;
+    rep->latency_min = stat->latency_min;
+    rep->latency_max = stat->latency_max;
+    rep->latency_sum = stat->latency_sum;
+  }
+
+  rep->nlatency = encode_deltas(&sb_latency_histogram, agent_sent_latency,
+                                deltas);
+
+  if (sb_globals.tx_rate > 0)
+    rep->nresponse = encode_deltas(&sb_response_histogram,
+                                   agent_sent_response,
+                                   deltas + rep->nlatency);
+
+  hdr->type = MSG_REPORT;
+  hdr->size = sizeof(*rep) +
+    (rep->nlatency + rep->nresponse) * sizeof(msg_delta_t);
+
+  return sb_net_write_all(agent_fd, agent_buf, sizeof(*hdr) + hdr->size);
+}
+
+
+/*
+  Agent thread sending intermediate statistics at the coordinator interval.
+  Intervals are counted from the end of warmup, like local reports.
+*/
+
+static void *agent_thread_proc(void *arg)
+{
+  const uint64_t warmup_ns = SEC2NS(sb_globals.warmup_time);
+  uint64_t       next_ns = agent_interval_ns;
+  uint64_t       curr_ns;
+  int            old_state;
+  int            err;
+
+  (void) arg; /* unused */
+
+  for (;;)
+  {
+    curr_ns = sb_timer_value(&sb_exec_timer);
+    curr_ns = curr_ns > warmup_ns ? curr_ns - warmup_ns : 0;
+
+    if (curr_ns < next_ns)
+    {
+      sb_nanosleep(next_ns - curr_ns);
+      continue;
+    }
+
+    /* Skip intervals missed due to oversleeping */
+    const uint64_t seq = curr_ns / agent_interval_ns;
+    next_ns = (seq + 1) * agent_interval_ns;
+
+    /* Do not let sb_dist_agent_done() cancel the thread in the middle */
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+    err = agent_send_report(seq, NULL);
+    pthread_setcancelstate(old_state, NULL);
+
+    if (err)
+    {
+      log_errno(LOG_FATAL, "Failed to send statistics to the coordinator");
+      sb_globals.error = 1;
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+
+int sb_dist_agent_init(void)
+{
+  const char  *spec = sb_get_value_string("dist-coordinator");
+  msg_hdr_t   hdr;
+  msg_hello_t hello;
+  const size_t size = sb_latency_histogram.array_size * sizeof(uint64_t);
+
+  if (spec == NULL || spec[0] == '\0')
+    return 0;
+
+  /* The coordinator may be starting concurrently with agents, so retry */
+  for (unsigned int ms = 0; ; ms += DIST_CONNECT_RETRY_MS)
+  {
+    if ((agent_fd = sb_net_connect(spec, "dist-coordinator")) >= 0)
+      break;
+
+    if (errno == EINVAL)
+      return 1;
+
+    if ((errno != ECONNREFUSED && errno != ENOENT) ||
+        ms >= DIST_CONNECT_TIMEOUT_MS)
+    {
+      log_errno(LOG_FATAL, "Cannot connect to the coordinator at '%s'", spec);
+      return 1;
+    }
+
+    usleep(DIST_CONNECT_RETRY_MS * 1000);
+  }
+
+  agent_buf = malloc(report_max_size());
+  agent_totals = malloc(size);
+  agent_sent_latency = calloc(1, size);
+  agent_sent_response = calloc(1, size);
+
+  if (agent_buf == NULL || agent_totals == NULL ||
+      agent_sent_latency == NULL || agent_sent_response == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
+  hdr.type = MSG_HELLO;
+  hdr.size = sizeof(hello);
+
+  memset(&hello, 0, sizeof(hello));
+  hello.magic = DIST_MAGIC;
+  hello.version = DIST_VERSION;
+  hello.threads = sb_globals.threads;
+  hello.tx_rate = sb_globals.tx_rate;
+  hello.array_size = sb_latency_histogram.array_size;
+
+  if (sb_net_write_all(agent_fd, &hdr, sizeof(hdr)) ||
+      sb_net_write_all(agent_fd, &hello, sizeof(hello)))
+  {
+    log_errno(LOG_FATAL, "Failed to send a handshake to the coordinator");
+    return 1;
+  }
+
+  log_text(LOG_NOTICE, "Connected to the coordinator at '%s'", spec);
+
+  return 0;
+}
+
+
+int sb_dist_agent_wait_start(void)
+{
+  msg_hdr_t   hdr;
+  msg_start_t start;
+
+  if (agent_fd < 0)
+    return 0;
+
+  /* Tell the coordinator that all worker threads have been initialized */
+  hdr.type = MSG_READY;
+  hdr.size = 0;
+
+  if (sb_net_write_all(agent_fd, &hdr, sizeof(hdr)))
+  {
+    log_errno(LOG_FATAL, "Failed to notify the coordinator");
+    return 1;
+  }
+
+  if (sb_net_read_all(agent_fd, &hdr, sizeof(hdr)) ||
+      hdr.type != MSG_START || hdr.size != sizeof(start) ||
+      sb_net_read_all(agent_fd, &start, sizeof(start)))
+  {
+    log_text(LOG_FATAL, "The coordinator closed the connection before "
+             "starting the benchmark");
+    return 1;
+  }
+
+  agent_interval_ns = start.report_interval_ns;
+
+  return 0;
+}
+
+
+void sb_dist_agent_reset(void)
+{
+  if (agent_fd < 0)
+    return;
+
+  /* Consider statistics collected so far as already sent */
+  sb_counters_agg_total(agent_sent_cnt);
+
+  sb_histogram_get_totals(&sb_latency_histogram, agent_sent_latency);
+
+  if (sb_globals.tx_rate > 0)
+    sb_histogram_get_totals(&sb_response_histogram, agent_sent_response);
+}
+
+
+int sb_dist_agent_start(void)
+{
+  if (agent_fd < 0 || agent_interval_ns == 0)
+    return 0;
+
+  if (sb_thread_create(&agent_thread, &sb_thread_attr, &agent_thread_proc,
+                       NULL) != 0)
+  {
+    log_errno(LOG_FATAL, "sb_thread_create() for the agent thread failed.");
+    return 1;
+  }
+
+  agent_thread_created = 1;
+
+  return 0;
+}
+
+
+void sb_dist_agent_done(const sb_stat_t *stat)
+{
+  if (agent_fd < 0)
+    return;
+
+  if (agent_thread_created)
+  {
+    if (sb_thread_cancel(agent_thread) || sb_thread_join(agent_thread, NULL))
+      log_errno(LOG_FATAL, "Terminating the agent thread failed.");
+
+    agent_thread_created = 0;
+  }
+
+  if (!sb_globals.error && agent_send_report(0, stat))
+    log_errno(LOG_FATAL, "Failed to send statistics to the coordinator");
+
+  close(agent_fd);
+  agent_fd = -1;
+
+  free(agent_buf);
+  free(agent_totals);
+  free(agent_sent_latency);
+  free(agent_sent_response);
+}
+
+
+/* Coordinator state */
+
+static agent_t          *agents;
+static unsigned int     nagents;
+static uint64_t         interval_ns;
+static interval_t       intervals[DIST_WINDOW];
+/* Number of the next interval to report */
+static uint64_t         next_seq = 1;
+/* Largest interval number received from any agent */
+static uint64_t         max_seq;
+/* Cumulative statistics */
+static sb_results_t     total;
+static char             *coord_buf;
+
+
+/* Add counter and histogram deltas from a report message */
+
+static void add_deltas(uint64_t *counters, uint64_t *latency,
+                       uint64_t *response, const msg_report_t *rep,
+                       const msg_delta_t *deltas)
+{
+  for (size_t i = 0; i < SB_CNT_MAX; i++)
+    counters[i] += rep->counters[i];
+
+  for (uint32_t i = 0; i < rep->nlatency; i++)
+    latency[deltas[i].index] += deltas[i].count;
+
+  deltas += rep->nlatency;
+
+  for (uint32_t i = 0; i < rep->nresponse; i++)
+    response[deltas[i].index] += deltas[i].count;
+}
+
+
+/* Add statistics from a report message to an interval */
+
+static void interval_add(interval_t *iv, const msg_report_t *rep,
+                         const msg_delta_t *deltas)
+{
+  add_deltas(iv->counters, iv->latency, iv->response, rep, deltas);
+
+  iv->threads_running += rep->threads_running;
+  iv->agents++;
+}
+
+
+static int interval_alloc(interval_t *iv)
+{
+  const size_t size = sb_latency_histogram.array_size;
+
+  iv->latency = calloc(size, sizeof(uint64_t));
+  iv->response = calloc(size, sizeof(uint64_t));
+
+  return iv->latency == NULL || iv->response == NULL;
+}
+
+
+static void interval_free(interval_t *iv)
+{
+  free(iv->latency);
+  free(iv->response);
+}
+
+
+/*
+  Calculate percentiles in seconds from a latency or response time histogram
+  array. Both use the parameters of sb_latency_histogram.
+*/
+
+static void get_pcts(const uint64_t *array, double *pcts)
+{
+  sb_histogram_t * const h = &sb_latency_histogram;
+  uint64_t       nevents = 0;
+
+  for (size_t i = 0; i < h->array_size; i++)
+    nevents += array[i];
+
+  sb_histogram_get_pcts_array(h, array, nevents, sb_globals.percentiles,
+                              sb_globals.n_percentiles, pcts);
+
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+    pcts[i] = MS2SEC(pcts[i]);
+}
+
+
+/* Print a merged intermediate report for a given interval and reset it */
+
+static void print_interval(uint64_t seq)
+{
+  interval_t * const iv = &intervals[seq % DIST_WINDOW];
+  const double       seconds = NS2SEC(interval_ns);
+  const uint64_t     * const cnt = iv->counters;
+  double             pcts[MAX_PERCENTILES];
+  char               buf[SB_LATENCY_PCTS_STR_SIZE];
+
+  if (iv->agents > 0)
+  {
+    get_pcts(iv->latency, pcts);
+
+    log_timestamp(LOG_NOTICE, NS2SEC(seq * interval_ns),
+                  "agents: %u thds: %" PRIu32 " eps: %4.2f qps: %4.2f "
+                  "(r/w/o: %4.2f/%4.2f/%4.2f) lat %s err/s: %4.2f "
+                  "reconn/s: %4.2f",
+                  iv->agents, iv->threads_running,
+                  cnt[SB_CNT_EVENT] / seconds,
+                  (cnt[SB_CNT_READ] + cnt[SB_CNT_WRITE] + cnt[SB_CNT_OTHER]) /
+                  seconds,
+                  cnt[SB_CNT_READ] / seconds,
+                  cnt[SB_CNT_WRITE] / seconds,
+                  cnt[SB_CNT_OTHER] / seconds,
+                  sb_latency_pcts_str(pcts, 2, buf, sizeof(buf)),
+                  cnt[SB_CNT_ERROR] / seconds,
+                  cnt[SB_CNT_RECONNECT] / seconds);
+
+    if (total.has_response)
+    {
+      get_pcts(iv->response, pcts);
+
+      log_timestamp(LOG_NOTICE, NS2SEC(seq * interval_ns), "resp %s",
+                    sb_latency_pcts_str(pcts, 2, buf, sizeof(buf)));
+    }
+  }
+
+  memset(iv->counters, 0, sizeof(iv->counters));
+  memset(iv->latency, 0,
+         sb_latency_histogram.array_size * sizeof(uint64_t));
+  memset(iv->response, 0,
+         sb_latency_histogram.array_size * sizeof(uint64_t));
+  iv->threads_running = 0;
+  iv->agents = 0;
+}
+
+
+/*
+  Print reports for intervals received from all active agents, or all received
+  intervals if 'all' is true
+*/
+
+static void flush_intervals(bool all)
+{
+  while (next_seq <= max_seq)
+  {
+    for (unsigned int i = 0; i < nagents && !all; i++)
+    {
+      if (!agents[i].done && agents[i].seq < next_seq)
+        return;
+    }
+
+    print_interval(next_seq++);
+  }
+}
+
+
+/*
+  Read and apply a report message from a given agent. Returns 0 on success, 1
+  on error or disconnect.
+*/
+
+static int coord_read_report(agent_t *a)
+{
+  msg_hdr_t    hdr;
+  msg_report_t * const rep = (msg_report_t *) coord_buf;
+  msg_delta_t  * const deltas = (msg_delta_t *) (rep + 1);
+
+  if (sb_net_read_all(a->fd, &hdr, sizeof(hdr)) || hdr.type != MSG_REPORT ||
+      hdr.size < sizeof(*rep) || hdr.size > report_max_size() ||
+      sb_net_read_all(a->fd, coord_buf, hdr.size))
+    return 1;
+
+  const size_t ndeltas = (hdr.size - sizeof(*rep)) / sizeof(msg_delta_t);
+
+  if ((size_t) rep->nlatency + rep->nresponse != ndeltas)
+    return 1;
+
+  for (size_t i = 0; i < ndeltas; i++)
+  {
+    if (deltas[i].index >= sb_latency_histogram.array_size)
+      return 1;
+  }
+
+  add_deltas(total.counters, total.latency, total.response, rep, deltas);
+
+  a->events += rep->counters[SB_CNT_EVENT];
+
+  if (rep->final)
+  {
+    a->done = true;
+
+    sb_results_add_run(&total, a->threads, a->events, rep->time_total,
+                       rep->latency_min, rep->latency_max, rep->latency_sum);
+
+    return 0;
+  }
+
+  if (rep->seq < next_seq)
+  {
+    /* Too late for its interval report, only accounted in cumulative stats */
+    return 0;
+  }
+
+  /* Do not wait for lagging agents beyond the accumulation window */
+  while (rep->seq >= next_seq + DIST_WINDOW)
+    print_interval(next_seq++);
+
+  interval_add(&intervals[rep->seq % DIST_WINDOW], rep, deltas);
+
+  a->seq = rep->seq;
+
+  if (rep->seq > max_seq)
+    max_seq = rep->seq;
+
+  return 0;
+}
+
+
+/* Wait for all agents to connect and validate their handshakes */
+
+static int coord_accept_agents(int listen_fd, const char *spec)
+{
+  msg_hdr_t   hdr;
+  msg_hello_t hello;
+
+  log_text(LOG_NOTICE, "Waiting for %u agent(s) on '%s'...", nagents, spec);
+
+  for (unsigned int i = 0; i < nagents; i++)
+  {
+    agent_t * const a = &agents[i];
+
+    while ((a->fd = accept(listen_fd, NULL, NULL)) < 0)
+    {
+      if (errno != EINTR)
+      {
+        log_errno(LOG_FATAL, "accept() failed");
+        return 1;
+      }
+    }
+
+    if (sb_net_read_all(a->fd, &hdr, sizeof(hdr)) ||
+        hdr.type != MSG_HELLO || hdr.size != sizeof(hello) ||
+        sb_net_read_all(a->fd, &hello, sizeof(hello)) ||
+        hello.magic != DIST_MAGIC || hello.version != DIST_VERSION)
+    {
+      log_text(LOG_FATAL, "Invalid handshake from agent #%u", i);
+      return 1;
+    }
+
+    if (hello.array_size != sb_latency_histogram.array_size)
+    {
+      log_text(LOG_FATAL, "Latency histogram of agent #%u does not match the "
+               "coordinator one. Use the same --histogram-precision value", i);
+      return 1;
+    }
+
+    a->threads = hello.threads;
+    a->tx_rate = hello.tx_rate;
+
+    if (a->tx_rate > 0)
+      total.has_response = true;
+
+    log_text(LOG_NOTICE, "Agent #%u connected, threads: %" PRIu32
+             ", rate: %" PRIu32, i, a->threads, a->tx_rate);
+  }
+
+  return 0;
+}
+
+
+/*
+  Wait until all agents have initialized their worker threads, then start the
+  benchmark on all of them
+*/
+
+static int coord_start_agents(void)
+{
+  struct
+  {
+    msg_hdr_t   hdr;
+    msg_start_t start;
+  } msg;
+
+  for (unsigned int i = 0; i < nagents; i++)
+  {
+    if (sb_net_read_all(agents[i].fd, &msg.hdr, sizeof(msg.hdr)) ||
+        msg.hdr.type != MSG_READY || msg.hdr.size != 0)
+    {
+      log_text(LOG_FATAL, "Agent #%u failed to initialize worker threads", i);
+      return 1;
+    }
+  }
+
+  memset(&msg, 0, sizeof(msg));
+  msg.hdr.type = MSG_START;
+  msg.hdr.size = sizeof(msg.start);
+  msg.start.report_interval_ns = interval_ns;
+
+  for (unsigned int i = 0; i < nagents; i++)
+  {
+    if (sb_net_write_all(agents[i].fd, &msg, sizeof(msg)))
+    {
+      log_errno(LOG_FATAL, "Failed to start agent #%u", i);
+      return 1;
+    }
+  }
+
+  log_text(LOG_NOTICE, "Benchmark started on %u agent(s)!\n", nagents);
+
+  return 0;
+}
+
+
+/* Receive reports from agents until all of them are done */
+
+static int coord_run(void)
+{
+  struct pollfd *fds;
+  unsigned int  active = nagents;
+  int           err = 0;
+
+  if ((fds = malloc(nagents * sizeof(struct pollfd))) == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
+  while (active > 0)
+  {
+    unsigned int n = 0;
+
+    for (unsigned int i = 0; i < nagents; i++)
+    {
+      if (agents[i].done)
+        continue;
+
+      fds[n].fd = agents[i].fd;
+      fds[n].events = POLLIN;
+      fds[n].revents = 0;
+      n++;
+    }
+
+    if (poll(fds, n, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      log_errno(LOG_FATAL, "poll() failed");
+      err = 1;
+      break;
+    }
+
+    for (unsigned int i = 0, j = 0; i < nagents; i++)
+    {
+      agent_t * const a = &agents[i];
+
+      if (a->done)
+        continue;
+
+      if (fds[j++].revents == 0)
+        continue;
+
+      if (coord_read_report(a))
+      {
+        log_text(LOG_FATAL, "Agent #%u disconnected without sending final "
+                 "statistics", i);
+        a->done = true;
+        err = 1;
+      }
+
+      if (a->done)
+        active--;
+    }
+
+    flush_intervals(false);
+  }
+
+  flush_intervals(true);
+
+  free(fds);
+
+  return err;
+}
+
+
+int sb_dist_coordinator(void)
+{
+  const char *spec = sb_get_value_string("dist-coordinator");
+  int        listen_fd;
+  int        err = 1;
+  int        n;
+
+  if (spec == NULL || spec[0] == '\0')
+  {
+    log_text(LOG_FATAL, "--dist-coordinator is required for the "
+             "'coordinator' command");
+    return 1;
+  }
+
+  n = sb_get_value_int("dist-agents");
+  if (n < 1)
+  {
+    log_text(LOG_FATAL, "Invalid value for --dist-agents: %d", n);
+    return 1;
+  }
+
+  nagents = n;
+  interval_ns = sb_globals.report_interval_ns;
+
+  agents = calloc(nagents, sizeof(agent_t));
+  coord_buf = malloc(report_max_size());
+
+  if (sb_results_init(&total))
+    return 1;
+
+  if (agents == NULL || coord_buf == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
+  for (unsigned int i = 0; i < DIST_WINDOW; i++)
+  {
+    if (interval_alloc(&intervals[i]))
+    {
+      log_text(LOG_FATAL, "Memory allocation failure");
+      return 1;
+    }
+  }
+
+  for (unsigned int i = 0; i < nagents; i++)
+    agents[i].fd = -1;
+
+  if ((listen_fd = sb_net_listen(spec, "dist-coordinator")) < 0)
+    return 1;
+
+  if (coord_accept_agents(listen_fd, spec))
+    goto end;
+
+  if (coord_start_agents())
+    goto end;
+
+  err = coord_run();
+
+  sb_results_print(&total, "agent");
+
+end:
+  sb_net_close_listen(listen_fd, spec);
+
+  for (unsigned int i = 0; i < nagents; i++)
+  {
+    if (agents[i].fd >= 0)
+      close(agents[i].fd);
+  }
+
+  for (unsigned int i = 0; i < DIST_WINDOW; i++)
+    interval_free(&intervals[i]);
+
+  sb_results_done(&total);
+  free(coord_buf);
+  free(agents);
+
+  return err;
+}
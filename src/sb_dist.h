@@ -0,0 +1,67 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+  Distributed mode. The 'coordinator' command waits for a number of agents,
+  i.e. sysbench processes running a benchmark with --dist-coordinator, starts
+  them simultaneously and combines their statistics into a single set of
+  intermediate and cumulative reports. Agents send counter and latency
+  histogram deltas, so percentiles are calculated from merged histograms rather
+  than aggregated from per-agent percentiles.
+*/
+
+#ifndef SB_DIST_H
+#define SB_DIST_H
+
+#include "sysbench.h"
+
+/* Register distributed mode options */
+int sb_dist_register(void);
+
+/* Print distributed mode options */
+void sb_dist_print_help(void);
+
+/* Connect to the coordinator if --dist-coordinator is specified */
+int sb_dist_agent_init(void);
+
+/*
+  Notify the coordinator that worker threads have been initialized and wait for
+  it to start the benchmark, i.e. until all agents are ready. Must be called
+  right before starting the execution timer.
+*/
+int sb_dist_agent_wait_start(void);
+
+/*
+  Exclude statistics collected so far, i.e. during warmup, from reports sent to
+  the coordinator
+*/
+void sb_dist_agent_reset(void);
+
+/* Start sending intermediate statistics to the coordinator */
+int sb_dist_agent_start(void);
+
+/*
+  Send final statistics (a given cumulative stat is used for values not
+  available from counters and histograms) and disconnect from the coordinator
+*/
+void sb_dist_agent_done(const sb_stat_t *stat);
+
+/* Implementation of the 'coordinator' command */
+int sb_dist_coordinator(void);
+
+#endif /* SB_DIST_H */
@@ -41,47 +41,92 @@
 #include "sb_util.h"
 
 
-/*
-   Number of slots for current histogram array. TODO: replace this constant with
-   some autodetection code based on the number of available cores or some such.
-*/
-#define SB_HISTOGRAM_NSLOTS 128
-
 /* Global latency histogram */
 sb_histogram_t sb_latency_histogram CK_CC_CACHELINE;
 
+/* Global response time histogram */
+sb_histogram_t sb_response_histogram CK_CC_CACHELINE;
 
-int sb_histogram_init(sb_histogram_t *h, size_t size,
-                      double range_min, double range_max)
+/*
+  Allocate and initialize arrays common to all histogram types. The number of
+  elements in each array must be set in h->array_size by the caller.
+*/
+
+static int histogram_alloc(sb_histogram_t *h)
 {
   size_t i;
   uint64_t *tmp;
 
-  /* Allocate memory for cumulative_array + temp_array + all slot arrays */
-  tmp = (uint64_t *) calloc(size * (SB_HISTOGRAM_NSLOTS + 2), sizeof(uint64_t));
-  h->interm_slots = (uint64_t **) malloc(SB_HISTOGRAM_NSLOTS *
-                                         sizeof(uint64_t *));
+  /*
+    One intermediate slot per worker thread plus one shared by background
+    threads, see sb_alloc_per_thread_array(). Each slot has an extra element
+    for the dirty chunks bitmap. Pad each slot to the cache line size to avoid
+    false sharing between threads.
+  */
+  const size_t slot_size = SB_ALIGN((h->array_size + 1) * sizeof(uint64_t),
+                                    CK_MD_CACHELINE) / sizeof(uint64_t);
 
-  if (tmp == NULL || h->interm_slots == NULL)
+  h->nslots = sb_globals.threads + 1;
+
+  /*
+    Split arrays into at most SB_HISTOGRAM_MAX_CHUNKS chunks of at least a cache
+    line each
+  */
+  h->chunk_shift = 3;
+  while (((h->array_size - 1) >> h->chunk_shift) >= SB_HISTOGRAM_MAX_CHUNKS)
+    h->chunk_shift++;
+
+  /*
+    Allocate memory for cumulative_array + merged_array + temp_array + all slot
+    arrays
+  */
+  const size_t total = slot_size * (h->nslots + 3) * sizeof(uint64_t);
+
+  tmp = (uint64_t *) sb_memalign(total, CK_MD_CACHELINE);
+  h->interm_slots = (uint64_t **) malloc(h->nslots * sizeof(uint64_t *));
+  h->dirty_prev = (uint64_t *) calloc(h->nslots, sizeof(uint64_t));
+
+  if (tmp == NULL || h->interm_slots == NULL || h->dirty_prev == NULL)
   {
     log_text(LOG_FATAL,
              "Failed to allocate memory for a histogram object, size = %zd",
-             size);
+             h->array_size);
+    free(tmp);
+    free(h->interm_slots);
+    free(h->dirty_prev);
     return 1;
   }
 
+  memset(tmp, 0, total);
+
   h->cumulative_array = tmp;
-  tmp += size;
+  tmp += slot_size;
+
+  h->merged_array = tmp;
+  tmp += slot_size;
 
   h->temp_array = tmp;
-  tmp += size;
+  tmp += slot_size;
 
-  for (i = 0; i < SB_HISTOGRAM_NSLOTS; i++)
+  for (i = 0; i < h->nslots; i++)
   {
     h->interm_slots[i] = tmp;
-    tmp += size;
+    tmp += slot_size;
   }
 
+  h->cumulative_nevents = 0;
+
+  pthread_rwlock_init(&h->lock, NULL);
+
+  return 0;
+}
+
+
+int sb_histogram_init(sb_histogram_t *h, size_t size,
+                      double range_min, double range_max)
+{
+  h->type = SB_HISTOGRAM_LOG;
+
   h->range_deduct = log(range_min);
   h->range_mult = (size - 1) / (log(range_max) - h->range_deduct);
 
@@ -90,18 +135,194 @@ int sb_histogram_init(sb_histogram_t *h, size_t size,
 
   h->array_size = size;
 
-  pthread_rwlock_init(&h->lock, NULL);
+  return histogram_alloc(h);
+}
 
-  return 0;
+
+int sb_histogram_init_hdr(sb_histogram_t *h, unsigned int precision,
+                          double range_min, double range_max)
+{
+  unsigned int magnitude;
+  uint64_t     largest_distinct;
+  uint64_t     smallest_untrackable;
+  size_t       nbuckets;
+  double       units;
+
+  if (precision < SB_HISTOGRAM_MIN_PRECISION ||
+      precision > SB_HISTOGRAM_MAX_PRECISION || range_min <= 0 ||
+      range_max <= range_min)
+  {
+    log_text(LOG_FATAL, "Invalid HDR histogram parameters: precision = %u, "
+             "range = [%g, %g]", precision, range_min, range_max);
+    return 1;
+  }
+
+  h->type = SB_HISTOGRAM_HDR;
+  h->precision = precision;
+
+  /*
+    The number of linear sub-buckets per power of 2 must be large enough to
+    distinguish values differing in the least significant requested digit,
+    i.e. it is the smallest power of 2 not less than 2 * 10^precision.
+  */
+  largest_distinct = 2;
+  for (unsigned int i = 0; i < precision; i++)
+    largest_distinct *= 10;
+
+  for (magnitude = 0; (UINT64_C(1) << magnitude) < largest_distinct;
+       magnitude++)
+    ;
+
+  h->sub_bucket_half_count_magnitude = magnitude - 1;
+  h->sub_bucket_half_count = UINT64_C(1) << (magnitude - 1);
+  h->sub_bucket_mask = (UINT64_C(1) << magnitude) - 1;
+
+  h->range_min = range_min;
+  h->range_max = range_max;
+
+  units = ceil(range_max / range_min);
+  h->max_units = units;
+
+  /* Calculate the number of buckets required to cover [0, max_units] */
+  smallest_untrackable = UINT64_C(1) << magnitude;
+  for (nbuckets = 1; smallest_untrackable <= h->max_units; nbuckets++)
+  {
+    if (smallest_untrackable > INT64_MAX / 2)
+    {
+      nbuckets++;
+      break;
+    }
+    smallest_untrackable <<= 1;
+  }
+
+  h->array_size = (nbuckets + 1) * h->sub_bucket_half_count;
+
+  return histogram_alloc(h);
+}
+
+
+/* Count leading zeros in a non-zero 64-bit value */
+
+static inline unsigned int clz64(uint64_t v)
+{
+#ifdef __GNUC__
+  return __builtin_clzll(v);
+#else
+  unsigned int n = 0;
+
+  while (!(v & (UINT64_C(1) << 63)))
+  {
+    v <<= 1;
+    n++;
+  }
+
+  return n;
+#endif
+}
+
+
+/* Map a value in range_min units to an array index in a HDR histogram */
+
+static inline size_t hdr_units_to_index(const sb_histogram_t *h,
+                                        uint64_t units)
+{
+  if (SB_UNLIKELY(units > h->max_units))
+    units = h->max_units;
+
+  const unsigned int half_magnitude = h->sub_bucket_half_count_magnitude;
+  const unsigned int bucket = 64 - clz64(units | h->sub_bucket_mask) -
+    (half_magnitude + 1);
+  const uint64_t sub_bucket = units >> bucket;
+
+  return ((size_t) (bucket + 1) << half_magnitude) + sub_bucket -
+    h->sub_bucket_half_count;
+}
+
+
+/*
+  Map an array index in a HDR histogram to the highest value (in range_min
+  units) that is equivalent to it, i.e. falls into the same array element.
+*/
+
+static inline uint64_t hdr_index_to_units(const sb_histogram_t *h, size_t i)
+{
+  int      bucket = (int) (i >> h->sub_bucket_half_count_magnitude) - 1;
+  uint64_t sub_bucket = (i & (h->sub_bucket_half_count - 1)) +
+    h->sub_bucket_half_count;
+
+  if (bucket < 0)
+  {
+    sub_bucket -= h->sub_bucket_half_count;
+    bucket = 0;
+  }
+
+  return (sub_bucket << bucket) + (UINT64_C(1) << bucket) - 1;
+}
+
+
+/* Map an array index to the value it represents */
+
+static double index_to_value(const sb_histogram_t *h, size_t i)
+{
+  if (h->type == SB_HISTOGRAM_HDR)
+    return SB_MIN(hdr_index_to_units(h, i), h->max_units) * h->range_min;
+
+  return exp(i / h->range_mult + h->range_deduct);
+}
+
+
+/*
+  Increment an element in the intermediate slot of a given thread and mark its
+  chunk as dirty. Worker thread slots have a single writer, so plain
+  (non-atomic) updates are sufficient. The dirty bitmap is only written when the
+  chunk bit is not set yet, i.e. at most once per chunk between intermediate
+  merges. The slot of background threads may be shared by multiple threads and
+  is updated atomically.
+*/
+
+static inline void slot_inc(sb_histogram_t *h, int thread_id, size_t i)
+{
+  uint64_t * const slot = h->interm_slots[thread_id];
+  uint64_t * const dirty = &slot[h->array_size];
+  const uint64_t   bit = (uint64_t) 1 << (i >> h->chunk_shift);
+  const uint64_t   d = ck_pr_load_64(dirty);
+
+  if (SB_UNLIKELY((size_t) thread_id == h->nslots - 1))
+  {
+    ck_pr_inc_64(&slot[i]);
+
+    if (!(d & bit))
+      ck_pr_or_64(dirty, bit);
+  }
+  else
+  {
+    ck_pr_store_64(&slot[i], ck_pr_load_64(&slot[i]) + 1);
+
+    if (SB_UNLIKELY(!(d & bit)))
+      ck_pr_store_64(dirty, d | bit);
+  }
+}
+
+
+void sb_histogram_update_units(sb_histogram_t *h, int thread_id,
+                               uint64_t units)
+{
+  slot_inc(h, thread_id, hdr_units_to_index(h, units));
 }
 
 
 void sb_histogram_update(sb_histogram_t *h, double value)
 {
-  size_t      slot;
   ssize_t     i;
 
-  slot = sb_rand_uniform_uint64() % SB_HISTOGRAM_NSLOTS;
+  if (h->type == SB_HISTOGRAM_HDR)
+  {
+    const double units = value / h->range_min + 0.5;
+
+    sb_histogram_update_units(h, sb_tls_thread_id,
+                              units > 0 ? (uint64_t) units : 0);
+    return;
+  }
 
   i = floor((log(value) - h->range_deduct) * h->range_mult + 0.5);
   if (SB_UNLIKELY(i < 0))
@@ -109,69 +330,146 @@ void sb_histogram_update(sb_histogram_t *h, double value)
   else if (SB_UNLIKELY(i >= (ssize_t) (h->array_size)))
     i = h->array_size - 1;
 
-  ck_pr_inc_64(&h->interm_slots[slot][i]);
+  slot_inc(h, sb_tls_thread_id, i);
 }
 
 
-double sb_histogram_get_pct_intermediate(sb_histogram_t *h,
-                                         double percentile)
+/*
+  Calculate values for a given list of percentiles (sorted in ascending order)
+  from a given array with a total number of events in a single pass over the
+  array.
+*/
+static void get_pcts(sb_histogram_t *h, const uint64_t *array,
+                     uint64_t nevents, const double *percentiles, size_t n,
+                     double *res)
 {
-  size_t   i, s;
-  uint64_t nevents, ncur, nmax;
-  double   res;
+  size_t   i, j;
+  uint64_t ncur, nmax;
 
-  nevents = 0;
+  if (n == 0)
+    return;
 
-  /*
-    This can be called concurrently with other sb_histogram_get_pct_*()
-    functions, so use the lock to protect shared structures. This will not block
-    sb_histogram_update() calls, but we make sure we don't lose any concurrent
-    increments by atomically fetching each array element and replacing it with
-    0.
-  */
-  pthread_rwlock_wrlock(&h->lock);
+  j = 0;
+  nmax = floor(nevents * percentiles[0] / 100 + 0.5);
+
+  ncur = 0;
+  for (i = 0; i < h->array_size; i++)
+  {
+    ncur += array[i];
+
+    while (ncur >= nmax)
+    {
+      res[j++] = index_to_value(h, i);
+
+      if (j == n)
+        return;
+
+      nmax = floor(nevents * percentiles[j] / 100 + 0.5);
+    }
+  }
+
+  for (; j < n; j++)
+    res[j] = index_to_value(h, h->array_size - 1);
+}
+
+
+/*
+  Aggregate intermediate slots into temp_array and replace its contents with
+  the number of events added since the previous merge. Slot counters are never
+  reset, so this does not interfere with concurrent sb_histogram_update() calls.
+  Each counter is monotonic and has a single writer, so any increments missed
+  by this merge are accounted by the next one.
+
+  Unless 'full' is true, only chunks marked as dirty by any slot since the
+  previous merge are aggregated, so frequent intermediate reports do not scan
+  the entire histogram for each thread. Dirty bitmaps are cleared without
+  synchronizing with writers, so an increment racing with the merge may be
+  missed together with its dirty bit. Chunks dirty in the previous merge are
+  aggregated again to account for such increments. Elements of temp_array
+  outside of aggregated chunks are zero.
+
+  Returns the number of events in temp_array. This should be called with the
+  histogram lock write-locked.
+*/
+static uint64_t merge_slots(sb_histogram_t *h, bool full)
+{
+  size_t   i, s;
+  uint64_t nevents;
+  uint64_t mask;
 
-  /*
-    Merge intermediate slots into temp_array.
-  */
   const size_t size = h->array_size;
+  const size_t chunk_size = (size_t) 1 << h->chunk_shift;
   uint64_t * const array = h->temp_array;
 
-  for (i = 0; i < size; i++)
+  mask = full ? ~(uint64_t) 0 : 0;
+
+  for (s = 0; s < h->nslots; s++)
   {
-    array[i] = ck_pr_fas_64(&h->interm_slots[0][i], 0);
-    nevents += array[i];
+    const uint64_t d = ck_pr_fas_64(&h->interm_slots[s][size], 0);
+
+    mask |= d | h->dirty_prev[s];
+    h->dirty_prev[s] = d;
   }
 
-  for (s = 1; s < SB_HISTOGRAM_NSLOTS; s++)
+  memset(array, 0, size * sizeof(uint64_t));
+
+  nevents = 0;
+
+  for (size_t c = 0; c * chunk_size < size; c++)
   {
-    for (i = 0; i < size; i++)
+    if (!(mask & ((uint64_t) 1 << c)))
+      continue;
+
+    const size_t start = c * chunk_size;
+    const size_t end = SB_MIN(start + chunk_size, size);
+
+    for (s = 0; s < h->nslots; s++)
     {
-      uint64_t t;
+      const uint64_t * const slot = h->interm_slots[s];
 
-      t = ck_pr_fas_64(&h->interm_slots[s][i], 0);
+      for (i = start; i < end; i++)
+        array[i] += ck_pr_load_64(&slot[i]);
+    }
 
-      array[i] += t;
-      nevents += t;
+    for (i = start; i < end; i++)
+    {
+      const uint64_t t = array[i];
+
+      array[i] = t - h->merged_array[i];
+      h->merged_array[i] = t;
+      nevents += array[i];
     }
   }
 
+  return nevents;
+}
+
+
+void sb_histogram_get_pcts_intermediate(sb_histogram_t *h,
+                                        const double *percentiles, size_t n,
+                                        double *res)
+{
+  size_t   i;
+  uint64_t nevents;
+
   /*
-    Now that we have an aggregate 'snapshot' of current arrays and the total
-    number of events in it, calculate the current, intermediate percentile value
-    to return.
+    This can be called concurrently with other sb_histogram_get_pct_*()
+    functions, so use the lock to protect shared structures. This will not block
+    sb_histogram_update() calls.
   */
-  nmax = floor(nevents * percentile / 100 + 0.5);
+  pthread_rwlock_wrlock(&h->lock);
 
-  ncur = 0;
-  for (i = 0; i < size; i++)
-  {
-    ncur += array[i];
-    if (ncur >= nmax)
-      break;
-  }
+  const size_t size = h->array_size;
+  uint64_t * const array = h->temp_array;
 
-  res = exp(i / h->range_mult + h->range_deduct);
+  nevents = merge_slots(h, false);
+
+  /*
+    Now that we have an aggregate 'snapshot' of current arrays and the total
+    number of events in it, calculate the current, intermediate percentile
+    values to return.
+  */
+  get_pcts(h, array, nevents, percentiles, n, res);
 
   /* Finally, add temp_array into accumulated values in cumulative_array. */
   for (i = 0; i < size; i++)
@@ -182,6 +480,15 @@ double sb_histogram_get_pct_intermediate(sb_histogram_t *h,
   h->cumulative_nevents += nevents;
 
   pthread_rwlock_unlock(&h->lock);
+}
+
+
+double sb_histogram_get_pct_intermediate(sb_histogram_t *h,
+                                         double percentile)
+{
+  double res;
+
+  sb_histogram_get_pcts_intermediate(h, &percentile, 1, &res);
 
   return res;
 }
@@ -193,48 +500,31 @@ double sb_histogram_get_pct_intermediate(sb_histogram_t *h,
 */
 static void merge_intermediate_into_cumulative(sb_histogram_t *h)
 {
-  size_t   i, s;
-  uint64_t nevents;
-
-  nevents = h->cumulative_nevents;
-
-  const size_t size = h->array_size;
-  uint64_t * const array = h->cumulative_array;
+  const uint64_t nevents = merge_slots(h, true);
 
-  for (s = 0; s < SB_HISTOGRAM_NSLOTS; s++)
-  {
-    for (i = 0; i < size; i++)
-    {
-      uint64_t t = ck_pr_fas_64(&h->interm_slots[s][i], 0);
-      array[i] += t;
-      nevents += t;
-    }
-  }
+  for (size_t i = 0; i < h->array_size; i++)
+    h->cumulative_array[i] += h->temp_array[i];
 
-  h->cumulative_nevents = nevents;
+  h->cumulative_nevents += nevents;
 }
 
 
-/*
-  Calculate a given percentile from the cumulative array. This should be called
-  with the histogram lock either read- or write-locked.
-*/
-static double get_pct_cumulative(sb_histogram_t *h, double percentile)
+void sb_histogram_get_pcts_cumulative(sb_histogram_t *h,
+                                      const double *percentiles, size_t n,
+                                      double *res)
 {
-  size_t   i;
-  uint64_t ncur, nmax;
+  /*
+    This can be called concurrently with other sb_histogram_get_pct_*()
+    functions, so use the lock to protect shared structures. This will not block
+    sb_histogram_update() calls.
+  */
+  pthread_rwlock_wrlock(&h->lock);
 
-  nmax = floor(h->cumulative_nevents * percentile / 100 + 0.5);
+  merge_intermediate_into_cumulative(h);
 
-  ncur = 0;
-  for (i = 0; i < h->array_size; i++)
-  {
-    ncur += h->cumulative_array[i];
-    if (ncur >= nmax)
-      break;
-  }
+  get_pcts(h, h->cumulative_array, h->cumulative_nevents, percentiles, n, res);
 
-  return exp(i / h->range_mult + h->range_deduct);
+  pthread_rwlock_unlock(&h->lock);
 }
 
 
@@ -242,50 +532,117 @@ double sb_histogram_get_pct_cumulative(sb_histogram_t *h, double percentile)
 {
   double res;
 
+  sb_histogram_get_pcts_cumulative(h, &percentile, 1, &res);
+
+  return res;
+}
+
+
+uint64_t sb_histogram_get_pcts_checkpoint(sb_histogram_t *h,
+                                          const double *percentiles, size_t n,
+                                          double *res)
+{
+  uint64_t nevents;
+
   /*
     This can be called concurrently with other sb_histogram_get_pct_*()
     functions, so use the lock to protect shared structures. This will not block
-    sb_histogram_update() calls, but we make sure we don't lose any concurrent
-    increments by atomically fetching each array element and replacing it with
-    0.
+    sb_histogram_update() calls.
   */
   pthread_rwlock_wrlock(&h->lock);
 
   merge_intermediate_into_cumulative(h);
 
-  res = get_pct_cumulative(h, percentile);
+  get_pcts(h, h->cumulative_array, h->cumulative_nevents, percentiles, n, res);
+
+  nevents = h->cumulative_nevents;
+
+  /* Reset the cumulative array */
+  memset(h->cumulative_array, 0, h->array_size * sizeof(uint64_t));
+  h->cumulative_nevents = 0;
 
   pthread_rwlock_unlock(&h->lock);
 
-  return res;
+  return nevents;
 }
 
 
 double sb_histogram_get_pct_checkpoint(sb_histogram_t *h,
                                        double percentile)
 {
-  double   res;
+  double res;
+
+  sb_histogram_get_pcts_checkpoint(h, &percentile, 1, &res);
+
+  return res;
+}
+
+
+uint64_t sb_histogram_get_totals(sb_histogram_t *h, uint64_t *array)
+{
+  size_t   i, s;
+  uint64_t nevents = 0;
+
+  /* Slot counters are never reset, so their sums are totals since start */
+  memset(array, 0, h->array_size * sizeof(uint64_t));
+
+  for (s = 0; s < h->nslots; s++)
+  {
+    const uint64_t * const slot = h->interm_slots[s];
+
+    for (i = 0; i < h->array_size; i++)
+      array[i] += ck_pr_load_64(&slot[i]);
+  }
+
+  for (i = 0; i < h->array_size; i++)
+    nevents += array[i];
+
+  return nevents;
+}
+
+
+void sb_histogram_get_pcts_array(sb_histogram_t *h, const uint64_t *array,
+                                 uint64_t nevents, const double *percentiles,
+                                 size_t n, double *res)
+{
+  get_pcts(h, array, nevents, percentiles, n, res);
+}
+
+
+double sb_histogram_get_value(sb_histogram_t *h, size_t i)
+{
+  return index_to_value(h, i);
+}
+
+
+uint64_t sb_histogram_get_cumulative(sb_histogram_t *h, uint64_t *array)
+{
+  uint64_t nevents;
 
-  /*
-    This can be called concurrently with other sb_histogram_get_pct_*()
-    functions, so use the lock to protect shared structures. This will not block
-    sb_histogram_update() calls, but we make sure we don't lose any concurrent
-    increments by atomically fetching each array element and replacing it with
-    0.
-  */
   pthread_rwlock_wrlock(&h->lock);
 
   merge_intermediate_into_cumulative(h);
 
-  res = get_pct_cumulative(h, percentile);
-
-  /* Reset the cumulative array */
-  memset(h->cumulative_array, 0, h->array_size * sizeof(uint64_t));
-  h->cumulative_nevents = 0;
+  memcpy(array, h->cumulative_array, h->array_size * sizeof(uint64_t));
+  nevents = h->cumulative_nevents;
 
   pthread_rwlock_unlock(&h->lock);
 
-  return res;
+  return nevents;
+}
+
+
+void sb_histogram_merge_array(sb_histogram_t *h, const uint64_t *array)
+{
+  pthread_rwlock_wrlock(&h->lock);
+
+  for (size_t i = 0; i < h->array_size; i++)
+  {
+    h->cumulative_array[i] += array[i];
+    h->cumulative_nevents += array[i];
+  }
+
+  pthread_rwlock_unlock(&h->lock);
 }
 
 
@@ -309,7 +666,10 @@ void sb_histogram_print(sb_histogram_t *h)
   }
 
   if (maxcnt == 0)
+  {
+    pthread_rwlock_unlock(&h->lock);
     return;
+  }
 
   printf("       value  ------------- distribution ------------- count\n");
 
@@ -321,7 +681,7 @@ void sb_histogram_print(sb_histogram_t *h)
     width = floor(array[i] * (double) 40 / maxcnt + 0.5);
 
     printf("%12.3f |%-40.*s %lu\n",
-           exp(i / h->range_mult + h->range_deduct),          /* value */
+           index_to_value(h, i),                              /* value */
            width, "****************************************", /* distribution */
            (unsigned long) array[i]);                /* count */
   }
@@ -336,6 +696,7 @@ void sb_histogram_done(sb_histogram_t *h)
 
   free(h->cumulative_array);
   free(h->interm_slots);
+  free(h->dirty_prev);
 }
 
 /*
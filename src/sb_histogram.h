@@ -1,4 +1,4 @@
-/* Copyright (C) 2011-2017 Alexey Kopytov.
+/* Copyright (C) 2011-2018 Alexey Kopytov.
 
    This program is free software; you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
@@ -24,12 +24,31 @@
 # include <pthread.h>
 #endif
 
+/* Histogram types, i.e. mappings between values and array elements */
+
+typedef enum {
+  /* Logarithmic buckets between range_min and range_max */
+  SB_HISTOGRAM_LOG,
+  /*
+    HdrHistogram-style buckets: each power of 2 is split into a fixed number of
+    linear sub-buckets, which is derived from the requested number of
+    significant decimal digits. Values are tracked as integer multiples of
+    range_min.
+  */
+  SB_HISTOGRAM_HDR
+} sb_histogram_type_t;
+
 typedef struct {
   /*
      Cumulative histogram array. Updated 'on demand' by
      sb_histogram_get_pct_intermediate(). Protected by 'lock'.
   */
   uint64_t              *cumulative_array;
+  /*
+    Sum of all intermediate slots as of the last merge into cumulative_array.
+    Protected by 'lock'.
+  */
+  uint64_t              *merged_array;
   /*
      Total number of events in cumulative_array. Updated on demand by
      sb_histogram_get_pct_intermediate(). Protected by 'lock'.
@@ -41,13 +60,28 @@ typedef struct {
   */
   uint64_t              *temp_array;
   /*
-     Intermediate histogram values are split into multiple slots and updated
-     with atomics. Aggregations into cumulative values is performed by
-     sb_histogram_get_pct_intermediate() function.
+     Intermediate histogram values are split into per-thread slots (one for each
+     worker thread plus one shared by background threads). Slots are only ever
+     incremented, so worker threads update them without atomic operations.
+     Aggregations into cumulative values is performed by
+     sb_histogram_get_pct_intermediate() function using differences from
+     merged_array. Each slot array is followed by a bitmap of 'dirty' chunks,
+     i.e. chunks updated since the last intermediate merge.
   */
   uint64_t              **interm_slots;
+  /* Number of elements in interm_slots */
+  size_t                nslots;
+  /*
+    Dirty chunks bitmaps from the previous intermediate merge, one per slot.
+    Protected by 'lock'.
+  */
+  uint64_t              *dirty_prev;
+  /* log2 of the number of array elements per dirty chunk */
+  unsigned int          chunk_shift;
   /* Number of elements in each array */
   size_t                array_size;
+  /* Histogram type */
+  sb_histogram_type_t   type;
   /* Lower bound of values to track */
   double                range_min;
   /* Upper bound of values to track */
@@ -56,6 +90,16 @@ typedef struct {
   double                range_deduct;
   /* Value to multiply to calculate histogram range based array element */
   double                range_mult;
+  /* Number of significant decimal digits (SB_HISTOGRAM_HDR only) */
+  unsigned int          precision;
+  /* log2 of the number of sub-buckets per half-bucket (SB_HISTOGRAM_HDR) */
+  unsigned int          sub_bucket_half_count_magnitude;
+  /* Number of sub-buckets per half-bucket (SB_HISTOGRAM_HDR only) */
+  uint64_t              sub_bucket_half_count;
+  /* Mask covering all sub-bucket bits of the first bucket (SB_HISTOGRAM_HDR) */
+  uint64_t              sub_bucket_mask;
+  /* Largest tracked value in range_min units (SB_HISTOGRAM_HDR only) */
+  uint64_t              max_units;
   /*
      rwlock to protect cumulative_array and cumulative_nevents from concurrent
      updates.
@@ -63,9 +107,22 @@ typedef struct {
   pthread_rwlock_t      lock;
 } sb_histogram_t;
 
+/* Supported range for the number of significant digits in HDR histograms */
+#define SB_HISTOGRAM_MIN_PRECISION 1
+#define SB_HISTOGRAM_MAX_PRECISION 5
+
+/* Maximum number of dirty chunks per slot, i.e. bits in a dirty bitmap */
+#define SB_HISTOGRAM_MAX_CHUNKS 64
+
 /* Global latency histogram */
 extern sb_histogram_t sb_latency_histogram;
 
+/*
+  Global response time histogram, i.e. time from the intended event start to
+  its completion. Only used in the --rate mode.
+*/
+extern sb_histogram_t sb_response_histogram;
+
 /*
   Allocate a new histogram and initialize it with sb_histogram_init().
 */
@@ -83,9 +140,25 @@ void sb_histogram_delete(sb_histogram_t *h);
 int sb_histogram_init(sb_histogram_t *h, size_t size,
                       double range_min, double range_max);
 
+/*
+  Initialize a new HDR histogram object tracking values between range_min and
+  range_max with a given number of significant decimal digits. range_min is
+  also the histogram resolution, i.e. values are rounded to multiples of it.
+*/
+int sb_histogram_init_hdr(sb_histogram_t *h, unsigned int precision,
+                          double range_min, double range_max);
+
 /* Update histogram with a given value. */
 void sb_histogram_update(sb_histogram_t *h, double value);
 
+/*
+  Update a HDR histogram with a value expressed as an integer number of
+  range_min units on behalf of a given thread. This avoids floating point
+  conversions on hot paths like sb_event_stop().
+*/
+void sb_histogram_update_units(sb_histogram_t *h, int thread_id,
+                               uint64_t units);
+
 /*
   Calculate a given percentile value from the intermediate histogram values,
   then merge intermediate values into cumulative ones atomically, i.e. in a way
@@ -94,12 +167,26 @@ void sb_histogram_update(sb_histogram_t *h, double value);
 */
 double sb_histogram_get_pct_intermediate(sb_histogram_t *h, double percentile);
 
+/*
+  Same as sb_histogram_get_pct_intermediate(), but calculate values for n
+  percentiles sorted in ascending order in a single pass over the histogram.
+  Values are stored into the res array.
+*/
+void sb_histogram_get_pcts_intermediate(sb_histogram_t *h,
+                                        const double *percentiles, size_t n,
+                                        double *res);
+
 /*
   Merge intermediate histogram values into cumulative ones and calculate a given
   percentile value from the cumulative array.
 */
 double sb_histogram_get_pct_cumulative(sb_histogram_t *h, double percentile);
 
+/* Multi-percentile version of sb_histogram_get_pct_cumulative() */
+void sb_histogram_get_pcts_cumulative(sb_histogram_t *h,
+                                      const double *percentiles, size_t n,
+                                      double *res);
+
 /*
    Similar to sb_histogram_get_pct_cumulative(), but also resets cumulative
    stats right after calculating the returned percentile. The reset happens
@@ -108,6 +195,47 @@ double sb_histogram_get_pct_cumulative(sb_histogram_t *h, double percentile);
 */
 double sb_histogram_get_pct_checkpoint(sb_histogram_t *h, double percentile);
 
+/*
+  Multi-percentile version of sb_histogram_get_pct_checkpoint(). Returns the
+  number of events in the reset cumulative stats.
+*/
+uint64_t sb_histogram_get_pcts_checkpoint(sb_histogram_t *h,
+                                          const double *percentiles, size_t n,
+                                          double *res);
+
+/*
+  Copy the total number of values added to each histogram array element since
+  the histogram initialization into a given array of h->array_size elements and
+  return the total number of values. This does not affect intermediate or
+  cumulative values and does not block any other histogram functions.
+*/
+uint64_t sb_histogram_get_totals(sb_histogram_t *h, uint64_t *array);
+
+/*
+  Calculate values for n percentiles sorted in ascending order from an array
+  returned by sb_histogram_get_totals(). Values are stored into the res array.
+*/
+void sb_histogram_get_pcts_array(sb_histogram_t *h, const uint64_t *array,
+                                 uint64_t nevents, const double *percentiles,
+                                 size_t n, double *res);
+
+/* Return the value represented by a given histogram array element */
+double sb_histogram_get_value(sb_histogram_t *h, size_t i);
+
+/*
+  Merge intermediate histogram values into cumulative ones, copy the cumulative
+  array into a given array of h->array_size elements and return the number of
+  values in it.
+*/
+uint64_t sb_histogram_get_cumulative(sb_histogram_t *h, uint64_t *array);
+
+/*
+  Add values from an array of h->array_size elements, e.g. one returned by
+  sb_histogram_get_totals() for a histogram with identical parameters in
+  another process, to cumulative values of a given histogram.
+*/
+void sb_histogram_merge_array(sb_histogram_t *h, const uint64_t *array);
+
 /*
   Print a given histogram to stdout
 */
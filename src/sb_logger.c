@@ -25,6 +25,9 @@
 # include <stdarg.h>
 # include <string.h>
 #endif
+#ifdef HAVE_STRINGS_H
+# include <strings.h>
+#endif
 #ifdef HAVE_ERRNO_H
 # include <errno.h>
 #endif
@@ -43,11 +46,12 @@
 #define ERROR_BUFFER_SIZE 256
 
 /*
-   Use 1024-element array for latency histogram tracking values between 0.001
-   milliseconds and 100 seconds.
+   Use a HDR histogram tracking latency values between 1 nanosecond and 100
+   seconds. Values are in milliseconds, so the histogram resolution (i.e.
+   OPER_LOG_MIN_VALUE) is 1 ns, which is what sb_event_stop() relies on when
+   updating the histogram with raw timer values.
 */
-#define OPER_LOG_GRANULARITY 1024
-#define OPER_LOG_MIN_VALUE   1e-3
+#define OPER_LOG_MIN_VALUE   1e-6
 #define OPER_LOG_MAX_VALUE   1E5
 
 /* Array of message handlers (one chain per message type) */
@@ -94,10 +98,14 @@ static log_handler_t text_handler = {
 
 static sb_arg_t oper_handler_args[] =
 {
-  SB_OPT("percentile", "percentile to calculate in latency statistics (1-100). "
-         "Use the special value of 0 to disable percentile calculations",
-         "95", INT),
+  SB_OPT("percentile", "comma-separated list of percentiles to calculate in "
+         "latency statistics (0-100, fractional values are allowed, 'max' is "
+         "the same as 100). Use the special value of 0 to disable percentile "
+         "calculations", "95", LIST),
   SB_OPT("histogram", "print latency histogram in report", "off", BOOL),
+  SB_OPT("histogram-precision", "number of significant decimal digits to "
+         "maintain in latency histograms (1-5). Higher values improve accuracy "
+         "of percentile calculations at the cost of memory usage", "2", INT),
 
   SB_OPT_END
 };
@@ -322,7 +330,8 @@ void log_timestamp(log_msg_priority_t priority, double seconds,
   maxlen = TEXT_BUFFER_SIZE;
   clen = 0;
 
-  n = snprintf(buf, maxlen, "[ %.0fs ] ", seconds);
+  n = snprintf(buf, maxlen, "[ %.*fs ] ", (int) sb_globals.report_digits,
+               seconds);
   clen += n;
   maxlen -= n;
 
@@ -461,28 +470,102 @@ int text_handler_process(log_msg_t *msg)
 /* Initialize operation messages handler */
 
 
+static int percentile_cmp(const void *a_ptr, const void *b_ptr)
+{
+  const double a = *(const double *) a_ptr;
+  const double b = *(const double *) b_ptr;
+
+  return (a > b) - (a < b);
+}
+
+
+/* Parse the --percentile list into sb_globals.percentiles */
+
+static int parse_percentiles(void)
+{
+  sb_list_item_t *pos;
+  value_t        *val;
+  unsigned int   i, n;
+
+  n = 0;
+
+  SB_LIST_FOR_EACH(pos, sb_get_value_list("percentile"))
+  {
+    char   *endptr;
+    double res;
+
+    val = SB_LIST_ENTRY(pos, value_t, listitem);
+
+    if (!strcasecmp(val->data, "max"))
+      res = 100;
+    else
+    {
+      res = strtod(val->data, &endptr);
+      if (*val->data == '\0' || *endptr != '\0' || !(res >= 0 && res <= 100))
+      {
+        log_text(LOG_FATAL, "Invalid value for --percentile: '%s'", val->data);
+        return 1;
+      }
+    }
+
+    /* 0 disables percentile calculations */
+    if (res == 0)
+      continue;
+
+    if (n == MAX_PERCENTILES)
+    {
+      log_text(LOG_FATAL, "Too many values in --percentile (up to %d can be "
+               "defined)", MAX_PERCENTILES);
+      return 1;
+    }
+
+    sb_globals.percentiles[n++] = res;
+  }
+
+  qsort(sb_globals.percentiles, n, sizeof(double), percentile_cmp);
+
+  /* Remove duplicates */
+  sb_globals.n_percentiles = 0;
+  for (i = 0; i < n; i++)
+  {
+    if (i == 0 || sb_globals.percentiles[i] !=
+        sb_globals.percentiles[sb_globals.n_percentiles - 1])
+      sb_globals.percentiles[sb_globals.n_percentiles++] =
+        sb_globals.percentiles[i];
+  }
+
+  return 0;
+}
+
+
 int oper_handler_init(void)
 {
   int          tmp;
 
-  tmp = sb_get_value_int("percentile");
-  if (tmp < 0 || tmp > 100)
-  {
-    log_text(LOG_FATAL, "Invalid value for --percentile: %d",
-             tmp);
+  if (parse_percentiles())
     return 1;
-  }
-  sb_globals.percentile = tmp;
 
   sb_globals.histogram = sb_get_value_flag("histogram");
-  if (sb_globals.percentile == 0 && sb_globals.histogram != 0)
+  if (sb_globals.n_percentiles == 0 && sb_globals.histogram != 0)
   {
     log_text(LOG_FATAL, "--histogram cannot be used with --percentile=0");
     return 1;
   }
 
-  if (sb_histogram_init(&sb_latency_histogram, OPER_LOG_GRANULARITY,
-                        OPER_LOG_MIN_VALUE, OPER_LOG_MAX_VALUE))
+  tmp = sb_get_value_int("histogram-precision");
+  if (tmp < SB_HISTOGRAM_MIN_PRECISION || tmp > SB_HISTOGRAM_MAX_PRECISION)
+  {
+    log_text(LOG_FATAL, "Invalid value for --histogram-precision: %d", tmp);
+    return 1;
+  }
+
+  if (sb_histogram_init_hdr(&sb_latency_histogram, tmp,
+                            OPER_LOG_MIN_VALUE, OPER_LOG_MAX_VALUE))
+    return 1;
+
+  if (sb_globals.tx_rate > 0 &&
+      sb_histogram_init_hdr(&sb_response_histogram, tmp,
+                            OPER_LOG_MIN_VALUE, OPER_LOG_MAX_VALUE))
     return 1;
 
   return 0;
@@ -495,5 +578,8 @@ int oper_handler_done(void)
 {
   sb_histogram_done(&sb_latency_histogram);
 
+  if (sb_globals.tx_rate > 0)
+    sb_histogram_done(&sb_response_histogram);
+
   return 0;
 }
@@ -36,6 +36,7 @@
 #include "db_driver.h"
 #include "sb_rand.h"
 #include "sb_thread.h"
+#include "sb_barrier.h"
 
 #include "sb_ck_pr.h"
 
@@ -56,6 +57,12 @@
 #define THREAD_INIT_FUNC "thread_init"
 #define THREAD_DONE_FUNC "thread_done"
 #define THREAD_RUN_FUNC "thread_run"
+/*
+  Internal functions calling thread_init()/thread_done() for each client of a
+  worker thread in the --clients mode
+*/
+#define CLIENTS_INIT_FUNC "clients_init"
+#define CLIENTS_DONE_FUNC "clients_done"
 #define INIT_FUNC "init"
 #define DONE_FUNC "done"
 #define REPORT_INTERMEDIATE_HOOK "report_intermediate"
@@ -119,6 +126,10 @@ static lua_State *gstate;
 /* Custom command name */
 static const char * sb_lua_custom_command;
 
+/* Synchronizes worker threads executing a parallel custom command */
+static sb_barrier_t cmd_barrier;
+static bool cmd_parallel;
+
 /* Lua test operations */
 
 static int sb_lua_op_init(void);
@@ -179,6 +190,15 @@ static bool func_available(lua_State *L, const char *func)
   return rc;
 }
 
+/* Push a given function from the 'sysbench' table */
+
+static void get_sysbench_func(lua_State *L, const char *func)
+{
+  lua_getglobal(L, "sysbench");
+  lua_getfield(L, -1, func);
+  lua_remove(L, -2);
+}
+
 /* Export command line options */
 
 static int do_export_options(lua_State *L, bool global)
@@ -410,7 +430,10 @@ int sb_lua_op_thread_init(int thread_id)
   if (export_options(L))
     return 1;
 
-  lua_getglobal(L, THREAD_INIT_FUNC);
+  if (sb_globals.clients > 0)
+    get_sysbench_func(L, CLIENTS_INIT_FUNC);
+  else
+    lua_getglobal(L, THREAD_INIT_FUNC);
   if (!lua_isnil(L, -1))
   {
     lua_pushnumber(L, thread_id);
@@ -446,7 +469,10 @@ int sb_lua_op_thread_done(int thread_id)
   lua_State * const L = states[thread_id];
   int rc = 0;
 
-  lua_getglobal(L, THREAD_DONE_FUNC);
+  if (sb_globals.clients > 0)
+    get_sysbench_func(L, CLIENTS_DONE_FUNC);
+  else
+    lua_getglobal(L, THREAD_DONE_FUNC);
   if (!lua_isnil(L, -1))
   {
     lua_pushnumber(L, thread_id);
@@ -977,11 +1003,27 @@ static void *cmd_worker_thread(void *arg)
 
   call_custom_command(L);
 
+  /* Do not make other threads wait for this one in sb_lua_cmd_barrier_wait() */
+  sb_barrier_leave(&cmd_barrier);
+
   sb_lua_close_state(L);
 
   return NULL;
 }
 
+/*
+  Wait until all worker threads executing a parallel custom command reach this
+  point. Returns immediately if the command is executed by a single thread.
+*/
+
+int sb_lua_cmd_barrier_wait(void)
+{
+  if (!cmd_parallel)
+    return 0;
+
+  return sb_barrier_wait(&cmd_barrier) < 0;
+}
+
 /* Call a specified custom command */
 
 int sb_lua_call_custom_command(const char *name)
@@ -992,10 +1034,21 @@ int sb_lua_call_custom_command(const char *name)
   {
     int err;
 
-    if ((err = sb_thread_create_workers(cmd_worker_thread)))
-      return err;
+    if (sb_barrier_init(&cmd_barrier, sb_globals.threads, NULL, NULL))
+    {
+      log_errno(LOG_FATAL, "sb_barrier_init() failed");
+      return 1;
+    }
 
-    return sb_thread_join_workers();
+    cmd_parallel = true;
+
+    if ((err = sb_thread_create_workers(cmd_worker_thread)) == 0)
+      err = sb_thread_join_workers();
+
+    cmd_parallel = false;
+    sb_barrier_destroy(&cmd_barrier);
+
+    return err;
   }
 
   return call_custom_command(gstate);
@@ -1003,6 +1056,23 @@ int sb_lua_call_custom_command(const char *name)
 
 #define stat_to_number(name) sb_lua_var_number(L, #name, stat->name)
 
+/* Export an array of numbers as a Lua table field with a given name */
+
+static void sb_lua_var_array(lua_State *L, const char *name,
+                             const double *values, unsigned int n)
+{
+  lua_pushstring(L, name);
+  lua_createtable(L, n, 0);
+
+  for (unsigned int i = 0; i < n; i++)
+  {
+    lua_pushnumber(L, values[i]);
+    lua_rawseti(L, -2, i + 1);
+  }
+
+  lua_settable(L, -3);
+}
+
 static void stat_to_lua_table(lua_State *L, sb_stat_t *stat)
 {
   lua_newtable(L);
@@ -1010,6 +1080,15 @@ static void stat_to_lua_table(lua_State *L, sb_stat_t *stat)
   stat_to_number(time_interval);
   stat_to_number(time_total);
   stat_to_number(latency_pct);
+  /* Percentile ranks and the corresponding latency values */
+  sb_lua_var_array(L, "percentiles", sb_globals.percentiles,
+                   sb_globals.n_percentiles);
+  sb_lua_var_array(L, "latency_pcts", stat->latency_pcts,
+                   sb_globals.n_percentiles);
+
+  if (sb_globals.tx_rate > 0)
+    sb_lua_var_array(L, "response_pcts", stat->response_pcts,
+                     sb_globals.n_percentiles);
   stat_to_number(events);
   stat_to_number(reads);
   stat_to_number(writes);
@@ -1034,6 +1113,7 @@ static void sb_lua_report_intermediate(sb_stat_t *stat)
   */
   stat_to_number(queue_length);
   stat_to_number(concurrency);
+  stat_to_number(scheduler_lag);
 
   if (lua_pcall(L, 1, 0, 0))
   {
@@ -35,6 +35,8 @@ bool sb_lua_custom_command_defined(const char *name);
 
 int sb_lua_call_custom_command(const char *name);
 
+int sb_lua_cmd_barrier_wait(void);
+
 int sb_lua_report_thread_init(void);
 
 void sb_lua_report_thread_done(void *);
@@ -0,0 +1,430 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdarg.h>
+#endif
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+# include <sys/socket.h>
+#endif
+
+#include "sysbench.h"
+#include "sb_metrics.h"
+#include "sb_net.h"
+#include "sb_options.h"
+#include "sb_logger.h"
+#include "sb_thread.h"
+#include "sb_timer.h"
+#include "sb_counter.h"
+#include "sb_histogram.h"
+
+/* Maximum size of a metrics response body */
+#define METRICS_BUF_SIZE 65536
+
+/* Maximum size of an HTTP request */
+#define REQUEST_BUF_SIZE 4096
+
+/* Delay before retrying accept() after running out of descriptors or memory */
+#define ACCEPT_BACKOFF_NS (100 * NS_PER_MS)
+
+/* Upper bounds of latency histogram buckets, in seconds */
+static const double bucket_bounds[] =
+{
+  1e-5, 2e-5, 5e-5,
+  1e-4, 2e-4, 5e-4,
+  1e-3, 2e-3, 5e-3,
+  1e-2, 2e-2, 5e-2,
+  1e-1, 2e-1, 5e-1,
+  1, 2, 5,
+  10, 20, 50,
+  100
+};
+
+#define NBUCKETS (sizeof(bucket_bounds) / sizeof(bucket_bounds[0]))
+
+/* Metrics exporter options */
+
+static sb_arg_t metrics_args[] =
+{
+  SB_OPT("metrics-listen", "serve live statistics in the Prometheus text "
+         "format over HTTP on the specified [host:]port", NULL, STRING),
+
+  SB_OPT_END
+};
+
+static int listen_fd = -1;
+
+static pthread_t metrics_thread;
+static int metrics_thread_created;
+
+/* Response body buffer */
+static char   *metrics_buf;
+static size_t metrics_len;
+
+/* Buffer for histogram snapshots */
+static uint64_t *hist_array;
+
+
+int sb_metrics_register(void)
+{
+  sb_register_arg_set(metrics_args);
+
+  return 0;
+}
+
+
+void sb_metrics_print_help(void)
+{
+  printf("Metrics exporter options:\n");
+
+  sb_print_options(metrics_args);
+}
+
+
+static void metrics_printf(const char *fmt, ...)
+  SB_ATTRIBUTE_FORMAT(printf, 1, 2);
+
+/* Append formatted text to the response body, truncating it on overflow */
+
+static void metrics_printf(const char *fmt, ...)
+{
+  va_list ap;
+  int     n;
+
+  if (metrics_len >= METRICS_BUF_SIZE)
+    return;
+
+  va_start(ap, fmt);
+  n = vsnprintf(metrics_buf + metrics_len, METRICS_BUF_SIZE - metrics_len,
+                fmt, ap);
+  va_end(ap);
+
+  if (n > 0)
+    metrics_len = SB_MIN(metrics_len + n, (size_t) METRICS_BUF_SIZE);
+}
+
+
+static void metric_header(const char *name, const char *type,
+                          const char *help)
+{
+  metrics_printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+
+static void metric_counter(const char *name, const char *help, uint64_t val)
+{
+  metric_header(name, "counter", help);
+  metrics_printf("%s %" PRIu64 "\n", name, val);
+}
+
+
+static void metric_gauge(const char *name, const char *help, double val)
+{
+  metric_header(name, "gauge", help);
+  metrics_printf("%s %.9g\n", name, val);
+}
+
+
+/*
+  Export a latency histogram with values in milliseconds as a summary with
+  configured percentiles and as a histogram with fixed buckets. Sums are
+  approximated from histogram element values.
+*/
+
+static void metric_histogram(sb_histogram_t *h, const char *name,
+                             const char *help)
+{
+  double   pcts[MAX_PERCENTILES];
+  uint64_t nevents;
+  uint64_t cnt = 0;
+  double   sum = 0;
+  size_t   b = 0;
+
+  nevents = sb_histogram_get_totals(h, hist_array);
+
+  sb_histogram_get_pcts_array(h, hist_array, nevents, sb_globals.percentiles,
+                              sb_globals.n_percentiles, pcts);
+
+  metric_header(name, "summary", help);
+
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+    metrics_printf("%s{quantile=\"%g\"} %.9g\n", name,
+                   sb_globals.percentiles[i] / 100,
+                   nevents > 0 ? MS2SEC(pcts[i]) : 0);
+
+  for (size_t i = 0; i < h->array_size; i++)
+    sum += hist_array[i] * sb_histogram_get_value(h, i);
+
+  metrics_printf("%s_sum %.9g\n", name, MS2SEC(sum));
+  metrics_printf("%s_count %" PRIu64 "\n", name, nevents);
+
+  metrics_printf("# HELP %s_histogram %s\n# TYPE %s_histogram histogram\n",
+                 name, help, name);
+
+  for (size_t i = 0; i < h->array_size; i++)
+  {
+    const double value = MS2SEC(sb_histogram_get_value(h, i));
+
+    for (; b < NBUCKETS && value > bucket_bounds[b]; b++)
+      metrics_printf("%s_histogram_bucket{le=\"%g\"} %" PRIu64 "\n", name,
+                     bucket_bounds[b], cnt);
+
+    cnt += hist_array[i];
+  }
+
+  for (; b < NBUCKETS; b++)
+    metrics_printf("%s_histogram_bucket{le=\"%g\"} %" PRIu64 "\n", name,
+                   bucket_bounds[b], cnt);
+
+  metrics_printf("%s_histogram_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, cnt);
+  metrics_printf("%s_histogram_sum %.9g\n", name, MS2SEC(sum));
+  metrics_printf("%s_histogram_count %" PRIu64 "\n", name, cnt);
+}
+
+
+/* Generate the response body with current statistics */
+
+static void metrics_generate(void)
+{
+  sb_counters_t cnt;
+
+  metrics_len = 0;
+
+  sb_counters_agg_total(cnt);
+
+  metric_counter("sysbench_events_total", "Number of executed events.",
+                 cnt[SB_CNT_EVENT]);
+
+  metric_header("sysbench_queries_total", "counter",
+                "Number of executed queries by type.");
+  metrics_printf("sysbench_queries_total{type=\"read\"} %" PRIu64 "\n",
+                 cnt[SB_CNT_READ]);
+  metrics_printf("sysbench_queries_total{type=\"write\"} %" PRIu64 "\n",
+                 cnt[SB_CNT_WRITE]);
+  metrics_printf("sysbench_queries_total{type=\"other\"} %" PRIu64 "\n",
+                 cnt[SB_CNT_OTHER]);
+
+  metric_counter("sysbench_errors_total", "Number of ignored errors.",
+                 cnt[SB_CNT_ERROR]);
+  metric_counter("sysbench_reconnects_total",
+                 "Number of reconnects to the server.",
+                 cnt[SB_CNT_RECONNECT]);
+  metric_counter("sysbench_read_bytes_total", "Number of bytes read.",
+                 cnt[SB_CNT_BYTES_READ]);
+  metric_counter("sysbench_written_bytes_total", "Number of bytes written.",
+                 cnt[SB_CNT_BYTES_WRITTEN]);
+
+  metric_gauge("sysbench_threads_running", "Number of running worker threads.",
+               ck_pr_load_uint(&sb_globals.threads_running));
+  metric_gauge("sysbench_elapsed_seconds",
+               "Time elapsed since the benchmark start.",
+               sb_timer_running(&sb_exec_timer) ?
+               NS2SEC(sb_timer_value(&sb_exec_timer)) : 0);
+
+  if (sb_globals.n_percentiles > 0)
+    metric_histogram(&sb_latency_histogram, "sysbench_latency_seconds",
+                     "Event execution time.");
+
+  if (sb_globals.tx_rate > 0)
+  {
+    sb_stat_t stat;
+
+    memset(&stat, 0, sizeof(stat));
+    sb_schedule_get_stat(&stat);
+
+    metric_gauge("sysbench_queue_length", "Estimated number of overdue events.",
+                 stat.queue_length);
+    metric_gauge("sysbench_concurrency", "Number of in-flight events.",
+                 stat.concurrency);
+    metric_gauge("sysbench_scheduler_lag_seconds",
+                 "Delay of the oldest overdue event.", stat.scheduler_lag);
+
+    if (sb_globals.n_percentiles > 0)
+      metric_histogram(&sb_response_histogram,
+                       "sysbench_response_time_seconds",
+                       "Time from the intended event start to its "
+                       "completion.");
+  }
+}
+
+
+/* Read an HTTP request from a client and send a response */
+
+static void metrics_serve(int fd)
+{
+  char        req[REQUEST_BUF_SIZE];
+  char        hdr[256];
+  size_t      len = 0;
+  ssize_t     n;
+  const char *status;
+
+  /* Read until the end of request headers */
+  while (len < sizeof(req) - 1 &&
+         (n = read(fd, req + len, sizeof(req) - 1 - len)) > 0)
+  {
+    len += n;
+    req[len] = '\0';
+
+    if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+      break;
+  }
+
+  req[len] = '\0';
+
+  if (strncmp(req, "GET ", 4))
+  {
+    status = "405 Method Not Allowed";
+    metrics_len = 0;
+  }
+  else if (strncmp(req + 4, "/metrics ", 9) && strncmp(req + 4, "/ ", 2))
+  {
+    status = "404 Not Found";
+    metrics_len = 0;
+  }
+  else
+  {
+    status = "200 OK";
+    metrics_generate();
+  }
+
+  snprintf(hdr, sizeof(hdr),
+           "HTTP/1.0 %s\r\n"
+           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+           "Content-Length: %zu\r\n"
+           "Connection: close\r\n\r\n", status, metrics_len);
+
+  if (!sb_net_write_all(fd, hdr, strlen(hdr)))
+    sb_net_write_all(fd, metrics_buf, metrics_len);
+}
+
+
+/* Exporter thread */
+
+static void *metrics_thread_proc(void *arg)
+{
+  (void) arg; /* unused */
+
+  for (;;)
+  {
+    /* accept() is a cancellation point, see sb_metrics_done() */
+    const int fd = accept(listen_fd, NULL, NULL);
+
+    if (fd < 0)
+    {
+      /*
+        The pending connection stays in the queue until resources are freed,
+        so retrying immediately would spin
+      */
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+          errno == ENOMEM)
+        sb_nanosleep(ACCEPT_BACKOFF_NS);
+
+      continue;
+    }
+
+    /* Do not let a stalled client block other scrapes */
+    const struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    metrics_serve(fd);
+
+    close(fd);
+  }
+
+  return NULL;
+}
+
+
+int sb_metrics_init(void)
+{
+  const char *spec = sb_get_value_string("metrics-listen");
+  size_t     size;
+  int        err;
+
+  if (spec == NULL || spec[0] == '\0')
+    return 0;
+
+  size = sb_latency_histogram.array_size;
+  if (sb_globals.tx_rate > 0)
+    size = SB_MAX(size, sb_response_histogram.array_size);
+
+  metrics_buf = malloc(METRICS_BUF_SIZE);
+  hist_array = malloc(size * sizeof(uint64_t));
+
+  if (metrics_buf == NULL || hist_array == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
+  if ((listen_fd = sb_net_listen(spec, "metrics-listen")) < 0)
+    return 1;
+
+  if ((err = sb_thread_create(&metrics_thread, &sb_thread_attr,
+                              &metrics_thread_proc, NULL)) != 0)
+  {
+    log_errno(LOG_FATAL,
+              "sb_thread_create() for the metrics exporter thread failed.");
+    return 1;
+  }
+
+  metrics_thread_created = 1;
+
+  return 0;
+}
+
+
+void sb_metrics_done(void)
+{
+  if (metrics_thread_created)
+  {
+    if (sb_thread_cancel(metrics_thread) ||
+        sb_thread_join(metrics_thread, NULL))
+      log_errno(LOG_FATAL, "Terminating the metrics exporter thread failed.");
+
+    metrics_thread_created = 0;
+  }
+
+  if (listen_fd >= 0)
+  {
+    sb_net_close_listen(listen_fd, sb_get_value_string("metrics-listen"));
+    listen_fd = -1;
+  }
+
+  free(metrics_buf);
+  free(hist_array);
+
+  metrics_buf = NULL;
+  hist_array = NULL;
+}
@@ -0,0 +1,41 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+  Live statistics exporter (--metrics-listen). A background thread serves
+  statistics in the Prometheus text exposition format over HTTP. Metrics are
+  calculated on each scrape from monotonic per-thread counters and histogram
+  slots, so scrapes neither block worker threads nor affect reports.
+*/
+
+#ifndef SB_METRICS_H
+#define SB_METRICS_H
+
+/* Register metrics exporter options */
+int sb_metrics_register(void);
+
+/* Print metrics exporter options */
+void sb_metrics_print_help(void);
+
+/* Start the exporter thread if --metrics-listen is specified */
+int sb_metrics_init(void);
+
+/* Stop the exporter thread */
+void sb_metrics_done(void);
+
+#endif /* SB_METRICS_H */
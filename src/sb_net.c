@@ -0,0 +1,314 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdio.h>
+# include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+# include <sys/socket.h>
+#endif
+#ifdef HAVE_SYS_UN_H
+# include <sys/un.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
+#ifdef HAVE_NETDB_H
+# include <netdb.h>
+#endif
+
+#include <errno.h>
+
+#include "sb_net.h"
+#include "sb_logger.h"
+
+/* Do not raise SIGPIPE when writing to a socket closed by the peer */
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+/* Whether an address specification is a Unix socket path */
+
+static int is_unix_path(const char *spec)
+{
+  return strchr(spec, '/') != NULL;
+}
+
+
+/* Fill a Unix socket address. Returns 0 on success, 1 if the path is too long */
+
+static int unix_addr(const char *spec, const char *option,
+                     struct sockaddr_un *addr)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+
+  if (strlen(spec) >= sizeof(addr->sun_path))
+  {
+    log_text(LOG_FATAL, "Invalid value for --%s: '%s' (path is too long)",
+             option, spec);
+    return 1;
+  }
+
+  strcpy(addr->sun_path, spec);
+
+  return 0;
+}
+
+
+/*
+  Remove a Unix socket file. Other files are never removed, so that a mistyped
+  path does not destroy user data.
+*/
+
+static void unlink_socket(const char *path)
+{
+  struct stat st;
+
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+    unlink(path);
+}
+
+
+/*
+  Parse a [host:]port specification and resolve it. Returns 0 on success, 1 on
+  error.
+*/
+
+static int resolve(const char *spec, const char *option, int passive,
+                   struct addrinfo **res)
+{
+  struct addrinfo hints;
+  char            host[256];
+  const char      *port;
+  const char      *sep;
+  int             rc;
+
+  host[0] = '\0';
+
+  if ((sep = strrchr(spec, ':')) != NULL)
+  {
+    const char *start = spec;
+    size_t     len = sep - spec;
+
+    /* Strip brackets from IPv6 addresses */
+    if (len >= 2 && spec[0] == '[' && spec[len - 1] == ']')
+    {
+      start++;
+      len -= 2;
+    }
+
+    if (len >= sizeof(host))
+      len = sizeof(host) - 1;
+
+    memcpy(host, start, len);
+    host[len] = '\0';
+    port = sep + 1;
+  }
+  else
+    port = spec;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+  if ((rc = getaddrinfo(host[0] != '\0' ? host : NULL, port, &hints, res)))
+  {
+    log_text(LOG_FATAL, "Invalid value for --%s: '%s' (%s)", option, spec,
+             gai_strerror(rc));
+    return 1;
+  }
+
+  return 0;
+}
+
+
+int sb_net_listen(const char *spec, const char *option)
+{
+  struct addrinfo *res, *ai;
+  int             fd = -1;
+
+  if (is_unix_path(spec))
+  {
+    struct sockaddr_un addr;
+
+    if (unix_addr(spec, option, &addr))
+      return -1;
+
+    /* Remove a stale socket file left by a previous run */
+    unlink_socket(spec);
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0 &&
+        (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) ||
+         listen(fd, 64)))
+    {
+      close(fd);
+      fd = -1;
+    }
+  }
+  else
+  {
+    if (resolve(spec, option, 1, &res))
+      return -1;
+
+    for (ai = res; ai != NULL; ai = ai->ai_next)
+    {
+      const int on = 1;
+
+      fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+
+      if (fd < 0)
+        continue;
+
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+      if (!bind(fd, ai->ai_addr, ai->ai_addrlen) && !listen(fd, 64))
+        break;
+
+      close(fd);
+      fd = -1;
+    }
+
+    freeaddrinfo(res);
+  }
+
+  if (fd < 0)
+    log_errno(LOG_FATAL, "Cannot listen on '%s' for --%s", spec, option);
+
+  return fd;
+}
+
+
+int sb_net_connect(const char *spec, const char *option)
+{
+  struct addrinfo *res, *ai;
+  int             fd = -1;
+  int             err = 0;
+
+  if (is_unix_path(spec))
+  {
+    struct sockaddr_un addr;
+
+    if (unix_addr(spec, option, &addr))
+      return -1;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0 &&
+        connect(fd, (struct sockaddr *) &addr, sizeof(addr)))
+    {
+      err = errno;
+      close(fd);
+      fd = -1;
+      errno = err;
+    }
+
+    return fd;
+  }
+
+  if (resolve(spec, option, 0, &res))
+    return -1;
+
+  for (ai = res; ai != NULL; ai = ai->ai_next)
+  {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+
+    if (fd < 0)
+    {
+      err = errno;
+      continue;
+    }
+
+    if (!connect(fd, ai->ai_addr, ai->ai_addrlen))
+      break;
+
+    err = errno;
+    close(fd);
+    fd = -1;
+  }
+
+  freeaddrinfo(res);
+
+  if (fd < 0)
+    errno = err;
+
+  return fd;
+}
+
+
+void sb_net_close_listen(int fd, const char *spec)
+{
+  close(fd);
+
+  if (is_unix_path(spec))
+    unlink_socket(spec);
+}
+
+
+int sb_net_write_all(int fd, const void *buf, size_t len)
+{
+  const char *ptr = buf;
+
+  while (len > 0)
+  {
+    const ssize_t n = send(fd, ptr, len, MSG_NOSIGNAL);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    if (n <= 0)
+      return 1;
+
+    ptr += n;
+    len -= n;
+  }
+
+  return 0;
+}
+
+
+int sb_net_read_all(int fd, void *buf, size_t len)
+{
+  char *ptr = buf;
+
+  while (len > 0)
+  {
+    const ssize_t n = read(fd, ptr, len);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    if (n <= 0)
+      return 1;
+
+    ptr += n;
+    len -= n;
+  }
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+  Socket helpers for built-in network services (metrics exporter, distributed
+  mode). Addresses are specified as [host:]port, where IPv6 hosts may be
+  enclosed in brackets, or as a Unix socket path, i.e. any string containing a
+  '/'.
+*/
+
+#ifndef SB_NET_H
+#define SB_NET_H
+
+#include <stddef.h>
+
+/*
+  Create a listening socket for a given address. The option name is used in
+  error messages. Returns the socket descriptor or -1 on error.
+*/
+int sb_net_listen(const char *spec, const char *option);
+
+/*
+  Connect to a given address. The option name is used in error messages for
+  invalid addresses. Connection failures are not logged to let callers retry,
+  errno is set in this case. Returns the socket descriptor or -1 on error.
+*/
+int sb_net_connect(const char *spec, const char *option);
+
+/* Close a listening socket created by sb_net_listen() */
+void sb_net_close_listen(int fd, const char *spec);
+
+/* Write a buffer to a socket. Returns 0 on success, 1 on error */
+int sb_net_write_all(int fd, const void *buf, size_t len);
+
+/*
+  Read exactly len bytes from a socket. Returns 0 on success, 1 on error or end
+  of file
+*/
+int sb_net_read_all(int fd, void *buf, size_t len);
+
+#endif /* SB_NET_H */
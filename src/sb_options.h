@@ -119,6 +119,12 @@ int sb_opt_to_int(option_t *);
 
 unsigned long long sb_opt_to_size(option_t *);
 
+/*
+  Convert a size string with an optional K/M/G/T suffix to a number of bytes.
+  Returns 0 if the suffix is unknown.
+*/
+unsigned long long sb_str_to_size(const char *);
+
 double sb_opt_to_double(option_t *);
 
 char *sb_opt_to_string(option_t *);
@@ -0,0 +1,257 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdlib.h>
+#endif
+#ifdef HAVE_ERRNO_H
+# include <errno.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+
+#include <stdint.h>
+
+#include "sb_poll.h"
+#include "sb_logger.h"
+
+struct sb_poll
+{
+#ifdef HAVE_SYS_EPOLL_H
+  int                fd;        /* epoll descriptor */
+  struct epoll_event *events;   /* epoll_wait() buffer */
+  int                nevents;   /* size of the events buffer */
+#else
+  struct pollfd      *fds;      /* registered descriptors */
+  int                *ids;      /* their ids */
+  unsigned int       nfds;      /* number of registered descriptors */
+  unsigned int       size;      /* size of the fds and ids arrays */
+#endif
+};
+
+sb_poll_t *sb_poll_create(void)
+{
+  sb_poll_t *p = calloc(1, sizeof(sb_poll_t));
+
+  if (p == NULL)
+    return NULL;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if ((p->fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+  {
+    log_errno(LOG_FATAL, "epoll_create1() failed");
+    free(p);
+    return NULL;
+  }
+#endif
+
+  return p;
+}
+
+void sb_poll_destroy(sb_poll_t *p)
+{
+  if (p == NULL)
+    return;
+
+#ifdef HAVE_SYS_EPOLL_H
+  close(p->fd);
+  free(p->events);
+#else
+  free(p->fds);
+  free(p->ids);
+#endif
+
+  free(p);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+int sb_poll_add(sb_poll_t *p, int fd, int events, int id)
+{
+  struct epoll_event ev;
+
+  ev.events = EPOLLONESHOT |
+    ((events & SB_POLL_READ) ? EPOLLIN : 0) |
+    ((events & SB_POLL_WRITE) ? EPOLLOUT : 0);
+  ev.data.u64 = (uint64_t) id;
+
+  /* Descriptors stay registered after being reported, but disabled */
+  if (epoll_ctl(p->fd, EPOLL_CTL_MOD, fd, &ev) == 0 ||
+      (errno == ENOENT && epoll_ctl(p->fd, EPOLL_CTL_ADD, fd, &ev) == 0))
+    return 0;
+
+  log_errno(LOG_FATAL, "epoll_ctl() failed for descriptor %d", fd);
+
+  return 1;
+}
+
+int sb_poll_wait(sb_poll_t *p, int *ids, int *events, int max,
+                 int timeout_ms)
+{
+  int n;
+
+  if (max > p->nevents)
+  {
+    struct epoll_event *tmp = realloc(p->events, max * sizeof(*tmp));
+
+    if (tmp == NULL)
+      return -1;
+
+    p->events = tmp;
+    p->nevents = max;
+  }
+
+  do
+  {
+    n = epoll_wait(p->fd, p->events, max, timeout_ms);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0)
+  {
+    log_errno(LOG_FATAL, "epoll_wait() failed");
+    return -1;
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    const uint32_t e = p->events[i].events;
+
+    ids[i] = (int) p->events[i].data.u64;
+    events[i] = ((e & (EPOLLIN | EPOLLPRI)) ? SB_POLL_READ : 0) |
+      ((e & EPOLLOUT) ? SB_POLL_WRITE : 0) |
+      /* Let the owner of the descriptor discover the error */
+      ((e & (EPOLLERR | EPOLLHUP)) ? SB_POLL_READ | SB_POLL_WRITE : 0);
+  }
+
+  return n;
+}
+
+#else /* !HAVE_SYS_EPOLL_H */
+
+int sb_poll_add(sb_poll_t *p, int fd, int events, int id)
+{
+  if (p->nfds == p->size)
+  {
+    const unsigned int size = p->size > 0 ? p->size * 2 : 64;
+    struct pollfd *fds = realloc(p->fds, size * sizeof(*fds));
+    int *ids;
+
+    if (fds == NULL)
+      return 1;
+    p->fds = fds;
+
+    if ((ids = realloc(p->ids, size * sizeof(*ids))) == NULL)
+      return 1;
+    p->ids = ids;
+
+    p->size = size;
+  }
+
+  p->fds[p->nfds].fd = fd;
+  p->fds[p->nfds].events = ((events & SB_POLL_READ) ? POLLIN : 0) |
+    ((events & SB_POLL_WRITE) ? POLLOUT : 0);
+  p->fds[p->nfds].revents = 0;
+  p->ids[p->nfds] = id;
+  p->nfds++;
+
+  return 0;
+}
+
+int sb_poll_wait(sb_poll_t *p, int *ids, int *events, int max,
+                 int timeout_ms)
+{
+  int          n;
+  unsigned int i;
+
+  do
+  {
+    n = poll(p->fds, p->nfds, timeout_ms);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0)
+  {
+    log_errno(LOG_FATAL, "poll() failed");
+    return -1;
+  }
+
+  n = 0;
+  for (i = 0; i < p->nfds && n < max; )
+  {
+    const short e = p->fds[i].revents;
+
+    if (e == 0)
+    {
+      i++;
+      continue;
+    }
+
+    ids[n] = p->ids[i];
+    events[n] = ((e & (POLLIN | POLLPRI)) ? SB_POLL_READ : 0) |
+      ((e & POLLOUT) ? SB_POLL_WRITE : 0) |
+      ((e & (POLLERR | POLLHUP | POLLNVAL)) ?
+       SB_POLL_READ | SB_POLL_WRITE : 0);
+    n++;
+
+    /* Registrations are one-shot, remove this one */
+    p->nfds--;
+    p->fds[i] = p->fds[p->nfds];
+    p->ids[i] = p->ids[p->nfds];
+  }
+
+  return n;
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
+int sb_poll_fd(int fd, int events, int timeout_ms)
+{
+  struct pollfd pfd;
+  int           n;
+
+  pfd.fd = fd;
+  pfd.events = ((events & SB_POLL_READ) ? POLLIN : 0) |
+    ((events & SB_POLL_WRITE) ? POLLOUT : 0);
+  pfd.revents = 0;
+
+  do
+  {
+    n = poll(&pfd, 1, timeout_ms);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0)
+  {
+    log_errno(LOG_FATAL, "poll() failed");
+    return -1;
+  }
+
+  return ((pfd.revents & (POLLIN | POLLPRI)) ? SB_POLL_READ : 0) |
+    ((pfd.revents & POLLOUT) ? SB_POLL_WRITE : 0) |
+    ((pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) ?
+     SB_POLL_READ | SB_POLL_WRITE : 0);
+}
@@ -0,0 +1,61 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+  I/O readiness notification for event loops multiplexing non-blocking
+  connections in a single thread. Uses epoll where available and poll()
+  otherwise. Each registration is one-shot, i.e. a descriptor must be added
+  again after it has been reported as ready.
+*/
+
+#ifndef SB_POLL_H
+#define SB_POLL_H
+
+/* Event flags */
+#define SB_POLL_READ  1
+#define SB_POLL_WRITE 2
+
+typedef struct sb_poll sb_poll_t;
+
+/* Create an event loop poller. Returns NULL on error */
+sb_poll_t *sb_poll_create(void);
+
+/* Destroy a poller created with sb_poll_create() */
+void sb_poll_destroy(sb_poll_t *p);
+
+/*
+  Wait for a file descriptor to become ready for given events. The id is
+  reported back by sb_poll_wait(). Returns 0 on success, 1 on error.
+*/
+int sb_poll_add(sb_poll_t *p, int fd, int events, int id);
+
+/*
+  Wait up to timeout_ms milliseconds (or indefinitely if negative) for
+  registered descriptors and store up to max ids and ready events of the ready
+  ones. Returns the number of stored entries, or -1 on error.
+*/
+int sb_poll_wait(sb_poll_t *p, int *ids, int *events, int max,
+                 int timeout_ms);
+
+/*
+  Wait for a single file descriptor without a poller. Returns ready events, or
+  -1 on error.
+*/
+int sb_poll_fd(int fd, int events, int timeout_ms);
+
+#endif /* SB_POLL_H */
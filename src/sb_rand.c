@@ -56,6 +56,12 @@
 
 #include "sb_ck_pr.h"
 
+/*
+  Number of uniform values averaged by the Gaussian distribution. This used to
+  be set with --rand-spec-iter, which no longer exists.
+*/
+#define RAND_GAUSSIAN_ITER 12
+
 TLS sb_rng_state_t sb_rng_state CK_CC_CACHELINE;
 
 /* Exported variables */
@@ -165,7 +171,7 @@ int sb_rand_init(void)
     return 1;
   }
 
-  rand_iter = sb_get_value_int("rand-spec-iter");
+  rand_iter = RAND_GAUSSIAN_ITER;
   rand_iter_mult = 1.0 / rand_iter;
 
   rand_pct = sb_get_value_int("rand-spec-pct");
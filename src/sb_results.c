@@ -0,0 +1,463 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdio.h>
+# include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include "sb_results.h"
+#include "sb_options.h"
+#include "sb_logger.h"
+#include "sb_timer.h"
+#include "sb_histogram.h"
+
+/* Results options */
+
+static sb_arg_t results_args[] =
+{
+  SB_OPT("save-results", "save statistics to the specified file at the end of "
+         "the run. Files from multiple runs can be combined with the "
+         "'merge-results' command", NULL, STRING),
+
+  SB_OPT_END
+};
+
+/* Histogram snapshots taken by sb_results_snapshot() */
+static uint64_t *snapshot_latency;
+static uint64_t *snapshot_response;
+
+
+int sb_results_register(void)
+{
+  sb_register_arg_set(results_args);
+
+  return 0;
+}
+
+
+void sb_results_print_help(void)
+{
+  printf("Results options:\n");
+
+  sb_print_options(results_args);
+}
+
+
+int sb_results_init(sb_results_t *r)
+{
+  const size_t size = sb_latency_histogram.array_size;
+
+  memset(r, 0, sizeof(*r));
+
+  r->latency = calloc(size, sizeof(uint64_t));
+  r->response = calloc(size, sizeof(uint64_t));
+
+  if (r->latency == NULL || r->response == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
+  return 0;
+}
+
+
+void sb_results_done(sb_results_t *r)
+{
+  free(r->latency);
+  free(r->response);
+
+  r->latency = NULL;
+  r->response = NULL;
+}
+
+
+void sb_results_add_run(sb_results_t *r, uint32_t threads, uint64_t events,
+                        double time_total, double latency_min,
+                        double latency_max, double latency_sum)
+{
+  r->nsources++;
+  r->threads += threads;
+
+  if (time_total > r->time_total)
+    r->time_total = time_total;
+
+  /* Latency min/max values are undefined for runs without events */
+  if (events > 0)
+  {
+    if (!r->has_latency || latency_min < r->latency_min)
+      r->latency_min = latency_min;
+    if (!r->has_latency || latency_max > r->latency_max)
+      r->latency_max = latency_max;
+
+    r->has_latency = true;
+  }
+
+  r->latency_sum += latency_sum;
+}
+
+
+/* Calculate percentiles in seconds from a histogram array */
+
+static void get_pcts(const uint64_t *array, double *pcts)
+{
+  uint64_t nevents = 0;
+
+  for (size_t i = 0; i < sb_latency_histogram.array_size; i++)
+    nevents += array[i];
+
+  sb_histogram_get_pcts_array(&sb_latency_histogram, array, nevents,
+                              sb_globals.percentiles,
+                              sb_globals.n_percentiles, pcts);
+
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+    pcts[i] = MS2SEC(pcts[i]);
+}
+
+
+void sb_results_print(sb_results_t *r, const char *sources)
+{
+  const uint64_t * const cnt = r->counters;
+  const uint64_t queries = cnt[SB_CNT_READ] + cnt[SB_CNT_WRITE] +
+    cnt[SB_CNT_OTHER];
+  const double   seconds = r->time_total;
+  double         pcts[MAX_PERCENTILES];
+
+  if (sb_globals.histogram && cnt[SB_CNT_EVENT] > 0)
+  {
+    sb_histogram_merge_array(&sb_latency_histogram, r->latency);
+
+    log_text(LOG_NOTICE, "Latency histogram (values are in milliseconds)");
+    sb_histogram_print(&sb_latency_histogram);
+    log_text(LOG_NOTICE, " ");
+  }
+
+  log_text(LOG_NOTICE, "Merged statistics from %u %s(s), %" PRIu32
+           " thread(s) total:\n", r->nsources, sources, r->threads);
+
+  if (queries > 0)
+  {
+    log_text(LOG_NOTICE, "SQL statistics:");
+    log_text(LOG_NOTICE, "    queries performed:");
+    log_text(LOG_NOTICE, "        read:                            %" PRIu64,
+             cnt[SB_CNT_READ]);
+    log_text(LOG_NOTICE, "        write:                           %" PRIu64,
+             cnt[SB_CNT_WRITE]);
+    log_text(LOG_NOTICE, "        other:                           %" PRIu64,
+             cnt[SB_CNT_OTHER]);
+    log_text(LOG_NOTICE, "        total:                           %" PRIu64,
+             queries);
+    log_text(LOG_NOTICE, "    transactions:                        %-6" PRIu64
+             " (%.2f per sec.)", cnt[SB_CNT_EVENT],
+             cnt[SB_CNT_EVENT] / seconds);
+    log_text(LOG_NOTICE, "    queries:                             %-6" PRIu64
+             " (%.2f per sec.)", queries, queries / seconds);
+    log_text(LOG_NOTICE, "    ignored errors:                      %-6" PRIu64
+             " (%.2f per sec.)", cnt[SB_CNT_ERROR],
+             cnt[SB_CNT_ERROR] / seconds);
+    log_text(LOG_NOTICE, "    reconnects:                          %-6" PRIu64
+             " (%.2f per sec.)\n", cnt[SB_CNT_RECONNECT],
+             cnt[SB_CNT_RECONNECT] / seconds);
+  }
+
+  log_text(LOG_NOTICE, "Throughput:");
+  log_text(LOG_NOTICE, "    events/s (eps):                      %.4f",
+           cnt[SB_CNT_EVENT] / seconds);
+  log_text(LOG_NOTICE, "    time elapsed:                        %.4fs",
+           seconds);
+  log_text(LOG_NOTICE, "    total number of events:              %" PRIu64
+           "\n", cnt[SB_CNT_EVENT]);
+
+  log_text(LOG_NOTICE, "Latency (ms):");
+  log_text(LOG_NOTICE, "         min: %39.2f", SEC2MS(r->latency_min));
+  log_text(LOG_NOTICE, "         avg: %39.2f",
+           cnt[SB_CNT_EVENT] > 0 ?
+           SEC2MS(r->latency_sum) / cnt[SB_CNT_EVENT] : 0);
+  log_text(LOG_NOTICE, "         max: %39.2f", SEC2MS(r->latency_max));
+
+  get_pcts(r->latency, pcts);
+  sb_print_latency_pcts(pcts, 27);
+
+  log_text(LOG_NOTICE, "         sum: %39.2f\n", SEC2MS(r->latency_sum));
+
+  if (r->has_response)
+  {
+    log_text(LOG_NOTICE, "Response time (ms):");
+    get_pcts(r->response, pcts);
+    sb_print_latency_pcts(pcts, 27);
+    log_text(LOG_NOTICE, "");
+  }
+}
+
+
+int sb_results_snapshot(void)
+{
+  const char   *path = sb_get_value_string("save-results");
+  const size_t size = sb_latency_histogram.array_size * sizeof(uint64_t);
+
+  if (path == NULL || path[0] == '\0')
+    return 0;
+
+  if (snapshot_latency == NULL)
+  {
+    snapshot_latency = malloc(size);
+    snapshot_response = calloc(1, size);
+
+    if (snapshot_latency == NULL || snapshot_response == NULL)
+    {
+      log_text(LOG_FATAL, "Memory allocation failure");
+      return 1;
+    }
+  }
+
+  sb_histogram_get_cumulative(&sb_latency_histogram, snapshot_latency);
+
+  if (sb_globals.tx_rate > 0)
+    sb_histogram_get_cumulative(&sb_response_histogram, snapshot_response);
+
+  return 0;
+}
+
+
+/* Write records for non-zero elements of a histogram array */
+
+static int write_records(FILE *fp, const uint64_t *array, uint64_t *n)
+{
+  sb_results_record_t rec;
+
+  *n = 0;
+
+  for (size_t i = 0; i < sb_latency_histogram.array_size; i++)
+  {
+    if (array[i] == 0)
+      continue;
+
+    rec.index = i;
+    rec.count = array[i];
+
+    if (fp != NULL && fwrite(&rec, sizeof(rec), 1, fp) != 1)
+      return 1;
+
+    (*n)++;
+  }
+
+  return 0;
+}
+
+
+int sb_results_save(const sb_stat_t *stat)
+{
+  const char          *path = sb_get_value_string("save-results");
+  sb_results_header_t hdr;
+  FILE                *fp;
+  int                 rc = 1;
+
+  if (path == NULL || path[0] == '\0' || snapshot_latency == NULL)
+    return 0;
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SB_RESULTS_MAGIC, sizeof(hdr.magic));
+  hdr.version = SB_RESULTS_VERSION;
+  hdr.threads = sb_globals.threads;
+  hdr.tx_rate = sb_globals.tx_rate;
+  hdr.precision = sb_latency_histogram.precision;
+  hdr.array_size = sb_latency_histogram.array_size;
+
+  hdr.counters[SB_CNT_OTHER] = stat->other;
+  hdr.counters[SB_CNT_READ] = stat->reads;
+  hdr.counters[SB_CNT_WRITE] = stat->writes;
+  hdr.counters[SB_CNT_EVENT] = stat->events;
+  hdr.counters[SB_CNT_ERROR] = stat->errors;
+  hdr.counters[SB_CNT_RECONNECT] = stat->reconnects;
+  hdr.counters[SB_CNT_BYTES_READ] = stat->bytes_read;
+  hdr.counters[SB_CNT_BYTES_WRITTEN] = stat->bytes_written;
+
+  hdr.time_total = stat->time_total;
+  hdr.latency_min = stat->latency_min;
+  hdr.latency_max = stat->latency_max;
+  hdr.latency_sum = stat->latency_sum;
+
+  /* Count records first to write the header in a single pass */
+  write_records(NULL, snapshot_latency, &hdr.nlatency);
+  write_records(NULL, snapshot_response, &hdr.nresponse);
+
+  if ((fp = fopen(path, "wb")) == NULL)
+  {
+    log_errno(LOG_FATAL, "Cannot open the results file '%s'", path);
+    goto end;
+  }
+
+  if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      write_records(fp, snapshot_latency, &hdr.nlatency) ||
+      write_records(fp, snapshot_response, &hdr.nresponse))
+  {
+    log_errno(LOG_FATAL, "Failed to write the results file '%s'", path);
+    fclose(fp);
+    goto end;
+  }
+
+  if (fclose(fp))
+  {
+    log_errno(LOG_FATAL, "Failed to write the results file '%s'", path);
+    goto end;
+  }
+
+  rc = 0;
+
+end:
+  free(snapshot_latency);
+  free(snapshot_response);
+
+  snapshot_latency = NULL;
+  snapshot_response = NULL;
+
+  return rc;
+}
+
+
+/* Read histogram records from a results file into a given array */
+
+static int read_records(FILE *fp, uint64_t n, uint64_t *array)
+{
+  sb_results_record_t rec;
+
+  for (uint64_t i = 0; i < n; i++)
+  {
+    if (fread(&rec, sizeof(rec), 1, fp) != 1 ||
+        rec.index >= sb_latency_histogram.array_size)
+      return 1;
+
+    array[rec.index] += rec.count;
+  }
+
+  return 0;
+}
+
+
+/* Merge results from a given file */
+
+static int results_load(sb_results_t *r, const char *path)
+{
+  sb_results_header_t hdr;
+  FILE                *fp;
+  int                 rc = 1;
+
+  if ((fp = fopen(path, "rb")) == NULL)
+  {
+    log_errno(LOG_FATAL, "Cannot open the results file '%s'", path);
+    return 1;
+  }
+
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      memcmp(hdr.magic, SB_RESULTS_MAGIC, sizeof(hdr.magic)))
+  {
+    log_text(LOG_FATAL, "'%s' is not a sysbench results file", path);
+    goto end;
+  }
+
+  if (hdr.version != SB_RESULTS_VERSION)
+  {
+    log_text(LOG_FATAL, "Unsupported results file version in '%s': %" PRIu32,
+             path, hdr.version);
+    goto end;
+  }
+
+  if (hdr.array_size != sb_latency_histogram.array_size)
+  {
+    log_text(LOG_FATAL, "'%s' was saved with --histogram-precision=%" PRIu32
+             ", use the same value to merge it", path, hdr.precision);
+    goto end;
+  }
+
+  if (read_records(fp, hdr.nlatency, r->latency) ||
+      read_records(fp, hdr.nresponse, r->response))
+  {
+    log_text(LOG_FATAL, "Corrupted results file '%s'", path);
+    goto end;
+  }
+
+  for (size_t i = 0; i < SB_CNT_MAX; i++)
+    r->counters[i] += hdr.counters[i];
+
+  sb_results_add_run(r, hdr.threads, hdr.counters[SB_CNT_EVENT],
+                     hdr.time_total, hdr.latency_min, hdr.latency_max,
+                     hdr.latency_sum);
+
+  if (hdr.tx_rate > 0)
+    r->has_response = true;
+
+  rc = 0;
+
+end:
+  fclose(fp);
+
+  return rc;
+}
+
+
+int sb_results_merge_files(void)
+{
+  sb_results_t r;
+  bool         command_seen = false;
+  int          rc = 1;
+
+  if (sb_results_init(&r))
+    return 1;
+
+  /* All non-option arguments after the command name are file names */
+  for (int i = 1; i < sb_globals.argc; i++)
+  {
+    const char * const arg = sb_globals.argv[i];
+
+    if (!strncmp(arg, "--", 2))
+      continue;
+
+    if (!command_seen)
+    {
+      command_seen = true;
+      continue;
+    }
+
+    if (results_load(&r, arg))
+      goto end;
+  }
+
+  if (r.nsources == 0)
+  {
+    fprintf(stderr, "The 'merge-results' command requires a list of results "
+            "files saved with --save-results\n");
+    goto end;
+  }
+
+  sb_results_print(&r, "file");
+
+  rc = 0;
+
+end:
+  sb_results_done(&r);
+
+  return rc;
+}
@@ -0,0 +1,130 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+  Mergeable benchmark results, i.e. counters, latency summary values and
+  latency histogram arrays. Results of a run can be saved to a file
+  (--save-results), and results of multiple runs ('merge-results' command) or
+  distributed agents can be merged into a single report with exact combined
+  percentiles.
+*/
+
+#ifndef SB_RESULTS_H
+#define SB_RESULTS_H
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <inttypes.h>
+#endif
+
+#include <stdbool.h>
+
+#include "sysbench.h"
+#include "sb_counter.h"
+
+/*
+  Results file format: a header followed by nlatency + nresponse records for
+  non-zero histogram elements, latency ones first. Values are in the native byte
+  order.
+*/
+
+#define SB_RESULTS_MAGIC "SBRESULT"
+#define SB_RESULTS_VERSION 1
+
+typedef struct
+{
+  char     magic[8];            /* SB_RESULTS_MAGIC */
+  uint32_t version;             /* SB_RESULTS_VERSION */
+  uint32_t threads;             /* number of worker threads */
+  uint32_t tx_rate;             /* --rate value */
+  uint32_t precision;           /* --histogram-precision value */
+  uint64_t array_size;          /* number of histogram array elements */
+  uint64_t counters[SB_CNT_MAX]; /* counter values, see sb_counter_type_t */
+  double   time_total;          /* benchmark duration in seconds */
+  double   latency_min;         /* latency values in seconds */
+  double   latency_max;
+  double   latency_sum;
+  uint64_t nlatency;            /* number of latency histogram records */
+  uint64_t nresponse;           /* number of response time histogram records */
+} sb_results_header_t;
+
+typedef struct
+{
+  uint64_t index;               /* histogram array element */
+  uint64_t count;               /* number of values */
+} sb_results_record_t;
+
+/* Merged results */
+
+typedef struct
+{
+  uint64_t     counters[SB_CNT_MAX];
+  unsigned int nsources;        /* number of merged runs */
+  uint32_t     threads;         /* total number of worker threads */
+  double       time_total;      /* longest duration */
+  double       latency_min;
+  double       latency_max;
+  double       latency_sum;
+  /* Whether latency_min and latency_max are defined, i.e. there were events */
+  bool         has_latency;
+  /* Whether any run used the --rate mode */
+  bool         has_response;
+  /* Histogram arrays with the parameters of sb_latency_histogram */
+  uint64_t     *latency;
+  uint64_t     *response;
+} sb_results_t;
+
+/* Register results options */
+int sb_results_register(void);
+
+/* Print results options */
+void sb_results_print_help(void);
+
+/* Initialize empty results */
+int sb_results_init(sb_results_t *r);
+
+/* Free memory allocated by sb_results_init() */
+void sb_results_done(sb_results_t *r);
+
+/*
+  Merge values of a single run, except histogram arrays, which should be added
+  by the caller, into results
+*/
+void sb_results_add_run(sb_results_t *r, uint32_t threads, uint64_t events,
+                        double time_total, double latency_min,
+                        double latency_max, double latency_sum);
+
+/* Print a cumulative report for merged results from a given kind of sources */
+void sb_results_print(sb_results_t *r, const char *sources);
+
+/*
+  Take snapshots of cumulative histograms for --save-results. Must be called
+  before they are reset by the final checkpoint.
+*/
+int sb_results_snapshot(void);
+
+/* Save results of the current run if --save-results is specified */
+int sb_results_save(const sb_stat_t *stat);
+
+/* Implementation of the 'merge-results' command */
+int sb_results_merge_files(void);
+
+#endif /* SB_RESULTS_H */
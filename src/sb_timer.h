@@ -84,6 +84,10 @@ typedef struct
   struct timespec time_start;
   struct timespec time_end;
   uint64_t        events;
+  /*
+    Time spent by the current event in the event queue (--rate mode only). It
+    is not included into timer values, see sb_event_stop().
+  */
   uint64_t        queue_time;
   uint64_t        min_time;
   uint64_t        max_time;
@@ -130,7 +134,7 @@ static inline uint64_t sb_timer_stop(sb_timer_t *t)
 
   SB_GETTIME(&t->time_end);
 
-  uint64_t elapsed = TIMESPEC_DIFF(t->time_end, t->time_start) + t->queue_time;
+  uint64_t elapsed = TIMESPEC_DIFF(t->time_end, t->time_start);
 
   t->events++;
   t->sum_time += elapsed;
@@ -145,6 +149,25 @@ static inline uint64_t sb_timer_stop(sb_timer_t *t)
   return elapsed;
 }
 
+/*
+  Account an event of a given duration measured by the caller, i.e. update
+  timer counters without starting or stopping it
+*/
+static inline void sb_timer_add(sb_timer_t *t, uint64_t elapsed)
+{
+  ck_spinlock_lock(&t->lock);
+
+  t->events++;
+  t->sum_time += elapsed;
+
+  if (SB_UNLIKELY(elapsed < t->min_time))
+    t->min_time = elapsed;
+  if (SB_UNLIKELY(elapsed > t->max_time))
+    t->max_time = elapsed;
+
+  ck_spinlock_unlock(&t->lock);
+}
+
 /*
   get the current timer value in nanoseconds without affecting its state, i.e.
   is safe to be used concurrently on a shared timer.
@@ -154,7 +177,7 @@ static inline uint64_t sb_timer_value(sb_timer_t *t)
   struct timespec ts;
 
   SB_GETTIME(&ts);
-  return TIMESPEC_DIFF(ts, t->time_start) + t->queue_time;
+  return TIMESPEC_DIFF(ts, t->time_start);
 }
 
 /* Clone a timer */
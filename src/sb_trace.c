@@ -0,0 +1,606 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdio.h>
+# include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include "sysbench.h"
+#include "sb_trace.h"
+#include "sb_options.h"
+#include "sb_logger.h"
+#include "sb_thread.h"
+#include "sb_timer.h"
+#include "sb_histogram.h"
+
+/* Interval between flushes of ring buffers to the trace file */
+#define TRACE_FLUSH_INTERVAL_NS (10 * NS_PER_MS)
+
+/* Latency trace options */
+
+static sb_arg_t trace_args[] =
+{
+  SB_OPT("latency-trace", "write a record with the start time, thread ID, "
+         "latency and type of each executed event to the specified binary "
+         "file. The file can be analyzed with the 'trace-summary' command",
+         NULL, STRING),
+  SB_OPT("latency-trace-buffer-size", "size of the per-thread buffer for "
+         "latency trace records. Records are dropped when a buffer is full",
+         "4M", SIZE),
+
+  SB_OPT_END
+};
+
+bool sb_trace_enabled;
+
+sb_trace_ring_t *sb_trace_rings;
+
+uint64_t sb_trace_ring_mask;
+
+static FILE *trace_file;
+static const char *trace_file_name;
+
+static pthread_t trace_thread;
+static int trace_thread_created;
+
+/* Set by sb_trace_done() to terminate the writer thread */
+static int trace_stop;
+
+/* Set by the writer thread on write errors */
+static int trace_error;
+
+
+int sb_trace_register(void)
+{
+  sb_register_arg_set(trace_args);
+
+  return 0;
+}
+
+
+void sb_trace_print_help(void)
+{
+  printf("Latency trace options:\n");
+
+  sb_print_options(trace_args);
+}
+
+
+/*
+  Write all records currently available in a ring buffer to the trace file.
+  Records between tail and head may wrap around the end of the ring buffer, so
+  this takes at most 2 fwrite() calls.
+*/
+
+static void trace_flush_ring(sb_trace_ring_t *ring)
+{
+  const uint64_t head = ck_pr_load_64(&ring->head);
+  uint64_t       tail = ring->tail;
+
+  /* Read records only after reading head, see sb_trace_event() */
+  ck_pr_fence_load();
+
+  while (tail < head && !trace_error)
+  {
+    const size_t pos = tail & sb_trace_ring_mask;
+    const size_t n = SB_MIN(head - tail, sb_trace_ring_mask + 1 - pos);
+
+    if (fwrite(ring->records + pos, sizeof(sb_trace_record_t), n,
+               trace_file) != n)
+    {
+      log_errno(LOG_FATAL, "Failed to write to the latency trace file '%s'",
+                trace_file_name);
+      trace_error = 1;
+    }
+
+    tail += n;
+  }
+
+  ck_pr_store_64(&ring->tail, tail);
+}
+
+
+static void trace_flush(void)
+{
+  for (unsigned int i = 0; i < sb_globals.threads; i++)
+    trace_flush_ring(&sb_trace_rings[i]);
+}
+
+
+/* Background thread draining ring buffers into the trace file */
+
+static void *trace_thread_proc(void *arg)
+{
+  (void) arg; /* unused */
+
+  while (!ck_pr_load_int(&trace_stop))
+  {
+    sb_nanosleep(TRACE_FLUSH_INTERVAL_NS);
+    trace_flush();
+  }
+
+  return NULL;
+}
+
+
+int sb_trace_init(void)
+{
+  sb_trace_header_t hdr;
+  uint64_t          nrecords;
+  int               err;
+
+  trace_file_name = sb_get_value_string("latency-trace");
+
+  if (trace_file_name == NULL || trace_file_name[0] == '\0')
+    return 0;
+
+  /* Round the number of records down to a power of 2 */
+  const uint64_t size = sb_get_value_size("latency-trace-buffer-size") /
+    sizeof(sb_trace_record_t);
+
+  if (size < 2)
+  {
+    log_text(LOG_FATAL, "Invalid value for --latency-trace-buffer-size");
+    return 1;
+  }
+
+  for (nrecords = 2; nrecords * 2 <= size; nrecords *= 2)
+    ;
+
+  sb_trace_ring_mask = nrecords - 1;
+
+  /* Slots are allocated for worker threads only */
+  sb_trace_rings = sb_memalign(sb_globals.threads * sizeof(sb_trace_ring_t),
+                               CK_MD_CACHELINE);
+
+  if (sb_trace_rings == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
+  memset(sb_trace_rings, 0, sb_globals.threads * sizeof(sb_trace_ring_t));
+
+  for (unsigned int i = 0; i < sb_globals.threads; i++)
+  {
+    sb_trace_rings[i].records =
+      sb_memalign(nrecords * sizeof(sb_trace_record_t), CK_MD_CACHELINE);
+
+    if (sb_trace_rings[i].records == NULL)
+    {
+      log_text(LOG_FATAL, "Failed to allocate latency trace buffers");
+      return 1;
+    }
+  }
+
+  if ((trace_file = fopen(trace_file_name, "wb")) == NULL)
+  {
+    log_errno(LOG_FATAL, "Cannot open the latency trace file '%s'",
+              trace_file_name);
+    return 1;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  strncpy(hdr.magic, SB_TRACE_MAGIC, sizeof(hdr.magic));
+  hdr.version = SB_TRACE_VERSION;
+  hdr.record_size = sizeof(sb_trace_record_t);
+
+  if (fwrite(&hdr, sizeof(hdr), 1, trace_file) != 1)
+  {
+    log_errno(LOG_FATAL, "Failed to write to the latency trace file '%s'",
+              trace_file_name);
+    return 1;
+  }
+
+  if ((err = sb_thread_create(&trace_thread, &sb_thread_attr,
+                              &trace_thread_proc, NULL)) != 0)
+  {
+    log_errno(LOG_FATAL,
+              "sb_thread_create() for the latency trace thread failed.");
+    return 1;
+  }
+
+  trace_thread_created = 1;
+  sb_trace_enabled = true;
+
+  return 0;
+}
+
+
+void sb_trace_done(void)
+{
+  uint64_t dropped = 0;
+
+  if (trace_thread_created)
+  {
+    ck_pr_store_int(&trace_stop, 1);
+
+    if (sb_thread_join(trace_thread, NULL))
+      log_errno(LOG_FATAL, "Terminating the latency trace thread failed.");
+
+    trace_thread_created = 0;
+  }
+
+  sb_trace_enabled = false;
+
+  if (trace_file != NULL)
+  {
+    /* Write records added after the last flush by the writer thread */
+    trace_flush();
+
+    if (fclose(trace_file))
+      log_errno(LOG_FATAL, "Failed to close the latency trace file '%s'",
+                trace_file_name);
+
+    trace_file = NULL;
+  }
+
+  if (sb_trace_rings != NULL)
+  {
+    for (unsigned int i = 0; i < sb_globals.threads; i++)
+    {
+      dropped += sb_trace_rings[i].dropped;
+      free(sb_trace_rings[i].records);
+    }
+
+    free(sb_trace_rings);
+    sb_trace_rings = NULL;
+  }
+
+  if (dropped > 0)
+    log_text(LOG_WARNING, "%" PRIu64 " latency trace records were dropped "
+             "because trace buffers were full. Consider increasing "
+             "--latency-trace-buffer-size", dropped);
+}
+
+
+/* Event latency and completion time, as used by the 'trace-summary' command */
+
+typedef struct
+{
+  uint64_t end_ns;
+  uint64_t latency_ns;
+} trace_event_t;
+
+/*
+  Records are written in the order ring buffers are flushed rather than in the
+  order of event completion, so completion times of records from different
+  threads may be out of order by up to a few flush intervals. 'trace-summary'
+  passes records through a min-heap on completion time and only takes records
+  completed more than this number of nanoseconds before the latest one seen, so
+  memory usage is bounded by the number of events completed in this window.
+*/
+#define TRACE_REORDER_NS NS_PER_SEC
+
+/* Streaming state of the 'trace-summary' command */
+
+typedef struct
+{
+  /* Min-heap of records ordered by completion time */
+  trace_event_t  *heap;
+  size_t         heap_len;
+  size_t         heap_size;
+  /* Latest completion time of all records read so far */
+  uint64_t       max_end_ns;
+
+  /* Totals */
+  uint64_t       nevents;
+  uint64_t       sum_ns;
+  uint64_t       min_ns;
+  uint64_t       max_ns;
+  unsigned int   nthreads;
+
+  /* Current report interval */
+  sb_histogram_t interval_histogram;
+  uint64_t       interval_end_ns;
+  uint64_t       interval_nevents;
+  uint64_t       interval_max_ns;
+} trace_summary_t;
+
+
+static int trace_heap_push(trace_summary_t *ts, const trace_event_t *ev)
+{
+  size_t i;
+
+  if (ts->heap_len == ts->heap_size)
+  {
+    const size_t size = SB_MAX(ts->heap_size * 2, (size_t) 1024);
+    trace_event_t *tmp = realloc(ts->heap, size * sizeof(trace_event_t));
+
+    if (tmp == NULL)
+    {
+      log_text(LOG_FATAL, "Memory allocation failure");
+      return 1;
+    }
+
+    ts->heap = tmp;
+    ts->heap_size = size;
+  }
+
+  for (i = ts->heap_len++; i > 0; i = (i - 1) / 2)
+  {
+    const size_t parent = (i - 1) / 2;
+
+    if (ts->heap[parent].end_ns <= ev->end_ns)
+      break;
+
+    ts->heap[i] = ts->heap[parent];
+  }
+
+  ts->heap[i] = *ev;
+
+  return 0;
+}
+
+
+static trace_event_t trace_heap_pop(trace_summary_t *ts)
+{
+  const trace_event_t top = ts->heap[0];
+  const trace_event_t last = ts->heap[--ts->heap_len];
+  size_t              i = 0;
+
+  for (;;)
+  {
+    size_t child = 2 * i + 1;
+
+    if (child >= ts->heap_len)
+      break;
+
+    if (child + 1 < ts->heap_len &&
+        ts->heap[child + 1].end_ns < ts->heap[child].end_ns)
+      child++;
+
+    if (last.end_ns <= ts->heap[child].end_ns)
+      break;
+
+    ts->heap[i] = ts->heap[child];
+    i = child;
+  }
+
+  if (ts->heap_len > 0)
+    ts->heap[i] = last;
+
+  return top;
+}
+
+
+/* Print statistics for the current report interval and reset them */
+
+static void trace_report_interval(trace_summary_t *ts)
+{
+  const uint64_t interval_ns = sb_globals.report_interval_ns;
+  double         pcts[MAX_PERCENTILES];
+  char           buf[SB_LATENCY_PCTS_STR_SIZE];
+
+  if (ts->interval_nevents == 0)
+    return;
+
+  sb_histogram_get_pcts_checkpoint(&ts->interval_histogram,
+                                   sb_globals.percentiles,
+                                   sb_globals.n_percentiles, pcts);
+
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+    pcts[i] = MS2SEC(pcts[i]);
+
+  log_timestamp(LOG_NOTICE, NS2SEC(ts->interval_end_ns),
+                "events: %" PRIu64 " eps: %4.2f lat %s max: %4.2f",
+                ts->interval_nevents,
+                ts->interval_nevents / NS2SEC(interval_ns),
+                sb_latency_pcts_str(pcts, 2, buf, sizeof(buf)),
+                NS2MS(ts->interval_max_ns));
+
+  ts->interval_nevents = 0;
+  ts->interval_max_ns = 0;
+}
+
+
+/*
+  Account a single event in total and per-interval statistics. Events are
+  assigned to intervals by their completion time, as in intermediate reports.
+*/
+
+static void trace_account(trace_summary_t *ts, const trace_event_t *ev)
+{
+  const double latency_ms = NS2MS(ev->latency_ns);
+
+  ts->nevents++;
+  ts->sum_ns += ev->latency_ns;
+  ts->min_ns = SB_MIN(ts->min_ns, ev->latency_ns);
+  ts->max_ns = SB_MAX(ts->max_ns, ev->latency_ns);
+
+  sb_histogram_update(&sb_latency_histogram, latency_ms);
+
+  if (sb_globals.report_interval_ns == 0)
+    return;
+
+  /*
+    A record delayed by more than TRACE_REORDER_NS is accounted in the current
+    interval
+  */
+  if (ev->end_ns >= ts->interval_end_ns)
+  {
+    const uint64_t interval_ns = sb_globals.report_interval_ns;
+
+    trace_report_interval(ts);
+    ts->interval_end_ns = (ev->end_ns / interval_ns + 1) * interval_ns;
+  }
+
+  sb_histogram_update(&ts->interval_histogram, latency_ms);
+
+  ts->interval_nevents++;
+  ts->interval_max_ns = SB_MAX(ts->interval_max_ns, ev->latency_ns);
+}
+
+
+/*
+  Read records from the trace file and account them in the order of
+  completion
+*/
+
+static int trace_read(FILE *fp, trace_summary_t *ts)
+{
+  sb_trace_header_t hdr;
+  sb_trace_record_t buf[1024];
+  trace_event_t     ev;
+  size_t            n;
+
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      strncmp(hdr.magic, SB_TRACE_MAGIC, sizeof(hdr.magic)) ||
+      hdr.version != SB_TRACE_VERSION ||
+      hdr.record_size != sizeof(sb_trace_record_t))
+  {
+    log_text(LOG_FATAL, "'%s' is not a valid latency trace file",
+             trace_file_name);
+    return 1;
+  }
+
+  while ((n = fread(buf, sizeof(buf[0]), sizeof(buf) / sizeof(buf[0]), fp)) > 0)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      ev.end_ns = buf[i].time_ns + buf[i].latency_ns;
+      ev.latency_ns = buf[i].latency_ns;
+
+      ts->max_end_ns = SB_MAX(ts->max_end_ns, ev.end_ns);
+      ts->nthreads = SB_MAX(ts->nthreads, buf[i].thread_id + 1);
+
+      if (trace_heap_push(ts, &ev))
+        return 1;
+    }
+
+    while (ts->heap_len > 0 &&
+           ts->heap[0].end_ns + TRACE_REORDER_NS <= ts->max_end_ns)
+    {
+      ev = trace_heap_pop(ts);
+      trace_account(ts, &ev);
+    }
+  }
+
+  if (ferror(fp))
+  {
+    log_errno(LOG_FATAL, "Failed to read the latency trace file '%s'",
+              trace_file_name);
+    return 1;
+  }
+
+  while (ts->heap_len > 0)
+  {
+    ev = trace_heap_pop(ts);
+    trace_account(ts, &ev);
+  }
+
+  if (sb_globals.report_interval_ns > 0)
+  {
+    trace_report_interval(ts);
+    log_text(LOG_NOTICE, "");
+  }
+
+  return 0;
+}
+
+
+/*
+  Print per-interval and total latency statistics calculated from a trace
+  file. The file is processed in a single pass, percentiles are calculated
+  with HDR histograms using the precision specified with
+  --histogram-precision.
+*/
+
+int sb_trace_summary(void)
+{
+  trace_summary_t ts;
+  double          pcts[MAX_PERCENTILES];
+  FILE            *fp;
+  int             rc = 1;
+
+  trace_file_name = sb_get_value_string("latency-trace");
+
+  if (trace_file_name == NULL || trace_file_name[0] == '\0')
+  {
+    fprintf(stderr, "The 'trace-summary' command requires a trace file "
+            "specified with --latency-trace\n");
+    return 1;
+  }
+
+  if ((fp = fopen(trace_file_name, "rb")) == NULL)
+  {
+    log_errno(LOG_FATAL, "Cannot open the latency trace file '%s'",
+              trace_file_name);
+    return 1;
+  }
+
+  memset(&ts, 0, sizeof(ts));
+  ts.min_ns = UINT64_MAX;
+
+  if (sb_globals.report_interval_ns > 0 &&
+      sb_histogram_init_hdr(&ts.interval_histogram,
+                            sb_get_value_int("histogram-precision"),
+                            sb_latency_histogram.range_min,
+                            sb_latency_histogram.range_max))
+  {
+    fclose(fp);
+    return 1;
+  }
+
+  if (trace_read(fp, &ts))
+    goto end;
+
+  sb_histogram_get_pcts_cumulative(&sb_latency_histogram,
+                                   sb_globals.percentiles,
+                                   sb_globals.n_percentiles, pcts);
+
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+    pcts[i] = MS2SEC(pcts[i]);
+
+  log_text(LOG_NOTICE, "Latency trace summary:");
+  log_text(LOG_NOTICE, "    trace file:                          %s",
+           trace_file_name);
+  log_text(LOG_NOTICE, "    threads:                             %u",
+           ts.nthreads);
+  log_text(LOG_NOTICE, "    total number of events:              %" PRIu64
+           "\n", ts.nevents);
+
+  log_text(LOG_NOTICE, "Latency (ms):");
+  log_text(LOG_NOTICE, "         min: %39.2f",
+           ts.nevents > 0 ? NS2MS(ts.min_ns) : 0);
+  log_text(LOG_NOTICE, "         avg: %39.2f",
+           ts.nevents > 0 ? NS2MS(ts.sum_ns) / ts.nevents : 0);
+  log_text(LOG_NOTICE, "         max: %39.2f", NS2MS(ts.max_ns));
+
+  sb_print_latency_pcts(pcts, 27);
+
+  log_text(LOG_NOTICE, "         sum: %39.2f", NS2MS(ts.sum_ns));
+
+  rc = 0;
+
+end:
+  if (sb_globals.report_interval_ns > 0)
+    sb_histogram_done(&ts.interval_histogram);
+  free(ts.heap);
+  fclose(fp);
+
+  return rc;
+}
@@ -0,0 +1,143 @@
+/*
+   Copyright (C) 2018 Alexey Kopytov <akopytov@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+  Per-event latency trace (--latency-trace). Worker threads append records to
+  per-thread single-producer/single-consumer ring buffers, which are drained
+  into the trace file by a background thread. Workers never block on the trace:
+  records are dropped if a ring buffer is full.
+*/
+
+#ifndef SB_TRACE_H
+#define SB_TRACE_H
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef STDC_HEADERS
+# include <inttypes.h>
+#endif
+
+#include <stdbool.h>
+
+#include "sb_util.h"
+#include "sb_ck_pr.h"
+
+/*
+  Trace file format: a header followed by records in the native byte order.
+  Records from different threads are interleaved in no particular order.
+*/
+
+#define SB_TRACE_MAGIC "SBTRACE"
+#define SB_TRACE_VERSION 1
+
+typedef struct
+{
+  char     magic[8];            /* SB_TRACE_MAGIC */
+  uint32_t version;             /* SB_TRACE_VERSION */
+  uint32_t record_size;         /* sizeof(sb_trace_record_t) */
+} sb_trace_header_t;
+
+typedef struct
+{
+  uint64_t time_ns;             /* event start time since the benchmark start */
+  uint64_t latency_ns;          /* event execution time */
+  uint32_t thread_id;           /* worker thread ID */
+  uint32_t type;                /* event type, see sb_event_type_t */
+} sb_trace_record_t;
+
+/* Per-thread ring buffer of trace records */
+
+typedef struct
+{
+  sb_trace_record_t *records;
+  /* Number of records added by the owner thread */
+  uint64_t          head;
+  /* Last known value of tail, to avoid reading it on each event */
+  uint64_t          cached_tail;
+  /* Number of records dropped because the ring buffer was full */
+  uint64_t          dropped;
+
+  char pad1[SB_CACHELINE_PAD(sizeof(sb_trace_record_t *) +
+                             sizeof(uint64_t) * 3)];
+
+  /* Number of records written to the trace file by the background thread */
+  uint64_t          tail;
+
+  char pad2[SB_CACHELINE_PAD(sizeof(uint64_t))];
+} sb_trace_ring_t;
+
+/* Whether the latency trace is enabled for the current run */
+extern bool sb_trace_enabled;
+
+extern sb_trace_ring_t *sb_trace_rings;
+
+/* Ring buffer size in records minus 1. Ring buffer sizes are powers of 2 */
+extern uint64_t sb_trace_ring_mask;
+
+/* Register latency trace options */
+int sb_trace_register(void);
+
+/* Print latency trace options */
+void sb_trace_print_help(void);
+
+/*
+  Allocate ring buffers, open the trace file and start the background writer
+  thread if --latency-trace is specified
+*/
+int sb_trace_init(void);
+
+/* Stop the writer thread, flush remaining records and close the trace file */
+void sb_trace_done(void);
+
+/* Implementation of the 'trace-summary' command */
+int sb_trace_summary(void);
+
+/* Add a record to the ring buffer of a given worker thread */
+
+static inline void sb_trace_event(int thread_id, uint64_t time_ns,
+                                  uint64_t latency_ns, int type)
+{
+  sb_trace_ring_t * const ring = &sb_trace_rings[thread_id];
+  const uint64_t head = ring->head;
+
+  if (SB_UNLIKELY(head - ring->cached_tail > sb_trace_ring_mask))
+  {
+    ring->cached_tail = ck_pr_load_64(&ring->tail);
+
+    if (head - ring->cached_tail > sb_trace_ring_mask)
+    {
+      ring->dropped++;
+      return;
+    }
+  }
+
+  sb_trace_record_t * const rec = &ring->records[head & sb_trace_ring_mask];
+
+  rec->time_ns = time_ns;
+  rec->latency_ns = latency_ns;
+  rec->thread_id = thread_id;
+  rec->type = type;
+
+  /* Make the record visible to the writer thread before advancing head */
+  ck_pr_fence_store();
+  ck_pr_store_64(&ring->head, head + 1);
+}
+
+#endif /* SB_TRACE_H */
@@ -73,15 +73,38 @@
 #include "sb_rand.h"
 #include "sb_thread.h"
 #include "sb_barrier.h"
+#include "sb_trace.h"
+#include "sb_metrics.h"
+#include "sb_dist.h"
+#include "sb_results.h"
 
 #include "ck_cc.h"
-#include "ck_ring.h"
+#include "ck_spinlock.h"
 
 #define VERSION_STRING PACKAGE" "PACKAGE_VERSION SB_GIT_SHA
 
-/* Maximum queue length for the tx-rate mode. Must be a power of 2 */
+/*
+  Maximum number of overdue events in the tx-rate mode. The run is aborted when
+  the event backlog grows beyond this limit.
+*/
 #define MAX_QUEUE_LEN 131072
 
+/* Number of event start times precomputed at once by each event schedule */
+#define SCHEDULE_BATCH 64
+
+/*
+  Busy-wait for the next scheduled event rather than sleep when it is due in
+  less than this number of nanoseconds, as nanosleep() is not accurate enough
+  for short intervals.
+*/
+#define SCHEDULE_SPIN_NS 50000
+
+/*
+  Maximum time to wait for the next scheduled event. Idle threads re-check for
+  global errors on each wakeup, so this bounds the time it takes to stop them.
+*/
+#define SCHEDULE_MAX_SLEEP_NS (100 * NS_PER_MS)
+
 /*
   Extra thread ID assigned to background threads. This may be used as an index
   into per-thread arrays (see comment in sb_alloc_per_thread_array().
@@ -92,6 +115,13 @@
 sb_arg_t general_args[] =
 {
   SB_OPT("threads", "number of threads to use", "1", INT),
+  SB_OPT("clients", "number of clients to simulate by running Lua script "
+         "events as coroutines multiplexed over worker threads. Requires a "
+         "database driver with non-blocking connections to be effective. 0 "
+         "runs a single client per thread", "0", INT),
+  SB_OPT("clients-blocking", "allow --clients with database drivers "
+         "that do not support non-blocking connections. Clients of a thread "
+         "then wait for each other's queries", "off", BOOL),
   SB_OPT("events", "limit for total number of events", "0", INT),
   SB_OPT("time", "limit for total execution time in seconds", "10", INT),
   SB_OPT("warmup-time", "execute events for this many seconds with statistics "
@@ -104,8 +134,12 @@ sb_arg_t general_args[] =
   SB_OPT("thread-init-timeout", "wait time in seconds for worker threads to initialize", "30", INT),
   SB_OPT("rate", "average transactions rate. 0 for unlimited rate", "0", INT),
   SB_OPT("report-interval", "periodically report intermediate statistics with "
-         "a specified interval in seconds. 0 disables intermediate reports",
-         "0", INT),
+         "a specified interval in seconds. Fractional values down to 0.001 "
+         "can be used for sub-second intervals. 0 disables intermediate "
+         "reports", "0", DOUBLE),
+  SB_OPT("report-compact", "print intermediate reports as lines of "
+         "space-separated values following a single header line. Overrides "
+         "report hooks of Lua scripts", "off", BOOL),
   SB_OPT("report-checkpoints", "dump full statistics and reset all counters at "
          "specified points in time. The argument is a list of comma-separated "
          "values representing the amount of time in seconds elapsed from start "
@@ -139,16 +173,47 @@ static int thread_init_timeout;
 /* Barrier to signal reporting threads */
 static sb_barrier_t report_barrier;
 
-/* structures to handle queue of events, needed for tx_rate mode */
-static pthread_mutex_t    queue_mutex;
-static pthread_cond_t     queue_cond;
-static uint64_t           queue_array[MAX_QUEUE_LEN] CK_CC_CACHELINE;
-static ck_ring_buffer_t   queue_ring_buffer[MAX_QUEUE_LEN] CK_CC_CACHELINE;
-static ck_ring_t          queue_ring CK_CC_CACHELINE;
+/*
+  Per-thread event schedule for the tx_rate mode. Each worker thread generates
+  its own Poisson arrival process with 1/threads of the target rate, so the
+  superposition of all schedules is a Poisson process with the target rate.
+  Intended event start times are precomputed in batches. Idle workers take
+  overdue events from schedules of busy ones, see schedule_next_event().
+*/
+typedef struct
+{
+  /* Start time of the next event, can be read without holding the lock */
+  uint64_t      next_ns;
+  /* Precomputed intended event start times */
+  uint64_t      times[SCHEDULE_BATCH];
+  /* Protects times and pos */
+  ck_spinlock_t lock;
+  /* Index of the next event in times */
+  unsigned int  pos;
+  /* Whether the owner thread is executing an event */
+  int           busy;
+
+  char pad[SB_CACHELINE_PAD(sizeof(uint64_t) * (SCHEDULE_BATCH + 1) +
+                            sizeof(ck_spinlock_t) + sizeof(int) * 2)];
+} sb_schedule_t;
+
+static sb_schedule_t *schedules;
+
+/* Mean interval between events in a single event schedule, in nanoseconds */
+static double schedule_lambda;
+
+/*
+  Idle threads wait for their next events on schedule_cond. One of them, the
+  watcher, also wakes up when the earliest event of any schedule is due, to
+  take it if the owner of that schedule is busy. schedule_mutex protects
+  handing the watcher role over to another idle thread.
+*/
+static pthread_mutex_t schedule_mutex;
+static pthread_cond_t  schedule_cond;
+static int             schedule_watcher = -1;
 
 static int report_thread_created CK_CC_CACHELINE;
 static int checkpoints_thread_created;
-static int eventgen_thread_created;
 
 /* per-thread timers for response time stats */
 static sb_timer_t *timers;
@@ -165,9 +230,13 @@ sb_timer_t sb_checkpoint_timer   CK_CC_CACHELINE;
 
 TLS int sb_tls_thread_id;
 
+/* Type of the current event for latency trace records */
+static TLS int tls_event_type = SB_REQ_TYPE_SCRIPT;
+
 static void print_header(void);
 static void print_help(void);
 static void print_run_mode(sb_test_t *);
+static void event_done(int thread_id, uint64_t start_ns, uint64_t value);
 
 #ifdef HAVE_ALARM
 static void sigalrm_thread_init_timeout_handler(int sig)
@@ -186,16 +255,81 @@ static void sigalrm_thread_init_timeout_handler(int sig)
 
 void sb_report_intermediate(sb_stat_t *stat)
 {
+  char pcts[SB_LATENCY_PCTS_STR_SIZE];
+
   log_timestamp(LOG_NOTICE, stat->time_total,
-                "thds: %" PRIu32 " eps: %4.2f lat (ms,%u%%): %4.2f",
+                "thds: %" PRIu32 " eps: %4.2f lat %s",
                 stat->threads_running,
                 stat->events / stat->time_interval,
-                sb_globals.percentile,
-                SEC2MS(stat->latency_pct));
+                sb_latency_pcts_str(stat->latency_pcts, 2, pcts,
+                                    sizeof(pcts)));
   if (sb_globals.tx_rate > 0)
     log_timestamp(LOG_NOTICE, stat->time_total,
-                  "queue length: %" PRIu64 " concurrency: %" PRIu64,
-                  stat->queue_length, stat->concurrency);
+                  "queue length: %" PRIu64 " concurrency: %" PRIu64
+                  " lag (ms): %4.2f resp %s",
+                  stat->queue_length, stat->concurrency,
+                  SEC2MS(stat->scheduler_lag),
+                  sb_latency_pcts_str(stat->response_pcts, 2, pcts,
+                                      sizeof(pcts)));
+}
+
+
+char *sb_latency_pcts_str(const double *values, int digits, char *buf,
+                          size_t size)
+{
+  size_t       len;
+  unsigned int i;
+
+  /* Keep the legacy format when percentile calculations are disabled */
+  if (sb_globals.n_percentiles == 0)
+  {
+    snprintf(buf, size, "(ms,0%%): %4.*f", digits, 0.0);
+    return buf;
+  }
+
+  len = snprintf(buf, size, "(ms,");
+
+  for (i = 0; i < sb_globals.n_percentiles && len < size; i++)
+  {
+    const double pct = sb_globals.percentiles[i];
+
+    if (pct == 100)
+      len += snprintf(buf + len, size - len, "%smax", i ? "/" : "");
+    else
+      len += snprintf(buf + len, size - len, "%s%g%%", i ? "/" : "", pct);
+  }
+
+  if (len < size)
+    len += snprintf(buf + len, size - len, "):");
+
+  for (i = 0; i < sb_globals.n_percentiles && len < size; i++)
+    len += snprintf(buf + len, size - len, "%s%4.*f", i ? "/" : " ", digits,
+                    SEC2MS(values[i]));
+
+  return buf;
+}
+
+
+void sb_print_latency_pcts(const double *values, int width)
+{
+  char label[32];
+
+  if (sb_globals.n_percentiles == 0)
+  {
+    log_text(LOG_NOTICE, "         percentile stats:               disabled");
+    return;
+  }
+
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+  {
+    /* Name the 100th percentile "max", as in intermediate reports */
+    if (sb_globals.percentiles[i] == 100)
+      snprintf(label, sizeof(label), "max percentile:");
+    else
+      snprintf(label, sizeof(label), "%gth percentile:",
+               sb_globals.percentiles[i]);
+    log_text(LOG_NOTICE, "%25s %*.2f", label, width, SEC2MS(values[i]));
+  }
 }
 
 
@@ -219,34 +353,167 @@ static void report_get_common_stat(sb_stat_t *stat, sb_counters_t cnt)
 }
 
 
+/*
+  Convert latency percentiles calculated from the latency histogram from
+  milliseconds to seconds.
+*/
+
+static void report_convert_pcts(sb_stat_t *stat)
+{
+  for (unsigned int i = 0; i < sb_globals.n_percentiles; i++)
+  {
+    stat->latency_pcts[i] = MS2SEC(stat->latency_pcts[i]);
+    stat->response_pcts[i] = MS2SEC(stat->response_pcts[i]);
+  }
+
+  stat->latency_pct = stat->latency_pcts[0];
+}
+
+
+/*
+  Estimate the event backlog and scheduler lag, i.e. how far behind the oldest
+  overdue event is, from the current state of event schedules.
+*/
+
+void sb_schedule_get_stat(sb_stat_t *stat)
+{
+  const uint64_t now_ns = sb_timer_value(&sb_exec_timer);
+  uint64_t       max_lag_ns = 0;
+  double         backlog = 0;
+
+  for (unsigned int i = 0; i < sb_globals.threads; i++)
+  {
+    const uint64_t next_ns = ck_pr_load_64(&schedules[i].next_ns);
+
+    stat->concurrency += ck_pr_load_int(&schedules[i].busy);
+
+    /* Skip schedules that have not been started yet */
+    if (next_ns == 0 || next_ns >= now_ns)
+      continue;
+
+    /* Expected number of overdue events in this schedule */
+    backlog += 1 + (now_ns - next_ns) / schedule_lambda;
+
+    max_lag_ns = SB_MAX(max_lag_ns, now_ns - next_ns);
+  }
+
+  stat->queue_length = backlog;
+  stat->scheduler_lag = NS2SEC(max_lag_ns);
+}
+
+
+/*
+  Append space-separated names or values of latency percentiles to a buffer for
+  compact intermediate reports
+*/
+
+static size_t compact_pcts(char *buf, size_t size, size_t len,
+                           const char *prefix, const double *values)
+{
+  for (unsigned int i = 0; i < sb_globals.n_percentiles && len < size; i++)
+  {
+    const double pct = sb_globals.percentiles[i];
+
+    if (values != NULL)
+      len += snprintf(buf + len, size - len, " %.3f", SEC2MS(values[i]));
+    else if (pct == 100)
+      len += snprintf(buf + len, size - len, " %smax", prefix);
+    else
+      len += snprintf(buf + len, size - len, " %s%g", prefix, pct);
+  }
+
+  return len;
+}
+
+
+/*
+  Compact intermediate reports handler (--report-compact). Prints a single
+  header line followed by one line of space-separated values per report, which
+  keeps the output small with short report intervals. Rates are per second,
+  latencies are in milliseconds.
+*/
+
+static void report_compact(sb_stat_t *stat)
+{
+  static bool header_printed;
+  char        buf[1024];
+  size_t      len;
+
+  const double seconds = stat->time_interval;
+
+  if (!header_printed)
+  {
+    len = snprintf(buf, sizeof(buf), "time thds eps qps err/s reconn/s");
+    len = compact_pcts(buf, sizeof(buf), len, "lat", NULL);
+
+    if (sb_globals.tx_rate > 0 && len < sizeof(buf))
+    {
+      len += snprintf(buf + len, sizeof(buf) - len, " queue conc lag");
+      compact_pcts(buf, sizeof(buf), len, "resp", NULL);
+    }
+
+    log_text(LOG_NOTICE, "%s", buf);
+    header_printed = true;
+  }
+
+  len = snprintf(buf, sizeof(buf), "%.*f %" PRIu32 " %.2f %.2f %.2f %.2f",
+                 (int) sb_globals.report_digits, stat->time_total,
+                 stat->threads_running,
+                 stat->events / seconds,
+                 (stat->reads + stat->writes + stat->other) / seconds,
+                 stat->errors / seconds,
+                 stat->reconnects / seconds);
+  len = compact_pcts(buf, sizeof(buf), len, NULL, stat->latency_pcts);
+
+  if (sb_globals.tx_rate > 0 && len < sizeof(buf))
+  {
+    len += snprintf(buf + len, sizeof(buf) - len,
+                    " %" PRIu64 " %" PRIu64 " %.3f",
+                    stat->queue_length, stat->concurrency,
+                    SEC2MS(stat->scheduler_lag));
+    compact_pcts(buf, sizeof(buf), len, NULL, stat->response_pcts);
+  }
+
+  log_text(LOG_NOTICE, "%s", buf);
+}
+
+
 static void report_intermediate(void)
 {
   sb_stat_t stat;
   sb_counters_t cnt;
 
   /*
-    sb_globals.report_interval may be set to 0 by the master thread to
+    sb_globals.report_interval_ns may be set to 0 by the master thread to
     silence intermediate reports at the end of the test
   */
-  if (ck_pr_load_uint(&sb_globals.report_interval) == 0)
+  if (ck_pr_load_64(&sb_globals.report_interval_ns) == 0)
     return;
 
   sb_counters_agg_intermediate(cnt);
   report_get_common_stat(&stat, cnt);
 
-  stat.latency_pct =
-    MS2SEC(sb_histogram_get_pct_intermediate(&sb_latency_histogram,
-                                             sb_globals.percentile));
+  sb_histogram_get_pcts_intermediate(&sb_latency_histogram,
+                                     sb_globals.percentiles,
+                                     sb_globals.n_percentiles,
+                                     stat.latency_pcts);
+
+  if (sb_globals.tx_rate > 0)
+    sb_histogram_get_pcts_intermediate(&sb_response_histogram,
+                                       sb_globals.percentiles,
+                                       sb_globals.n_percentiles,
+                                       stat.response_pcts);
+
+  report_convert_pcts(&stat);
 
   stat.time_interval = NS2SEC(sb_timer_current(&sb_intermediate_timer));
 
   if (sb_globals.tx_rate > 0)
-  {
-    stat.queue_length = ck_ring_size(&queue_ring);
-    stat.concurrency = ck_pr_load_int(&sb_globals.concurrency);
-  }
+    sb_schedule_get_stat(&stat);
 
-  if (current_test && current_test->ops.report_intermediate)
+  if (sb_globals.report_compact)
+    report_compact(&stat);
+  else if (current_test && current_test->ops.report_intermediate)
     current_test->ops.report_intermediate(&stat);
   else
     sb_report_intermediate(&stat);
@@ -306,16 +573,24 @@ void sb_report_cumulative(sb_stat_t *stat)
   log_text(LOG_NOTICE, "         max: %39.2f",
            SEC2MS(stat->latency_max));
 
-  if (sb_globals.percentile > 0)
-    log_text(LOG_NOTICE, "        %3dth percentile: %27.2f",
-             sb_globals.percentile, SEC2MS(stat->latency_pct));
-  else
-    log_text(LOG_NOTICE, "         percentile stats:               disabled");
+  sb_print_latency_pcts(stat->latency_pcts, 27);
 
   log_text(LOG_NOTICE, "         sum: %39.2f",
            SEC2MS(stat->latency_sum));
   log_text(LOG_NOTICE, "");
 
+  if (sb_globals.tx_rate > 0)
+  {
+    /*
+      Latency above is the event execution time. Response time also includes
+      time spent in the event queue, measured from the intended event start
+      time, so it is not affected by coordinated omission.
+    */
+    log_text(LOG_NOTICE, "Response time (ms):");
+    sb_print_latency_pcts(stat->response_pcts, 27);
+    log_text(LOG_NOTICE, "");
+  }
+
   /* Aggregate temporary timers copy */
   sb_timer_t t;
   sb_timer_init(&t);
@@ -378,9 +653,18 @@ static void checkpoint(sb_stat_t *stat)
 
   stat->time_interval = NS2SEC(sb_timer_current(&sb_checkpoint_timer));
 
-  stat->latency_pct =
-    MS2SEC(sb_histogram_get_pct_checkpoint(&sb_latency_histogram,
-                                           sb_globals.percentile));
+  sb_histogram_get_pcts_checkpoint(&sb_latency_histogram,
+                                   sb_globals.percentiles,
+                                   sb_globals.n_percentiles,
+                                   stat->latency_pcts);
+
+  if (sb_globals.tx_rate > 0)
+    sb_histogram_get_pcts_checkpoint(&sb_response_histogram,
+                                     sb_globals.percentiles,
+                                     sb_globals.n_percentiles,
+                                     stat->response_pcts);
+
+  report_convert_pcts(stat);
 
   /* Atomically reset each timer after copying it into its timers_copy slot */
   for (size_t i = 0; i < sb_globals.threads; i++)
@@ -393,6 +677,9 @@ static void report_cumulative(void)
   sb_stat_t  stat;
   sb_timer_t t;
 
+  /* Histograms are reset by checkpoint(), save them for --save-results */
+  sb_results_snapshot();
+
   checkpoint(&stat);
 
   sb_timer_init(&t);
@@ -407,6 +694,11 @@ static void report_cumulative(void)
   stat.latency_avg = NS2SEC(sb_timer_avg(&t));
   stat.latency_sum = NS2SEC(sb_timer_sum(&t));
 
+  sb_dist_agent_done(&stat);
+
+  if (sb_results_save(&stat))
+    sb_globals.error = 1;
+
   if (current_test && current_test->ops.report_cumulative)
     current_test->ops.report_cumulative(&stat);
   else
@@ -449,6 +741,10 @@ static int register_tests(void)
     + register_test_mutex(&tests)
     + db_register()
     + sb_rand_register()
+    + sb_trace_register()
+    + sb_metrics_register()
+    + sb_dist_register()
+    + sb_results_register()
     ;
 }
 
@@ -482,6 +778,14 @@ void print_help(void)
 
   log_print_help();
 
+  sb_trace_print_help();
+
+  sb_metrics_print_help();
+
+  sb_dist_print_help();
+
+  sb_results_print_help();
+
   db_print_help();
 
   printf("Compiled-in tests:\n");
@@ -563,6 +867,10 @@ static int parse_general_arguments(int argc, char *argv[])
         continue;
       }
 
+      /* The 'merge-results' command takes a list of file names */
+      if (!strcmp(testname, "merge-results"))
+        continue;
+
       if (cmdname == NULL)
       {
         cmdname = argv[i];
@@ -619,6 +927,9 @@ void print_run_mode(sb_test_t *test)
   log_text(LOG_NOTICE, "Running the test with following options:");
   log_text(LOG_NOTICE, "Number of threads: %d", sb_globals.threads);
 
+  if (sb_globals.clients > 0)
+    log_text(LOG_NOTICE, "Number of clients: %u", sb_globals.clients);
+
   if (sb_globals.warmup_time > 0)
     log_text(LOG_NOTICE, "Warmup time: %ds", sb_globals.warmup_time);
 
@@ -628,10 +939,10 @@ void print_run_mode(sb_test_t *test)
             "Target transaction rate: %d/sec", sb_globals.tx_rate);
   }
 
-  if (sb_globals.report_interval)
+  if (sb_globals.report_interval_ns)
   {
-    log_text(LOG_NOTICE, "Report intermediate results every %d second(s)",
-             sb_globals.report_interval);
+    log_text(LOG_NOTICE, "Report intermediate results every %g second(s)",
+             NS2SEC(sb_globals.report_interval_ns));
   }
 
   if (sb_globals.n_checkpoints > 0)
@@ -685,10 +996,264 @@ void print_run_mode(sb_test_t *test)
     test->ops.print_mode();
 }
 
-bool sb_more_events(int thread_id)
+/* Generate exponentially distributed number with a given Lambda */
+
+static inline double sb_rand_exp(double lambda)
+{
+  return -lambda * log(1 - sb_rand_uniform_double());
+}
+
+
+/* Precompute the next batch of intended event start times for a schedule */
+
+static void schedule_refill(sb_schedule_t *s)
+{
+  /* The first batch starts from 0, i.e. the start of sb_exec_timer */
+  double t = s->times[SCHEDULE_BATCH - 1];
+
+  for (unsigned int i = 0; i < SCHEDULE_BATCH; i++)
+  {
+    t += sb_rand_exp(schedule_lambda);
+    s->times[i] = t;
+  }
+
+  s->pos = 0;
+}
+
+
+/*
+  Take the next event from a schedule, unless its intended start time is later
+  than limit_ns. When 'wait' is false, give up if the schedule is locked by
+  another thread. Returns the intended event start time, or UINT64_MAX if no
+  event was taken.
+*/
+
+static uint64_t schedule_take(sb_schedule_t *s, uint64_t limit_ns, bool wait)
+{
+  uint64_t start_ns;
+
+  /* Avoid locking schedules that have no overdue events */
+  const uint64_t next_ns = ck_pr_load_64(&s->next_ns);
+  if (next_ns > limit_ns)
+    return UINT64_MAX;
+
+  if (wait)
+    ck_spinlock_lock(&s->lock);
+  else if (!ck_spinlock_trylock(&s->lock))
+    return UINT64_MAX;
+
+  /* Schedules are started lazily by the first thread accessing them */
+  if (s->pos == SCHEDULE_BATCH)
+    schedule_refill(s);
+
+  start_ns = s->times[s->pos];
+
+  if (start_ns > limit_ns)
+    start_ns = UINT64_MAX;
+  else if (++s->pos == SCHEDULE_BATCH)
+    schedule_refill(s);
+
+  ck_pr_store_64(&s->next_ns, s->times[s->pos]);
+
+  ck_spinlock_unlock(&s->lock);
+
+  return start_ns;
+}
+
+
+/*
+  Take an overdue event from the schedule of another thread that is busy
+  executing an event. Overdue events of idle threads are left to their owners.
+  Returns the intended event start time, or UINT64_MAX if no event was taken.
+  The earliest start time of an event that other threads may need help with is
+  stored in *next_ns.
+*/
+
+static uint64_t schedule_steal(int thread_id, uint64_t now_ns,
+                               uint64_t *next_ns)
+{
+  const unsigned int nthreads = sb_globals.threads;
+
+  *next_ns = UINT64_MAX;
+
+  for (unsigned int i = 1; i < nthreads; i++)
+  {
+    sb_schedule_t * const s = &schedules[(thread_id + i) % nthreads];
+    const uint64_t        ns = ck_pr_load_64(&s->next_ns);
+
+    /* Skip schedules that have not been started yet */
+    if (ns == 0)
+      continue;
+
+    if (ns <= now_ns)
+    {
+      if (!ck_pr_load_int(&s->busy))
+        continue;
+
+      const uint64_t start_ns = schedule_take(s, now_ns, false);
+
+      if (start_ns != UINT64_MAX)
+        return start_ns;
+    }
+
+    *next_ns = SB_MIN(*next_ns, ns);
+  }
+
+  return UINT64_MAX;
+}
+
+
+/*
+  Wait on schedule_cond until a given time or until signaled, and take the
+  watcher role if it is free. Returns whether the thread is the watcher.
+*/
+
+static bool schedule_wait(int thread_id, bool watcher, uint64_t now_ns,
+                          uint64_t wake_ns)
+{
+  struct timespec ts;
+  uint64_t        ns;
+
+  pthread_mutex_lock(&schedule_mutex);
+
+  /* Take the free watcher role without waiting to scan other schedules first */
+  if (!watcher && schedule_watcher < 0)
+  {
+    schedule_watcher = thread_id;
+    pthread_mutex_unlock(&schedule_mutex);
+    return true;
+  }
+
+  /* pthread_cond_timedwait() takes an absolute time of the realtime clock */
+#ifdef HAVE_CLOCK_GETTIME
+  clock_gettime(CLOCK_REALTIME, &ts);
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  ts.tv_sec = tv.tv_sec;
+  ts.tv_nsec = tv.tv_usec * 1000;
+#endif
+
+  ns = ts.tv_nsec + (wake_ns - now_ns);
+  ts.tv_sec += ns / NS_PER_SEC;
+  ts.tv_nsec = ns % NS_PER_SEC;
+
+  pthread_cond_timedwait(&schedule_cond, &schedule_mutex, &ts);
+
+  if (!watcher && schedule_watcher < 0)
+  {
+    schedule_watcher = thread_id;
+    watcher = true;
+  }
+
+  pthread_mutex_unlock(&schedule_mutex);
+
+  return watcher;
+}
+
+
+/* Give up the watcher role and wake up an idle thread to take it over */
+
+static void schedule_release_watcher(void)
 {
-  (void) thread_id; /* unused */
+  pthread_mutex_lock(&schedule_mutex);
+  schedule_watcher = -1;
+  pthread_cond_signal(&schedule_cond);
+  pthread_mutex_unlock(&schedule_mutex);
+}
+
+
+/*
+  Get the intended start time for the next event to be executed by a given
+  thread and wait until that time. Returns UINT64_MAX if the thread must stop
+  executing events.
+
+  Idle threads sleep until their next events are almost due, and then spin to
+  start them accurately. A thread that has just finished an event also takes
+  overdue events from schedules of busy threads, as they would be executed by
+  any idle thread with a single shared event queue. Between those points only
+  the watcher thread looks at other schedules. It sleeps until the earliest
+  event of any schedule is due, so no thread polls while nothing is due.
+*/
+
+static uint64_t schedule_next_event(int thread_id)
+{
+  sb_schedule_t * const own = &schedules[thread_id];
+  bool                  watcher = false;
+  bool                  first = true;
+  uint64_t              now_ns;
+  uint64_t              start_ns;
+  uint64_t              next_ns;
+  uint64_t              other_ns;
+  uint64_t              wake_ns;
+
+  for (;;)
+  {
+    now_ns = sb_timer_value(&sb_exec_timer);
+
+    if ((start_ns = schedule_take(own, now_ns, true)) != UINT64_MAX)
+      break;
+
+    other_ns = UINT64_MAX;
+
+    if ((first || watcher) &&
+        (start_ns = schedule_steal(thread_id, now_ns, &other_ns)) !=
+        UINT64_MAX)
+      break;
+
+    first = false;
+
+    if (sb_globals.error)
+      break;
+
+    next_ns = ck_pr_load_64(&own->next_ns);
+
+    if (sb_globals.max_time_ns > 0 &&
+        SB_UNLIKELY(next_ns >= sb_globals.max_time_ns))
+    {
+      log_text(LOG_INFO, "Time limit exceeded, exiting...");
+      break;
+    }
+
+    /* Sleep until the event is almost due, then spin to start it accurately */
+    wake_ns = next_ns > now_ns + SCHEDULE_SPIN_NS ?
+      next_ns - SCHEDULE_SPIN_NS : now_ns;
+
+    if (watcher)
+      wake_ns = SB_MIN(wake_ns, other_ns);
+
+    if (wake_ns <= now_ns)
+    {
+      ck_pr_stall();
+      continue;
+    }
+
+    watcher = schedule_wait(thread_id, watcher, now_ns,
+                            SB_MIN(wake_ns, now_ns + SCHEDULE_MAX_SLEEP_NS));
+  }
+
+  if (watcher)
+    schedule_release_watcher();
+
+  if (start_ns == UINT64_MAX)
+    return UINT64_MAX;
+
+  if ((now_ns - start_ns) / schedule_lambda * sb_globals.threads >
+      MAX_QUEUE_LEN)
+  {
+    log_text(LOG_FATAL,
+             "The event queue is full. This means the worker threads are "
+             "unable to keep up with the specified event generation rate");
+    sb_globals.error = 1;
+    return UINT64_MAX;
+  }
+
+  return start_ns;
+}
+
 
+bool sb_more_events(int thread_id)
+{
   if (sb_globals.error)
     return false;
 
@@ -709,35 +1274,20 @@ bool sb_more_events(int thread_id)
     return false;
   }
 
-  /* If we are in tx_rate mode, we take events from queue */
+  /* If we are in tx_rate mode, we take events from the event schedules */
   if (sb_globals.tx_rate > 0)
   {
-    void *ptr = NULL;
-
-    while (!ck_ring_dequeue_spmc(&queue_ring, queue_ring_buffer, &ptr) &&
-           !sb_globals.error)
-    {
-      pthread_mutex_lock(&queue_mutex);
-      pthread_cond_wait(&queue_cond, &queue_mutex);
-      pthread_mutex_unlock(&queue_mutex);
+    const uint64_t start_ns = schedule_next_event(thread_id);
 
-      /* Re-check for global error and time limit after waiting */
+    if (start_ns == UINT64_MAX)
+      return false;
 
-      if (sb_globals.error)
-        return false;
+    ck_pr_store_int(&schedules[thread_id].busy, 1);
 
-      if (sb_globals.max_time_ns > 0 &&
-          SB_UNLIKELY(sb_timer_value(&sb_exec_timer) >= sb_globals.max_time_ns))
-      {
-        log_text(LOG_INFO, "Time limit exceeded, exiting...");
-        return false;
-      }
-    }
+    /* Account the delay since the intended event start time */
+    const uint64_t now_ns = sb_timer_value(&sb_exec_timer);
 
-    ck_pr_inc_int(&sb_globals.concurrency);
-
-    timers[thread_id].queue_time = sb_timer_value(&sb_exec_timer) -
-      ((uint64_t *) ptr)[0];
+    timers[thread_id].queue_time = now_ns > start_ns ? now_ns - start_ns : 0;
   }
 
   return true;
@@ -757,15 +1307,59 @@ void sb_event_stop(int thread_id)
 
   value = sb_timer_stop(timer);
 
-  if (sb_globals.percentile > 0)
-    sb_histogram_update(&sb_latency_histogram, NS2MS(value));
+  if (sb_globals.tx_rate > 0 && sb_globals.n_percentiles > 0)
+    sb_histogram_update_units(&sb_response_histogram, thread_id,
+                              timer->queue_time + value);
 
-  sb_counter_inc(thread_id, SB_CNT_EVENT);
+  event_done(thread_id,
+             TIMESPEC_DIFF(timer->time_start, sb_exec_timer.time_start),
+             (uint64_t) value);
 
   if (sb_globals.tx_rate > 0)
-  {
-    ck_pr_dec_int(&sb_globals.concurrency);
-  }
+    ck_pr_store_int(&schedules[thread_id].busy, 0);
+}
+
+
+/*
+  Start an event of a client coroutine in the --clients mode. Events of
+  multiple clients of a worker thread overlap, so the start time is kept by the
+  caller rather than in the thread timer.
+*/
+
+uint64_t sb_client_event_start(void)
+{
+  return sb_timer_value(&sb_exec_timer);
+}
+
+
+/* Finish an event of a client coroutine started at a given time */
+
+void sb_client_event_stop(int thread_id, uint64_t start_ns)
+{
+  const uint64_t value = sb_timer_value(&sb_exec_timer) - start_ns;
+
+  sb_timer_add(&timers[thread_id], value);
+
+  event_done(thread_id, start_ns, value);
+}
+
+
+/*
+  Account a finished event which started at a given offset from the
+  benchmark start and took a given time
+*/
+
+static void event_done(int thread_id, uint64_t start_ns, uint64_t value)
+{
+  /* The latency histogram resolution is 1 ns, so feed raw timer values */
+  if (sb_globals.n_percentiles > 0)
+    sb_histogram_update_units(&sb_latency_histogram, thread_id, value);
+
+  sb_counter_inc(thread_id, SB_CNT_EVENT);
+
+  if (SB_UNLIKELY(sb_trace_enabled) &&
+      (unsigned int) thread_id < sb_globals.threads)
+    sb_trace_event(thread_id, start_ns, value, tls_event_type);
 }
 
 
@@ -783,6 +1377,8 @@ static int thread_run(sb_test_t *test, int thread_id)
     if (event.type == SB_REQ_TYPE_NULL)
       break;
 
+    tls_event_type = event.type;
+
     sb_event_start(thread_id);
 
     rc = test->ops.execute_event(&event, thread_id);
@@ -847,86 +1443,6 @@ static void *worker_thread(void *arg)
   return NULL;
 }
 
-/* Generate exponentially distributed number with a given Lambda */
-
-static inline double sb_rand_exp(double lambda)
-{
-  return -lambda * log(1 - sb_rand_uniform_double());
-}
-
-static void *eventgen_thread_proc(void *arg)
-{
-  (void)arg; /* unused */
-
-  sb_tls_thread_id = SB_BACKGROUND_THREAD_ID;
-
-  /* Initialize thread-local RNG state */
-  sb_rand_thread_init();
-
-  ck_ring_init(&queue_ring, MAX_QUEUE_LEN);
-
-  if (pthread_mutex_init(&queue_mutex, NULL) ||
-      pthread_cond_init(&queue_cond, NULL))
-  {
-    sb_barrier_wait(&worker_barrier);
-    return NULL;
-  }
-
-  log_text(LOG_DEBUG, "Event generating thread started");
-
-  /* Wait for the worker threads to initialize */
-  if (sb_barrier_wait(&worker_barrier) < 0)
-    return NULL;
-
-  eventgen_thread_created = 1;
-
-  /*
-    Get exponentially distributed time intervals in nanoseconds with Lambda =
-    tx_rate. Alternatively, we can use Lambda = tx_rate / 1e9
-  */
-  const double lambda = 1e9 / sb_globals.tx_rate;
-
-  uint64_t curr_ns = sb_timer_value(&sb_exec_timer);
-  uint64_t intr_ns = sb_rand_exp(lambda);
-  uint64_t next_ns = curr_ns + intr_ns;
-
-  for (int i = 0; ; i = (i+1) % MAX_QUEUE_LEN)
-  {
-    curr_ns = sb_timer_value(&sb_exec_timer);
-    intr_ns = sb_rand_exp(lambda);
-    next_ns += intr_ns;
-
-    if (sb_globals.max_time_ns > 0 &&
-        SB_UNLIKELY(curr_ns >= sb_globals.max_time_ns))
-    {
-      /* Wake all waiting threads */
-      pthread_cond_broadcast(&queue_cond);
-      return NULL;
-    }
-
-    if (next_ns > curr_ns)
-      sb_nanosleep(next_ns - curr_ns);
-
-    /* Enqueue a new event */
-    queue_array[i] = sb_timer_value(&sb_exec_timer);
-    if (ck_ring_enqueue_spmc(&queue_ring, queue_ring_buffer,
-                             &queue_array[i]) == false)
-    {
-      sb_globals.error = 1;
-      log_text(LOG_FATAL,
-               "The event queue is full. This means the worker threads are "
-               "unable to keep up with the specified event generation rate");
-      pthread_cond_broadcast(&queue_cond);
-      return NULL;
-    }
-
-    /* Wake up one waiting thread, if there are any */
-    pthread_cond_signal(&queue_cond);
-  }
-
-  return NULL;
-}
-
 /* Intermediate reports thread */
 
 static void *report_thread_proc(void *arg)
@@ -935,7 +1451,7 @@ static void *report_thread_proc(void *arg)
   unsigned long long       prev_ns;
   unsigned long long       next_ns;
   unsigned long long       curr_ns;
-  const unsigned long long interval_ns = SEC2NS(sb_globals.report_interval);
+  const unsigned long long interval_ns = sb_globals.report_interval_ns;
 
   (void)arg; /* unused */
 
@@ -1040,6 +1556,10 @@ static int threads_started_callback(void *arg)
 
   sb_globals.threads_running = sb_globals.threads;
 
+  /* Wait for other agents in distributed mode */
+  if (sb_dist_agent_wait_start())
+    return 1;
+
   sb_timer_start(&sb_exec_timer);
   sb_timer_copy(&sb_intermediate_timer, &sb_exec_timer);
   sb_timer_copy(&sb_checkpoint_timer, &sb_exec_timer);
@@ -1059,7 +1579,6 @@ static int run_test(sb_test_t *test)
   int          err;
   pthread_t    report_thread;
   pthread_t    checkpoints_thread;
-  pthread_t    eventgen_thread;
   unsigned int barrier_threads;
   uint64_t     old_max_events = 0;
 
@@ -1084,8 +1603,7 @@ static int run_test(sb_test_t *test)
   sb_globals.threads_running = 0;
 
   /* Calculate the required number of threads for the worker start barrier */
-  barrier_threads = 1 /* main thread */ + sb_globals.threads +
-    (sb_globals.tx_rate > 0) /* event generation thread */;
+  barrier_threads = 1 /* main thread */ + sb_globals.threads;
 
   if (sb_barrier_init(&worker_barrier, barrier_threads,
                       threads_started_callback, NULL))
@@ -1096,7 +1614,7 @@ static int run_test(sb_test_t *test)
 
   /* Calculate the required number of threads for the report start barrier */
   barrier_threads = 1 /* main thread */ +
-    (sb_globals.report_interval > 0) /* intermediate reports thread */ +
+    (sb_globals.report_interval_ns > 0) /* intermediate reports thread */ +
     (sb_globals.n_checkpoints > 0) /* checkpoint reports thread */;
 
   if (sb_barrier_init(&report_barrier, barrier_threads, NULL, NULL))
@@ -1106,7 +1624,7 @@ static int run_test(sb_test_t *test)
   }
 
 
-  if (sb_globals.report_interval > 0)
+  if (sb_globals.report_interval_ns > 0)
   {
     /* Create a thread for intermediate statistic reports */
     if ((err = sb_thread_create(&report_thread, &sb_thread_attr,
@@ -1118,17 +1636,6 @@ static int run_test(sb_test_t *test)
     }
   }
 
-  if (sb_globals.tx_rate > 0)
-  {
-    if ((err = sb_thread_create(&eventgen_thread, &sb_thread_attr,
-                                &eventgen_thread_proc, NULL)) != 0)
-    {
-      log_errno(LOG_FATAL,
-                "sb_thread_create() for the reporting thread failed.");
-      return 1;
-    }
-  }
-
   if (sb_globals.n_checkpoints > 0)
   {
     /* Create a thread for checkpoint statistic reports */
@@ -1141,6 +1648,9 @@ static int run_test(sb_test_t *test)
     }
   }
 
+  if (sb_trace_init() || sb_metrics_init() || sb_dist_agent_init())
+    return 1;
+
   if ((err = sb_thread_create_workers(&worker_thread)))
     return err;
 
@@ -1189,6 +1699,7 @@ static int run_test(sb_test_t *test)
     /* Perform a checkpoint to reset previously collected stats */
     sb_stat_t stat;
     checkpoint(&stat);
+    sb_dist_agent_reset();
   }
 
   /* Signal the report threads to start reporting */
@@ -1198,15 +1709,22 @@ static int run_test(sb_test_t *test)
     return 1;
   }
 
+  if (sb_dist_agent_start())
+    return 1;
+
   if ((err = sb_thread_join_workers()))
     return err;
 
+  sb_trace_done();
+
+  sb_metrics_done();
+
   sb_timer_stop(&sb_exec_timer);
   sb_timer_stop(&sb_intermediate_timer);
   sb_timer_stop(&sb_checkpoint_timer);
 
   /* Silence periodic reports if they were on */
-  ck_pr_store_uint(&sb_globals.report_interval, 0);
+  ck_pr_store_64(&sb_globals.report_interval_ns, 0);
 
 #ifdef HAVE_ALARM
   alarm(0);
@@ -1224,17 +1742,6 @@ static int run_test(sb_test_t *test)
       log_errno(LOG_FATAL, "Terminating the reporting thread failed.");
   }
 
-  if (eventgen_thread_created)
-  {
-    /*
-      When a time limit is used, the event generation thread may terminate
-      itself.
-    */
-    if ((sb_thread_cancel(eventgen_thread) ||
-         sb_thread_join(eventgen_thread, NULL)) && sb_globals.max_time_ns == 0)
-      log_text(LOG_FATAL, "Terminating the event generator thread failed.");
-  }
-
   if (checkpoints_thread_created)
   {
     if (sb_thread_cancel(checkpoints_thread) ||
@@ -1383,7 +1890,45 @@ static int init(void)
 
   sb_globals.tx_rate = sb_get_value_int("rate");
 
-  sb_globals.report_interval = sb_get_value_int("report-interval");
+  const int clients = sb_get_value_int("clients");
+
+  if (clients < 0 || (clients > 0 && (unsigned) clients < sb_globals.threads))
+  {
+    log_text(LOG_FATAL, "Invalid value for --clients: %d. Must be 0 or at "
+             "least --threads", clients);
+    return 1;
+  }
+
+  if (clients > 0 && sb_globals.tx_rate > 0)
+  {
+    log_text(LOG_FATAL, "--rate is not supported with --clients");
+    return 1;
+  }
+
+  sb_globals.clients = (unsigned) clients;
+
+  const double report_interval = sb_get_value_double("report-interval");
+
+  if (report_interval != 0 && !(report_interval >= 0.001))
+  {
+    log_text(LOG_FATAL, "Invalid value for --report-interval: %g. "
+             "Must be 0 or at least 0.001", report_interval);
+    return 1;
+  }
+
+  /* Round the interval to milliseconds */
+  const uint64_t report_interval_ms = report_interval * MS_PER_SEC + 0.5;
+
+  sb_globals.report_interval_ns = MS2NS(report_interval_ms);
+
+  /* Print as many decimal digits in timestamps as the interval has */
+  sb_globals.report_digits = 0;
+  for (uint64_t unit = MS_PER_SEC;
+       report_interval_ms % unit != 0 && sb_globals.report_digits < 3;
+       unit /= 10)
+    sb_globals.report_digits++;
+
+  sb_globals.report_compact = sb_get_value_flag("report-compact");
 
   sb_globals.n_checkpoints = 0;
   checkpoints_list = sb_get_value_list("report-checkpoints");
@@ -1428,6 +1973,33 @@ static int init(void)
   for (unsigned i = 0; i < sb_globals.threads; i++)
     sb_timer_init(&timers[i]);
 
+  if (sb_globals.tx_rate > 0)
+  {
+    /* Initialize event schedules */
+    schedules = sb_alloc_per_thread_array(sizeof(sb_schedule_t));
+
+    if (schedules == NULL)
+    {
+      log_text(LOG_FATAL, "Memory allocation failure");
+      return 1;
+    }
+
+    for (unsigned i = 0; i <= sb_globals.threads; i++)
+    {
+      ck_spinlock_init(&schedules[i].lock);
+      schedules[i].pos = SCHEDULE_BATCH;
+    }
+
+    schedule_lambda = 1e9 * sb_globals.threads / sb_globals.tx_rate;
+
+    if (pthread_mutex_init(&schedule_mutex, NULL) ||
+        pthread_cond_init(&schedule_cond, NULL))
+    {
+      log_text(LOG_FATAL, "Failed to initialize the event scheduler");
+      return 1;
+    }
+  }
+
   /* LuaJIT commands */
   sb_globals.luajit_cmd = sb_get_value_string("luajit-cmd");
 
@@ -1480,6 +2052,28 @@ int main(int argc, char *argv[])
 
   print_header();
 
+  /* Built-in commands that do not require a test */
+  if (sb_globals.testname != NULL &&
+      !strcmp(sb_globals.testname, "trace-summary"))
+  {
+    rc = sb_trace_summary() ? EXIT_FAILURE : EXIT_SUCCESS;
+    goto end;
+  }
+
+  if (sb_globals.testname != NULL &&
+      !strcmp(sb_globals.testname, "coordinator"))
+  {
+    rc = sb_dist_coordinator() ? EXIT_FAILURE : EXIT_SUCCESS;
+    goto end;
+  }
+
+  if (sb_globals.testname != NULL &&
+      !strcmp(sb_globals.testname, "merge-results"))
+  {
+    rc = sb_results_merge_files() ? EXIT_FAILURE : EXIT_SUCCESS;
+    goto end;
+  }
+
   if (sb_globals.testname != NULL && strcmp(sb_globals.testname, "-"))
   {
     /* Is it a built-in test name? */
@@ -1601,6 +2195,13 @@ end:
   free(timers);
   free(timers_copy);
 
+  if (schedules != NULL)
+  {
+    pthread_cond_destroy(&schedule_cond);
+    pthread_mutex_destroy(&schedule_mutex);
+    free(schedules);
+  }
+
   free(sb_globals.argv);
 
   return rc;
@@ -51,6 +51,9 @@
 /* Maximum number of elements in --report-checkpoints list */
 #define MAX_CHECKPOINTS 256
 
+/* Maximum number of elements in --percentile list */
+#define MAX_PERCENTILES 16
+
 /* Request types definition */
 
 typedef enum
@@ -91,7 +94,15 @@ typedef struct {
   double   time_interval;       /* Time elapsed since the last report */
   double   time_total;          /* Time elapsed since the benchmark start */
 
-  double   latency_pct;         /* Latency percentile */
+  double   latency_pct;         /* Latency percentile (the lowest one
+                                   specified with --percentile) */
+  /* Latency values for all percentiles in sb_globals.percentiles */
+  double   latency_pcts[MAX_PERCENTILES];
+  /*
+    Response time values, i.e. time from the intended event start to its
+    completion, for all percentiles in sb_globals.percentiles (tx_rate-only)
+  */
+  double   response_pcts[MAX_PERCENTILES];
 
   double   latency_min;         /* Minimum latency (cumulative reports only) */
   double   latency_max;         /* Maximum latency (cumulative reports only) */
@@ -110,6 +121,8 @@ typedef struct {
 
   uint64_t queue_length;        /* Event queue length (tx_rate-only) */
   uint64_t concurrency;         /* Number of in-flight events (tx_rate-only) */
+  double   scheduler_lag;       /* Delay of the oldest overdue event
+                                   (tx_rate-only) */
 } sb_stat_t;
 
 /* Commands */
@@ -190,8 +203,14 @@ typedef struct
   const char      *cmdname;     /* command passed from command line */
   unsigned int    threads CK_CC_CACHELINE;  /* number of threads to use */
   unsigned int    threads_running;  /* number of threads currently active */
-  unsigned int    report_interval;  /* intermediate reports interval */
-  unsigned int    percentile;   /* percentile rank for latency stats */
+  unsigned int    clients;      /* number of Lua client coroutines, or 0 */
+  uint64_t        report_interval_ns; /* intermediate reports interval */
+  /* number of decimal digits in intermediate report timestamps */
+  unsigned int    report_digits;
+  unsigned char   report_compact; /* compact intermediate reports */
+  /* percentile ranks for latency stats, sorted in ascending order */
+  double          percentiles[MAX_PERCENTILES];
+  unsigned int    n_percentiles; /* number of percentile ranks */
   unsigned int    histogram;    /* show histogram in latency stats */
   /* array of report checkpoints */
   unsigned int    checkpoints[MAX_CHECKPOINTS];
@@ -200,8 +219,6 @@ typedef struct
   unsigned int    timeout;      /* forced shutdown timeout */
   unsigned char   validate;     /* validation flag */
   unsigned char   verbosity CK_CC_CACHELINE;    /* log verbosity */
-  int             concurrency CK_CC_CACHELINE;  /* number of concurrent requests
-                                                when tx-rate is used */
   int             force_shutdown CK_CC_CACHELINE; /* whether we must force test
                                                   shutdown */
   int             forced_shutdown_in_progress;
@@ -226,6 +243,8 @@ bool sb_more_events(int thread_id);
 sb_event_t sb_next_event(sb_test_t *test, int thread_id);
 void sb_event_start(int thread_id);
 void sb_event_stop(int thread_id);
+uint64_t sb_client_event_start(void);
+void sb_client_event_stop(int thread_id, uint64_t start_ns);
 
 /* Print a description of available command line options for the current test */
 void sb_print_test_options(void);
@@ -236,6 +255,30 @@ void sb_report_intermediate(sb_stat_t *stat);
 /* Default cumulative reports handler */
 void sb_report_cumulative(sb_stat_t *stat);
 
+/*
+  Fill event queue length, concurrency and scheduler lag in a given stat
+  structure (tx_rate mode only)
+*/
+void sb_schedule_get_stat(sb_stat_t *stat);
+
+/* Buffer size sufficient to hold any sb_latency_pcts_str() result */
+#define SB_LATENCY_PCTS_STR_SIZE (MAX_PERCENTILES * 32)
+
+/*
+  Format latency values for all percentiles in sb_globals.percentiles (e.g.
+  stat->latency_pcts) for intermediate reports, e.g. "(ms,95%): 1.23" or
+  "(ms,50%/99%/max): 0.50/1.23/4.56" using a given number of digits after the
+  decimal point for values. Returns buf.
+*/
+char *sb_latency_pcts_str(const double *values, int digits, char *buf,
+                          size_t size);
+
+/*
+  Print latency values for all percentiles in sb_globals.percentiles for
+  cumulative reports, one per line, using a given field width for values.
+*/
+void sb_print_latency_pcts(const double *values, int width);
+
 /*
   Allocate an array of objects of the specified size for all threads, both
   worker and background ones.
@@ -39,12 +39,24 @@
 #ifdef HAVE_ERRNO_H
 # include <errno.h>
 #endif
+#ifdef HAVE_LIMITS_H
+# include <limits.h>
+#endif
 #ifdef HAVE_LIBAIO
 # include <libaio.h>
 #endif
+#ifdef HAVE_IO_URING
+# include <sys/syscall.h>
+# include <sys/uio.h>
+# include <linux/io_uring.h>
+#endif
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_SYS_RESOURCE_H
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
 
 #include "sysbench.h"
 #include "crc32.h"
@@ -86,6 +98,7 @@ typedef enum
 {
   FILE_IO_MODE_SYNC,
   FILE_IO_MODE_ASYNC,
+  FILE_IO_MODE_URING,
   FILE_IO_MODE_MMAP
 } file_io_mode_t;
 
@@ -95,31 +108,130 @@ typedef enum {
   SB_FILE_FLAG_DIRECTIO = 4
 } file_flags_t;
 
+/* Maximum number of block sizes in --file-block-size */
+#define FILE_MAX_BLOCK_SIZES 16
+
+/* Maximum number of units in the bitmap of accessed units */
+#define FILE_MAX_UNITS (1ULL << 30)
+
+/* Per-block size latency histogram bounds in milliseconds */
+#define FILE_BLOCK_LAT_MIN 1e-3
+#define FILE_BLOCK_LAT_MAX 1e5
+
+/* Block size of the --file-block-size distribution */
+typedef struct
+{
+  long long      size;          /* Block size in bytes */
+  unsigned int   weight;        /* Relative weight */
+  double         cdf;           /* Cumulative probability */
+  sb_histogram_t latency;       /* Request latency histogram, ms */
+  /* Counter totals as of the last cumulative report */
+  uint64_t       cumul_ops;
+  uint64_t       cumul_bytes;
+  uint64_t       cumul_ns;
+} sb_file_block_t;
+
 #ifdef HAVE_LIBAIO
+/* Async I/O operation */
+typedef struct
+{
+  struct iocb     iocb; 
+  sb_file_op_t    type;
+  ssize_t         len;
+  unsigned int    block;        /* Block size index, see file_block_update() */
+  struct timespec start;        /* Submission time (mixed block sizes only) */
+} sb_aio_oper_t;
+
 /* Per-thread async I/O context */
 typedef struct
 {
   io_context_t    io_ctxt;      /* AIO context */
   unsigned int    nrequests;    /* Current number of queued I/O requests */
   struct io_event *events;      /* Array of events */
+  sb_aio_oper_t   *opers;       /* Preallocated operations */
+  sb_aio_oper_t   **free_opers; /* Stack of operations not in use */
+  unsigned int    nfree;        /* Number of operations not in use */
+  struct iocb     **pending;    /* Operations to submit with next io_submit() */
+  unsigned int    npending;     /* Number of operations to submit */
 } sb_aio_context_t;
 
-/* Async I/O operation */
+static sb_aio_context_t *aio_ctxts;
+#endif
+
+#ifdef HAVE_IO_URING
+/* io_uring request, passed as user data of its submission queue entry */
 typedef struct
 {
-  struct iocb   iocb; 
-  sb_file_op_t  type;
-  ssize_t       len;
-} sb_aio_oper_t;
+  sb_file_op_t    type;
+  ssize_t         len;
+  unsigned int    block;        /* Block size index, see file_block_update() */
+  struct timespec start;        /* Submission time (mixed block sizes only) */
+} sb_uring_req_t;
 
-static sb_aio_context_t *aio_ctxts;
+/* Per-thread io_uring context */
+typedef struct
+{
+  int                 fd;           /* io_uring file descriptor */
+  void                *sq_ring;     /* Submission queue ring mapping */
+  size_t              sq_ring_size;
+  unsigned int        *sq_tail;
+  unsigned int        *sq_flags;
+  unsigned int        sq_mask;
+  struct io_uring_sqe *sqes;        /* Submission queue entries mapping */
+  size_t              sqes_size;
+  void                *cq_ring;     /* Completion queue ring mapping */
+  size_t              cq_ring_size;
+  unsigned int        *cq_head;
+  unsigned int        *cq_tail;
+  unsigned int        cq_mask;
+  struct io_uring_cqe *cqes;
+  unsigned int        tail;         /* Submission queue tail to be published */
+  unsigned int        nqueued;      /* Number of queued, not submitted requests */
+  unsigned int        nrequests;    /* Current number of queued I/O requests */
+  sb_uring_req_t      *reqs;        /* Preallocated requests */
+  sb_uring_req_t      **free_reqs;  /* Stack of requests not in use */
+  unsigned int        nfree;        /* Number of requests not in use */
+} sb_uring_context_t;
+
+static sb_uring_context_t *uring_ctxts;
 #endif
 
+/*
+  Per-thread state. Request generators only modify the state of the calling
+  thread, so they do not need any locks, except for block ownership checks in
+  random --validate runs. Slots are aligned to cache lines to
+  avoid false sharing.
+*/
 typedef struct
 {
-  void           *buffer;
-  unsigned int    buffer_file_id;
-  long long       buffer_pos;
+  void              *buffer CK_CC_CACHELINE;
+  /* Block used by a random request, protected by the execution mutex */
+  unsigned int      buffer_file_id;
+  long long         buffer_pos;
+
+  /*
+    Sequential requests walk offsets in all files taken as a single contiguous
+    range, i.e. file_id * file_size + pos
+  */
+  unsigned long long seq_first;         /* First sequential offset */
+  unsigned long long seq_end;           /* End of sequential offsets */
+  unsigned long long seq_next;          /* Next sequential offset */
+  unsigned int      fsynced_file;       /* File to be fsynced (periodic) */
+  int               is_dirty;           /* Any writes after last fsync series? */
+  unsigned int      req_performed;      /* Number of requests done */
+  sb_file_request_t prev_req;           /* Previous request for validation */
+
+  /* Per-block size stats, only used with multiple block sizes */
+  unsigned int      block;              /* Block size index of last request */
+  uint64_t          block_ops[FILE_MAX_BLOCK_SIZES];
+  uint64_t          block_bytes[FILE_MAX_BLOCK_SIZES];
+  uint64_t          block_ns[FILE_MAX_BLOCK_SIZES];
+
+  /* Random access stats, only used with skewed random requests */
+  uint64_t          rnd_reqs;           /* Random reads and writes */
+  uint64_t          rnd_hot;            /* Requests to the hot set */
+  uint64_t          rnd_reaccess;       /* Requests to accessed units only */
+  uint64_t          rnd_units;          /* Units accessed since test start */
 } sb_per_thread_t;
 
 static sb_per_thread_t	*per_thread;
@@ -129,6 +241,9 @@ static unsigned int      num_files;
 static long long         total_size;
 static long long         file_size;
 static int               file_block_size;
+static sb_file_block_t   file_blocks[FILE_MAX_BLOCK_SIZES];
+static unsigned int      file_nblocks;
+static long long         file_block_align;
 static file_flags_t      file_extra_flags;
 static int               file_fsync_freq;
 static int               file_fsync_all;
@@ -137,18 +252,43 @@ static file_fsync_mode_t file_fsync_mode;
 static double            file_rw_ratio;
 static int               file_merged_requests;
 static long long         file_request_size;
+static int               file_merge_factor;
+static double            file_hot_fraction;
+static double            file_hot_probability;
+static long long         file_hot_size;
+/* Whether --rand-type is 'uniform' */
+static bool              file_rand_uniform;
+/* Whether random offsets use --rand-type or the hot set */
+static bool              file_rnd_skewed;
+
+/*
+  Bitmap of file units accessed by skewed random requests, including requests
+  made during warmup. A request is counted as a re-access if all of its units
+  have been accessed before. This is the hit ratio of a cache that can hold the
+  whole working set and is cold at the test start.
+*/
+static unsigned int       *file_units;
+static long long          file_unit_size;
+static unsigned long long file_nunits;
+
+/*
+  Random access stats totals as of the last cumulative report. The working set
+  is not reset by reports, as it is reported since the test start.
+*/
+static uint64_t          cumul_rnd_reqs;
+static uint64_t          cumul_rnd_hot;
+static uint64_t          cumul_rnd_reaccess;
 static file_io_mode_t    file_io_mode;
 #ifdef HAVE_LIBAIO
 static unsigned int      file_async_backlog;
+static unsigned int      file_async_batch;
+#endif
+#ifdef HAVE_IO_URING
+static unsigned int      file_uring_depth;
+static unsigned int      file_uring_batch;
+static int               file_uring_sqpoll;
+static int               file_uring_iopoll;
 #endif
-
-/* statistical and other "local" variables */
-static long long       position;      /* current position in file */
-static unsigned int    current_file;  /* current file */
-static unsigned int    fsynced_file;  /* file number to be fsynced (periodic) */
-
-static int is_dirty;               /* any writes after last fsync series ? */
-static unsigned int req_performed; /* number of requests done */
 
 static const double mebibyte = 1024 * 1024;
 static const double megabyte = 1000 * 1000;
@@ -165,28 +305,46 @@ static FILE_DESCRIPTOR *files;
 /* test mode type */
 static file_test_mode_t test_mode;
 
-/* Previous request needed for validation */
-static sb_file_request_t prev_req;
+#ifdef HAVE_SYS_RESOURCE_H
+/* Process CPU usage at the start of the current cumulative report interval */
+static struct rusage rusage_start;
+#endif
 
 static sb_arg_t fileio_args[] = {
   SB_OPT("file-num", "number of files to create", "128", INT),
-  SB_OPT("file-block-size", "block size to use in all IO operations", "16384",
-         INT),
+  SB_OPT("file-block-size", "block size to use in all IO operations, or a "
+         "list of size:weight pairs to pick a block size for each request "
+         "with a given probability, e.g. 4K:70,16K:20,128K:10", "16384", LIST),
+  SB_OPT("file-block-align", "alignment of random request offsets "
+         "(0 - align to the request block size)", "0", SIZE),
   SB_OPT("file-total-size", "total size of files to create", "2G", SIZE),
   SB_OPT("file-test-mode",
          "test mode {seqwr, seqrewr, seqrd, rndrd, rndwr, rndrw}", NULL,
          STRING),
-  SB_OPT("file-io-mode", "file operations mode {sync,async,mmap}", "sync",
-         STRING),
+  SB_OPT("file-io-mode", "file operations mode {sync,async,uring,mmap}",
+         "sync", STRING),
 #ifdef HAVE_LIBAIO
   SB_OPT("file-async-backlog",
          "number of asynchronous operatons to queue per thread", "128", INT),
+  SB_OPT("file-async-batch", "number of asynchronous operations to queue "
+         "before submitting them with a single io_submit() call", "1", INT),
+#endif
+#ifdef HAVE_IO_URING
+  SB_OPT("file-uring-depth",
+         "number of io_uring operations to queue per thread", "128", INT),
+  SB_OPT("file-uring-batch", "number of io_uring operations to queue before "
+         "submitting them with a single system call", "1", INT),
+  SB_OPT("file-uring-sqpoll", "submit io_uring operations from a kernel "
+         "polling thread rather than with system calls", "off", BOOL),
+  SB_OPT("file-uring-iopoll", "busy-poll for io_uring completions rather than "
+         "wait for interrupts, requires --file-extra-flags=direct", "off",
+         BOOL),
 #endif
   SB_OPT("file-extra-flags",
          "list of additional flags to use to open files {sync,dsync,direct}",
          "", LIST),
   SB_OPT("file-fsync-freq", "do fsync() after this number of requests "
-         "(0 - don't use fsync())", "100", INT),
+         "per thread (0 - don't use fsync())", "100", INT),
   SB_OPT("file-fsync-all", "do fsync() after each write operation", "off",
          BOOL),
   SB_OPT("file-fsync-end", "do fsync() at the end of test", "on", BOOL),
@@ -196,6 +354,11 @@ static sb_arg_t fileio_args[] = {
   SB_OPT("file-merged-requests", "merge at most this number of IO requests "
          "if possible (0 - don't merge)", "0", INT),
   SB_OPT("file-rw-ratio", "reads/writes ratio for combined test", "1.5", DOUBLE),
+  SB_OPT("file-hot-fraction", "fraction of the total file size at its start "
+         "that forms a hot set for random requests (0 - no hot set)", "0",
+         DOUBLE),
+  SB_OPT("file-hot-probability", "probability for a random request to access "
+         "the hot set", "0.9", DOUBLE),
 
   SB_OPT_END
 };
@@ -241,8 +404,9 @@ static sb_test_t fileio_test =
 static int create_files(void);
 static int remove_files(void);
 static int parse_arguments(void);
+static int file_units_init(void);
 static void init_vars(void);
-static sb_event_t file_get_seq_request(void);
+static sb_event_t file_get_seq_request(int thread_id);
 static sb_event_t file_get_rnd_request(int thread_id);
 static void check_seq_req(sb_file_request_t *, sb_file_request_t *);
 static const char *get_io_mode_str(file_io_mode_t mode);
@@ -255,12 +419,22 @@ static int file_do_fsync(unsigned int, int);
 static int file_fsync(unsigned int, int);
 static ssize_t file_pread(unsigned int, void *, ssize_t, long long, int);
 static ssize_t file_pwrite(unsigned int, void *, ssize_t, long long, int);
+static int file_wait_all(int);
 #ifdef HAVE_LIBAIO
 static int file_async_init(void);
 static int file_async_done(void);
 static int file_submit_or_wait(struct iocb *, sb_file_op_t, ssize_t, int);
+static int file_async_submit(int);
 static int file_wait(int, long);
 #endif
+#ifdef HAVE_IO_URING
+static int file_uring_init(void);
+static int file_uring_prepare(void);
+static int file_uring_done(void);
+static int file_uring_submit_or_wait(int, sb_file_op_t, unsigned int, ssize_t,
+                                     long long);
+static int file_uring_drain(int);
+#endif
 #ifdef HAVE_MMAP
 static int file_mmap_prepare(void);
 static int file_mmap_done(void);
@@ -297,6 +471,11 @@ int file_init(void)
     return 1;
 #endif
 
+#ifdef HAVE_IO_URING
+  if (file_uring_init())
+    return 1;
+#endif
+
   init_vars();
 
   return 0;
@@ -361,6 +540,15 @@ int file_prepare(void)
     return 1;
 #endif
 
+#ifdef HAVE_IO_URING
+  if (file_uring_prepare())
+    return 1;
+#endif
+
+#ifdef HAVE_SYS_RESOURCE_H
+  getrusage(RUSAGE_SELF, &rusage_start);
+#endif
+
   return 0; 
 }
 
@@ -377,6 +565,11 @@ int file_done(void)
     return 1;
 #endif
 
+#ifdef HAVE_IO_URING
+  if (file_uring_done())
+    return 1;
+#endif
+
 #ifdef HAVE_MMAP
   if (file_mmap_done())
     return 1;
@@ -389,6 +582,13 @@ int file_done(void)
   }
 
   free(per_thread);
+  free(file_units);
+
+  if (file_nblocks > 1)
+  {
+    for (i = 0; i < file_nblocks; i++)
+      sb_histogram_done(&file_blocks[i].latency);
+  }
 
   return 0;
 }
@@ -397,24 +597,79 @@ sb_event_t file_next_event(int thread_id)
 {
   if (test_mode == MODE_WRITE || test_mode == MODE_REWRITE ||
       test_mode == MODE_READ)
-    return file_get_seq_request();
+    return file_get_seq_request(thread_id);
   
   
   return file_get_rnd_request(thread_id);
 }
 
 
-/* Get sequential read or write request */
+/*
+  Generate a periodic fsync request if it is time to fsync file(s). Each thread
+  fsyncs all files after every --file-fsync-freq of its own requests, if there
+  were writes since the last fsync series. That keeps the ratio of fsyncs to
+  other requests the same as with a single thread.
+*/
+
+
+static bool file_get_fsync_request(int thread_id, sb_file_request_t *file_req)
+{
+  sb_per_thread_t * const pt = &per_thread[thread_id];
+
+  if (file_fsync_freq == 0 || !pt->is_dirty ||
+      pt->req_performed % file_fsync_freq != 0)
+    return false;
+
+  file_req->operation = FILE_OP_TYPE_FSYNC;
+  file_req->file_id = pt->fsynced_file;
+  file_req->pos = 0;
+  file_req->size = 0;
+  pt->fsynced_file++;
+  if (pt->fsynced_file == num_files)
+  {
+    pt->fsynced_file = 0;
+    pt->is_dirty = 0;
+  }
+
+  return true;
+}
+
+
+/* Pick a block size index for the next request from --file-block-size */
+
+static unsigned int file_rand_block(void)
+{
+  unsigned int i;
+  double       r;
+
+  if (file_nblocks == 1)
+    return 0;
+
+  r = sb_rand_uniform_double();
+  for (i = 0; i < file_nblocks - 1 && r >= file_blocks[i].cdf; i++)
+    ;
+
+  return i;
+}
+
+
+/*
+  Get sequential read or write request. Each thread walks its own contiguous
+  range of offsets, see init_vars(), so no synchronization is required.
+  Requests are truncated at file and partition ends.
+*/
 
 
-sb_event_t file_get_seq_request(void)
+sb_event_t file_get_seq_request(int thread_id)
 {
   sb_event_t           sb_req;
   sb_file_request_t    *file_req = &sb_req.u.file_request;
+  sb_per_thread_t      * const pt = &per_thread[thread_id];
+  unsigned long long   off;
+  unsigned int         block;
 
   sb_req.type = SB_REQ_TYPE_FILE;
-  SB_THREAD_MUTEX_LOCK();
-  
+
   /* assume function is called with correct mode always */
   if (test_mode == MODE_WRITE || test_mode == MODE_REWRITE)
     file_req->operation = FILE_OP_TYPE_WRITE;
@@ -422,58 +677,139 @@ sb_event_t file_get_seq_request(void)
     file_req->operation = FILE_OP_TYPE_READ;
 
   /* See whether it's time to fsync file(s) */
-  if (file_fsync_freq != 0 && file_req->operation == FILE_OP_TYPE_WRITE &&
-      is_dirty && req_performed % file_fsync_freq == 0)
-  {
-    file_req->operation = FILE_OP_TYPE_FSYNC;
-    file_req->file_id = fsynced_file;
-    file_req->pos = 0;
-    file_req->size = 0;
-    fsynced_file++;
-    if (fsynced_file == num_files)
-    {
-      fsynced_file = 0;
-      is_dirty = 0;
-    }
-
-    SB_THREAD_MUTEX_UNLOCK();
+  if (file_req->operation == FILE_OP_TYPE_WRITE &&
+      file_get_fsync_request(thread_id, file_req))
     return sb_req;
-  }
 
-  req_performed++;
+  pt->req_performed++;
 
   if (file_req->operation == FILE_OP_TYPE_WRITE)
-    is_dirty = 1;
+    pt->is_dirty = 1;
+
+  block = file_rand_block();
+  off = pt->seq_next;
+
+  file_req->file_id = (unsigned int) (off / file_size);
+  file_req->pos = (long long) (off % file_size);
+  file_req->size = SB_MIN(file_blocks[block].size * file_merge_factor,
+                          file_size - file_req->pos);
+  file_req->size = SB_MIN((unsigned long long) file_req->size,
+                          pt->seq_end - off);
+
+  pt->seq_next = off + file_req->size;
+  pt->block = block;
 
-  /* Rewind to the first file if all files are processed */
-  if (current_file == num_files)
+  /* Rewind to the start of the partition if all of it is processed */
+  if (pt->seq_next == pt->seq_end)
+    pt->seq_next = pt->seq_first;
+
+  if (sb_globals.validate)
   {
-    position= 0;
-    current_file= 0;
+    check_seq_req(&pt->prev_req, file_req);
+    pt->prev_req = *file_req;
+
+    /* Do not check the jump back to the partition start */
+    if (pt->seq_next == pt->seq_first)
+      pt->prev_req.operation = FILE_OP_TYPE_NULL;
   }
+  
+  return sb_req;    
+}
+
+
+/* Pick a random unit in [0, n) with the --rand-type distribution */
 
-  file_req->file_id = current_file;
-  file_req->pos = position;
-  file_req->size = SB_MIN(file_request_size, file_size - position);
+static unsigned long long file_rand_unit(unsigned long long n)
+{
+  if (file_rand_uniform)
+    return (unsigned long long) (sb_rand_uniform_double() * n);
+
+  if (n <= UINT32_MAX)
+    return sb_rand_default(0, (uint32_t) (n - 1));
+
+  /* Scale larger ranges, which keeps the shape of the distribution */
+  return (unsigned long long) (sb_rand_default(0, UINT32_MAX - 1) /
+                               (double) UINT32_MAX * n);
+}
+
+
+/*
+  Pick a skewed random offset in all files aligned to a given value. With a hot
+  set, the hot or the cold part of files is picked first, then an offset in that
+  part is picked with the --rand-type distribution.
+*/
 
-  position += file_req->size;
+static unsigned long long file_rand_offset(long long align, bool *hot)
+{
+  const unsigned long long nunits =
+    SB_MAX((unsigned long long) (file_size * num_files / align), 1ULL);
+  const unsigned long long nhot =
+    SB_MAX((unsigned long long) (file_hot_size / align), 1ULL);
+
+  *hot = false;
 
-  /* scroll to the next file if not already out of bound */
-  if (position == file_size)
+  if (file_hot_size == 0 || nhot >= nunits)
+    return file_rand_unit(nunits) * align;
+
+  if (sb_rand_uniform_double() < file_hot_probability)
   {
-    current_file++;
-    position=0;
-  }      
-  
-  if (sb_globals.validate)
+    *hot = true;
+    return file_rand_unit(nhot) * align;
+  }
+
+  return (nhot + file_rand_unit(nunits - nhot)) * align;
+}
+
+
+/* Whether the benchmark is in the warmup phase */
+
+static bool file_warmup(void)
+{
+  return sb_globals.warmup_time > 0 &&
+    sb_timer_value(&sb_exec_timer) < SEC2NS(sb_globals.warmup_time);
+}
+
+
+/*
+  Account a skewed random request in random access stats. Units of the request
+  are marked as accessed in the shared bitmap, which is only written on the first
+  access to a unit. Newly marked units are always counted, as the working set is
+  reported since the test start. During warmup request counters are not updated.
+*/
+
+static void file_rnd_update(sb_per_thread_t *pt, sb_file_request_t *file_req,
+                            bool hot)
+{
+  const bool               warmup = file_warmup();
+  const unsigned long long off =
+    (unsigned long long) file_req->file_id * file_size + file_req->pos;
+  const unsigned long long last = SB_MIN((off + file_req->size - 1) /
+                                         file_unit_size, file_nunits - 1);
+  unsigned long long       u;
+  bool                     hit = true;
+
+  for (u = off / file_unit_size; u <= last; u++)
   {
-    check_seq_req(&prev_req, file_req);
-    prev_req = *file_req;
+    unsigned int * const word = &file_units[u / 32];
+    const unsigned int   bit = u % 32;
+
+    if ((ck_pr_load_uint(word) & (1U << bit)) == 0 &&
+        !ck_pr_bts_uint(word, bit))
+    {
+      hit = false;
+      ck_pr_store_64(&pt->rnd_units, pt->rnd_units + 1);
+    }
   }
-  
-  SB_THREAD_MUTEX_UNLOCK(); 
 
-  return sb_req;    
+  if (warmup)
+    return;
+
+  /* Only the owning thread updates its counters */
+  ck_pr_store_64(&pt->rnd_reqs, pt->rnd_reqs + 1);
+  if (hot)
+    ck_pr_store_64(&pt->rnd_hot, pt->rnd_hot + 1);
+  if (hit)
+    ck_pr_store_64(&pt->rnd_reaccess, pt->rnd_reaccess + 1);
 }
 
 
@@ -484,9 +820,12 @@ sb_event_t file_get_rnd_request(int thread_id)
 {
   sb_event_t           sb_req;
   sb_file_request_t    *file_req = &sb_req.u.file_request;
+  sb_per_thread_t      * const pt = &per_thread[thread_id];
   unsigned long long   tmppos;
+  long long            align;
   int                  mode = test_mode;
-  unsigned int         i;
+  unsigned int         i, block;
+  bool                 hot = false;
 
   sb_req.type = SB_REQ_TYPE_FILE;
 
@@ -501,68 +840,100 @@ sb_event_t file_get_rnd_request(int thread_id)
     is_dirty is only set if writes are done and cleared after all files
     are synced
   */
-  if (file_fsync_freq != 0 && is_dirty)
-  {
-    if (req_performed % file_fsync_freq == 0)
-    {
-      file_req->operation = FILE_OP_TYPE_FSYNC;  
-      file_req->file_id = fsynced_file;
-      file_req->pos = 0;
-      file_req->size = 0;
-      fsynced_file++;
-      if (fsynced_file == num_files)
-      {
-        fsynced_file = 0;
-        is_dirty = 0;
-      }
-
-      SB_THREAD_MUTEX_UNLOCK();
-      return sb_req;
-    }
-  }
+  if (file_get_fsync_request(thread_id, file_req))
+    return sb_req;
 
   if (mode==MODE_RND_WRITE) /* mode shall be WRITE or RND_WRITE only */
     file_req->operation = FILE_OP_TYPE_WRITE;
   else
     file_req->operation = FILE_OP_TYPE_READ;
 
+  block = file_rand_block();
+  align = file_block_align > 0 ? file_block_align : file_blocks[block].size;
+
 retry:
-  tmppos = (long long) (sb_rand_uniform_double() * total_size);
-  tmppos = tmppos - (tmppos % (long long) file_block_size);
+  if (file_rnd_skewed)
+    tmppos = file_rand_offset(align, &hot);
+  else
+  {
+    tmppos = (long long) (sb_rand_uniform_double() * total_size);
+    tmppos = tmppos - (tmppos % (unsigned long long) align);
+  }
   file_req->file_id = (int) (tmppos / (long long) file_size);
   file_req->pos = (long long) (tmppos % (long long) file_size);
-  file_req->size = SB_MIN(file_block_size, file_size - file_req->pos);
+  file_req->size = SB_MIN(file_blocks[block].size, file_size - file_req->pos);
 
   if (sb_globals.validate)
   {
     /*
        For the multi-threaded validation test we have to make sure the block is
-       not being used by another thread
+       not being used by another thread. Checking and claiming a block must be
+       atomic, so this is the only place where request generation takes the
+       execution mutex.
     */
+    SB_THREAD_MUTEX_LOCK();
+
     for (i = 0; i < sb_globals.threads; i++)
     {
-      if (i != (unsigned) thread_id && per_thread[i].buffer_file_id == file_req->file_id &&
+      if (i != (unsigned) thread_id &&
+          per_thread[i].buffer_file_id == file_req->file_id &&
           per_thread[i].buffer_pos == file_req->pos)
+      {
+        SB_THREAD_MUTEX_UNLOCK();
         goto retry;
+      }
     }
+
+    pt->buffer_file_id = file_req->file_id;
+    pt->buffer_pos = file_req->pos;
+
+    SB_THREAD_MUTEX_UNLOCK();
   }
 
-  per_thread[thread_id].buffer_file_id = file_req->file_id;
-  per_thread[thread_id].buffer_pos = file_req->pos;
+  if (file_rnd_skewed)
+    file_rnd_update(pt, file_req, hot);
 
-  req_performed++;
+  pt->block = block;
+  pt->req_performed++;
   if (file_req->operation == FILE_OP_TYPE_WRITE) 
-    is_dirty = 1;
+    pt->is_dirty = 1;
 
-  SB_THREAD_MUTEX_UNLOCK();        
   return sb_req;
 }
 
 
+/*
+  Account a read or write request started at a given time in per-block size
+  stats. Requests made during warmup are ignored.
+*/
+
+static void file_block_update(int thread_id, unsigned int block, ssize_t len,
+                              const struct timespec *start)
+{
+  sb_per_thread_t * const pt = &per_thread[thread_id];
+  struct timespec         ts;
+  uint64_t                ns;
+
+  if (file_warmup())
+    return;
+
+  SB_GETTIME(&ts);
+  ns = TIMESPEC_DIFF(ts, (*start));
+
+  /* Only the owning thread updates its counters */
+  ck_pr_store_64(&pt->block_ops[block], pt->block_ops[block] + 1);
+  ck_pr_store_64(&pt->block_bytes[block], pt->block_bytes[block] + len);
+  ck_pr_store_64(&pt->block_ns[block], pt->block_ns[block] + ns);
+
+  sb_histogram_update(&file_blocks[block].latency, NS2MS(ns));
+}
+
+
 int file_execute_event(sb_event_t *sb_req, int thread_id)
 {
   FILE_DESCRIPTOR    fd;
   sb_file_request_t *file_req = &sb_req->u.file_request;
+  struct timespec    start;
 
   if (sb_globals.debug)
   {
@@ -591,6 +962,9 @@ int file_execute_event(sb_event_t *sb_req, int thread_id)
   }
   fd = files[file_req->file_id];
 
+  if (file_nblocks > 1)
+    SB_GETTIME(&start);
+
   switch (file_req->operation) {
     case FILE_OP_TYPE_NULL:
       log_text(LOG_FATAL, "Execute of NULL request called !, aborting");
@@ -610,12 +984,23 @@ int file_execute_event(sb_event_t *sb_req, int thread_id)
         return 1;
       }
 
+      /*
+        In validation mode the buffer is refilled for the next request, so
+        wait for an asynchronous write to complete before returning
+      */
+      if (sb_globals.validate && file_wait_all(thread_id))
+        return 1;
+
       /* Check if we have to fsync each write operation */
       if (file_fsync_all && file_fsync(file_req->file_id, thread_id))
           return 1;
 
-      /* In async mode stats will me updated on AIO requests completion */
-      if (file_io_mode != FILE_IO_MODE_ASYNC)
+      /*
+        In async and io_uring modes stats will be updated on requests
+        completion
+      */
+      if (file_io_mode != FILE_IO_MODE_ASYNC &&
+          file_io_mode != FILE_IO_MODE_URING)
       {
         sb_counter_inc(thread_id, SB_CNT_WRITE);
         sb_counter_add(thread_id, SB_CNT_BYTES_WRITTEN, file_req->size);
@@ -632,7 +1017,13 @@ int file_execute_event(sb_event_t *sb_req, int thread_id)
         return 1;
       }
 
-      /* Validate block if run with validation enabled */
+      /*
+        Validate block if run with validation enabled. In async and io_uring
+        modes the request has only been queued at this point, so wait for it
+        to complete first.
+      */
+      if (sb_globals.validate && file_wait_all(thread_id))
+        return 1;
       if (sb_globals.validate &&
           file_validate_buffer(per_thread[thread_id].buffer, file_req->size, file_req->pos))
       {
@@ -642,8 +1033,12 @@ int file_execute_event(sb_event_t *sb_req, int thread_id)
         return 1;
       }
 
-      /* In async mode stats will me updated on AIO requests completion */
-      if(file_io_mode != FILE_IO_MODE_ASYNC)
+      /*
+        In async and io_uring modes stats will be updated on requests
+        completion
+      */
+      if (file_io_mode != FILE_IO_MODE_ASYNC &&
+          file_io_mode != FILE_IO_MODE_URING)
       {
         sb_counter_inc(thread_id, SB_CNT_READ);
         sb_counter_add(thread_id, SB_CNT_BYTES_READ, file_req->size);
@@ -663,6 +1058,16 @@ int file_execute_event(sb_event_t *sb_req, int thread_id)
                "aborting", file_req->operation);
       return 1;
   }
+
+  /*
+    In async and io_uring modes per-block size stats are updated on requests
+    completion
+  */
+  if (file_nblocks > 1 && file_req->operation != FILE_OP_TYPE_FSYNC &&
+      file_io_mode != FILE_IO_MODE_ASYNC && file_io_mode != FILE_IO_MODE_URING)
+    file_block_update(thread_id, per_thread[thread_id].block, file_req->size,
+                      &start);
+
   return 0;
 
 }
@@ -687,8 +1092,29 @@ void file_print_mode(void)
   log_text(LOG_NOTICE, "%sB total file size",
            sb_print_value_size(sizestr, sizeof(sizestr),
                                file_size * num_files));
-  log_text(LOG_NOTICE, "Block size %sB",
-           sb_print_value_size(sizestr, sizeof(sizestr), file_block_size));
+  if (file_nblocks == 1)
+    log_text(LOG_NOTICE, "Block size %sB",
+             sb_print_value_size(sizestr, sizeof(sizestr), file_block_size));
+  else
+  {
+    char         buf[FILE_MAX_BLOCK_SIZES * 32];
+    unsigned int i, n = 0;
+    double       prev = 0;
+
+    for (i = 0; i < file_nblocks; i++)
+    {
+      n += snprintf(buf + n, sizeof(buf) - n, "%s%sB (%.0f%%)",
+                    i > 0 ? ", " : "",
+                    sb_print_value_size(sizestr, sizeof(sizestr),
+                                        file_blocks[i].size),
+                    (file_blocks[i].cdf - prev) * 100);
+      prev = file_blocks[i].cdf;
+    }
+    log_text(LOG_NOTICE, "Block sizes %s", buf);
+  }
+  if (file_block_align > 0)
+    log_text(LOG_NOTICE, "Aligning random requests to %sB",
+             sb_print_value_size(sizestr, sizeof(sizestr), file_block_align));
   if (file_merged_requests > 0)
     log_text(LOG_NOTICE, "Merging requests up to %sB for sequential IO.",
              sb_print_value_size(sizestr, sizeof(sizestr),
@@ -704,6 +1130,13 @@ void file_print_mode(void)
       log_text(LOG_NOTICE,
                "Read/Write ratio for combined random IO test: %2.2f",
                file_rw_ratio);
+      if (!file_rand_uniform)
+        log_text(LOG_NOTICE, "Using %s distribution for random offsets",
+                 sb_get_value_string("rand-type"));
+      if (file_hot_size > 0)
+        log_text(LOG_NOTICE, "Hot set %sB, accessed by %.0f%% of requests",
+                 sb_print_value_size(sizestr, sizeof(sizestr), file_hot_size),
+                 file_hot_probability * 100);
       break;
     default:
       break;
@@ -722,6 +1155,19 @@ void file_print_mode(void)
 
   log_text(LOG_NOTICE, "Using %s I/O mode", get_io_mode_str(file_io_mode));
 
+#ifdef HAVE_LIBAIO
+  if (file_io_mode == FILE_IO_MODE_ASYNC)
+    log_text(LOG_NOTICE, "Asynchronous I/O backlog %u, submitting in batches "
+             "of %u", file_async_backlog, file_async_batch);
+#endif
+#ifdef HAVE_IO_URING
+  if (file_io_mode == FILE_IO_MODE_URING)
+    log_text(LOG_NOTICE, "io_uring queue depth %u, submitting in batches of "
+             "%u%s%s", file_uring_depth, file_uring_batch,
+             file_uring_sqpoll ? ", SQ polling" : "",
+             file_uring_iopoll ? ", I/O polling" : "");
+#endif
+
   if (sb_globals.validate)
     log_text(LOG_NOTICE, "Using checksums validation.");
   
@@ -733,22 +1179,156 @@ void file_print_mode(void)
 void file_report_intermediate(sb_stat_t *stat)
 {
   const double seconds = stat->time_interval;
+  char pcts[SB_LATENCY_PCTS_STR_SIZE];
 
   log_timestamp(LOG_NOTICE, stat->time_total,
                 "reads: %4.2f MiB/s writes: %4.2f MiB/s fsyncs: %4.2f/s "
-                "latency (ms,%u%%): %4.3f",
+                "latency %s",
                 stat->bytes_read / mebibyte / seconds,
                 stat->bytes_written / mebibyte / seconds,
                 stat->other / seconds,
-                sb_globals.percentile,
-                SEC2MS(stat->latency_pct));
+                sb_latency_pcts_str(stat->latency_pcts, 3, pcts,
+                                    sizeof(pcts)));
+
+  if (sb_globals.tx_rate > 0)
+    log_timestamp(LOG_NOTICE, stat->time_total,
+                  "queue length: %" PRIu64 " concurrency: %" PRIu64
+                  " lag (ms): %4.3f resp %s",
+                  stat->queue_length, stat->concurrency,
+                  SEC2MS(stat->scheduler_lag),
+                  sb_latency_pcts_str(stat->response_pcts, 3, pcts,
+                                      sizeof(pcts)));
+}
+
+#ifdef HAVE_SYS_RESOURCE_H
+/* Difference between two timeval values in microseconds */
+
+static double timeval_diff_us(const struct timeval *a, const struct timeval *b)
+{
+  return (a->tv_sec - b->tv_sec) * 1e6 + (a->tv_usec - b->tv_usec);
+}
+#endif
+
+/*
+  Collect per-block size counters since the last cumulative report and print
+  throughput for each block size
+*/
+
+static void file_report_blocks(double seconds, uint64_t *ops, uint64_t *ns)
+{
+  char         label[32];
+  char         sizestr[16];
+  unsigned int i, t;
+
+  log_text(LOG_NOTICE, "Throughput by block size:");
+
+  for (i = 0; i < file_nblocks; i++)
+  {
+    sb_file_block_t * const b = &file_blocks[i];
+    uint64_t                bytes = 0;
+
+    ops[i] = 0;
+    ns[i] = 0;
+
+    for (t = 0; t < sb_globals.threads; t++)
+    {
+      ops[i] += ck_pr_load_64(&per_thread[t].block_ops[i]);
+      bytes += ck_pr_load_64(&per_thread[t].block_bytes[i]);
+      ns[i] += ck_pr_load_64(&per_thread[t].block_ns[i]);
+    }
+
+    ops[i] -= b->cumul_ops;
+    bytes -= b->cumul_bytes;
+    ns[i] -= b->cumul_ns;
+
+    b->cumul_ops += ops[i];
+    b->cumul_bytes += bytes;
+    b->cumul_ns += ns[i];
+
+    snprintf(label, sizeof(label), "%sB:",
+             sb_print_value_size(sizestr, sizeof(sizestr), b->size));
+    log_text(LOG_NOTICE, "         %-7s IOPS=%4.2f %4.2f MiB/s (%4.2f MB/s)",
+             label, ops[i] / seconds, bytes / mebibyte / seconds,
+             bytes / megabyte / seconds);
+  }
+
+  log_text(LOG_NOTICE, "");
+}
+
+
+/* Print random access stats */
+
+static void file_report_rnd(void)
+{
+  uint64_t     reqs = 0, hot = 0, reaccess = 0, units = 0;
+  unsigned int t;
+
+  for (t = 0; t < sb_globals.threads; t++)
+  {
+    reqs += ck_pr_load_64(&per_thread[t].rnd_reqs);
+    hot += ck_pr_load_64(&per_thread[t].rnd_hot);
+    reaccess += ck_pr_load_64(&per_thread[t].rnd_reaccess);
+    units += ck_pr_load_64(&per_thread[t].rnd_units);
+  }
+
+  reqs -= cumul_rnd_reqs;
+  hot -= cumul_rnd_hot;
+  reaccess -= cumul_rnd_reaccess;
+
+  cumul_rnd_reqs += reqs;
+  cumul_rnd_hot += hot;
+  cumul_rnd_reaccess += reaccess;
+
+  log_text(LOG_NOTICE, "Random access pattern:");
+  if (file_hot_size > 0)
+    log_text(LOG_NOTICE, "         hot set requests (%%):           %10.2f",
+             reqs > 0 ? hot * 100.0 / reqs : 0.0);
+  log_text(LOG_NOTICE, "         re-access ratio (%%):            %10.2f",
+           reqs > 0 ? reaccess * 100.0 / reqs : 0.0);
+  log_text(LOG_NOTICE, "         working set since start (MiB):  %10.2f",
+           SB_MIN(units * file_unit_size,
+                  (unsigned long long) file_size * num_files) / mebibyte);
+  log_text(LOG_NOTICE, "");
+}
+
+
+/* Print latency for each block size */
+
+static void file_report_blocks_latency(const uint64_t *ops, const uint64_t *ns)
+{
+  double       pcts[MAX_PERCENTILES];
+  char         sizestr[16];
+  unsigned int i, j;
+
+  log_text(LOG_NOTICE, "Latency by block size (ms):");
+
+  for (i = 0; i < file_nblocks; i++)
+  {
+    sb_histogram_get_pcts_checkpoint(&file_blocks[i].latency,
+                                     sb_globals.percentiles,
+                                     sb_globals.n_percentiles, pcts);
+    for (j = 0; j < sb_globals.n_percentiles; j++)
+      pcts[j] = MS2SEC(pcts[j]);
+
+    log_text(LOG_NOTICE, "    %sB:",
+             sb_print_value_size(sizestr, sizeof(sizestr),
+                                 file_blocks[i].size));
+    log_text(LOG_NOTICE, "         avg:                            %10.2f",
+             ops[i] > 0 ? NS2MS((double) ns[i] / ops[i]) : 0.0);
+    sb_print_latency_pcts(pcts, 25);
+  }
+
+  log_text(LOG_NOTICE, "");
 }
 
+
 /* Print cumulative test statistics. */
 
 void file_report_cumulative(sb_stat_t *stat)
 {
   const double seconds = stat->time_interval;
+  uint64_t     block_ops[FILE_MAX_BLOCK_SIZES];
+  uint64_t     block_ns[FILE_MAX_BLOCK_SIZES];
 
   log_text(LOG_NOTICE, "\n"
            "Throughput:\n"
@@ -766,6 +1346,33 @@ void file_report_cumulative(sb_stat_t *stat)
 
   log_text(LOG_NOTICE, "");
 
+  if (file_nblocks > 1)
+    file_report_blocks(seconds, block_ops, block_ns);
+
+  if (file_units != NULL)
+    file_report_rnd();
+
+#ifdef HAVE_SYS_RESOURCE_H
+  /*
+    Client CPU time per I/O request tells client overhead from device limits
+  */
+  struct rusage ru;
+  const uint64_t nios = stat->reads + stat->writes + stat->other;
+
+  getrusage(RUSAGE_SELF, &ru);
+
+  log_text(LOG_NOTICE, "CPU time per I/O (us):");
+  log_text(LOG_NOTICE, "         user:                           %10.2f",
+           nios > 0 ? timeval_diff_us(&ru.ru_utime, &rusage_start.ru_utime) /
+           nios : 0.0);
+  log_text(LOG_NOTICE, "         system:                         %10.2f",
+           nios > 0 ? timeval_diff_us(&ru.ru_stime, &rusage_start.ru_stime) /
+           nios : 0.0);
+  log_text(LOG_NOTICE, "");
+
+  rusage_start = ru;
+#endif
+
   log_text(LOG_NOTICE, "Latency (ms):");
   log_text(LOG_NOTICE, "         min:                            %10.2f",
            SEC2MS(stat->latency_min));
@@ -774,15 +1381,21 @@ void file_report_cumulative(sb_stat_t *stat)
   log_text(LOG_NOTICE, "         max:                            %10.2f",
            SEC2MS(stat->latency_max));
 
-  if (sb_globals.percentile > 0)
-    log_text(LOG_NOTICE, "        %3dth percentile:                %10.2f",
-             sb_globals.percentile, SEC2MS(stat->latency_pct));
-  else
-    log_text(LOG_NOTICE, "         percentile stats:               disabled");
+  sb_print_latency_pcts(stat->latency_pcts, 25);
 
   log_text(LOG_NOTICE, "         sum:                            %10.2f",
            SEC2MS(stat->latency_sum));
   log_text(LOG_NOTICE, "");
+
+  if (file_nblocks > 1)
+    file_report_blocks_latency(block_ops, block_ns);
+
+  if (sb_globals.tx_rate > 0)
+  {
+    log_text(LOG_NOTICE, "Response time (ms):");
+    sb_print_latency_pcts(stat->response_pcts, 25);
+    log_text(LOG_NOTICE, "");
+  }
 }
 
 /* Return name for I/O mode */
@@ -794,6 +1407,8 @@ const char *get_io_mode_str(file_io_mode_t mode)
       return "synchronous";
     case FILE_IO_MODE_ASYNC:
       return "asynchronous";
+    case FILE_IO_MODE_URING:
+      return "io_uring";
     case FILE_IO_MODE_MMAP:
 #if SIZEOF_SIZE_T == 4
       return "slow mmaped";
@@ -1018,28 +1633,67 @@ int file_cmd_cleanup(void)
   return remove_files();
 }
 
-void init_vars(void)
+/* Convert a sequential request number to an offset in all files */
+
+static unsigned long long seq_req_offset(unsigned long long req,
+                                         unsigned long long file_reqs)
 {
-  position = 0; /* position in file */
-  current_file = 0;
-  fsynced_file = 0; /* for counting file to be fsynced */
-  req_performed = 0;
-  is_dirty = 0;
-  if (sb_globals.validate)
-  {
-    prev_req.size = 0;
-    prev_req.operation = FILE_OP_TYPE_NULL;
-    prev_req.file_id = 0;
-    prev_req.pos = 0;
-  }
+  return (req / file_reqs) * file_size +
+    (req % file_reqs) * file_request_size;
 }
 
+
 /*
-  Before the benchmark is stopped, issue fsync() if --file-fsync-end is used,
-  and wait for all async operations to complete.
+  Initialize request generators. Sequential requests over all files are split
+  into contiguous partitions, one per thread. Each thread walks its partition
+  sequentially and wraps around to its start.
 */
 
-int file_thread_done(int thread_id)
+void init_vars(void)
+{
+  unsigned long long file_reqs;
+  unsigned long long total_reqs;
+  unsigned long long first, end;
+  unsigned int       i;
+
+  file_reqs = SB_MAX((file_size + file_request_size - 1) /
+                     file_request_size, 1LL);
+  total_reqs = file_reqs * num_files;
+
+  for (i = 0; i < sb_globals.threads; i++)
+  {
+    sb_per_thread_t * const pt = &per_thread[i];
+
+    first = total_reqs * i / sb_globals.threads;
+    end = total_reqs * (i + 1) / sb_globals.threads;
+    /* More threads than requests, share a request with another thread */
+    if (end == first)
+      end = first + 1;
+
+    pt->seq_first = seq_req_offset(first, file_reqs);
+    pt->seq_end = seq_req_offset(end, file_reqs);
+    pt->seq_next = pt->seq_first;
+
+    /* No blocks are used by random requests yet */
+    pt->buffer_file_id = num_files;
+    pt->buffer_pos = 0;
+
+    pt->fsynced_file = 0;
+    pt->req_performed = 0;
+    pt->is_dirty = 0;
+    pt->prev_req.size = 0;
+    pt->prev_req.operation = FILE_OP_TYPE_NULL;
+    pt->prev_req.file_id = 0;
+    pt->prev_req.pos = 0;
+  }
+}
+
+/*
+  Before the benchmark is stopped, issue fsync() if --file-fsync-end is used,
+  and wait for all async operations to complete.
+*/
+
+int file_thread_done(int thread_id)
 {
   if (file_fsync_end && test_mode != MODE_READ && test_mode != MODE_RND_READ)
   {
@@ -1050,21 +1704,49 @@ int file_thread_done(int thread_id)
     }
   }
 
+  return file_wait_all(thread_id);
+}
+
+
+/*
+  Submit all queued asynchronous requests and wait for them to complete. Does
+  nothing in synchronous modes.
+*/
+
+
+int file_wait_all(int thread_id)
+{
 #ifdef HAVE_LIBAIO
-  if (file_io_mode == FILE_IO_MODE_ASYNC && aio_ctxts[thread_id].nrequests > 0)
-    return file_wait(thread_id, aio_ctxts[thread_id].nrequests);
+  if (file_io_mode == FILE_IO_MODE_ASYNC)
+  {
+    if (file_async_submit(thread_id))
+      return 1;
+    if (aio_ctxts[thread_id].nrequests > 0)
+      return file_wait(thread_id, aio_ctxts[thread_id].nrequests);
+  }
+#endif
+
+#ifdef HAVE_IO_URING
+  if (file_io_mode == FILE_IO_MODE_URING)
+    return file_uring_drain(thread_id);
 #endif
 
+  (void) thread_id; /* unused */
+
   return 0;
 }
 
 #ifdef HAVE_LIBAIO
-/* Allocate async contexts pool */
+/*
+  Allocate async contexts pool. Operations are preallocated, so no memory is
+  allocated when requests are submitted.
+*/
 
 
 int file_async_init(void)
 {
-  unsigned int i;
+  unsigned int i, j;
+  int          val;
 
   if (file_io_mode != FILE_IO_MODE_ASYNC)
     return 0;
@@ -1076,23 +1758,45 @@ int file_async_init(void)
     return 1;
   }
 
+  val = sb_get_value_int("file-async-batch");
+  if (val <= 0 || (unsigned int) val > file_async_backlog)
+  {
+    log_text(LOG_FATAL, "Invalid value of file-async-batch: %d, must be "
+             "between 1 and file-async-backlog", val);
+    return 1;
+  }
+  file_async_batch = (unsigned int) val;
+
   aio_ctxts = (sb_aio_context_t *)calloc(sb_globals.threads,
                                          sizeof(sb_aio_context_t));
   for (i = 0; i < sb_globals.threads; i++)
   {
-    if (io_queue_init(file_async_backlog, &aio_ctxts[i].io_ctxt))
+    sb_aio_context_t * const ctx = &aio_ctxts[i];
+
+    if (io_queue_init(file_async_backlog, &ctx->io_ctxt))
     {
       log_errno(LOG_FATAL, "io_queue_init() failed!");
       return 1;
     }
       
-    aio_ctxts[i].events = (struct io_event *)malloc(file_async_backlog *
-                                                    sizeof(struct io_event));
-    if (aio_ctxts[i].events == NULL)
+    ctx->events = (struct io_event *)malloc(file_async_backlog *
+                                            sizeof(struct io_event));
+    ctx->opers = (sb_aio_oper_t *)malloc(file_async_backlog *
+                                         sizeof(sb_aio_oper_t));
+    ctx->free_opers = (sb_aio_oper_t **)malloc(file_async_backlog *
+                                               sizeof(sb_aio_oper_t *));
+    ctx->pending = (struct iocb **)malloc(file_async_backlog *
+                                          sizeof(struct iocb *));
+    if (ctx->events == NULL || ctx->opers == NULL || ctx->free_opers == NULL ||
+        ctx->pending == NULL)
     {
       log_errno(LOG_FATAL, "Failed to allocate async I/O context!");
       return 1;
     }
+
+    for (j = 0; j < file_async_backlog; j++)
+      ctx->free_opers[j] = &ctx->opers[j];
+    ctx->nfree = file_async_backlog;
   }
 
   return 0;
@@ -1113,6 +1817,9 @@ int file_async_done(void)
   {
     io_queue_release(aio_ctxts[i].io_ctxt);
     free(aio_ctxts[i].events);
+    free(aio_ctxts[i].opers);
+    free(aio_ctxts[i].free_opers);
+    free(aio_ctxts[i].pending);
   }
   
   free(aio_ctxts);
@@ -1121,43 +1828,72 @@ int file_async_done(void)
 }  
 
 /*
-  Submit async I/O requests until the length of request queue exceeds
-  the limit. Then wait for at least one request to complete and proceed.
+  Queue async I/O requests and submit them in batches of --file-async-batch
+  until the length of request queue exceeds the limit. Then wait for at least
+  one request to complete and proceed.
 */
 
 
 int file_submit_or_wait(struct iocb *iocb, sb_file_op_t type, ssize_t len,
                         int thread_id)
 {
-  sb_aio_oper_t   *oper;
-  struct iocb     *iocbp;
+  sb_aio_context_t * const ctx = &aio_ctxts[thread_id];
+  sb_aio_oper_t    *oper;
 
-  oper = (sb_aio_oper_t *)malloc(sizeof(sb_aio_oper_t));
-  if (oper == NULL)
-  {
-    log_text(LOG_FATAL, "Failed to allocate AIO operation!");
-    return 1;
-  }
+  /* There is always a free operation, as we never queue more than backlog */
+  oper = ctx->free_opers[--ctx->nfree];
 
   memcpy(&oper->iocb, iocb, sizeof(*iocb));
   oper->type = type;
   oper->len = len;
-  iocbp = &oper->iocb;
+  oper->block = per_thread[thread_id].block;
 
-  if (io_submit(aio_ctxts[thread_id].io_ctxt, 1, &iocbp) < 1)
-  {
-    log_errno(LOG_FATAL, "io_submit() failed!");
+  if (file_nblocks > 1)
+    SB_GETTIME(&oper->start);
+
+  ctx->pending[ctx->npending++] = &oper->iocb;
+  ctx->nrequests++;
+
+  if ((ctx->npending >= file_async_batch ||
+       ctx->nrequests >= file_async_backlog) && file_async_submit(thread_id))
     return 1;
-  }
-  
-  aio_ctxts[thread_id].nrequests++;
-  if (aio_ctxts[thread_id].nrequests < file_async_backlog)
+
+  if (ctx->nrequests < file_async_backlog)
     return 0;
   
   return file_wait(thread_id, 1);
 }
 
 
+/* Submit all queued async I/O requests */
+
+
+int file_async_submit(int thread_id)
+{
+  sb_aio_context_t * const ctx = &aio_ctxts[thread_id];
+  unsigned int     nsubmitted = 0;
+  int              rc;
+
+  while (nsubmitted < ctx->npending)
+  {
+    rc = io_submit(ctx->io_ctxt, ctx->npending - nsubmitted,
+                   ctx->pending + nsubmitted);
+    if (rc < 1)
+    {
+      log_text(LOG_FATAL, "io_submit() failed: %s",
+               rc < 0 ? strerror(-rc) : "no requests submitted");
+      return 1;
+    }
+
+    nsubmitted += (unsigned int) rc;
+  }
+
+  ctx->npending = 0;
+
+  return 0;
+}
+
+
 /*
   Wait for at least nreq I/O requests to complete
 */
@@ -1214,6 +1950,9 @@ int file_wait(int thread_id, long nreq)
         sb_counter_inc(thread_id, SB_CNT_READ);
         sb_counter_add(thread_id, SB_CNT_BYTES_READ, oper->len);
 
+        if (file_nblocks > 1)
+          file_block_update(thread_id, oper->block, oper->len, &oper->start);
+
         break;
 
     case FILE_OP_TYPE_WRITE:
@@ -1226,12 +1965,15 @@ int file_wait(int thread_id, long nreq)
         sb_counter_inc(thread_id, SB_CNT_WRITE);
         sb_counter_add(thread_id, SB_CNT_BYTES_WRITTEN, oper->len);
 
+        if (file_nblocks > 1)
+          file_block_update(thread_id, oper->block, oper->len, &oper->start);
+
         break;
 
     default:
         break;
     }
-    free(oper);
+    aio_ctxts[thread_id].free_opers[aio_ctxts[thread_id].nfree++] = oper;
     aio_ctxts[thread_id].nrequests--;
   }
   
@@ -1239,6 +1981,461 @@ int file_wait(int thread_id, long nreq)
 }
 #endif /* HAVE_LIBAIO */
 
+#ifdef HAVE_IO_URING
+/*
+  io_uring system call wrappers. The interface is used directly rather than
+  via liburing, so only kernel headers are required.
+*/
+
+
+static int sb_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+  long rc = syscall(__NR_io_uring_setup, entries, p);
+
+  return (int) rc;
+}
+
+
+static int sb_io_uring_enter(int fd, unsigned int to_submit,
+                             unsigned int min_complete, unsigned int flags)
+{
+  long rc = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                    NULL, 0);
+
+  return (int) rc;
+}
+
+
+static int sb_io_uring_register(int fd, unsigned int opcode, const void *arg,
+                                unsigned int nr_args)
+{
+  long rc = syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+
+  return (int) rc;
+}
+
+
+/* Parse io_uring options and allocate per-thread contexts */
+
+
+int file_uring_init(void)
+{
+  unsigned int i;
+  int          val;
+
+  if (file_io_mode != FILE_IO_MODE_URING)
+    return 0;
+
+  val = sb_get_value_int("file-uring-depth");
+  if (val <= 0)
+  {
+    log_text(LOG_FATAL, "Invalid value of file-uring-depth: %d", val);
+    return 1;
+  }
+  file_uring_depth = (unsigned int) val;
+
+  val = sb_get_value_int("file-uring-batch");
+  if (val <= 0 || (unsigned int) val > file_uring_depth)
+  {
+    log_text(LOG_FATAL, "Invalid value of file-uring-batch: %d, must be "
+             "between 1 and file-uring-depth", val);
+    return 1;
+  }
+  file_uring_batch = (unsigned int) val;
+
+  file_uring_sqpoll = sb_get_value_flag("file-uring-sqpoll");
+  file_uring_iopoll = sb_get_value_flag("file-uring-iopoll");
+
+  if (file_uring_iopoll && !(file_extra_flags & SB_FILE_FLAG_DIRECTIO))
+  {
+    log_text(LOG_FATAL, "--file-uring-iopoll requires "
+             "--file-extra-flags=direct");
+    return 1;
+  }
+
+  uring_ctxts = (sb_uring_context_t *) calloc(sb_globals.threads,
+                                              sizeof(sb_uring_context_t));
+  if (uring_ctxts == NULL)
+  {
+    log_text(LOG_FATAL, "Failed to allocate io_uring contexts!");
+    return 1;
+  }
+
+  for (i = 0; i < sb_globals.threads; i++)
+    uring_ctxts[i].fd = -1;
+
+  return 0;
+}
+
+
+/*
+  Create a ring for a given thread with test files registered and the thread
+  buffer registered as a fixed buffer
+*/
+
+
+static int file_uring_setup(int thread_id)
+{
+  sb_uring_context_t     *ctx = &uring_ctxts[thread_id];
+  struct io_uring_params params;
+  struct iovec           iov;
+  unsigned int           *sq_array;
+  unsigned int           i;
+
+  memset(&params, 0, sizeof(params));
+  if (file_uring_sqpoll)
+    params.flags |= IORING_SETUP_SQPOLL;
+  if (file_uring_iopoll)
+    params.flags |= IORING_SETUP_IOPOLL;
+
+  ctx->fd = sb_io_uring_setup(file_uring_depth, &params);
+  if (ctx->fd < 0)
+  {
+    log_errno(LOG_FATAL, "io_uring_setup() failed!");
+    return 1;
+  }
+
+  ctx->reqs = (sb_uring_req_t *) malloc(file_uring_depth *
+                                        sizeof(sb_uring_req_t));
+  ctx->free_reqs = (sb_uring_req_t **) malloc(file_uring_depth *
+                                              sizeof(sb_uring_req_t *));
+  if (ctx->reqs == NULL || ctx->free_reqs == NULL)
+  {
+    log_text(LOG_FATAL, "Failed to allocate io_uring requests!");
+    return 1;
+  }
+
+  for (i = 0; i < file_uring_depth; i++)
+    ctx->free_reqs[i] = &ctx->reqs[i];
+  ctx->nfree = file_uring_depth;
+
+  ctx->sq_ring_size = params.sq_off.array +
+    params.sq_entries * sizeof(unsigned int);
+  ctx->sq_ring = mmap(NULL, ctx->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ctx->fd, IORING_OFF_SQ_RING);
+
+  ctx->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  ctx->sqes = mmap(NULL, ctx->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ctx->fd, IORING_OFF_SQES);
+
+  ctx->cq_ring_size = params.cq_off.cqes +
+    params.cq_entries * sizeof(struct io_uring_cqe);
+  ctx->cq_ring = mmap(NULL, ctx->cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ctx->fd, IORING_OFF_CQ_RING);
+
+  if (ctx->sq_ring == MAP_FAILED || ctx->sqes == MAP_FAILED ||
+      ctx->cq_ring == MAP_FAILED)
+  {
+    log_errno(LOG_FATAL, "Failed to map io_uring rings!");
+    return 1;
+  }
+
+  ctx->sq_tail = (unsigned int *) ((char *) ctx->sq_ring + params.sq_off.tail);
+  ctx->sq_flags = (unsigned int *) ((char *) ctx->sq_ring +
+                                    params.sq_off.flags);
+  ctx->sq_mask = *(unsigned int *) ((char *) ctx->sq_ring +
+                                    params.sq_off.ring_mask);
+  ctx->tail = *ctx->sq_tail;
+
+  /* Submission queue entries are always used in the ring order */
+  sq_array = (unsigned int *) ((char *) ctx->sq_ring + params.sq_off.array);
+  for (i = 0; i < params.sq_entries; i++)
+    sq_array[i] = i;
+
+  ctx->cq_head = (unsigned int *) ((char *) ctx->cq_ring + params.cq_off.head);
+  ctx->cq_tail = (unsigned int *) ((char *) ctx->cq_ring + params.cq_off.tail);
+  ctx->cq_mask = *(unsigned int *) ((char *) ctx->cq_ring +
+                                    params.cq_off.ring_mask);
+  ctx->cqes = (struct io_uring_cqe *) ((char *) ctx->cq_ring +
+                                       params.cq_off.cqes);
+
+  if (sb_io_uring_register(ctx->fd, IORING_REGISTER_FILES, files, num_files))
+  {
+    log_errno(LOG_FATAL, "Failed to register files with io_uring!");
+    return 1;
+  }
+
+  iov.iov_base = per_thread[thread_id].buffer;
+  iov.iov_len = file_request_size;
+
+  if (sb_io_uring_register(ctx->fd, IORING_REGISTER_BUFFERS, &iov, 1))
+  {
+    log_errno(LOG_FATAL, "Failed to register buffers with io_uring!");
+    log_text(LOG_WARNING, "Check the locked memory limit (ulimit -l)");
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/* Create rings for all threads. Must be called after files are opened. */
+
+
+int file_uring_prepare(void)
+{
+  unsigned int i;
+
+  if (file_io_mode != FILE_IO_MODE_URING)
+    return 0;
+
+  for (i = 0; i < sb_globals.threads; i++)
+  {
+    if (file_uring_setup(i))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/* Destroy rings and contexts */
+
+
+int file_uring_done(void)
+{
+  unsigned int i;
+
+  if (file_io_mode != FILE_IO_MODE_URING)
+    return 0;
+
+  for (i = 0; i < sb_globals.threads; i++)
+  {
+    sb_uring_context_t * const ctx = &uring_ctxts[i];
+
+    if (ctx->sq_ring != NULL && ctx->sq_ring != MAP_FAILED)
+      munmap(ctx->sq_ring, ctx->sq_ring_size);
+    if (ctx->sqes != NULL && ctx->sqes != MAP_FAILED)
+      munmap(ctx->sqes, ctx->sqes_size);
+    if (ctx->cq_ring != NULL && ctx->cq_ring != MAP_FAILED)
+      munmap(ctx->cq_ring, ctx->cq_ring_size);
+    if (ctx->fd >= 0)
+      close(ctx->fd);
+
+    free(ctx->reqs);
+    free(ctx->free_reqs);
+  }
+
+  free(uring_ctxts);
+
+  return 0;
+}
+
+
+/* Make queued requests visible to the kernel and submit them */
+
+
+static int file_uring_submit(sb_uring_context_t *ctx)
+{
+  int rc;
+
+  ck_pr_fence_release();
+  ck_pr_store_uint(ctx->sq_tail, ctx->tail);
+
+  if (file_uring_sqpoll)
+  {
+    /* The polling thread picks up new entries unless it has gone idle */
+    ck_pr_fence_memory();
+    if ((ck_pr_load_uint(ctx->sq_flags) & IORING_SQ_NEED_WAKEUP) &&
+        sb_io_uring_enter(ctx->fd, 0, 0, IORING_ENTER_SQ_WAKEUP) < 0)
+    {
+      log_errno(LOG_FATAL, "io_uring_enter() failed!");
+      return 1;
+    }
+
+    ctx->nqueued = 0;
+
+    return 0;
+  }
+
+  while (ctx->nqueued > 0)
+  {
+    rc = sb_io_uring_enter(ctx->fd, ctx->nqueued, 0, 0);
+    if (rc < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      log_errno(LOG_FATAL, "io_uring_enter() failed!");
+      return 1;
+    }
+
+    ctx->nqueued -= (unsigned int) rc;
+  }
+
+  return 0;
+}
+
+
+/*
+  Process available completions, waiting for at least nreq I/O requests to
+  complete
+*/
+
+
+static int file_uring_wait(int thread_id, unsigned int nreq)
+{
+  sb_uring_context_t  *ctx = &uring_ctxts[thread_id];
+  struct io_uring_cqe *cqe;
+  unsigned int        head;
+  unsigned int        tail;
+  unsigned int        ncompleted = 0;
+  sb_uring_req_t      *req;
+
+  for (;;)
+  {
+    head = *ctx->cq_head;
+    tail = ck_pr_load_uint(ctx->cq_tail);
+    ck_pr_fence_acquire();
+
+    for (; head != tail; head++)
+    {
+      cqe = &ctx->cqes[head & ctx->cq_mask];
+      req = (sb_uring_req_t *) (uintptr_t) cqe->user_data;
+
+      switch (req->type) {
+      case FILE_OP_TYPE_FSYNC:
+        if (cqe->res != 0)
+        {
+          log_text(LOG_FATAL, "io_uring fsync failed: %s", strerror(-cqe->res));
+          return 1;
+        }
+
+        break;
+
+      case FILE_OP_TYPE_READ:
+        if (cqe->res != req->len)
+        {
+          log_text(LOG_FATAL, "io_uring read failed: %s", cqe->res < 0 ?
+                   strerror(-cqe->res) : "short read");
+          return 1;
+        }
+
+        sb_counter_inc(thread_id, SB_CNT_READ);
+        sb_counter_add(thread_id, SB_CNT_BYTES_READ, req->len);
+
+        if (file_nblocks > 1)
+          file_block_update(thread_id, req->block, req->len, &req->start);
+
+        break;
+
+      case FILE_OP_TYPE_WRITE:
+        if (cqe->res != req->len)
+        {
+          log_text(LOG_FATAL, "io_uring write failed: %s", cqe->res < 0 ?
+                   strerror(-cqe->res) : "short write");
+          return 1;
+        }
+
+        sb_counter_inc(thread_id, SB_CNT_WRITE);
+        sb_counter_add(thread_id, SB_CNT_BYTES_WRITTEN, req->len);
+
+        if (file_nblocks > 1)
+          file_block_update(thread_id, req->block, req->len, &req->start);
+
+        break;
+
+      default:
+        break;
+      }
+
+      ctx->free_reqs[ctx->nfree++] = req;
+      ctx->nrequests--;
+      ncompleted++;
+    }
+
+    ck_pr_fence_release();
+    ck_pr_store_uint(ctx->cq_head, head);
+
+    if (ncompleted >= nreq)
+      return 0;
+
+    if (sb_io_uring_enter(ctx->fd, 0, nreq - ncompleted,
+                          IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+    {
+      log_errno(LOG_FATAL, "io_uring_enter() failed!");
+      return 1;
+    }
+  }
+}
+
+
+/*
+  Queue an I/O request on the thread ring. Queued requests are submitted in
+  batches of --file-uring-batch. When the number of in-flight requests reaches
+  --file-uring-depth, wait for at least one request to complete.
+*/
+
+
+int file_uring_submit_or_wait(int thread_id, sb_file_op_t type,
+                              unsigned int file_id, ssize_t len,
+                              long long offset)
+{
+  sb_uring_context_t  *ctx = &uring_ctxts[thread_id];
+  struct io_uring_sqe *sqe = &ctx->sqes[ctx->tail & ctx->sq_mask];
+  sb_uring_req_t      *req;
+
+  /* There is always a free request, as we never queue more than the depth */
+  req = ctx->free_reqs[--ctx->nfree];
+  req->type = type;
+  req->len = len;
+  req->block = per_thread[thread_id].block;
+
+  if (file_nblocks > 1)
+    SB_GETTIME(&req->start);
+
+  memset(sqe, 0, sizeof(*sqe));
+
+  /* Files and buffers are registered, see file_uring_setup() */
+  sqe->fd = (int) file_id;
+  sqe->flags = IOSQE_FIXED_FILE;
+
+  if (type == FILE_OP_TYPE_FSYNC)
+  {
+    /* Do not start fsync until previously queued writes complete */
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->flags |= IOSQE_IO_DRAIN;
+    if (file_fsync_mode == FSYNC_DATA)
+      sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+  }
+  else
+  {
+    sqe->opcode = type == FILE_OP_TYPE_READ ? IORING_OP_READ_FIXED :
+      IORING_OP_WRITE_FIXED;
+    sqe->addr = (unsigned long) per_thread[thread_id].buffer;
+    sqe->len = (unsigned int) len;
+    sqe->off = (unsigned long long) offset;
+    sqe->buf_index = 0;
+  }
+
+  sqe->user_data = (unsigned long long) (uintptr_t) req;
+
+  ctx->tail++;
+  ctx->nqueued++;
+  ctx->nrequests++;
+
+  if ((ctx->nqueued >= file_uring_batch ||
+       ctx->nrequests >= file_uring_depth) && file_uring_submit(ctx))
+    return 1;
+
+  return file_uring_wait(thread_id, ctx->nrequests >= file_uring_depth);
+}
+
+
+/* Submit all queued requests and wait for them to complete */
+
+
+int file_uring_drain(int thread_id)
+{
+  sb_uring_context_t *ctx = &uring_ctxts[thread_id];
+
+  if (ctx->nqueued > 0 && file_uring_submit(ctx))
+    return 1;
+
+  return file_uring_wait(thread_id, ctx->nrequests);
+}
+#endif /* HAVE_IO_URING */
+
                         
 #ifdef HAVE_MMAP
 /* Initialize data structures required for mmap'ed I/O operations */
@@ -1316,12 +2513,33 @@ int file_do_fsync(unsigned int id, int thread_id)
   (void)thread_id; /* unused */
 #endif
 
+#ifdef HAVE_IO_URING
+  if (file_io_mode == FILE_IO_MODE_URING)
+  {
+    if (!file_uring_iopoll)
+      return file_uring_submit_or_wait(thread_id, FILE_OP_TYPE_FSYNC, id, 0, 0);
+
+    /*
+      fsync is not supported on rings with I/O polling, so wait for queued
+      writes to complete and use a synchronous one
+    */
+    if (file_uring_drain(thread_id))
+      return 1;
+  }
+#endif
+#ifdef HAVE_LIBAIO
+  /* Make sure writes queued for a batched io_submit() are issued first */
+  if (file_io_mode == FILE_IO_MODE_ASYNC && file_async_submit(thread_id))
+    return 1;
+#endif
+
   /*
     FIXME: asynchronous fsync support is missing
     in Linux kernel at the moment
   */
   if (file_io_mode == FILE_IO_MODE_SYNC
       || file_io_mode == FILE_IO_MODE_ASYNC
+      || file_io_mode == FILE_IO_MODE_URING
 #if defined(HAVE_MMAP) && SIZEOF_SIZE_T == 4
       /* Use fsync in mmaped mode on 32-bit architectures */
       || file_io_mode == FILE_IO_MODE_MMAP
@@ -1408,6 +2626,16 @@ ssize_t file_pread(unsigned int file_id, void *buf, ssize_t count,
     return count;
   }
 #endif
+#ifdef HAVE_IO_URING
+  else if (file_io_mode == FILE_IO_MODE_URING)
+  {
+    if (file_uring_submit_or_wait(thread_id, FILE_OP_TYPE_READ, file_id, count,
+                                  offset))
+      return 0;
+
+    return count;
+  }
+#endif
 #ifdef HAVE_MMAP
   else if (file_io_mode == FILE_IO_MODE_MMAP)
   {
@@ -1468,6 +2696,16 @@ ssize_t file_pwrite(unsigned int file_id, void *buf, ssize_t count,
     return count;
   }
 #endif
+#ifdef HAVE_IO_URING
+  else if (file_io_mode == FILE_IO_MODE_URING)
+  {
+    if (file_uring_submit_or_wait(thread_id, FILE_OP_TYPE_WRITE, file_id, count,
+                                  offset))
+      return 0;
+
+    return count;
+  }
+#endif
 #ifdef HAVE_MMAP
   else if (file_io_mode == FILE_IO_MODE_MMAP)
   {
@@ -1504,6 +2742,84 @@ ssize_t file_pwrite(unsigned int file_id, void *buf, ssize_t count,
 /* Parse the command line arguments */
 
 
+/*
+  Parse --file-block-size, i.e. a list of block sizes with optional relative
+  weights. Sizes without a weight have weight 1.
+*/
+
+static int parse_block_sizes(void)
+{
+  sb_list_item_t *pos;
+  unsigned int    i, total_weight = 0, weight = 0;
+
+  file_nblocks = 0;
+  file_block_size = 0;
+
+  SB_LIST_FOR_EACH(pos, sb_get_value_list("file-block-size"))
+  {
+    const char      *val = SB_LIST_ENTRY(pos, value_t, listitem)->data;
+    sb_file_block_t *b = &file_blocks[file_nblocks];
+    char            buf[64];
+    char            *c, *end;
+
+    if (file_nblocks == FILE_MAX_BLOCK_SIZES)
+    {
+      log_text(LOG_FATAL, "Too many values for file-block-size, at most %d "
+               "are supported", FILE_MAX_BLOCK_SIZES);
+      return 1;
+    }
+
+    snprintf(buf, sizeof(buf), "%s", val);
+
+    b->weight = 1;
+    if ((c = strchr(buf, ':')) != NULL)
+    {
+      *c++ = '\0';
+      b->weight = (unsigned int) strtoul(c, &end, 10);
+      if (*c < '0' || *c > '9' || *end != '\0' || b->weight == 0)
+      {
+        log_text(LOG_FATAL, "Invalid weight for file-block-size: %s", val);
+        return 1;
+      }
+    }
+
+    b->size = (long long) sb_str_to_size(buf);
+    if (b->size <= 0 || b->size > INT_MAX)
+    {
+      log_text(LOG_FATAL, "Invalid value for file-block-size: %s", val);
+      return 1;
+    }
+
+    for (i = 0; i < file_nblocks; i++)
+    {
+      if (file_blocks[i].size == b->size)
+      {
+        log_text(LOG_FATAL, "Duplicate value for file-block-size: %s", val);
+        return 1;
+      }
+    }
+
+    total_weight += b->weight;
+    file_block_size = SB_MAX(file_block_size, (int) b->size);
+    file_nblocks++;
+  }
+
+  if (file_nblocks == 0)
+  {
+    log_text(LOG_FATAL, "Missing value for file-block-size");
+    return 1;
+  }
+
+  for (i = 0; i < file_nblocks; i++)
+  {
+    weight += file_blocks[i].weight;
+    file_blocks[i].cdf = (double) weight / total_weight;
+  }
+
+  return 0;
+}
+
+
 int parse_arguments(void)
 {
   char         *mode;
@@ -1571,6 +2887,16 @@ int parse_arguments(void)
     log_text(LOG_FATAL,
              "asynchronous I/O mode is unsupported on this platform.");
     return 1;
+#endif
+  }
+  else if (!strcmp(mode, "uring"))
+  {
+#ifdef HAVE_IO_URING
+    file_io_mode = FILE_IO_MODE_URING;
+#else
+    log_text(LOG_FATAL,
+             "io_uring I/O mode is unsupported on this platform.");
+    return 1;
 #endif
   }
   else if (!strcmp(mode, "mmap"))
@@ -1597,18 +2923,25 @@ int parse_arguments(void)
     return 1;
   }
   
-  file_block_size = sb_get_value_size("file-block-size");
-  if (file_block_size <= 0)
+  if (parse_block_sizes())
+    return 1;
+
+  file_block_align = sb_get_value_size("file-block-align");
+
+  /*
+    Validation checks whole blocks written at the same offsets, so blocks must
+    never overlap
+  */
+  if (sb_globals.validate &&
+      (file_nblocks > 1 || file_block_align % file_block_size != 0))
   {
-    log_text(LOG_FATAL, "Invalid value for file-block-size: %d.",
-             file_block_size);
+    log_text(LOG_FATAL, "--validate requires a single file-block-size and "
+             "file-block-align to be a multiple of it");
     return 1;
   }
 
-  if (file_merged_requests > 0)
-    file_request_size = file_block_size * file_merged_requests;
-  else
-    file_request_size = file_block_size;
+  file_merge_factor = file_merged_requests > 0 ? file_merged_requests : 1;
+  file_request_size = (long long) file_block_size * file_merge_factor;
 
   mode = sb_get_value_string("file-extra-flags");
 
@@ -1671,7 +3004,38 @@ int parse_arguments(void)
     return 1;
   }
 
-  per_thread = malloc(sizeof(*per_thread) * sb_globals.threads);
+  file_hot_fraction = sb_get_value_double("file-hot-fraction");
+  if (file_hot_fraction < 0 || file_hot_fraction >= 1)
+  {
+    log_text(LOG_FATAL, "Invalid value for --file-hot-fraction: %f.",
+             file_hot_fraction);
+    return 1;
+  }
+
+  file_hot_probability = sb_get_value_double("file-hot-probability");
+  if (file_hot_probability < 0 || file_hot_probability > 1)
+  {
+    log_text(LOG_FATAL, "Invalid value for --file-hot-probability: %f.",
+             file_hot_probability);
+    return 1;
+  }
+
+  file_hot_size = (long long) (file_size * num_files * file_hot_fraction);
+  file_rand_uniform = !strcmp(sb_get_value_string("rand-type"), "uniform");
+  file_rnd_skewed = !file_rand_uniform || file_hot_fraction > 0;
+
+  if (file_rnd_skewed && (test_mode == MODE_RND_READ ||
+                          test_mode == MODE_RND_WRITE ||
+                          test_mode == MODE_RND_RW) &&
+      !strcmp(sb_globals.cmdname, "run") && file_units_init())
+    return 1;
+
+  per_thread = sb_alloc_per_thread_array(sizeof(*per_thread));
+  if (per_thread == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
   for (i = 0; i < sb_globals.threads; i++)
   {
     per_thread[i].buffer = sb_memalign(file_request_size, sb_getpagesize());
@@ -1683,6 +3047,45 @@ int parse_arguments(void)
     memset(per_thread[i].buffer, 0, file_request_size);
   }
 
+  if (file_nblocks > 1)
+  {
+    for (i = 0; i < file_nblocks; i++)
+      if (sb_histogram_init_hdr(&file_blocks[i].latency,
+                                sb_get_value_int("histogram-precision"),
+                                FILE_BLOCK_LAT_MIN, FILE_BLOCK_LAT_MAX))
+        return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+  Allocate the bitmap of accessed units for re-access ratios. Units are the
+  smallest block size, doubled until the bitmap fits into FILE_MAX_UNITS bits.
+*/
+
+static int file_units_init(void)
+{
+  const unsigned long long total = file_size * num_files;
+  unsigned int             i;
+
+  file_unit_size = file_blocks[0].size;
+  for (i = 1; i < file_nblocks; i++)
+    file_unit_size = SB_MIN(file_unit_size, file_blocks[i].size);
+
+  while ((total + file_unit_size - 1) / file_unit_size > FILE_MAX_UNITS)
+    file_unit_size *= 2;
+
+  file_nunits = SB_MAX((total + file_unit_size - 1) / file_unit_size, 1ULL);
+
+  file_units = calloc((file_nunits + 31) / 32, sizeof(unsigned int));
+  if (file_units == NULL)
+  {
+    log_text(LOG_FATAL, "Memory allocation failure");
+    return 1;
+  }
+
   return 0;
 }
 
@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2016-2018 Alexey Kopytov <akopytov@gmail.com>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Measure the cost of a histogram update with an increasing number of threads
+# updating the same histogram. Each thread updates its own slot, so the cost
+# should stay flat as long as there are enough CPUs.
+#
+# Usage: ./bench_histogram.sh [max_threads] [seconds]
+
+set -eu
+
+testroot=$(cd $(dirname "$0"); echo $PWD)
+sysbench=${SYSBENCH:-$testroot/../src/sysbench}
+max_threads=${1:-$(getconf _NPROCESSORS_ONLN)}
+time=${2:-3}
+
+# Number of updates per event
+nupdates=100000
+
+script=$(mktemp)
+trap 'rm -f $script' EXIT
+
+cat >$script <<EOF
+ffi.cdef[[int setenv(const char *, const char *, int);]]
+
+-- Create a histogram shared by all threads in the main Lua state
+function init()
+  h = ffi.C.sb_histogram_new(1024, 0.001, 1000)
+  ffi.C.setenv("SB_BENCH_HISTOGRAM",
+               tostring(tonumber(ffi.cast("uintptr_t", h))), 1)
+end
+
+function thread_init()
+  h = ffi.cast("sb_histogram_t *", tonumber(os.getenv("SB_BENCH_HISTOGRAM")))
+end
+
+function event()
+  for i = 1, $nupdates do
+    h:update(i % 1000)
+  end
+end
+
+-- Print the median event time divided by the number of updates per event
+sysbench.hooks.report_cumulative = function(stat)
+  print(string.format("%8u %16.2f", sysbench.opt.threads,
+                      stat.latency_pct * 1e9 / $nupdates))
+end
+EOF
+
+echo " threads  ns per update"
+
+threads=1
+while [ $threads -le $max_threads ]
+do
+  $sysbench $script --threads=$threads --time=$time --percentile=50 \
+            --verbosity=1 run
+  threads=$((threads * 2))
+done
@@ -274,3 +274,96 @@ end
 EOF
 
 sysbench $SB_ARGS
+
+cat <<EOF
+########################################################################
+# Streamed result sets
+########################################################################
+########################################################################
+EOF
+cat >$CRAMTMP/api_sql.lua <<EOF
+c = sysbench.sql.driver():connect()
+c:query("CREATE TABLE t1(a INT)")
+c:bulk_insert_init("INSERT INTO t1 VALUES")
+for i = 1, 1000 do
+  c:bulk_insert_next(string.format("(%d)", i))
+end
+c:bulk_insert_done()
+
+rs = c:query("SELECT a FROM t1 ORDER BY a")
+print(rs.streamed, rs.nrows)
+sum = 0
+r = rs:fetch_row()
+while r do
+  sum = sum + tonumber(r[1])
+  r = rs:fetch_row()
+end
+print(sum, rs.nrows)
+
+-- Unread rows are discarded
+rs = c:query("SELECT a FROM t1 ORDER BY a")
+print(rs:fetch_row()[1])
+rs:free()
+print(c:query_row("SELECT COUNT(*) FROM t1"))
+print(c:query_row("SELECT a FROM t1 WHERE a < 0"))
+
+c:query("DROP TABLE t1")
+EOF
+
+sysbench --db-stream-results $SB_ARGS
+
+cat <<EOF
+########################################################################
+# Bound result buffers
+########################################################################
+EOF
+cat >$CRAMTMP/api_sql.lua <<EOF
+c = sysbench.sql.driver():connect()
+c:query("CREATE TABLE t1(a INT, b VARCHAR(10), c DOUBLE PRECISION)")
+c:query("INSERT INTO t1 VALUES (1, 'one', 0.5), (2, NULL, 1.5), (3, 'three', NULL)")
+
+stmt = c:prepare("SELECT a, b, c FROM t1 WHERE a >= ? ORDER BY a")
+p = stmt:bind_create(sysbench.sql.type.INT)
+a = stmt:bind_create(sysbench.sql.type.INT)
+b = stmt:bind_create(sysbench.sql.type.VARCHAR, 3)
+d = stmt:bind_create(sysbench.sql.type.DOUBLE)
+stmt:bind_param(p)
+stmt:bind_result(a, b, d)
+
+for _, v in ipairs({2, 4}) do
+  p:set(v)
+  rs = stmt:execute()
+  while rs:fetch() do
+    print(a:get(), b:get(), d:get())
+  end
+  print('--')
+end
+
+stmt:close()
+c:query("DROP TABLE t1")
+EOF
+
+sysbench $SB_ARGS
+
+cat <<EOF
+########################################################################
+# Connection pools
+########################################################################
+EOF
+cat >$CRAMTMP/api_sql.lua <<EOF
+pool = sysbench.sql.driver():pool(2)
+c1 = pool:checkout()
+c2 = pool:checkout()
+print(pcall(pool.checkout, pool))
+
+-- Idle connections are reused
+pool:checkin(c1)
+print(pool:checkout() == c1)
+
+-- Closed connections are replaced with new ones
+c2:disconnect()
+pool:checkin(c2)
+print(pool:checkout():query_row("SELECT 1"))
+EOF
+
+sysbench $SB_ARGS
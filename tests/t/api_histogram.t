@@ -19,3 +19,72 @@ Tests for histogram API
          2.001 |********************                     1
          4.997 |********************                     1
         10.000 |**************************************** 2
+
+Concurrent updates are merged into cumulative values exactly once, when
+intermediate, cumulative and checkpoint merges are interleaved with updates
+
+  $ cat >$CRAMTMP/merge.lua <<EOF
+  > ffi.cdef[[
+  > int setenv(const char *, const char *, int);
+  > void sb_histogram_get_pcts_intermediate(sb_histogram_t *h,
+  >                                         const double *percentiles, size_t n,
+  >                                         double *res);
+  > void sb_histogram_get_pcts_cumulative(sb_histogram_t *h,
+  >                                       const double *percentiles, size_t n,
+  >                                       double *res);
+  > uint64_t sb_histogram_get_pcts_checkpoint(sb_histogram_t *h,
+  >                                           const double *percentiles,
+  >                                           size_t n, double *res);
+  > ]]
+  > 
+  > local pct = ffi.new("double[1]", 95)
+  > local res = ffi.new("double[1]")
+  > local merged = 0
+  > 
+  > -- Create a histogram shared by all threads in the main Lua state
+  > function init()
+  >   h = ffi.C.sb_histogram_new(1024, 0.001, 1000)
+  >   ffi.C.setenv("SBTEST_HISTOGRAM",
+  >                tostring(tonumber(ffi.cast("uintptr_t", h))), 1)
+  > end
+  > 
+  > function thread_init()
+  >   h = ffi.cast("sb_histogram_t *", tonumber(os.getenv("SBTEST_HISTOGRAM")))
+  > end
+  > 
+  > -- Each event is one update. Thread 0 also merges updates of other threads.
+  > function event(thread_id)
+  >   h:update(sysbench.rand.uniform_double() * 100)
+  > 
+  >   if thread_id == 0 then
+  >     local r = sysbench.rand.uniform(1, 3)
+  >     if r == 1 then
+  >       ffi.C.sb_histogram_get_pcts_intermediate(h, pct, 1, res)
+  >     elseif r == 2 then
+  >       ffi.C.sb_histogram_get_pcts_cumulative(h, pct, 1, res)
+  >     else
+  >       merged = merged +
+  >         tonumber(ffi.C.sb_histogram_get_pcts_checkpoint(h, pct, 1, res))
+  >     end
+  >   end
+  > end
+  > 
+  > function thread_done(thread_id)
+  >   if thread_id == 0 then
+  >     print("checkpoints: " .. merged)
+  >   end
+  > end
+  > 
+  > -- Merge the remaining updates after all threads are done
+  > function done()
+  >   print("final: " ..
+  >         tonumber(ffi.C.sb_histogram_get_pcts_checkpoint(h, pct, 1, res)))
+  > end
+  > EOF
+
+  $ sysbench $CRAMTMP/merge.lua --threads=16 --events=1000000 --time=0 run |
+  >   awk '/^checkpoints:/ { merged += $2 }
+  >        /^final:/ { merged += $2 }
+  >        /total number of events:/ { events = $5 }
+  >        END { print (merged == events) ? "ok" : merged " != " events }'
+  ok
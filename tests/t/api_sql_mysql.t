@@ -133,6 +133,28 @@ SQL Lua API + MySQL tests
   ########################################################################
   1
   2
+  ########################################################################
+  # Streamed result sets
+  ########################################################################
+  true	0
+  500500	1000
+  1
+  1000
+  nil
+  ########################################################################
+  # Bound result buffers
+  ########################################################################
+  2	nil	1.5
+  3	thr	nil
+  --
+  --
+  ########################################################################
+  # Connection pools
+  ########################################################################
+  FATAL: all 2 connections of the pool are checked out
+  false	connection checkout failed
+  true
+  1
 ########################################################################
 # GH-304: Benchmark Stored Procedure with sysbench
 ########################################################################
@@ -191,3 +213,110 @@ SQL Lua API + MySQL tests
   1
   1
   done
+########################################################################
+# Emulated statements escape backslashes unless NO_BACKSLASH_ESCAPES is set
+########################################################################
+  $ cat >api_sql.lua <<EOF
+  >   con = sysbench.sql.driver():connect()
+  >  
+  >   con:query("DROP TABLE IF EXISTS t1")
+  >   con:query("CREATE TABLE t1(a VARCHAR(10))")
+  >  
+  >   stmt = con:prepare("INSERT INTO t1 VALUES(?)")
+  >   param = stmt:bind_create(sysbench.sql.type.VARCHAR, 10)
+  >   stmt:bind_param(param)
+  >   param:set([[a\\b'c]])
+  >  
+  >   stmt:execute()
+  >   con:query("SET SESSION sql_mode = CONCAT(@@sql_mode, ',NO_BACKSLASH_ESCAPES')")
+  >   stmt:execute()
+  >  
+  >   rs = con:query("SELECT a, LENGTH(a) FROM t1")
+  >   for i = 1, rs.nrows do
+  >      print(unpack(rs:fetch_row(), 1, rs.nfields))
+  >   end
+  >  
+  >   con:query("DROP TABLE t1")
+  > EOF
+
+  $ sysbench $DB_DRIVER_ARGS --db-ps-mode=disable --verbosity=1 api_sql.lua
+  a\\b'c\t5 (esc)
+  a\\b'c\t5 (esc)
+########################################################################
+# --clients with a client library lacking non-blocking connections
+########################################################################
+  $ cat >clients.lua <<EOF
+  > function thread_init()
+  >    con = sysbench.sql.driver():connect()
+  > end
+  > function event()
+  >    con:query("SELECT 1")
+  > end
+  > EOF
+
+  $ args="$DB_DRIVER_ARGS --clients=2 --events=10 --verbosity=1 clients.lua run"
+  $ if sysbench $args 2>&1 | grep -q "requires non-blocking connections"
+  > then
+  >   sysbench $args --clients-blocking
+  > fi
+  $ unset args
+########################################################################
+# Non-blocking connections
+########################################################################
+
+Skip the rest of the test if the client library does not provide the
+non-blocking API
+
+  $ cat >api_sql.lua <<EOF
+  > print(ffi.C.db_async_supported(sysbench.sql.driver()))
+  > EOF
+  $ if [ "$(sysbench $DB_DRIVER_ARGS --verbosity=1 api_sql.lua)" != "true" ]
+  > then
+  >   exit 80
+  > fi
+
+  $ cat >api_sql.lua <<EOF
+  > ffi.cdef[[int sb_poll_fd(int fd, int events, int timeout_ms);]]
+  >  
+  > function connect()
+  >    local drv = sysbench.sql.driver()
+  >    return drv:connect_async()
+  > end
+  >  
+  > results = {}
+  >  
+  > function client(con, n)
+  >    for i = 1, 3 do
+  >       results[#results + 1] = con:query_row("SELECT " .. n .. " * " .. i)
+  >    end
+  > end
+  >  
+  > sysbench.sql.async_yield = true
+  > clients = {}
+  > for n = 1, 2 do
+  >    local con = connect()
+  >    clients[n] = { con = con, co = coroutine.create(client) }
+  >    assert(coroutine.resume(clients[n].co, con, n))
+  >    -- The client must be suspended waiting for the server, which would not
+  >    -- happen with a blocking connection
+  >    assert(coroutine.status(clients[n].co) == "suspended")
+  > end
+  >  
+  > repeat
+  >    local active = false
+  >    for _, c in ipairs(clients) do
+  >       if coroutine.status(c.co) == "suspended" then
+  >          active = true
+  >          local events = ffi.C.sb_poll_fd(c.con:async_fd(),
+  >                                          c.con:async_events(), -1)
+  >          assert(coroutine.resume(c.co, events))
+  >       end
+  >    end
+  > until not active
+  >  
+  > table.sort(results, function(a, b) return tonumber(a) < tonumber(b) end)
+  > print(table.concat(results, " "))
+  > EOF
+
+  $ sysbench $DB_DRIVER_ARGS --verbosity=1 api_sql.lua
+  1 2 2 3 4 6
@@ -138,3 +138,66 @@ SQL Lua API + PostgreSQL tests
   ########################################################################
   1
   2
+  ########################################################################
+  # Streamed result sets
+  ########################################################################
+  true	0
+  500500	1000
+  1
+  1000
+  nil
+  ########################################################################
+  # Bound result buffers
+  ########################################################################
+  2	nil	1.5
+  3	thr	nil
+  --
+  --
+  ########################################################################
+  # Connection pools
+  ########################################################################
+  FATAL: all 2 connections of the pool are checked out
+  false	connection checkout failed
+  true
+  1
+########################################################################
+# Pipeline mode
+########################################################################
+  $ cat >api_sql.lua <<EOF
+  >   con = sysbench.sql.driver():connect()
+  >  
+  >   con:query("DROP TABLE IF EXISTS t1")
+  >   con:query("CREATE TABLE t1(a INT PRIMARY KEY)")
+  >  
+  >   stmt = con:prepare("INSERT INTO t1 VALUES(?)")
+  >   param = stmt:bind_create(sysbench.sql.type.INT)
+  >   stmt:bind_param(param)
+  >  
+  >   con:pipeline()
+  >   for i = 1, 3 do
+  >      param:set(i)
+  >      stmt:execute_async()
+  >   end
+  >   print(pcall(con.query, con, "SELECT 1") == false)
+  >   con:pipeline_end()
+  >   print(con:query_row("SELECT COUNT(*) FROM t1"))
+  >  
+  >   -- A failed statement aborts the entire pipeline
+  >   con:pipeline()
+  >   for _, i in ipairs({10, 1, 11}) do
+  >      param:set(i)
+  >      stmt:execute_async()
+  >   end
+  >   e, m = pcall(con.pipeline_end, con)
+  >   print(m.sql_state)
+  >   print(con:query_row("SELECT COUNT(*) FROM t1"))
+  >  
+  >   con:query("DROP TABLE t1")
+  > EOF
+
+  $ sysbench $DB_DRIVER_ARGS --verbosity=1 api_sql.lua
+  ALERT: attempt to execute a synchronous call in pipeline mode
+  true
+  3
+  23505
+  3
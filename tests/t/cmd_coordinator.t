@@ -0,0 +1,81 @@
+########################################################################
+# Distributed mode tests
+########################################################################
+
+  $ sysbench coordinator
+  sysbench * (glob)
+  
+  FATAL: --dist-coordinator is required for the 'coordinator' command
+  [1]
+
+  $ sysbench --dist-coordinator=$CRAMTMP/sb.sock --dist-agents=0 coordinator
+  sysbench * (glob)
+  
+  FATAL: Invalid value for --dist-agents: 0
+  [1]
+
+Files other than sockets are never removed
+
+  $ echo data > $CRAMTMP/regular
+  $ sysbench --dist-coordinator=$CRAMTMP/regular coordinator
+  sysbench * (glob)
+  
+  FATAL: Cannot listen on '*/regular' for --dist-coordinator errno = 98 (Address already in use) (glob)
+  [1]
+  $ cat $CRAMTMP/regular
+  data
+
+Run a coordinator and 3 agents with a fixed number of events each
+
+  $ sysbench --dist-coordinator=$CRAMTMP/sb.sock --dist-agents=3 \
+  >   --percentile=50,max coordinator > $CRAMTMP/coordinator.log &
+  $ for i in 1 2 3; do
+  >   sysbench --dist-coordinator=$CRAMTMP/sb.sock cpu --threads=$i \
+  >     --events=100 --time=0 run > $CRAMTMP/agent$i.log &
+  > done; wait
+
+  $ grep -c '^Connected to the coordinator' $CRAMTMP/agent*.log
+  */agent1.log:1 (glob)
+  */agent2.log:1 (glob)
+  */agent3.log:1 (glob)
+
+  $ sed -n '/^Waiting/,$p' $CRAMTMP/coordinator.log
+  Waiting for 3 agent(s) on '*/sb.sock'... (glob)
+  Agent #0 connected, threads: *, rate: 0 (glob)
+  Agent #1 connected, threads: *, rate: 0 (glob)
+  Agent #2 connected, threads: *, rate: 0 (glob)
+  Benchmark started on 3 agent(s)!
+  
+  Merged statistics from 3 agent(s), 6 thread(s) total:
+  
+  Throughput:
+      events/s (eps): * (glob)
+      time elapsed: *s (glob)
+      total number of events:              300
+  
+  Latency (ms):
+           min: * (glob)
+           avg: * (glob)
+           max: * (glob)
+           50th percentile: * (glob)
+            max percentile: * (glob)
+           sum: * (glob)
+  
+
+Merged intermediate reports. Intervals and totals exclude warmup.
+
+  $ sysbench --dist-coordinator=$CRAMTMP/sb.sock --dist-agents=2 \
+  >   --report-interval=1 coordinator > $CRAMTMP/coordinator.log &
+  $ for i in 1 2; do
+  >   sysbench --dist-coordinator=$CRAMTMP/sb.sock cpu --time=3 \
+  >     --warmup-time=1 run > $CRAMTMP/agent$i.log &
+  > done; wait
+
+  $ grep '^\[ 1s \]' $CRAMTMP/coordinator.log
+  [ 1s ] agents: 2 thds: 2 eps: *.* qps: * lat (ms,95%): *.* err/s: * (glob)
+  $ grep '^\[ 2s \]' $CRAMTMP/coordinator.log
+  [ 2s ] agents: 2 thds: 2 eps: *.* qps: * lat (ms,95%): *.* err/s: * (glob)
+  $ events() { awk '/total number of events/ { s += $NF } END { print s }' "$@"; }
+  $ test "$(events $CRAMTMP/agent1.log $CRAMTMP/agent2.log)" = \
+  >   "$(events $CRAMTMP/coordinator.log)" && echo equal
+  equal
@@ -0,0 +1,53 @@
+########################################################################
+# --save-results and merge-results tests
+########################################################################
+
+  $ sysbench merge-results
+  sysbench * (glob)
+  
+  The 'merge-results' command requires a list of results files saved with --save-results
+  [1]
+
+  $ sysbench merge-results $CRAMTMP/nonexistent.res
+  sysbench * (glob)
+  
+  FATAL: Cannot open the results file '*/nonexistent.res'* (glob)
+  [1]
+
+  $ echo "not a results file" > $CRAMTMP/bad.res
+  $ sysbench merge-results $CRAMTMP/bad.res
+  sysbench * (glob)
+  
+  FATAL: '*/bad.res' is not a sysbench results file (glob)
+  [1]
+
+  $ sysbench cpu --events=100 --time=0 --save-results=$CRAMTMP/r1.res run |
+  >   grep 'total number of events'
+      total number of events:              100
+  $ sysbench cpu --events=150 --threads=2 --time=0 \
+  >   --save-results=$CRAMTMP/r2.res run | grep 'total number of events'
+      total number of events:              150
+
+  $ sysbench --histogram-precision=3 merge-results $CRAMTMP/r1.res
+  sysbench * (glob)
+  
+  FATAL: '*/r1.res' was saved with --histogram-precision=2, use the same value to merge it (glob)
+  [1]
+
+  $ sysbench --percentile=50 merge-results $CRAMTMP/r1.res $CRAMTMP/r2.res
+  sysbench * (glob)
+  
+  Merged statistics from 2 file(s), 3 thread(s) total:
+  
+  Throughput:
+      events/s (eps): * (glob)
+      time elapsed: * (glob)
+      total number of events:              250
+  
+  Latency (ms):
+           min: * (glob)
+           avg: * (glob)
+           max: * (glob)
+           50th percentile: * (glob)
+           sum: * (glob)
+  
@@ -413,6 +413,38 @@ Command line options tests
   Unknown command: cmd3
   [1]
 
+  $ cat >cmdline.lua <<EOF
+  > ffi.cdef "unsigned int sleep(unsigned int);"
+  > function cmd_func()
+  >   if sysbench.tid == 2 then error("thread 2 failed") end
+  >   ffi.C.sleep(sysbench.tid % 2)
+  >   print("before barrier, sysbench.tid = " .. sysbench.tid)
+  >   sysbench.cmdline.barrier()
+  >   if sysbench.tid == 0 then ffi.C.sleep(1) end
+  >   print("after barrier, sysbench.tid = " .. sysbench.tid)
+  > end
+  > sysbench.cmdline.commands = {
+  >   cmd = { cmd_func, sysbench.cmdline.PARALLEL_COMMAND }
+  > }
+  > EOF
+
+  $ sysbench --threads=3 cmdline.lua cmd 2>&1
+  sysbench * (glob)
+  
+  Initializing worker threads...
+  
+  FATAL: `sysbench.cmdline.call_command' function failed: cmdline.lua:3: thread 2 failed
+  before barrier, sysbench.tid = 0
+  before barrier, sysbench.tid = 1
+  after barrier, sysbench.tid = 1
+  after barrier, sysbench.tid = 0
+
+  $ sysbench cmdline.lua cmd
+  sysbench * (glob)
+  
+  before barrier, sysbench.tid = 0
+  after barrier, sysbench.tid = 0
+
   $ cat >cmdline.lua <<EOF
   > sysbench.cmdline.options = { opt1 = {"opt1"}, opt2 = {"opt2"} }
   > function print_cmd()
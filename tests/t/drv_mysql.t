@@ -25,6 +25,11 @@ MySQL driver tests
       queries:                             10     (*.* per sec.) (glob)
       ignored errors:                      0      (0.00 per sec.)
       reconnects:                          0      (0.00 per sec.)
+      connections:                         2      (*.* per sec.) (glob)
+  
+  Connect latency (ms):
+           avg: *.* (glob)
+           95th percentile: *.* (glob)
   
   Throughput:
       events/s (eps): *.* (glob)
@@ -13,6 +13,9 @@ Skip test if the MySQL driver is not available.
     --mysql-host=[LIST,...]               MySQL server host [localhost]
     --mysql-port=[LIST,...]               MySQL server port [3306]
     --mysql-socket=[LIST,...]             MySQL socket
+    --mysql-balance=STRING                method of choosing a server from the --mysql-host/--mysql-port or --mysql-socket lists for new connections {rr, weighted, least-conn} [rr]
+    --mysql-weights=[LIST,...]            list of server weights for --mysql-balance=weighted and least-conn, one for each server
+    --mysql-retry-interval=N              number of seconds a failed server is not used for new connections, unless all servers have failed [5]
     --mysql-user=STRING                   MySQL user [sbtest]
     --mysql-password=STRING               MySQL password []
     --mysql-db=STRING                     MySQL database name [sbtest]
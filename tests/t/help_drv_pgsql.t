@@ -13,4 +13,5 @@ Skip test if the PostgreSQL driver is not available.
     --pgsql-password=STRING PostgreSQL password []
     --pgsql-db=STRING       PostgreSQL database name [sbtest]
     --pgsql-sslmode=STRING  PostgreSQL SSL mode (disable, allow, prefer, require, verify-ca, verify-full) [prefer]
+    --pgsql-binary[=on|off] Use the binary format for numeric, timestamp and string parameters and bound results of prepared statements [on]
   
@@ -0,0 +1,40 @@
+########################################################################
+--clients tests
+########################################################################
+
+  $ cat >$CRAMTMP/clients.lua <<EOF
+  > function thread_init(id)
+  >   client_id = id
+  >   nevents = 0
+  > end
+  > function event(id)
+  >   assert(client_id == id)
+  >   nevents = nevents + 1
+  > end
+  > function thread_done(id)
+  >   print(string.format("client %d: tid = %d, events = %d", client_id,
+  >                       sysbench.tid, nevents))
+  > end
+  > EOF
+
+  $ sysbench --clients=-1 $CRAMTMP/clients.lua run
+  FATAL: Invalid value for --clients: -1. Must be 0 or at least --threads
+  [1]
+
+  $ sysbench --clients=1 --threads=2 $CRAMTMP/clients.lua run
+  FATAL: Invalid value for --clients: 1. Must be 0 or at least --threads
+  [1]
+
+  $ sysbench --clients=2 --rate=10 $CRAMTMP/clients.lua run
+  FATAL: --rate is not supported with --clients
+  [1]
+
+  $ sysbench --clients=3 --events=30 --verbosity=1 $CRAMTMP/clients.lua run
+  client 0: tid = 0, events = 10
+  client 1: tid = 0, events = 10
+  client 2: tid = 0, events = 10
+
+  $ sysbench --clients=5 --threads=2 --events=100 $CRAMTMP/clients.lua run |
+  >   grep -E "clients|total number of events"
+  Number of clients: 5
+      total number of events:              100
@@ -13,6 +13,8 @@ separately.
   
   General options:
     --threads=N                     number of threads to use [1]
+    --clients=N                     number of clients to simulate by running Lua script events as coroutines multiplexed over worker threads. Requires a database driver with non-blocking connections to be effective. 0 runs a single client per thread [0]
+    --clients-blocking[=on|off]     allow --clients with database drivers that do not support non-blocking connections. Clients of a thread then wait for each other's queries [off]
     --events=N                      limit for total number of events [0]
     --time=N                        limit for total execution time in seconds [10]
     --warmup-time=N                 execute events for this many seconds with statistics disabled before the actual benchmark run with statistics enabled [0]
@@ -20,7 +22,8 @@ separately.
     --thread-stack-size=SIZE        size of stack per thread [64K]
     --thread-init-timeout=N         wait time in seconds for worker threads to initialize [30]
     --rate=N                        average transactions rate. 0 for unlimited rate [0]
-    --report-interval=N             periodically report intermediate statistics with a specified interval in seconds. 0 disables intermediate reports [0]
+    --report-interval=N             periodically report intermediate statistics with a specified interval in seconds. Fractional values down to 0.001 can be used for sub-second intervals. 0 disables intermediate reports [0]
+    --report-compact[=on|off]       print intermediate reports as lines of space-separated values following a single header line. Overrides report hooks of Lua scripts [off]
     --report-checkpoints=[LIST,...] dump full statistics and reset all counters at specified points in time. The argument is a list of comma-separated values representing the amount of time in seconds elapsed from start of test when report checkpoint(s) must be performed. Report checkpoints are off by default. []
     --debug[=on|off]                print more debugging info [off]
     --validate[=on|off]             perform validation checks where possible [off]
@@ -38,14 +41,32 @@ separately.
   Log options:
     --verbosity=N verbosity level {5 - debug, 0 - only critical messages} [3]
   
-    --percentile=N       percentile to calculate in latency statistics (1-100). Use the special value of 0 to disable percentile calculations [95]
-    --histogram[=on|off] print latency histogram in report [off]
+    --percentile=[LIST,...] comma-separated list of percentiles to calculate in latency statistics (0-100, fractional values are allowed, 'max' is the same as 100). Use the special value of 0 to disable percentile calculations [95]
+    --histogram[=on|off]    print latency histogram in report [off]
+    --histogram-precision=N number of significant decimal digits to maintain in latency histograms (1-5). Higher values improve accuracy of percentile calculations at the cost of memory usage [2]
+  
+  Latency trace options:
+    --latency-trace=STRING           write a record with the start time, thread ID, latency and type of each executed event to the specified binary file. The file can be analyzed with the 'trace-summary' command
+    --latency-trace-buffer-size=SIZE size of the per-thread buffer for latency trace records. Records are dropped when a buffer is full [4M]
+  
+  Metrics exporter options:
+    --metrics-listen=STRING serve live statistics in the Prometheus text format over HTTP on the specified [host:]port
+  
+  Distributed mode options:
+    --dist-coordinator=STRING coordinator address in distributed mode, [host:]port or a Unix socket path. The 'coordinator' command listens on this address, other commands connect to it as agents
+    --dist-agents=N           number of agents the 'coordinator' command waits for before starting the benchmark [1]
+  
+  Results options:
+    --save-results=STRING save statistics to the specified file at the end of the run. Files from multiple runs can be combined with the 'merge-results' command
   
   General database options:
   
-    --db-driver=STRING  specifies database driver to use \('help' to get list of available drivers\)( \[mysql\])? (re)
-    --db-ps-mode=STRING prepared statements usage mode {auto, disable} [auto]
-    --db-debug[=on|off] print database-specific debug information [off]
+    --db-driver=STRING           specifies database driver to use \('help' to get list of available drivers\)( \[mysql\])? (re)
+    --db-ps-mode=STRING          prepared statements usage mode {auto, disable} [auto]
+    --db-debug[=on|off]          print database-specific debug information [off]
+    --db-stream-results[=on|off] fetch result sets from the server row by row rather than buffering them in client memory [off]
+    --db-pool-size=N             maximum number of connections in connection pools opened by scripts, 0 disables pooling [0]
+    --db-pool-scope=STRING       connection pools scope {thread, global} [thread]
   
   
     fileio - File I/O test
@@ -49,3 +49,39 @@
       events (avg/stddev):           1.0000/0.00
       execution time (avg/stddev):   */* (glob)
   
+
+########################################################################
+--histogram-precision tests
+########################################################################
+
+  $ sysbench --histogram-precision=0 cpu run
+  FATAL: Invalid value for --histogram-precision: 0
+  [1]
+
+  $ sysbench --histogram-precision=6 cpu run
+  FATAL: Invalid value for --histogram-precision: 6
+  [1]
+
+Percentiles are resolved to a fraction of a microsecond for sub-millisecond
+latencies
+
+  $ cat >$CRAMTMP/spin.lua <<EOF
+  > ffi.cdef[[
+  >   struct sb_test_timespec { long tv_sec; long tv_nsec; };
+  >   int clock_gettime(int, struct sb_test_timespec *);
+  > ]]
+  > local ts = ffi.new("struct sb_test_timespec")
+  > local function now()
+  >   ffi.C.clock_gettime(1, ts) -- CLOCK_MONOTONIC
+  >   return tonumber(ts.tv_sec) * 1e9 + tonumber(ts.tv_nsec)
+  > end
+  > function event()
+  >   local deadline = now() + 250000
+  >   while now() < deadline do end
+  > end
+  > sysbench.hooks.report_cumulative = function(stat)
+  >   print(string.format("%.4f", stat.latency_pct * 1000))
+  > end
+  > EOF
+  $ sysbench $CRAMTMP/spin.lua --events=200 --percentile=50 --histogram-precision=3 --verbosity=1 run
+  0\.25[0-4][0-9] (re)
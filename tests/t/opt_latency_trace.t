@@ -0,0 +1,40 @@
+########################################################################
+--latency-trace and trace-summary tests
+########################################################################
+
+  $ sysbench cpu --cpu-max-prime=1000 --events=100 --latency-trace=$CRAMTMP/trace.bin run > /dev/null
+
+# 16-byte header + 24 bytes per event
+  $ wc -c < $CRAMTMP/trace.bin | tr -d ' '
+  2416
+
+  $ sysbench --latency-trace=$CRAMTMP/trace.bin --percentile=50,max trace-summary | sed -e '/trace file:/d'
+  sysbench * (glob)
+  
+  Latency trace summary:
+      threads:                             1
+      total number of events:              100
+  
+  Latency (ms):
+           min: *.* (glob)
+           avg: *.* (glob)
+           max: *.* (glob)
+           50th percentile: *.* (glob)
+            max percentile: *.* (glob)
+           sum: *.* (glob)
+
+  $ sysbench --latency-trace=$CRAMTMP/trace.bin --report-interval=1000 trace-summary | grep '^\['
+  [ 1000s ] events: 100 eps: 0.10 lat (ms,95%): *.* max: *.* (glob)
+
+  $ sysbench trace-summary
+  sysbench * (glob)
+  
+  The 'trace-summary' command requires a trace file specified with --latency-trace
+  [1]
+
+  $ echo garbage > $CRAMTMP/garbage.bin
+  $ sysbench --latency-trace=$CRAMTMP/garbage.bin trace-summary
+  sysbench * (glob)
+  
+  FATAL: '*/garbage.bin' is not a valid latency trace file (glob)
+  [1]
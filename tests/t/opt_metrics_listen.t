@@ -0,0 +1,33 @@
+########################################################################
+--metrics-listen tests
+########################################################################
+
+  $ sysbench cpu run --time=1 --metrics-listen=127.0.0.1:notaport 2>&1 | grep FATAL
+  FATAL: Invalid value for --metrics-listen: '127.0.0.1:notaport' (*) (glob)
+
+Scrape live statistics over a Unix socket. Skip if curl is not available.
+
+  $ if ! command -v curl >/dev/null 2>&1
+  > then
+  >   exit 80
+  > fi
+
+  $ sock=$CRAMTMP/metrics.sock
+  $ sysbench cpu --cpu-max-prime=1000 --time=3 --metrics-listen=$sock run > /dev/null &
+  $ for i in $(seq 50); do [ -S $sock ] && break; sleep 0.1; done
+  $ sleep 1
+  $ curl -s --unix-socket $sock http://localhost/metrics > $CRAMTMP/metrics.txt
+  $ curl -s -o /dev/null -w "%{http_code}\n" --unix-socket $sock http://localhost/foo
+  404
+  $ wait
+
+  $ grep -E "^(# TYPE )?sysbench_(events_total|latency_seconds)( |\{)" $CRAMTMP/metrics.txt
+  # TYPE sysbench_events_total counter
+  sysbench_events_total [1-9][0-9]* (re)
+  # TYPE sysbench_latency_seconds summary
+  sysbench_latency_seconds{quantile="0.95"} [0-9.e+-]+ (re)
+  $ grep -E "^sysbench_latency_seconds_(sum|count) " $CRAMTMP/metrics.txt
+  sysbench_latency_seconds_sum [0-9.e+-]+ (re)
+  sysbench_latency_seconds_count [1-9][0-9]* (re)
+  $ test -e $sock
+  [1]
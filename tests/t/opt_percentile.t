@@ -0,0 +1,35 @@
+########################################################################
+--percentile tests
+########################################################################
+
+  $ sysbench --percentile=101 cpu run --verbosity=1
+  FATAL: Invalid value for --percentile: '101'
+  [1]
+
+  $ sysbench --percentile=foo cpu run --verbosity=1
+  FATAL: Invalid value for --percentile: 'foo'
+  [1]
+
+  $ sysbench --percentile=1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17 cpu run --verbosity=1
+  FATAL: Too many values in --percentile (up to 16 can be defined)
+  [1]
+
+# Multiple percentiles are sorted and deduplicated
+  $ sysbench --percentile=max,99.9,50,50 cpu run --events=100 --time=0 | grep percentile
+           50th percentile:                        *.* (glob)
+         99.9th percentile:                        *.* (glob)
+            max percentile:                        *.* (glob)
+
+  $ cat >$CRAMTMP/percentile.lua <<EOF
+  > ffi.cdef[[int usleep(unsigned int);]]
+  > function event()
+  >   ffi.C.usleep(1000)
+  > end
+  > sysbench.hooks.report_intermediate = sysbench.report_default
+  > EOF
+
+  $ sysbench $CRAMTMP/percentile.lua --percentile=50,99,max --time=3 --report-interval=2 --verbosity=1 run
+  \[ 2s \] thds: 1 tps: [0-9]*\.[0-9]* qps: 0\.00 \(r\/w\/o: 0\.00\/0\.00\/0\.00\) lat \(ms,50%\/99%\/max\): [1-9][0-9]*\.[0-9]*\/[1-9][0-9]*\.[0-9]*\/[1-9][0-9]*\.[0-9]* err\/s 0\.00 reconn\/s: 0\.00 (re)
+
+  $ sysbench --percentile=0 cpu run --events=10 --time=0 | grep percentile
+           percentile stats:               disabled
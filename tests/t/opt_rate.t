@@ -6,3 +6,36 @@ Tests for the --rate option (aka the limited rate mode)
   $ sysbench --rate=2000000000 cpu run --verbosity=1
   FATAL: The event queue is full. This means the worker threads are unable to keep up with the specified event generation rate
   [1]
+
+# Response time (from the intended event start time) is reported along with
+# event execution latency
+  $ sysbench --rate=100 cpu run --time=1 --cpu-max-prime=1000 | sed -n '/^Latency/,/^Threads fairness/p'
+  Latency (ms):
+           min: *.* (glob)
+           avg: *.* (glob)
+           max: *.* (glob)
+           95th percentile: *.* (glob)
+           sum: *.* (glob)
+  
+  Response time (ms):
+           95th percentile: *.* (glob)
+  
+  Threads fairness:
+
+# The target rate is delivered when some events are slow. Overdue events of a
+# busy thread are picked up by idle threads without waiting for their own next
+# scheduled event, so response time stays close to execution latency
+  $ cat >$CRAMTMP/slow.lua <<EOF
+  > ffi.cdef[[int usleep(unsigned int);]]
+  > function event(thread_id)
+  >   if thread_id == 0 then
+  >     ffi.C.usleep(50000)
+  >   end
+  > end
+  > EOF
+  $ sysbench $CRAMTMP/slow.lua --threads=4 --rate=400 --time=3 --percentile=90 run |
+  >   awk '/events\/s/ { print ($3 > 340 && $3 < 460) ? "rate ok" : "rate " $3 }
+  >        /^Response time/ { resp = 1 }
+  >        resp && /percentile/ { print ($3 < 2) ? "response ok" : "response " $3 }'
+  rate ok
+  response ok
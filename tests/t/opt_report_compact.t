@@ -0,0 +1,19 @@
+########################################################################
+# Sub-second --report-interval and --report-compact tests
+########################################################################
+
+  $ sysbench cpu --report-interval=0.25 --time=1 run | grep '^\[ 0.5'
+  [ 0.5?s ] thds: 1 eps: * lat (ms,95%): * (glob)
+
+  $ sysbench cpu --report-interval=0.0001 run
+  FATAL: Invalid value for --report-interval: 0.0001. Must be 0 or at least 0.001
+  [1]
+
+  $ sysbench cpu --report-interval=0.1 --report-compact --percentile=50,max --time=1 run | sed -n '/^time /,$p' | head -3
+  time thds eps qps err/s reconn/s lat50 latmax
+  0.* 1 * 0.00 0.00 0.00 *.* *.* (glob)
+  0.* 1 * 0.00 0.00 0.00 *.* *.* (glob)
+
+  $ sysbench cpu --report-interval=0.1 --report-compact --rate=100 --time=1 run | sed -n '/^time /,$p' | head -2
+  time thds eps qps err/s reconn/s lat95 queue conc lag resp95
+  0.* 1 * 0.00 0.00 0.00 *.* * * *.* *.* (glob)
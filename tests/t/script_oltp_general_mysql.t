@@ -21,3 +21,31 @@
 
   $ sysbench $ARGS cleanup
   Dropping table 'sbtest1'...
+
+Batched SELECT queries are still accounted per statement
+
+  $ sysbench $ARGS prepare
+  Creating table 'sbtest1'...
+  Inserting 10000 records into 'sbtest1'
+  Creating a secondary index on 'sbtest1'...
+
+  $ BATCH_ARGS="oltp_read_write ${DB_DRIVER_ARGS} ${SB_EXTRA_ARGS} --events=10"
+  $ sysbench $BATCH_ARGS --point_selects_batch=multi \
+  >   --range_selects_batch=multi run | grep -E "(read|write|other):"
+          read:                            140
+          write:                           40
+          other:                           20
+  $ sysbench $BATCH_ARGS --point_selects_batch=in \
+  >   --range_selects_batch=multi run | grep -E "(read|write|other):"
+          read:                            140
+          write:                           40
+          other:                           20
+  $ sysbench $BATCH_ARGS --rw_split run | grep -E "(read|write|other):"
+          read:                            140
+          write:                           40
+          other:                           20
+  $ sysbench $BATCH_ARGS --rw_split --pipeline run 2>&1 | grep rw_split
+  FATAL: `thread_init' function failed: */oltp_common.lua:*: --rw_split cannot be used with --pipeline (glob)
+
+  $ sysbench $ARGS cleanup
+  Dropping table 'sbtest1'...
@@ -7,6 +7,7 @@ OLTP usage information test
   
   oltp_read_write.lua options:
     --auto_inc[=on|off]           Use AUTO_INCREMENT column as Primary Key (for MySQL), or its alternatives in other DBMS. When disabled, use client-generated IDs [on]
+    --bulk_load[=on|off]          Load data on prepare with LOAD DATA LOCAL INFILE (MySQL) or COPY (PostgreSQL) rather than multi-row INSERTs, if allowed by the server [on]
     --create_secondary[=on|off]   Create a secondary index in addition to the PRIMARY KEY [on]
     --create_table_options=STRING Extra CREATE TABLE options []
     --delete_inserts=N            Number of DELETE/INSERT combinations per transaction [1]
@@ -16,10 +17,14 @@ OLTP usage information test
     --non_index_updates=N         Number of UPDATE non-index queries per transaction [1]
     --order_ranges=N              Number of SELECT ORDER BY queries per transaction [1]
     --pgsql_variant=STRING        Use this PostgreSQL variant when running with the PostgreSQL driver. The only currently supported variant is 'redshift'. When enabled, create_secondary is automatically disabled, and delete_inserts is set to 0
+    --pipeline[=on|off]           Send all queries of a transaction to the server at once and only then wait for their results, if supported by the driver (currently PostgreSQL only). Has no effect with --skip_trx [off]
     --point_selects=N             Number of point SELECT queries per transaction [10]
+    --point_selects_batch=STRING  Send point SELECT queries of a transaction in one round trip: 'in' merges them into a single SELECT ... WHERE id IN (...) query, 'multi' sends them in a multi-statement query along with other batched queries (MySQL only), 'none' executes them one by one [none]
     --range_selects[=on|off]      Enable/disable all range SELECT queries [on]
+    --range_selects_batch=STRING  Send range SELECT queries of a transaction in one round trip: 'multi' sends them in a multi-statement query along with other batched queries (MySQL only), 'none' executes them one by one [none]
     --range_size=N                Range size for range SELECT queries [100]
     --reconnect=N                 Reconnect after every N events. The default (0) is to not reconnect [0]
+    --rw_split[=on|off]           Execute SELECT queries on a separate connection to a read-only server and all other queries on a connection to a writable one, if the driver balances connections over multiple servers (currently MySQL only). SELECT queries are then executed outside of transactions. Cannot be used with --pipeline [off]
     --secondary[=on|off]          Use a secondary index in place of the PRIMARY KEY [off]
     --simple_ranges=N             Number of simple range SELECT queries per transaction [1]
     --skip_trx[=on|off]           Don't start explicit transactions and execute all queries in the AUTOCOMMIT mode [off]
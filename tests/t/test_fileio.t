@@ -62,6 +62,10 @@ fileio benchmark tests
            write: IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
            fsync: IOPS=*.* (glob)
   
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
   Latency (ms):
            min:                              *.* (glob)
            avg:                              *.* (glob)
@@ -97,6 +101,10 @@ fileio benchmark tests
            write: IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
            fsync: IOPS=*.* (glob)
   
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
   Latency (ms):
            min:                              *.* (glob)
            avg:                              *.* (glob)
@@ -131,6 +139,10 @@ fileio benchmark tests
            write: IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
            fsync: IOPS=*.* (glob)
   
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
   Latency (ms):
            min:                              *.* (glob)
            avg:                              *.* (glob)
@@ -167,6 +179,10 @@ fileio benchmark tests
            write: IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
            fsync: IOPS=*.* (glob)
   
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
   Latency (ms):
            min:                              *.* (glob)
            avg:                              *.* (glob)
@@ -189,6 +205,15 @@ fileio benchmark tests
   Removing test files...
   $ ls
 
+Blocks used by a thread are not read or written by other threads in random
+--validate runs
+
+  $ args="fileio --file-num=1 --file-total-size=96K --file-block-size=4K --file-fsync-freq=0 --validate --verbosity=2"
+  $ sysbench $args prepare
+  $ sysbench $args --file-test-mode=rndrw --threads=16 --events=20000 run
+  $ sysbench $args cleanup
+  $ unset args
+
   $ sysbench $fileio_args --file-test-mode=rndrw --verbosity=2 run
   FATAL: Cannot open file 'test_file.0' errno = 2 (No such file or directory)
   WARNING: Did you forget to run the prepare step?
@@ -319,6 +344,10 @@ GH-229: "--file-fsync-freq=0" seems to prevent fsync() at end of test
            write: IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
            fsync: IOPS=[^0].* (re)
   
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
   Latency (ms):
            min:                              *.* (glob)
            avg:                              *.* (glob)
@@ -350,6 +379,10 @@ GH-229: "--file-fsync-freq=0" seems to prevent fsync() at end of test
            write: IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
            fsync: IOPS=0.00
   
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
   Latency (ms):
            min:                              *.* (glob)
            avg:                              *.* (glob)
@@ -357,3 +390,98 @@ GH-229: "--file-fsync-freq=0" seems to prevent fsync() at end of test
            95th percentile:         *.* (glob)
            sum: *.* (glob)
   
+
+########################################################################
+Weighted block size distributions
+########################################################################
+  $ args="fileio --file-total-size=4M --file-num=2 --events=500"
+  $ sysbench $args --verbosity=2 prepare
+  $ sysbench $args --file-test-mode=rndrw --file-block-size=4K:70,16K:20,128K:10 run |
+  >   sed -n -e '/^Block sizes/p' -e '/by block size/,/^$/p'
+  Block sizes 4KiB (70%), 16KiB (20%), 128KiB (10%)
+  Throughput by block size:
+           4KiB:   IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
+           16KiB:  IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
+           128KiB: IOPS=*.* *.* MiB/s (*.* MB/s) (glob)
+  
+  Latency by block size (ms):
+      4KiB:
+           avg:                              *.* (glob)
+           95th percentile:         *.* (glob)
+      16KiB:
+           avg:                              *.* (glob)
+           95th percentile:         *.* (glob)
+      128KiB:
+           avg:                              *.* (glob)
+           95th percentile:         *.* (glob)
+  
+  $ sysbench $args --file-test-mode=seqrd --file-block-size=4K,64K --threads=2 run |
+  >   grep -A2 "by block size:"
+  Throughput by block size:
+           4KiB:   IOPS=[^0].* (re)
+           64KiB:  IOPS=[^0].* (re)
+  $ sysbench $args --file-test-mode=rndrd --file-block-size=4K --file-block-align=1K run |
+  >   grep -E "^(Block|Aligning)"
+  Block size 4KiB
+  Aligning random requests to 1KiB
+  $ sysbench $args --file-test-mode=rndrd --file-block-size=4K:0 run
+  sysbench * (glob)
+  
+  FATAL: Invalid weight for file-block-size: 4K:0
+  [1]
+  $ sysbench $args --file-test-mode=rndrd --file-block-size=4K:1,16K:1 --validate run
+  sysbench * (glob)
+  
+  FATAL: --validate requires a single file-block-size and file-block-align to be a multiple of it
+  [1]
+  $ sysbench $args cleanup >/dev/null
+  $ unset args
+
+########################################################################
+Skewed random offsets and hot sets
+########################################################################
+  $ args="fileio --file-total-size=4M --file-num=2 --events=500"
+  $ sysbench $args --verbosity=2 prepare
+  $ sysbench $args --file-test-mode=rndrd --rand-type=pareto run |
+  >   sed -n -e '/distribution/p' -e '/^Random access/,/^$/p'
+  Using pareto distribution for random offsets
+  Random access pattern:
+           re-access ratio (%):                 *.* (glob)
+           working set since start (MiB):       *.* (glob)
+  
+  $ sysbench $args --file-test-mode=rndrw --file-hot-fraction=0.01 --file-hot-probability=1 run |
+  >   sed -n -e '/^Hot set/p' -e '/^Random access/,/^$/p'
+  Hot set 40.96KiB, accessed by 100% of requests
+  Random access pattern:
+           hot set requests (%):               100.00
+           re-access ratio (%):                 *.* (glob)
+           working set since start (MiB):        0.03
+  
+  $ sysbench $args --file-test-mode=rndrd run | grep -c "Random access"
+  0
+  [1]
+  $ sysbench $args --file-test-mode=rndrd --file-hot-fraction=1 run
+  sysbench * (glob)
+  
+  FATAL: Invalid value for --file-hot-fraction: 1.000000.
+  [1]
+  $ sysbench $args --file-test-mode=rndrd --file-hot-probability=2 run
+  sysbench * (glob)
+  
+  FATAL: Invalid value for --file-hot-probability: 2.000000.
+  [1]
+
+Data accessed during warmup counts as accessed before and is a part of the
+working set, but requests made during warmup are not counted
+
+  $ sysbench fileio --file-total-size=4M --file-num=2 --file-test-mode=rndrd \
+  >   --file-hot-fraction=0.01 --file-hot-probability=1 --warmup-time=1 \
+  >   --time=1 run | sed -n -e '/^Random access/,/^$/p'
+  Random access pattern:
+           hot set requests (%):               100.00
+           re-access ratio (%):                100.00
+           working set since start (MiB):        0.03
+  
+
+  $ sysbench $args cleanup >/dev/null
+  $ unset args
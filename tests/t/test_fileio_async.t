@@ -0,0 +1,64 @@
+########################################################################
+fileio async mode tests
+########################################################################
+
+Skip test if asynchronous I/O is not supported by the build.
+
+  $ fileio_args="fileio --file-num=4 --file-total-size=8M --file-io-mode=async"
+
+  $ if ! sysbench fileio help | grep -q -- --file-async-batch
+  > then
+  >   exit 80
+  > fi
+
+  $ sysbench $fileio_args --verbosity=2 prepare
+
+Requests queued in a batch are submitted before a periodic fsync() and are all
+completed by the end of the test. 150 events are 146 writes and 4 fsyncs with
+the default --file-fsync-freq
+
+  $ args="$fileio_args --file-async-backlog=16 --file-async-batch=7"
+  $ sysbench $args --events=100 --file-test-mode=rndrd run |
+  >   grep -E "(I/O mode|I/O backlog|IOPS)"
+  Using asynchronous I/O mode
+  Asynchronous I/O backlog 16, submitting in batches of 7
+           read:  IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
+           write: IOPS=0.00 0.00 MiB/s (0.00 MB/s)
+           fsync: IOPS=0.00
+  $ sysbench $args --events=150 --file-test-mode=seqwr --verbosity=2 run
+  $ for i in $(seq 0 3)
+  > do
+  >   echo -n "test_file.$i: "
+  >   echo $(wc -c < test_file.$i)
+  > done
+  test_file.0: 2097152
+  test_file.1: 294912
+  test_file.2: 0
+  test_file.3: 0
+  $ sysbench $args --events=150 --file-test-mode=rndwr run |
+  >   grep -E "(write|fsync):"
+           write: IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
+           fsync: IOPS=[^0].* (re)
+  $ unset args
+
+Blocks written in batches are validated when read back
+
+  $ args="$fileio_args --file-async-backlog=16 --file-async-batch=7 --file-fsync-freq=0 --validate --verbosity=2"
+  $ sysbench $args --events=512 --file-test-mode=seqwr run
+  $ sysbench $args --events=512 --file-test-mode=seqrd run
+  $ sysbench $args --events=500 --file-test-mode=rndrw run
+  $ sysbench $args --events=512 --file-test-mode=seqrd run
+  $ unset args
+
+  $ sysbench $fileio_args --file-async-batch=0 --file-test-mode=rndrd run
+  sysbench *.* * (glob)
+  
+  FATAL: Invalid value of file-async-batch: 0, must be between 1 and file-async-backlog
+  [1]
+  $ sysbench $fileio_args --file-async-backlog=4 --file-async-batch=5 --file-test-mode=rndrd run
+  sysbench *.* * (glob)
+  
+  FATAL: Invalid value of file-async-batch: 5, must be between 1 and file-async-backlog
+  [1]
+
+  $ sysbench $fileio_args --verbosity=2 cleanup
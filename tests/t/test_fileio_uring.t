@@ -0,0 +1,119 @@
+########################################################################
+fileio io_uring mode tests
+########################################################################
+
+Skip test if io_uring is not supported by the build or by the kernel.
+
+  $ fileio_args="fileio --file-num=4 --file-total-size=8M --file-io-mode=uring"
+
+  $ if ! sysbench fileio help | grep -q -- --file-uring-depth
+  > then
+  >   exit 80
+  > fi
+
+  $ sysbench $fileio_args --verbosity=2 prepare
+  $ if sysbench $fileio_args --file-test-mode=rndrd --events=1 run 2>&1 |
+  >   grep -q "io_uring_setup() failed"
+  > then
+  >   exit 80
+  > fi
+
+  $ sysbench $fileio_args --events=150 --file-test-mode=rndrw run
+  sysbench *.* * (glob)
+  
+  Running the test with following options:
+  Number of threads: 1
+  Initializing random number generator from current time
+  
+  
+  Extra file open flags: (none)
+  4 files, 2MiB each
+  8MiB total file size
+  Block size 16KiB
+  Number of IO requests: 150
+  Read/Write ratio for combined random IO test: 1.50
+  Periodic FSYNC enabled, calling fsync() each 100 requests.
+  Calling fsync() at the end of test, Enabled.
+  Using io_uring I/O mode
+  io_uring queue depth 128, submitting in batches of 1
+  Doing random r/w test
+  Initializing worker threads...
+  
+  Threads started!
+  
+  
+  Throughput:
+           read:  IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
+           write: IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
+           fsync: IOPS=[^0].* (re)
+  
+  CPU time per I/O (us):
+           user:                              *.* (glob)
+           system:                            *.* (glob)
+  
+  Latency (ms):
+           min:                              *.* (glob)
+           avg:                              *.* (glob)
+           max:                              *.* (glob)
+           95th percentile:         *.* (glob)
+           sum: *.* (glob)
+  
+
+Requests queued in a batch are all completed by the end of the test. 150
+events are 146 writes and 4 fsyncs with the default --file-fsync-freq
+
+  $ args="$fileio_args --file-uring-depth=16 --file-uring-batch=7"
+  $ sysbench $args --events=100 --file-test-mode=rndrd run |
+  >   grep -E "(io_uring|IOPS)"
+  Using io_uring I/O mode
+  io_uring queue depth 16, submitting in batches of 7
+           read:  IOPS=[^0].* [^0].* MiB/s \([^0].* MB/s\) (re)
+           write: IOPS=0.00 0.00 MiB/s (0.00 MB/s)
+           fsync: IOPS=0.00
+  $ sysbench $args --events=150 --file-test-mode=seqwr --verbosity=2 run
+  $ for i in $(seq 0 3)
+  > do
+  >   echo -n "test_file.$i: "
+  >   echo $(wc -c < test_file.$i)
+  > done
+  test_file.0: 2097152
+  test_file.1: 294912
+  test_file.2: 0
+  test_file.3: 0
+  $ unset args
+
+Blocks are validated only after the read has completed, and the buffer is not
+refilled while a write is in flight
+
+  $ args="$fileio_args --file-uring-depth=16 --file-uring-batch=7 --file-fsync-freq=0 --validate --verbosity=2"
+  $ sysbench $args --events=512 --file-test-mode=seqwr run
+  $ sysbench $args --events=512 --file-test-mode=seqrd run
+  $ sysbench $args --events=500 --file-test-mode=rndrw run
+  $ sysbench $args --events=512 --file-test-mode=seqrd run
+  $ unset args
+
+Per-block size statistics are accounted on request completion, so they cover
+all completed reads and writes
+
+  $ args="$fileio_args --file-uring-depth=16 --file-uring-batch=4 --events=500"
+  $ sysbench $args --file-test-mode=rndrw --file-block-size=4K:70,16K:20,128K:10 run |
+  >   sed -n -e '/^Throughput:/,/^$/p' -e '/by block size:/,/^$/p' |
+  >   awk -F'[= ]+' '/(read|write):/ { total += $4 }
+  >                  /KiB:/ { blocks += $4 }
+  >                  END { print (blocks > 0 && blocks > total * 0.99 &&
+  >                               blocks < total * 1.01) ? "ok" : blocks " " total }'
+  ok
+  $ unset args
+
+  $ sysbench $fileio_args --file-uring-batch=0 --file-test-mode=rndrd run
+  sysbench *.* * (glob)
+  
+  FATAL: Invalid value of file-uring-batch: 0, must be between 1 and file-uring-depth
+  [1]
+  $ sysbench $fileio_args --file-uring-iopoll --file-test-mode=rndrd run
+  sysbench *.* * (glob)
+  
+  FATAL: --file-uring-iopoll requires --file-extra-flags=direct
+  [1]
+
+  $ sysbench $fileio_args --verbosity=2 cleanup